@@ -19,10 +19,22 @@
 
 #include <string>
 #include <sstream>
+#include <stdexcept>
 #include <vector>
 #include <optional>
 
 namespace ArcGraphics {
+
+/**
+ * @brief Thrown when device memory could not be allocated, after the partially
+ * created resource has been destroyed again.
+ * Callers can free memory, e.g. with TextureResidency, and retry.
+ */
+class OutOfDeviceMemory : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
     
 /**
  * @brief A collection of validation layers.
@@ -58,6 +70,7 @@ struct PhysicalDevicePropertyFeatureSet {
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphics; /// graphics index
     std::optional<uint32_t> present;  /// presentation index
+    std::optional<uint32_t> compute;  /// compute index, a dedicated family when there is one
 
     /**
     * @brief Predicate for if all the required indices found.
@@ -76,9 +89,13 @@ struct QueueFamilyIndices {
         else
             ss << "[Graphics: 'nil', ";
         if (present)
-            ss << "Present: " << *present << "]";
+            ss << "Present: " << *present << ", ";
         else
-            ss << "Present: 'nil']";
+            ss << "Present: 'nil', ";
+        if (compute)
+            ss << "Compute: " << *compute << "]";
+        else
+            ss << "Compute: 'nil']";
         return ss.str();
     }
 };
@@ -203,6 +220,51 @@ get_physical_device_memory_properties(const VkPhysicalDevice device);
 uint32_t find_memory_type(const VkPhysicalDeviceMemoryProperties mem_properties,
                           const uint32_t type_filter,
                           const VkMemoryPropertyFlags property_flags);
+
+/**
+ * @brief Budget and usage of a memory heap, in bytes.
+ */
+struct MemoryHeapBudget {
+    VkDeviceSize budget;
+    VkDeviceSize usage;
+    bool device_local;
+    /** @brief Whether the numbers come from VK_EXT_memory_budget, or usage is unknown. */
+    bool measured;
+};
+
+/**
+ * @brief Optional features for submitting many draws with few calls.
+ * @see ArcGraphics::DrawSubmitter
+ */
+struct DrawSubmissionFeatures {
+    /** @brief vkCmdDrawIndexedIndirect accepts a drawCount above 1. */
+    bool multi_draw_indirect{false};
+    /** @brief Indirect commands may have a firstInstance other than 0. */
+    bool draw_indirect_first_instance{false};
+    uint32_t max_draw_indirect_count{1};
+    /** @brief VK_KHR_draw_indirect_count is supported, reading the draw count from a buffer. */
+    bool draw_indirect_count{false};
+    /** @brief VK_EXT_multi_draw is supported, drawing a list of index ranges with one call. */
+    bool multi_draw{false};
+    uint32_t max_multi_draw_count{0};
+};
+
+/**
+ * @brief Check whether an instance extension is available.
+ */
+[[nodiscard]]
+bool is_instance_extension_available(const char* extension);
+
+/**
+ * @brief Get the budget and usage of every memory heap of device.
+ * Without VK_EXT_memory_budget the budget is the heap size and usage is 0.
+ * @param memory_budget whether VK_EXT_memory_budget was enabled on the logical device,
+ * which requires VK_KHR_get_physical_device_properties2 on instance.
+ */
+[[nodiscard]]
+std::vector<MemoryHeapBudget> get_memory_heap_budgets(const VkInstance instance,
+                                                      const VkPhysicalDevice device,
+                                                      const bool memory_budget);
  
 /**
  * @brief Get collection of physical device features.
@@ -232,6 +294,15 @@ find_graphics_present_indices(const std::vector<VkQueueFamilyProperties> familie
                               const VkPhysicalDevice& device,
                               const VkSurfaceKHR& surface);
 
+/**
+ * @brief Find the queue family for compute work.
+ * A family with compute but without graphics runs asynchronously to rendering,
+ * so it is preferred over a family that does both.
+ */
+[[nodiscard]]
+std::optional<uint32_t>
+find_compute_index(const std::vector<VkQueueFamilyProperties>& families);
+
 /**
  * @brief Get physical device extensions.
  */
@@ -301,9 +372,59 @@ std::vector<ScoredDevice> sort_devices_by_score(const std::vector<VkPhysicalDevi
 std::vector<ScoredDevice>
 remove_zero_score_devices(const std::vector<ScoredDevice>& score_devices);
     
+/**
+ * @brief The identity of a previously selected physical device.
+ * Stored on disk so later launches can skip scoring every device.
+ * @see ArcGraphics::Device::Builder::with_device_cache
+ */
+struct CachedDeviceSelection {
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint32_t driver_version;
+    std::string pipeline_cache_uuid; /// hex encoded, changes with driver/hardware
+    uint32_t graphics_index;         /// graphics queue family index
+    uint32_t present_index;          /// presentation queue family index
+};
+
+/**
+ * @brief Read a device selection cache.
+ * @return nullopt if the file does not exist or is malformed.
+ */
+[[nodiscard]]
+std::optional<CachedDeviceSelection> read_device_selection_cache(const std::string& path);
+
+/**
+ * @brief Write the device selection cache for a chosen physical device.
+ * @note Failing to write the cache is not an error, it only costs the next launch time.
+ */
+void write_device_selection_cache(const std::string& path,
+                                  const VkPhysicalDevice device,
+                                  const QueueFamilyIndices& indices);
+
+/**
+ * @brief Find the cached physical device among the available ones.
+ * Only the device identity and the cached queue families are verified,
+ * which is much cheaper than scoring every device.
+ * @return nullopt if the cached device is no longer present or usable.
+ */
+[[nodiscard]]
+std::optional<VkPhysicalDevice>
+find_cached_physical_device(const VkInstance instance,
+                            const VkSurfaceKHR window_surface,
+                            const CachedDeviceSelection& cache);
+    
 [[nodiscard]]
 VkExtent2D get_window_size(const VkDevice logical_device, SDL_Window* window);
     
+
+/**
+ * @brief Get the first of the candidate formats that supports features with tiling.
+ */
+[[nodiscard]]
+std::optional<VkFormat> find_supported_texture_format(const VkPhysicalDevice& physical_device,
+                                                      const std::vector<VkFormat>& candidates,
+                                                      const VkImageTiling tiling,
+                                                      const VkFormatFeatureFlags features);
     
 void create_image(const VkPhysicalDevice physical_device,
                   const VkDevice logical_device,
@@ -314,13 +435,19 @@ void create_image(const VkPhysicalDevice physical_device,
                   const VkImageUsageFlags usage,
                   const VkMemoryPropertyFlags properties,
                   VkImage& image,
-                  VkDeviceMemory& memory);
+                  VkDeviceMemory& memory,
+                  const uint32_t mip_levels = 1,
+                  const uint32_t array_layers = 1);
 
 [[nodiscard]]
 std::optional<VkImageView> create_image_view(const VkDevice& device,
                                              const VkImage image,
                                              const VkFormat format,
-                                             const VkImageAspectFlags aspect);
+                                             const VkImageAspectFlags aspect,
+                                             const uint32_t mip_levels = 1,
+                                             const uint32_t array_layers = 1,
+                                             const VkImageViewType view_type = VK_IMAGE_VIEW_TYPE_2D,
+                                             const VkComponentMapping& components = {});
 
 [[nodiscard]]
 std::vector<VkImage> get_swap_chain_images(const VkDevice& device,
@@ -348,10 +475,46 @@ VkPhysicalDevice get_best_physical_device(const VkInstance instance,
                                           const VkSurfaceKHR window_surface,
                                           const DeviceExtensions extensions);
 
+/**
+ * @brief Get the draw submission features supported by device.
+ * VK_EXT_multi_draw is only reported when VK_KHR_get_physical_device_properties2
+ * is available on instance, as its features can not be queried otherwise.
+ */
+[[nodiscard]]
+DrawSubmissionFeatures get_draw_submission_features(const VkInstance instance,
+                                                    const VkPhysicalDevice device);
+
+/**
+ * @brief Check whether device supports VK_KHR_synchronization2 and its feature.
+ * Like VK_EXT_multi_draw, this needs VK_KHR_get_physical_device_properties2 on instance.
+ */
+[[nodiscard]]
+bool is_synchronization2_supported(const VkInstance instance,
+                                   const VkPhysicalDevice device);
+
+/**
+ * @brief Check whether device supports VK_KHR_timeline_semaphore and its feature.
+ * @see ArcGraphics::GpuTimeline
+ */
+[[nodiscard]]
+bool is_timeline_semaphore_supported(const VkInstance instance,
+                                     const VkPhysicalDevice device);
+
+/**
+ * @param draw_features optional draw features to enable, the VK_EXT_multi_draw
+ * extension itself must be in extensions when multi_draw is set.
+ * @param synchronization2 enable the synchronization2 feature, the extension
+ * must be in extensions.
+ * @param timeline_semaphore enable the timeline semaphore feature, the extension
+ * must be in extensions.
+ */
 [[nodiscard]]
 VkDevice get_logical_device(const VkPhysicalDevice physical_device,
                             const VkSurfaceKHR window_surface,
-                            const DeviceExtensions extensions);
+                            const DeviceExtensions extensions,
+                            const DrawSubmissionFeatures& draw_features = {},
+                            const bool synchronization2 = false,
+                            const bool timeline_semaphore = false);
 
 
 [[nodiscard]]
@@ -0,0 +1,283 @@
+#pragma once
+/** *******************************************************************
+ * @file AssetArchive.hpp
+ * @brief Single file asset archives, memory mapped and read without parsing.
+ *
+ * An archive is a header, a table of contents sorted by name hash, a table of
+ * texture levels, the asset names and the asset data, all little endian:
+ *
+ *   ArchiveHeader | ArchiveEntry[] | ArchiveLevel[] | names | aligned blobs
+ *
+ * Blobs are stored in the layout they are uploaded in. Shaders are SPIR-V words,
+ * buffers are tightly packed elements and textures are their mip levels packed
+ * the way buffer to image copies expect, so loading an asset is a lookup in the
+ * mapping followed by a copy into staging memory.
+ *
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "BasicBuffer.hpp"
+#include "CompressedImage.hpp"
+#include "MappedFile.hpp"
+#include "RenderPipeline.hpp"
+#include "StagingBuffer.hpp"
+#include "Texture.hpp"
+#include "TypeTraits.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace ArcGraphics {
+
+enum class AssetType : uint32_t {
+    shader = 1,
+    vertices = 2,
+    indices = 3,
+    texture = 4,
+    blob = 5,
+};
+
+struct ArchiveHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_count;
+    uint64_t entries_offset;
+    uint64_t levels_offset;
+    uint32_t level_count;
+    uint32_t names_size;
+    uint64_t names_offset;
+    uint64_t file_size;
+};
+static_assert(sizeof(ArchiveHeader) == 56);
+
+/**
+ * @brief An asset in the table of contents.
+ */
+struct ArchiveEntry {
+    uint64_t name_hash;
+    uint32_t name_offset;
+    uint32_t name_size;
+    AssetType type;
+    /** @brief VkFormat of textures, 0 otherwise. */
+    uint32_t format;
+    /** @brief Size of one element of vertex and index buffers, 0 otherwise. */
+    uint32_t stride;
+    uint32_t width;
+    uint32_t height;
+    /** @brief Index of the first level of a texture in the level table. */
+    uint32_t first_level;
+    uint32_t level_count;
+    uint32_t reserved;
+    uint64_t data_offset;
+    uint64_t data_size;
+};
+static_assert(sizeof(ArchiveEntry) == 64);
+
+/**
+ * @brief A texture mip level, at an offset from the start of the file.
+ */
+struct ArchiveLevel {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+static_assert(sizeof(ArchiveLevel) == 24);
+
+/**
+ * @brief Hash an asset name with 64 bit FNV-1a, which is how the table of contents is sorted.
+ */
+[[nodiscard]]
+uint64_t hash_asset_name(const std::string_view name);
+
+/**
+ * @brief A memory mapped archive, whose assets are pointers into the mapping.
+ */
+class AssetArchive : public IsNotLvalueCopyable
+{
+public:
+    /**
+     * @brief Map an archive and check that its tables lie within the file.
+     * The levels of texture entries must be their mip chain, packed in order within
+     * the data of the entry.
+     * @return nullptr if the file could not be mapped or is not a valid archive.
+     */
+    [[nodiscard]]
+    static std::unique_ptr<AssetArchive> open(const std::string& path);
+
+    /**
+     * @brief Find an asset by binary search on the hash of its name.
+     * @return nullptr if the archive has no asset of that name.
+     */
+    [[nodiscard]]
+    const ArchiveEntry* find(const std::string_view name) const;
+
+    [[nodiscard]]
+    const unsigned char* data(const ArchiveEntry& entry) const;
+
+    [[nodiscard]]
+    std::string_view name(const ArchiveEntry& entry) const;
+
+    /**
+     * @brief Get the level_count levels of a texture entry.
+     */
+    [[nodiscard]]
+    const ArchiveLevel* levels(const ArchiveEntry& entry) const;
+
+    /**
+     * @brief Copy the SPIR-V of a shader out of the archive.
+     * @throw std::runtime_error if there is no shader of that name.
+     */
+    [[nodiscard]]
+    ShaderBytecode shader_bytecode(const std::string_view name) const;
+
+    [[nodiscard]]
+    const ArchiveEntry* entries() const;
+
+    [[nodiscard]]
+    size_t entry_count() const;
+
+private:
+    explicit AssetArchive(std::unique_ptr<MappedFile> file);
+
+    std::unique_ptr<MappedFile> m_file;
+    const ArchiveHeader* m_header;
+};
+
+/**
+ * @brief Collects assets and writes them as an archive, used by the bake tools.
+ */
+class ArchiveWriter
+{
+public:
+    /**
+     * @throw std::invalid_argument for this and the other add functions if the name,
+     * or its hash, is already in the archive.
+     */
+    void add_shader(const std::string& name, const ShaderBytecode& bytecode);
+
+    /**
+     * @param type is AssetType::vertices or AssetType::indices.
+     * @param stride the size of one element, which size must be a multiple of.
+     */
+    void add_buffer(const std::string& name,
+                    const AssetType type,
+                    const void* data,
+                    const size_t size,
+                    const uint32_t stride);
+
+    /**
+     * @param levels of the texture starting with level 0, at offsets into data.
+     * @throw std::invalid_argument if the levels are not the mip chain of a block
+     * compressed format.
+     */
+    void add_texture(const std::string& name,
+                     const VkFormat format,
+                     const uint32_t width,
+                     const uint32_t height,
+                     const std::vector<CompressedLevel>& levels,
+                     const unsigned char* data);
+
+    void add_blob(const std::string& name, const void* data, const size_t size);
+
+    /**
+     * @return false if the file could not be written.
+     */
+    bool write(const std::string& path) const;
+
+private:
+    struct Asset {
+        std::string name;
+        ArchiveEntry entry;
+        std::vector<unsigned char> data;
+        /** @brief Level offsets are relative to the start of data. */
+        std::vector<ArchiveLevel> levels;
+    };
+
+    void add(Asset asset);
+
+    std::vector<Asset> m_assets{};
+    std::unordered_set<uint64_t> m_hashes{};
+};
+
+/**
+ * @brief Upload a texture entry, whose levels are copied from the mapping into staging.
+ * @return nullptr if the entry is not a texture or its format can not be sampled.
+ */
+[[nodiscard]]
+std::unique_ptr<Texture> upload_archive_texture(const VkPhysicalDevice& physical_device,
+                                                const VkDevice& logical_device,
+                                                const VkCommandPool& command_pool,
+                                                const VkQueue& graphics_queue,
+                                                StagingBuffer& staging,
+                                                const AssetArchive& archive,
+                                                const ArchiveEntry& entry,
+                                                SamplerCache* samplers = nullptr);
+
+/**
+ * @brief Upload a vertex or index entry into a device local buffer.
+ * @throw std::invalid_argument if the stride of the entry differs from the buffer elements.
+ */
+template <BasicBufferPolicy Policy>
+[[nodiscard]]
+std::unique_ptr<BasicBuffer<Policy>> upload_archive_buffer(const VkPhysicalDevice& physical_device,
+                                                           const VkDevice& logical_device,
+                                                           const VkCommandPool& command_pool,
+                                                           const VkQueue& graphics_queue,
+                                                           StagingBuffer& staging,
+                                                           const AssetArchive& archive,
+                                                           const ArchiveEntry& entry)
+{
+    using value_type = typename Policy::value_type;
+    if (entry.stride != sizeof(value_type) || entry.data_size % sizeof(value_type) != 0)
+        throw std::invalid_argument("Archive buffer does not match the buffer element type!");
+
+    // Written archives start every blob on a cache line, the bounds are skipped for others.
+    const auto data = archive.data(entry);
+    const bool aligned = reinterpret_cast<uintptr_t>(data) % alignof(value_type) == 0;
+    auto buffer = BasicBuffer<Policy>::create_transfer_destination(
+        physical_device,
+        logical_device,
+        static_cast<size_t>(entry.data_size / sizeof(value_type)),
+        aligned ? reinterpret_cast<const value_type*>(data) : nullptr);
+
+    // Buffers larger than the shared staging buffer get a buffer of their own.
+    std::optional<StagingBuffer> temporary{};
+    auto region = staging.allocate(entry.data_size);
+    if (!region) {
+        temporary.emplace(physical_device, logical_device, entry.data_size);
+        region = temporary->allocate(entry.data_size);
+    }
+    memcpy(region->data, archive.data(entry), static_cast<size_t>(entry.data_size));
+
+    const VkBuffer source = temporary ? temporary->buffer() : staging.buffer();
+    const auto record_copy = [&](VkCommandBuffer& command_buffer) {
+        VkBufferCopy copy{};
+        copy.srcOffset = region->offset;
+        copy.dstOffset = 0;
+        copy.size = entry.data_size;
+        vkCmdCopyBuffer(command_buffer, source, buffer->get_buffer(), 1, &copy);
+    };
+    with_single_use_command_buffer(logical_device,
+                                   command_pool,
+                                   graphics_queue,
+                                   record_copy);
+
+    if (temporary)
+        temporary->destroy(logical_device);
+    else
+        staging.release(*region);
+    return buffer;
+}
+
+}
@@ -0,0 +1,123 @@
+#pragma once
+/** *******************************************************************
+ * @file AssetLoader.hpp
+ * @brief Parallel loading of startup assets followed by a single batched upload.
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "ThreadPool.hpp"
+#include "RenderPipeline.hpp"
+#include "SimpleGeometry.hpp"
+#include "Texture.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ArcGraphics {
+
+/**
+ * @brief Vertices and indices produced by a geometry generator.
+ */
+struct LoadedGeometry {
+    VertexBuffer_PosTex::vector_type vertices;
+    IndexBuffer::vector_type indices;
+};
+
+/**
+ * @brief CPU side results of BatchLoader::load, keyed by asset name.
+ */
+struct LoadedAssets {
+    std::unordered_map<std::string, std::unique_ptr<Image>> images{};
+    std::unordered_map<std::string, ShaderBytecode> shaders{};
+    std::unordered_map<std::string, LoadedGeometry> geometry{};
+    /** @brief Names of the assets that could not be loaded. */
+    std::vector<std::string> failed{};
+};
+
+/**
+ * @brief Called on the thread calling BatchLoader::load each time an asset finishes.
+ */
+using LoadProgressCallback = std::function<void(const size_t done,
+                                                const size_t total,
+                                                const std::string& name)>;
+
+/**
+ * @brief Collects image, shader and geometry requests and loads them on a thread pool.
+ */
+class BatchLoader
+{
+public:
+    explicit BatchLoader(ThreadPool& pool);
+
+    BatchLoader& add_image(const std::string& name, const std::string& path);
+    BatchLoader& add_shader(const std::string& name, const std::string& path);
+    BatchLoader& add_geometry(const std::string& name,
+                              std::function<LoadedGeometry()> generator);
+
+    /**
+     * @brief Load all queued assets, blocking until every asset is done.
+     * Assets that fail to load are listed in LoadedAssets::failed instead of throwing.
+     */
+    [[nodiscard]]
+    LoadedAssets load(const LoadProgressCallback& progress = {});
+
+private:
+    enum class AssetKind { image, shader, geometry };
+
+    struct Request {
+        AssetKind kind;
+        std::string name;
+        std::string path;
+        std::function<LoadedGeometry()> generator;
+    };
+
+    ThreadPool& m_pool;
+    std::vector<Request> m_requests{};
+};
+
+/**
+ * @brief Vertex and index buffers of uploaded geometry.
+ */
+struct UploadedGeometry {
+    std::unique_ptr<VertexBuffer_PosTex> vertices;
+    std::unique_ptr<IndexBuffer> indices;
+};
+
+/**
+ * @brief GPU side results of upload_assets, keyed by asset name.
+ */
+struct UploadedAssets {
+    std::unordered_map<std::string, std::unique_ptr<Texture>> textures{};
+    std::unordered_map<std::string, UploadedGeometry> geometry{};
+
+    /**
+     * @brief Destroy the textures, the buffers free themselves.
+     */
+    void destroy(const VkDevice logical_device);
+};
+
+/**
+ * @brief Upload all images and geometry through one staging buffer and one command buffer.
+ * @param logical_device must outlive the created buffers.
+ * Each texture gets the smallest format that holds the channels of its image.
+ * @param generate_mipmaps gives every texture a full mip chain, see Texture::create_staging.
+ * @param samplers shares one sampler between the textures, each owns its own without it.
+ * @throw std::runtime_error if any of the resources could not be created.
+ */
+[[nodiscard]]
+UploadedAssets upload_assets(const VkPhysicalDevice& physical_device,
+                             const VkDevice& logical_device,
+                             const VkCommandPool& command_pool,
+                             const VkQueue& graphics_queue,
+                             const LoadedAssets& assets,
+                             const bool srgb = true,
+                             const bool generate_mipmaps = true,
+                             SamplerCache* samplers = nullptr);
+
+}
@@ -4,8 +4,10 @@
 
 #include "TypeTraits.hpp"
 #include "Algorithm.hpp"
+#include "Bounds.hpp"
 
 #include <memory>
+#include <optional>
 #include <vector>
 #include <array>
 #include <functional>
@@ -15,6 +17,11 @@ namespace ArcGraphics {
 
   
 
+/**
+ * @param queue_families the families that access the buffer, it is shared
+ * concurrently when they differ and owned by a single family otherwise.
+ * @see ArcGraphics::ComputePipeline::sharing_queue_families
+ */
 void create_buffer(const VkPhysicalDevice& physical_device,
                    const VkDevice& logical_device,
                    const VkDeviceSize size,
@@ -22,7 +29,8 @@ void create_buffer(const VkPhysicalDevice& physical_device,
                    const VkMemoryPropertyFlags properties,
                    VkBufferCreateInfo& out_info,
                    VkBuffer& out_buffer,
-                   VkDeviceMemory& out_memory);
+                   VkDeviceMemory& out_memory,
+                   const std::vector<uint32_t>& queue_families = {});
     
 void with_single_use_command_buffer(const VkDevice& logical_device,
                                     const VkCommandPool& command_pool,
@@ -36,7 +44,35 @@ void copy_buffer(const VkDevice& logical_device,
                  const VkBuffer& src,
                  VkBuffer& dst);
    
- void transition_image_layout(const VkDevice& logical_device,
+/**
+ * @brief Record an image layout transition barrier into a command buffer.
+ * Only the mip levels [base_mip_level, base_mip_level + level_count) of the
+ * first layer_count array layers are transitioned.
+ * @throw std::invalid_argument if the transition is not supported.
+ */
+void record_transition_image_layout(VkCommandBuffer command_buffer,
+                                    VkImage image,
+                                    VkImageLayout old_layout,
+                                    VkImageLayout new_layout,
+                                    uint32_t base_mip_level = 0,
+                                    uint32_t level_count = 1,
+                                    uint32_t layer_count = 1);
+
+/**
+ * @brief Record a copy of tightly packed pixels at offset in buffer into an image.
+ * With more than one layer, the layers follow each other in the buffer.
+ * @note The image is expected to be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL.
+ */
+void record_copy_buffer_to_image(VkCommandBuffer command_buffer,
+                                 VkBuffer buffer,
+                                 VkDeviceSize offset,
+                                 VkImage image,
+                                 uint32_t width,
+                                 uint32_t height,
+                                 uint32_t mip_level = 0,
+                                 uint32_t layer_count = 1);
+
+void transition_image_layout(const VkDevice& logical_device,
                              const VkCommandPool& command_pool,
                              const VkQueue& graphics_queue,
                              VkImage image,
@@ -89,6 +125,20 @@ public:
                                                        const VkCommandPool& command_pool,
                                                        const VkQueue& graphics_queue,
                                                        const vector_type& values);
+
+    /**
+     * @brief Create an uninitialized device local buffer for count values.
+     * The buffer can only be filled through transfers, which is used when
+     * uploads of many buffers are batched into a single command buffer.
+     * @param values the count values the buffer will be filled with, which the
+     * bounds are computed from. Without them the buffer has no bounds.
+     */
+    [[nodiscard]]
+    static std::unique_ptr<BasicBuffer> create_transfer_destination(
+        const VkPhysicalDevice& physical_device,
+        const VkDevice& logical_device,
+        const size_t count,
+        const value_type* values = nullptr);
  
     BasicBuffer() = delete;
     BasicBuffer(const VkDevice& logical_device);
@@ -102,6 +152,20 @@ public:
     [[nodiscard]]
     VkBuffer get_buffer();
 
+    /**
+     * @brief Get a sphere around the vertices, computed when the buffer is created
+     * from values of a vertex type with a position.
+     * @return std::nullopt for other buffers.
+     */
+    [[nodiscard]]
+    const std::optional<BoundingSphere>& get_bounds() const;
+
+    /**
+     * @brief Get the box around the vertices, computed alongside get_bounds().
+     */
+    [[nodiscard]]
+    const std::optional<BoundingBox>& get_bounding_box() const;
+
     ~BasicBuffer();
 
 private:
@@ -110,6 +174,8 @@ private:
     VkBuffer m_buffer;
     VkDeviceMemory m_memory;
     size_t m_count;
+    std::optional<BoundingSphere> m_bounds{};
+    std::optional<BoundingBox> m_bounding_box{};
 };
     
 template <BasicBufferPolicy Policy>
@@ -120,6 +186,10 @@ std::unique_ptr<BasicBuffer<Policy>> BasicBuffer<Policy>::create(
 {
     auto buffer = std::make_unique<BasicBuffer<Policy>>(logical_device);
     buffer->m_count = values.size();
+    if constexpr (HasVertexPosition<value_type>) {
+        buffer->m_bounds = compute_bounding_sphere(values.data(), values.size());
+        buffer->m_bounding_box = compute_bounding_box(values.data(), values.size());
+    }
     create_buffer(physical_device,
                   logical_device,
                   sizeof(values[0]) * values.size(),
@@ -165,6 +235,10 @@ BasicBuffer<Policy>::create_staging(const VkPhysicalDevice& physical_device,
 
     auto buffer = std::make_unique<BasicBuffer<Policy>>(logical_device);
     buffer->m_count = values.size();
+    if constexpr (HasVertexPosition<value_type>) {
+        buffer->m_bounds = compute_bounding_sphere(values.data(), values.size());
+        buffer->m_bounding_box = compute_bounding_box(values.data(), values.size());
+    }
     create_buffer(physical_device,
                   logical_device,
                   size,
@@ -185,6 +259,32 @@ BasicBuffer<Policy>::create_staging(const VkPhysicalDevice& physical_device,
     return buffer;
 }
     
+template <BasicBufferPolicy Policy>
+std::unique_ptr<BasicBuffer<Policy>>
+BasicBuffer<Policy>::create_transfer_destination(const VkPhysicalDevice& physical_device,
+                                                 const VkDevice& logical_device,
+                                                 const size_t count,
+                                                 const value_type* values)
+{
+    auto buffer = std::make_unique<BasicBuffer<Policy>>(logical_device);
+    buffer->m_count = count;
+    if constexpr (HasVertexPosition<value_type>) {
+        if (values) {
+            buffer->m_bounds = compute_bounding_sphere(values, count);
+            buffer->m_bounding_box = compute_bounding_box(values, count);
+        }
+    }
+    create_buffer(physical_device,
+                  logical_device,
+                  sizeof(value_type) * count,
+                  Policy::buffer_type_bit | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                  buffer->m_info,
+                  buffer->m_buffer,
+                  buffer->m_memory);
+    return buffer;
+}
+    
 template <BasicBufferPolicy Policy>
 BasicBuffer<Policy>::BasicBuffer(const VkDevice& logical_device)
     : m_logical_device(logical_device)
@@ -215,5 +315,17 @@ size_t BasicBuffer<Policy>::get_count()
 {
     return m_count;
 }
+
+template <BasicBufferPolicy Policy>
+const std::optional<BoundingSphere>& BasicBuffer<Policy>::get_bounds() const
+{
+    return m_bounds;
+}
+
+template <BasicBufferPolicy Policy>
+const std::optional<BoundingBox>& BasicBuffer<Policy>::get_bounding_box() const
+{
+    return m_bounding_box;
+}
  
 } 
@@ -0,0 +1,51 @@
+#pragma once
+/** *******************************************************************
+ * @file BlockCompression.hpp
+ * @brief CPU encoders for BC1, BC3 and BC5, meant for baking assets offline.
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "CompressedImage.hpp"
+#include "Texture.hpp"
+#include "ThreadPool.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+
+namespace ArcGraphics {
+
+/**
+ * @brief Encode a 4x4 block of RGBA8 pixels as BC1, alpha is ignored.
+ * @param dst receives 8 bytes.
+ */
+void encode_bc1_block(const unsigned char* rgba, unsigned char* dst);
+
+/**
+ * @brief Encode a 4x4 block of RGBA8 pixels as BC3.
+ * @param dst receives 16 bytes.
+ */
+void encode_bc3_block(const unsigned char* rgba, unsigned char* dst);
+
+/**
+ * @brief Encode the red and green channels of a 4x4 block of RGBA8 pixels as BC5.
+ * @param dst receives 16 bytes.
+ */
+void encode_bc5_block(const unsigned char* rgba, unsigned char* dst);
+
+/**
+ * @brief Encode an 8 bit image into a block compressed format.
+ * Images with fewer than four channels are expanded with expand_channels first.
+ * Levels 1 and up are box filtered before encoding when generate_mipmaps is set.
+ * @param pool spreads the blocks over its threads when given.
+ * @throw std::invalid_argument if the format can not be encoded.
+ * @note BC7 can be loaded from KTX2, but encoding it is not supported.
+ */
+[[nodiscard]]
+std::unique_ptr<CompressedImage> compress_image(const Image& image,
+                                                const VkFormat format,
+                                                const bool generate_mipmaps = true,
+                                                ThreadPool* pool = nullptr);
+
+}
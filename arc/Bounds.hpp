@@ -0,0 +1,145 @@
+#pragma once
+/** *******************************************************************
+ * @file Bounds.hpp
+ * @brief Bounding volumes of meshes, for visibility tests.
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "GLM.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+
+namespace ArcGraphics {
+
+struct BoundingSphere {
+    glm::vec3 center{0.0f};
+    float radius{0.0f};
+};
+
+/**
+ * @brief Axis aligned bounding box.
+ */
+struct BoundingBox {
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+
+    [[nodiscard]]
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+
+    [[nodiscard]]
+    glm::vec3 extent() const { return max - min; }
+
+    /** @brief Half the surface area, which is all the SAH needs. */
+    [[nodiscard]]
+    float half_area() const
+    {
+        const glm::vec3 e = extent();
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+
+    [[nodiscard]]
+    bool contains(const BoundingBox& other) const
+    {
+        return glm::all(glm::lessThanEqual(min, other.min))
+            && glm::all(glm::greaterThanEqual(max, other.max));
+    }
+
+    [[nodiscard]]
+    bool overlaps(const BoundingBox& other) const
+    {
+        return glm::all(glm::lessThanEqual(min, other.max))
+            && glm::all(glm::greaterThanEqual(max, other.min));
+    }
+};
+
+[[nodiscard]]
+inline BoundingBox merge(const BoundingBox& a, const BoundingBox& b)
+{
+    return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+/**
+ * @brief Vertex types with a position, whose buffers get bounds computed on upload.
+ */
+template <typename Vertex>
+concept HasVertexPosition = requires(const Vertex& vertex)
+{
+    { vertex.pos } -> std::convertible_to<glm::vec3>;
+};
+
+/**
+ * @brief Get the box around every vertex position.
+ */
+template <HasVertexPosition Vertex>
+[[nodiscard]]
+BoundingBox compute_bounding_box(const Vertex* vertices, const size_t count)
+{
+    if (count == 0)
+        return {};
+    BoundingBox box{vertices[0].pos, vertices[0].pos};
+    for (size_t i = 1; i < count; i++) {
+        box.min = glm::min(box.min, glm::vec3(vertices[i].pos));
+        box.max = glm::max(box.max, glm::vec3(vertices[i].pos));
+    }
+    return box;
+}
+
+/**
+ * @brief Get a sphere around every vertex position.
+ * The center is the middle of the bounding box, which is not the smallest
+ * sphere but is close for typical meshes and a single pass cheaper.
+ */
+template <HasVertexPosition Vertex>
+[[nodiscard]]
+BoundingSphere compute_bounding_sphere(const Vertex* vertices, const size_t count)
+{
+    if (count == 0)
+        return {};
+    BoundingSphere sphere{};
+    sphere.center = compute_bounding_box(vertices, count).center();
+    float radius_squared = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        const glm::vec3 offset = glm::vec3(vertices[i].pos) - sphere.center;
+        radius_squared = std::max(radius_squared, glm::dot(offset, offset));
+    }
+    sphere.radius = std::sqrt(radius_squared);
+    return sphere;
+}
+
+/**
+ * @brief Move a sphere into the space of model, growing it by the largest axis scale.
+ */
+[[nodiscard]]
+inline BoundingSphere transform_bounding_sphere(const BoundingSphere& sphere,
+                                                const glm::mat4& model)
+{
+    const float scale = std::max({glm::length(glm::vec3(model[0])),
+                                  glm::length(glm::vec3(model[1])),
+                                  glm::length(glm::vec3(model[2]))});
+    return {glm::vec3(model * glm::vec4(sphere.center, 1.0f)), sphere.radius * scale};
+}
+
+/**
+ * @brief Get the box around a box placed by model.
+ * Every row of the rotation and scale adds its smallest and largest term, see
+ * Arvo, "Transforming Axis-Aligned Bounding Boxes", Graphics Gems 1990.
+ */
+[[nodiscard]]
+inline BoundingBox transform_bounding_box(const BoundingBox& box, const glm::mat4& model)
+{
+    BoundingBox result{glm::vec3(model[3]), glm::vec3(model[3])};
+    for (int column = 0; column < 3; column++) {
+        const glm::vec3 axis(model[column]);
+        const glm::vec3 a = axis * box.min[column];
+        const glm::vec3 b = axis * box.max[column];
+        result.min += glm::min(a, b);
+        result.max += glm::max(a, b);
+    }
+    return result;
+}
+
+}
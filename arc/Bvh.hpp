@@ -0,0 +1,166 @@
+#pragma once
+/** *******************************************************************
+ * @file Bvh.hpp
+ * @brief Dynamic bounding volume hierarchy over the boxes of scene objects.
+ *
+ * The tree lives in one flat node array where a full build places every left
+ * child right after its parent. Leaves hold boxes grown by a margin, so small
+ * moves only update the exact box; larger moves refit the path to the root
+ * and rotate nodes along it to keep the surface area low.
+ *
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "Bounds.hpp"
+#include "Frustum.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <vector>
+
+namespace ArcGraphics {
+
+struct BvhRayHit {
+    uint32_t object{0};
+    float distance{0.0f};
+};
+
+/**
+ * @brief Objects are identified by ids picked by the caller, which should be
+ * dense, e.g. the CpuCulling id or an index into the scene.
+ */
+class Bvh
+{
+public:
+    static constexpr uint32_t null_node = std::numeric_limits<uint32_t>::max();
+
+    /**
+     * @param margin added on every side of the box of a leaf.
+     */
+    explicit Bvh(const float margin = 0.1f);
+
+    /**
+     * @brief Replace the tree with a SAH build over boxes, object i gets boxes[i].
+     */
+    void build(const std::vector<BoundingBox>& boxes);
+
+    /**
+     * @brief SAH build over the objects already in the tree, for when many
+     * moves have worn down the tree quality.
+     */
+    void rebuild();
+
+    /**
+     * @throws std::invalid_argument if object is already in the tree.
+     */
+    void insert(const uint32_t object, const BoundingBox& box);
+
+    /**
+     * @throws std::out_of_range if object is not in the tree.
+     */
+    void move(const uint32_t object, const BoundingBox& box);
+
+    /**
+     * @throws std::out_of_range if object is not in the tree.
+     */
+    void remove(const uint32_t object);
+
+    void clear();
+
+    [[nodiscard]]
+    bool contains(const uint32_t object) const;
+
+    [[nodiscard]]
+    size_t size() const;
+
+    /**
+     * @brief Get the number of levels below the root, 0 for an empty tree.
+     */
+    [[nodiscard]]
+    uint32_t height() const;
+
+    /**
+     * @brief Append every object whose box touches the frustum.
+     * Nodes fully inside the frustum add their whole subtree without further tests.
+     */
+    void query_frustum(const Frustum& frustum, std::vector<uint32_t>& objects) const;
+
+    /**
+     * @brief Append every object whose box overlaps box.
+     */
+    void query_overlap(const BoundingBox& box, std::vector<uint32_t>& objects) const;
+
+    /**
+     * @brief Find the closest object along a ray, e.g. for picking.
+     * @param hit_test optional exact test of an object whose box is hit,
+     *        returning the distance along direction or std::nullopt for a miss.
+     *        Without it the distance to the box is used.
+     */
+    [[nodiscard]]
+    std::optional<BvhRayHit> ray_cast(
+        const glm::vec3& origin,
+        const glm::vec3& direction,
+        const float max_distance = std::numeric_limits<float>::max(),
+        const std::function<std::optional<float>(uint32_t)>& hit_test = {}) const;
+
+private:
+    struct Node {
+        /** @brief The grown box for leaves. */
+        BoundingBox box{};
+        /** @brief Next free node when on the free list. */
+        uint32_t parent{null_node};
+        /** @brief null_node for leaves. */
+        uint32_t left{null_node};
+        /** @brief The object for leaves. */
+        uint32_t right{null_node};
+        uint32_t height{0};
+    };
+
+    struct Object {
+        uint32_t leaf{null_node};
+        BoundingBox box{};
+    };
+
+    struct BuildItem {
+        uint32_t object;
+        BoundingBox box;
+        glm::vec3 centroid;
+    };
+
+    [[nodiscard]]
+    bool is_leaf(const uint32_t node) const;
+
+    [[nodiscard]]
+    BoundingBox grow(const BoundingBox& box) const;
+
+    [[nodiscard]]
+    uint32_t allocate_node();
+    void free_node(const uint32_t node);
+
+    void build_items(std::vector<BuildItem>& items);
+    void insert_leaf(const uint32_t leaf);
+    void remove_leaf(const uint32_t leaf);
+
+    /** @brief Rotate and refit node and every ancestor. */
+    void refit_from(uint32_t node);
+    void rotate(const uint32_t node);
+    /** @brief Swap child, a child of node, with grandchild, a child of other. */
+    void swap_grandchild(const uint32_t node,
+                         const uint32_t child,
+                         const uint32_t other,
+                         const uint32_t grandchild);
+    void refit(const uint32_t node);
+
+    std::vector<Node> m_nodes{};
+    std::vector<Object> m_objects{};
+    uint32_t m_root{null_node};
+    uint32_t m_free{null_node};
+    size_t m_count{0};
+    float m_margin;
+};
+
+}
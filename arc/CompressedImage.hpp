@@ -0,0 +1,134 @@
+#pragma once
+/** *******************************************************************
+ * @file CompressedImage.hpp
+ * @brief Block compressed images with pre-built mip chains, stored as KTX2.
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "TypeTraits.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ArcGraphics {
+
+/**
+ * @brief Get the size in bytes of a single 4x4 block of a block compressed format.
+ * @return 0 if the format is not one of the supported BC1, BC3, BC5 or BC7 formats.
+ */
+[[nodiscard]]
+uint32_t block_byte_size(const VkFormat format);
+
+/**
+ * @brief Get the size in bytes of a width x height image in a block compressed format.
+ */
+[[nodiscard]]
+VkDeviceSize block_compressed_size(const VkFormat format,
+                                   const uint32_t width,
+                                   const uint32_t height);
+
+/**
+ * @brief Location of a mip level within CompressedImage::data.
+ */
+struct CompressedLevel {
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    uint32_t width;
+    uint32_t height;
+};
+
+/**
+ * @brief The levels of a KTX2 container, and where they are packed when copied out of it.
+ */
+struct Ktx2Layout {
+    VkFormat format;
+    uint32_t width;
+    uint32_t height;
+    /** @brief Levels packed level 0 first, at offsets usable for buffer to image copies. */
+    std::vector<CompressedLevel> levels;
+    /** @brief Offset of each level within the container. */
+    std::vector<VkDeviceSize> source_offsets;
+    /** @brief Size of the packed levels. */
+    VkDeviceSize data_size;
+};
+
+/**
+ * @brief Read the header and level index of a KTX2 container, without copying any levels.
+ * @see CompressedImage::parse_ktx2 for the supported containers.
+ */
+[[nodiscard]]
+std::optional<Ktx2Layout> read_ktx2_layout(const unsigned char* data, const size_t size);
+
+/**
+ * @brief A block compressed 2D image whose levels are uploaded as is, without decoding.
+ */
+class CompressedImage : IsNotLvalueCopyable
+{
+public:
+    /**
+     * @brief Load a KTX2 container.
+     * @return nullptr if the file could not be read or is not a supported KTX2 image.
+     */
+    [[nodiscard]]
+    static std::unique_ptr<CompressedImage> load_from_path(const std::string& path);
+
+    /**
+     * @brief Parse a KTX2 container held in memory.
+     * Only uncompressed containers holding a single 2D image with a BC1, BC3, BC5 or
+     * BC7 format are supported.
+     * @return nullptr if the data is not a supported KTX2 image.
+     */
+    [[nodiscard]]
+    static std::unique_ptr<CompressedImage> parse_ktx2(const unsigned char* data,
+                                                       const size_t size);
+
+    /**
+     * @param levels must start with level 0 and lie within data.
+     */
+    CompressedImage(const VkFormat format,
+                    const uint32_t width,
+                    const uint32_t height,
+                    std::vector<CompressedLevel> levels,
+                    std::vector<unsigned char> data);
+
+    /**
+     * @brief Write the image as a KTX2 container.
+     * @return false if the file could not be written.
+     */
+    bool write_ktx2(const std::string& path) const;
+
+    [[nodiscard]]
+    VkFormat format() const;
+
+    [[nodiscard]]
+    uint32_t width() const;
+
+    [[nodiscard]]
+    uint32_t height() const;
+
+    [[nodiscard]]
+    const std::vector<CompressedLevel>& levels() const;
+
+    [[nodiscard]]
+    const unsigned char* data() const;
+
+    /**
+     * @brief Get the size of the data holding every level.
+     */
+    [[nodiscard]]
+    VkDeviceSize device_size() const;
+
+private:
+    VkFormat m_format;
+    uint32_t m_width;
+    uint32_t m_height;
+    std::vector<CompressedLevel> m_levels;
+    std::vector<unsigned char> m_data;
+};
+
+}
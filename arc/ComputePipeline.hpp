@@ -0,0 +1,181 @@
+#pragma once
+/** *******************************************************************
+ * @file ComputePipeline.hpp
+ * @brief Compute shaders submitted to a compute queue alongside rendering.
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "Renderer.hpp"
+#include "RenderPipeline.hpp"
+#include "Algorithm.hpp"
+#include "TypeTraits.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace ArcGraphics {
+
+struct ComputeFrameLocks {
+    /** @brief Point of Device::timeline() signaled by the last submission of the frame. */
+    TimelinePoint timeline_point{};
+};
+
+/**
+ * @brief A compute shader with its own command buffers per frame in flight.
+ *
+ * Work is submitted to a dedicated compute queue family when the device has
+ * one, so it can overlap rendering. end_command_buffer() returns a timeline point
+ * which RenderPipeline::wait_for_timeline() makes the graphics submission of
+ * the same frame wait on. Buffers written here and read by graphics must be
+ * shared by both families, see sharing_queue_families().
+ */
+class ComputePipeline : public IsNotLvalueCopyable
+{
+public:
+    class Builder;
+
+    ComputePipeline(Device* device,
+                    const VkPipelineLayout pipeline_layout,
+                    const VkPipeline pipeline,
+                    const VkQueue compute_queue,
+                    const uint32_t compute_family,
+                    const uint32_t graphics_family,
+                    const std::vector<ComputeFrameLocks> framelocks,
+                    const std::vector<VkCommandBuffer> commandbuffers,
+                    const VkCommandPool command_pool,
+                    const uint32_t push_constant_size);
+
+    uint32_t max_frames_in_flight() const;
+    uint32_t current_flight_frame() const;
+    const VkPipelineLayout& layout() const;
+    const VkCommandPool& command_pool() const;
+    const VkQueue& queue() const;
+    uint32_t queue_family() const;
+
+    /**
+     * @brief Check whether compute runs on another queue family than graphics.
+     */
+    bool has_dedicated_queue() const;
+
+    /**
+     * @brief Get the queue families to create buffers shared between compute and graphics with.
+     * @see ArcGraphics::create_buffer
+     */
+    std::vector<uint32_t> sharing_queue_families() const;
+
+    /**
+     * @brief Wait until the current frame is no longer in flight, then begin its
+     * command buffer with the pipeline bound.
+     */
+    VkCommandBuffer begin_command_buffer();
+
+    void bind_descriptor_set(VkCommandBuffer command_buffer, const VkDescriptorSet descriptor_set) const;
+
+    /**
+     * @throw std::invalid_argument if the range is beyond the push constants of the pipeline.
+     */
+    void push_constants(VkCommandBuffer command_buffer,
+                        const void* data,
+                        const uint32_t size,
+                        const uint32_t offset = 0) const;
+
+    template <typename T>
+    void push_constants(VkCommandBuffer command_buffer, const T& value) const
+    {
+        push_constants(command_buffer, &value, sizeof(T));
+    }
+
+    void dispatch(VkCommandBuffer command_buffer,
+                  const uint32_t group_count_x,
+                  const uint32_t group_count_y = 1,
+                  const uint32_t group_count_z = 1) const;
+
+    /**
+     * @brief Dispatch enough groups of local_size invocations to cover element_count elements.
+     * The shader must skip invocations past element_count.
+     */
+    void dispatch_elements(VkCommandBuffer command_buffer,
+                           const uint32_t element_count,
+                           const uint32_t local_size) const;
+
+    void dispatch_indirect(VkCommandBuffer command_buffer,
+                           const VkBuffer buffer,
+                           const VkDeviceSize offset = 0) const;
+
+    /**
+     * @brief Submit the command buffer to the compute queue and move on to the next frame.
+     * @return the point of Device::timeline() signaled when the work is done. Unlike a
+     * binary semaphore it may be waited on any number of times, or not at all when
+     * the frame that would read the work is dropped.
+     */
+    TimelinePoint end_command_buffer(VkCommandBuffer command_buffer);
+
+    /**
+     * @brief Get the timeline point signaled by the last submission.
+     */
+    [[nodiscard]]
+    TimelinePoint last_timeline_point() const;
+
+    ~ComputePipeline() = default;
+    void destroy();
+
+private:
+    Device* m_device{nullptr};
+    VkPipelineLayout m_pipeline_layout;
+    VkPipeline m_pipeline;
+    VkQueue m_compute_queue;
+    uint32_t m_compute_family;
+    uint32_t m_graphics_family;
+    std::vector<ComputeFrameLocks> m_framelocks;
+    std::vector<VkCommandBuffer> m_commandbuffers;
+    VkCommandPool m_command_pool;
+    uint32_t m_push_constant_size;
+    uint32_t m_current_flight_frame{0};
+    TimelinePoint m_last_timeline_point{};
+};
+
+class ComputePipeline::Builder : protected IsNotLvalueCopyable
+{
+public:
+    /**
+     * @param renderer used to find the graphics family that consumes the compute output.
+     */
+    Builder(Device* device,
+            Renderer* renderer,
+            const ShaderBytecode compute_bytecode,
+            const VkDescriptorSetLayout descriptorset_layout);
+
+    ~Builder() = default;
+
+    /**
+     * @brief Should match the frames in flight of the RenderPipeline waiting on the compute work.
+     */
+    Builder& with_frames_in_flight(const uint32_t frames);
+
+    /**
+     * @brief Reserve size bytes of push constants, at most 128 are guaranteed.
+     */
+    Builder& with_push_constants(const uint32_t size);
+
+    /**
+     * @brief Submit to the graphics queue even when a dedicated compute family exists.
+     */
+    Builder& with_graphics_queue();
+
+    [[nodiscard]]
+    ComputePipeline produce();
+
+private:
+    Device* m_device{nullptr};
+    Renderer* m_renderer{nullptr};
+    ShaderBytecode m_compute_bytecode;
+    VkDescriptorSetLayout m_descriptorset_layout{};
+    uint32_t m_max_frames_in_flight{2};
+    uint32_t m_push_constant_size{0};
+    bool m_use_graphics_queue{false};
+};
+
+}
@@ -0,0 +1,89 @@
+#pragma once
+/** *******************************************************************
+ * @file CpuCulling.hpp
+ * @brief Frustum culling of bounding spheres on the CPU, for when GPU culling is not an option.
+ *
+ * Spheres are kept as structure of arrays, so the plane tests run on 8 spheres
+ * per instruction with AVX, 4 with SSE2 or NEON, and one at a time otherwise.
+ *
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "Bounds.hpp"
+#include "Frustum.hpp"
+#include "ThreadPool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ArcGraphics {
+
+/**
+ * @brief Test count spheres against frustum, writing 1 to visible for every sphere
+ * that touches it and 0 otherwise.
+ */
+void cull_spheres(const Frustum& frustum,
+                  const float* center_x,
+                  const float* center_y,
+                  const float* center_z,
+                  const float* radius,
+                  const size_t count,
+                  uint8_t* visible);
+
+/**
+ * @brief World space bounding spheres of objects, in structure of arrays layout.
+ * The id of an object is its index, in the order it was added.
+ */
+class CpuCulling
+{
+public:
+    /** @brief Spheres handed to a single task when culling on a thread pool. */
+    static constexpr size_t block_size = 16384;
+
+    /**
+     * @return the id of the object.
+     */
+    uint32_t add(const BoundingSphere& world);
+
+    /**
+     * @brief Add an object with mesh bounds, e.g. BasicBuffer::get_bounds(), placed by model.
+     */
+    uint32_t add(const BoundingSphere& local, const glm::mat4& model);
+
+    /**
+     * @brief Move an object.
+     */
+    void set(const uint32_t id, const BoundingSphere& world);
+
+    void reserve(const size_t count);
+    void clear();
+
+    [[nodiscard]]
+    size_t size() const;
+
+    /**
+     * @brief Write whether every object is visible, visible is resized to size().
+     * @param pool spreads blocks of spheres over its threads when given.
+     */
+    void cull(const Frustum& frustum,
+              std::vector<uint8_t>& visible,
+              ThreadPool* pool = nullptr) const;
+
+    /**
+     * @brief Write the ids of the visible objects in ascending order.
+     * Like cull, this only reads the objects, so threads may cull concurrently.
+     */
+    void cull_ids(const Frustum& frustum,
+                  std::vector<uint32_t>& ids,
+                  ThreadPool* pool = nullptr) const;
+
+private:
+    std::vector<float> m_center_x{};
+    std::vector<float> m_center_y{};
+    std::vector<float> m_center_z{};
+    std::vector<float> m_radius{};
+};
+
+}
@@ -8,9 +8,13 @@
 
 #include "GlobalContext.hpp"
 #include "Algorithm.hpp"
+#include "SamplerCache.hpp"
+#include "GpuTimeline.hpp"
+#include "Timing.hpp"
 
 #include <vector>
 #include <optional>
+#include <string>
 
 namespace ArcGraphics {
 
@@ -59,6 +63,68 @@ public:
     [[nodiscard]]
     const DeviceRenderingCapabilities& capabilities() const noexcept;
 
+    /**
+     * @brief Get the window the device was selected for.
+     * @return nullptr if the device was produced without a window.
+     * @see ArcGraphics::Device::Builder::with_window
+     */
+    [[nodiscard]]
+    SDL_Window* window() const noexcept;
+
+    /**
+     * @brief Get the surface of the window the device was selected for.
+     * @return VK_NULL_HANDLE if the device was produced without a window.
+     */
+    [[nodiscard]]
+    const VkSurfaceKHR& window_surface() const noexcept;
+
+    /**
+     * @brief Get the timing breakdown of producing the device.
+     */
+    [[nodiscard]]
+    const PhaseTimings& startup_timings() const noexcept;
+
+    /**
+     * @brief Get the samplers shared by the textures of this device.
+     * @see ArcGraphics::Texture::create_staging
+     */
+    [[nodiscard]]
+    SamplerCache& sampler_cache() const noexcept;
+
+    /**
+     * @brief Check whether VK_EXT_memory_budget is enabled on the logical device.
+     */
+    [[nodiscard]]
+    bool has_memory_budget() const noexcept;
+
+    /**
+     * @brief Get the current budget and usage of every memory heap.
+     * @see ArcGraphics::get_memory_heap_budgets
+     */
+    [[nodiscard]]
+    std::vector<MemoryHeapBudget> memory_heap_budgets() const;
+
+    /**
+     * @brief Get the optional draw submission features enabled on the logical device.
+     * @see ArcGraphics::DrawSubmitter
+     */
+    [[nodiscard]]
+    const DrawSubmissionFeatures& draw_submission_features() const noexcept;
+
+    /**
+     * @brief Check whether VK_KHR_synchronization2 is enabled on the logical device.
+     * @see ArcGraphics::RenderGraph
+     */
+    [[nodiscard]]
+    bool has_synchronization2() const noexcept;
+
+    /**
+     * @brief Get the timeline that frames, compute and uploads of this device signal.
+     * @see ArcGraphics::GpuTimeline
+     */
+    [[nodiscard]]
+    GpuTimeline& timeline() const noexcept;
+
 private:
      /**
      * @brief Construct the Devices.
@@ -68,12 +134,27 @@ private:
     Device(const VkInstance instance,
            const VkPhysicalDevice physical_device,
            const VkDevice logical_device,
-           const DeviceRenderingCapabilities capabilities);
+           const DeviceRenderingCapabilities capabilities,
+           SDL_Window* window,
+           const VkSurfaceKHR window_surface,
+           const PhaseTimings startup_timings,
+           const bool memory_budget,
+           const DrawSubmissionFeatures draw_features,
+           const bool synchronization2,
+           const bool timeline_semaphore);
 
     VkInstance m_instance;                      /// Vulkan instance
     VkPhysicalDevice m_physical_device;         /// physical device
     VkDevice m_logical_device;                  /// logical device
     DeviceRenderingCapabilities m_capabilities; /// rendering capabilities
+    SDL_Window* m_window{nullptr};              /// owned window, if any
+    VkSurfaceKHR m_window_surface;              /// owned window surface, if any
+    PhaseTimings m_startup_timings;             /// timing breakdown of produce()
+    mutable SamplerCache m_sampler_cache;       /// samplers shared by textures
+    bool m_memory_budget;                       /// VK_EXT_memory_budget is enabled
+    DrawSubmissionFeatures m_draw_features;     /// enabled draw submission features
+    bool m_synchronization2;                    /// VK_KHR_synchronization2 is enabled
+    mutable GpuTimeline m_timeline;             /// progress of every submission
 };
     
 /**
@@ -107,13 +188,41 @@ public:
      */
     Builder& add_khronos_validation_layer();
 
+    /**
+     * @brief Create the real window up front and select the device for its surface.
+     * Without this a temporary window is created just to score the devices.
+     * The window and surface are owned by the Device, and reused by the Renderer.
+     * @see ArcGraphics::Renderer::Builder::produce
+     */
+    Builder& with_window(const std::string& name,
+                         const uint32_t width,
+                         const uint32_t height,
+                         const uint32_t flags = 0);
+
+    /**
+     * @brief Cache the selected physical device in a file.
+     * Later launches only verify the cached device instead of scoring every device.
+     * A stale or missing cache falls back to the full selection and is rewritten.
+     */
+    Builder& with_device_cache(const std::string& path);
+
     /**
      * @brief Produce the Device.
      */
     Device produce();
     
 private:
-    ValidationLayers m_validation_layers{}; /// The validation layers to be enabled
+    struct WindowSettings {
+        std::string name;
+        uint32_t width;
+        uint32_t height;
+        uint32_t flags;
+    };
+
+    ValidationLayers m_validation_layers{};                 /// The validation layers to be enabled
+    std::optional<WindowSettings> m_window{};               /// The real window, if created here
+    std::optional<std::string> m_device_cache_path{};       /// Where to cache the selected device
+    PhaseTimings m_timings{};                               /// Phases measured before produce()
 };
  
 
@@ -0,0 +1,67 @@
+#pragma once
+/** *******************************************************************
+ * @file Frustum.hpp
+ * @brief View frustum planes for visibility tests.
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "GLM.hpp"
+#include "Bounds.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace ArcGraphics {
+
+/**
+ * @brief The six planes of a view frustum, facing inwards.
+ * A point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0, and the
+ * planes are normalized so that value is the distance to the plane.
+ * Order: left, right, bottom, top, near, far.
+ */
+struct Frustum {
+    std::array<glm::vec4, 6> planes{};
+};
+
+/**
+ * @brief Extract the frustum planes of a projection times view matrix.
+ * The near plane assumes Vulkan depth from 0 to 1, see GLM.hpp.
+ */
+[[nodiscard]]
+Frustum extract_frustum(const glm::mat4& view_projection);
+
+/**
+ * @brief Check whether a sphere touches the frustum.
+ */
+[[nodiscard]]
+bool is_sphere_in_frustum(const Frustum& frustum,
+                          const glm::vec3& center,
+                          const float radius);
+
+/**
+ * @brief Where a volume lies relative to the frustum.
+ */
+enum class FrustumContainment {
+    outside,
+    intersecting,
+    inside,
+};
+
+/** @brief Plane mask with one bit per frustum plane, in plane order. */
+constexpr uint32_t all_frustum_planes = 0x3f;
+
+/**
+ * @brief Classify a box against the frustum.
+ * Boxes near a frustum corner may be reported as intersecting while outside,
+ * which is conservative for culling.
+ * @param plane_mask when given, only planes with their bit set are tested, and
+ *        the bits of planes the box is fully inside of are cleared. Children of
+ *        the box can then skip those planes.
+ */
+[[nodiscard]]
+FrustumContainment classify_box_in_frustum(const Frustum& frustum,
+                                           const BoundingBox& box,
+                                           uint32_t* plane_mask = nullptr);
+
+}
@@ -0,0 +1,337 @@
+#pragma once
+/** *******************************************************************
+ * @file GltfLoader.hpp
+ * @brief Loading of glTF 2.0 triangle meshes into vertex and index buffers.
+ *
+ * Binary buffers (.glb chunks and external .bin files) are memory mapped and
+ * accessors point straight into the mapping. Vertex attributes are only
+ * converted when their layout differs from the vertex type, and every
+ * primitive is written directly into staging memory on a thread pool.
+ *
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "BasicBuffer.hpp"
+#include "Bounds.hpp"
+#include "IndexBuffer.hpp"
+#include "MappedFile.hpp"
+#include "SimpleGeometry.hpp"
+#include "StagingBuffer.hpp"
+#include "ThreadPool.hpp"
+#include "TypeTraits.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ArcGraphics {
+
+/**
+ * @brief Typed view of accessor data inside a mapped buffer.
+ * Accessors without a buffer view have no data and read as zeros.
+ */
+struct GltfAccessor {
+    const unsigned char* data{nullptr};
+    uint32_t count{0};
+    /** @brief Bytes between consecutive elements. */
+    uint32_t stride{0};
+    /** @brief One of the GL component types, e.g. 5126 for float. */
+    uint32_t component_type{0};
+    /** @brief Components per element, 1 for SCALAR up to 16 for MAT4. */
+    uint32_t components{0};
+    bool normalized{false};
+    /** @brief Index of the buffer view, used to detect interleaved attributes. */
+    int32_t buffer_view{-1};
+};
+
+struct GltfPrimitive {
+    uint32_t mesh;
+    int32_t material;
+    std::vector<std::pair<std::string, GltfAccessor>> attributes;
+    std::optional<GltfAccessor> indices;
+
+    /**
+     * @return nullptr if the primitive has no attribute of that semantic.
+     */
+    [[nodiscard]]
+    const GltfAccessor* attribute(const std::string_view semantic) const;
+
+    [[nodiscard]]
+    uint32_t vertex_count() const;
+
+    /**
+     * @brief Get the number of indices, which is the vertex count for unindexed primitives.
+     */
+    [[nodiscard]]
+    uint32_t index_count() const;
+};
+
+/**
+ * @brief A parsed glTF file whose buffers stay mapped for as long as it lives.
+ * Only triangle list primitives are kept. Node transforms, materials and
+ * animation are not read.
+ */
+class GltfModel : public IsNotLvalueCopyable
+{
+public:
+    /**
+     * @brief Map a .gltf or .glb file and the buffers it refers to.
+     * @return nullptr if the file could not be read or is not valid glTF 2.0.
+     */
+    [[nodiscard]]
+    static std::unique_ptr<GltfModel> open(const std::string& path);
+
+    [[nodiscard]]
+    const std::vector<GltfPrimitive>& primitives() const;
+
+    [[nodiscard]]
+    const std::vector<std::string>& mesh_names() const;
+
+private:
+    GltfModel() = default;
+
+    std::unique_ptr<MappedFile> m_file{};
+    std::vector<std::unique_ptr<MappedFile>> m_external_buffers{};
+    /** @brief Buffers embedded as base64 data URIs. */
+    std::vector<std::vector<unsigned char>> m_decoded_buffers{};
+    std::vector<GltfPrimitive> m_primitives{};
+    std::vector<std::string> m_mesh_names{};
+};
+
+/**
+ * @brief Where a glTF attribute goes in a vertex.
+ * Every attribute is stored as components 32 bit floats.
+ */
+struct GltfVertexAttribute {
+    const char* semantic;
+    uint32_t offset;
+    uint32_t components;
+};
+
+/**
+ * @brief Specialize with a static constexpr array attributes to load glTF into
+ * vertex buffers of another vertex type.
+ */
+template <typename Vertex>
+struct GltfVertexLayout;
+
+template <>
+struct GltfVertexLayout<Vertex_PosTex> {
+    static constexpr std::array<GltfVertexAttribute, 2> attributes{{
+        {"POSITION", offsetof(Vertex_PosTex, pos), 3},
+        {"TEXCOORD_0", offsetof(Vertex_PosTex, uv), 2},
+    }};
+};
+
+/**
+ * @brief Write count elements of accessor as components floats each, out_stride bytes apart.
+ * Missing components and accessors without data are written as zeros.
+ * @throw std::invalid_argument if the component type can not be converted to float.
+ */
+void read_gltf_floats(const GltfAccessor* accessor,
+                      const uint32_t count,
+                      const uint32_t components,
+                      unsigned char* out,
+                      const size_t out_stride);
+
+/**
+ * @brief Write the indices of primitive as 32 bit indices, adding base_vertex to each.
+ * @throw std::out_of_range if an index is not below the vertex count of primitive.
+ */
+void read_gltf_indices(const GltfPrimitive& primitive,
+                       const uint32_t base_vertex,
+                       uint32_t* out);
+
+/**
+ * @brief The part of the shared buffers a primitive was written to.
+ */
+struct GltfDrawRange {
+    uint32_t mesh;
+    int32_t material;
+    uint32_t first_index;
+    uint32_t index_count;
+    uint32_t first_vertex;
+    uint32_t vertex_count;
+    /** @brief Box around the vertices of the primitive, e.g. to build a Bvh from. Set by read_gltf_geometry. */
+    BoundingBox bounds{};
+};
+
+/**
+ * @brief Plan where every primitive of model goes in shared vertex and index buffers.
+ * @throw std::length_error if the indices or vertices of model do not fit 32 bit offsets.
+ */
+[[nodiscard]]
+std::vector<GltfDrawRange> plan_gltf_ranges(const GltfModel& model);
+
+/**
+ * @brief Write every primitive of model into vertices and indices, as planned by plan_gltf_ranges.
+ * Indices are rebased onto the shared vertex buffer, so every range is drawn with a
+ * vertex offset of 0. When the attributes of a primitive are already interleaved
+ * exactly like Vertex, they are copied as a single block.
+ * The bounds of every range are computed from its vertices when Vertex has a position.
+ * @param pool spreads the primitives over its threads when given.
+ */
+template <typename Vertex>
+void read_gltf_geometry(const GltfModel& model,
+                        std::vector<GltfDrawRange>& ranges,
+                        Vertex* vertices,
+                        uint32_t* indices,
+                        ThreadPool* pool = nullptr)
+{
+    const auto& layout = GltfVertexLayout<Vertex>::attributes;
+    // A block copy must not read past the attributes, so it needs a layout without padding.
+    constexpr bool covers_vertex = [] {
+        uint32_t size = 0;
+        for (const auto& attribute: GltfVertexLayout<Vertex>::attributes)
+            size += attribute.components * 4;
+        return GltfVertexLayout<Vertex>::attributes[0].offset == 0 && size == sizeof(Vertex);
+    }();
+    const auto read_primitive = [&](const size_t i) {
+        const auto& primitive = model.primitives()[i];
+        auto& range = ranges[i];
+        auto out = reinterpret_cast<unsigned char*>(vertices + range.first_vertex);
+
+        // Interleaved float attributes with the offsets and stride of Vertex are copied as is.
+        const auto first = primitive.attribute(layout[0].semantic);
+        bool interleaved = covers_vertex && first && first->data && first->stride == sizeof(Vertex);
+        for (const auto& attribute: layout) {
+            const auto accessor = primitive.attribute(attribute.semantic);
+            interleaved = interleaved && accessor
+                && accessor->buffer_view == first->buffer_view
+                && accessor->count >= range.vertex_count
+                && accessor->component_type == 5126
+                && accessor->components == attribute.components
+                && accessor->data - first->data == ptrdiff_t(attribute.offset);
+        }
+        if (interleaved) {
+            memcpy(out, first->data, size_t(range.vertex_count) * sizeof(Vertex));
+        } else {
+            memset(out, 0, size_t(range.vertex_count) * sizeof(Vertex));
+            for (const auto& attribute: layout)
+                read_gltf_floats(primitive.attribute(attribute.semantic),
+                                 range.vertex_count,
+                                 attribute.components,
+                                 out + attribute.offset,
+                                 sizeof(Vertex));
+        }
+        if constexpr (HasVertexPosition<Vertex>)
+            range.bounds = compute_bounding_box(vertices + range.first_vertex, range.vertex_count);
+        read_gltf_indices(primitive, range.first_vertex, indices + range.first_index);
+    };
+
+    const size_t count = model.primitives().size();
+    if (!pool) {
+        for (size_t i = 0; i < count; i++)
+            read_primitive(i);
+        return;
+    }
+    pool->parallel_for(0, count, [&](const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; i++)
+            read_primitive(i);
+    });
+}
+
+/**
+ * @brief Device local buffers holding every primitive of a glTF model.
+ */
+template <BasicBufferPolicy Policy>
+struct GltfGeometry {
+    std::unique_ptr<BasicBuffer<Policy>> vertices{};
+    std::unique_ptr<IndexBuffer> indices{};
+    std::vector<GltfDrawRange> ranges{};
+};
+
+/**
+ * @brief Upload every primitive of model into one vertex and one index buffer.
+ * The primitives are written straight into staging memory and copied to the
+ * device with a single command buffer.
+ * @return nullptr if the model has no triangles.
+ */
+template <BasicBufferPolicy Policy>
+[[nodiscard]]
+std::unique_ptr<GltfGeometry<Policy>> upload_gltf_geometry(const VkPhysicalDevice& physical_device,
+                                                           const VkDevice& logical_device,
+                                                           const VkCommandPool& command_pool,
+                                                           const VkQueue& graphics_queue,
+                                                           StagingBuffer& staging,
+                                                           const GltfModel& model,
+                                                           ThreadPool* pool = nullptr)
+{
+    using Vertex = typename Policy::value_type;
+    auto ranges = plan_gltf_ranges(model);
+    if (ranges.empty())
+        return nullptr;
+    const size_t vertex_count = ranges.back().first_vertex + ranges.back().vertex_count;
+    const size_t index_count = ranges.back().first_index + ranges.back().index_count;
+    if (vertex_count == 0 || index_count == 0)
+        return nullptr;
+    const VkDeviceSize vertex_bytes = vertex_count * sizeof(Vertex);
+    const VkDeviceSize index_bytes = index_count * sizeof(uint32_t);
+
+    auto geometry = std::make_unique<GltfGeometry<Policy>>();
+    geometry->indices = IndexBuffer::create_transfer_destination(physical_device,
+                                                                 logical_device,
+                                                                 index_count);
+
+    // Models larger than the shared staging buffer get a buffer of their own.
+    const VkDeviceSize index_offset = (vertex_bytes + 15) / 16 * 16;
+    const VkDeviceSize size = index_offset + index_bytes;
+    std::optional<StagingBuffer> temporary{};
+    auto region = staging.allocate(size);
+    if (!region) {
+        temporary.emplace(physical_device, logical_device, size);
+        region = temporary->allocate(size);
+    }
+
+    const auto release = [&] {
+        if (temporary)
+            temporary->destroy(logical_device);
+        else
+            staging.release(*region);
+    };
+
+    const VkBuffer source = temporary ? temporary->buffer() : staging.buffer();
+    const auto record_copy = [&](VkCommandBuffer& command_buffer) {
+        VkBufferCopy copy{};
+        copy.srcOffset = region->offset;
+        copy.size = vertex_bytes;
+        vkCmdCopyBuffer(command_buffer, source, geometry->vertices->get_buffer(), 1, &copy);
+        copy.srcOffset = region->offset + index_offset;
+        copy.size = index_bytes;
+        vkCmdCopyBuffer(command_buffer, source, geometry->indices->get_buffer(), 1, &copy);
+    };
+    try {
+        read_gltf_geometry(model,
+                           ranges,
+                           reinterpret_cast<Vertex*>(region->data),
+                           reinterpret_cast<uint32_t*>(region->data + index_offset),
+                           pool);
+        // The vertices only exist in staging memory, so the bounds are read back from there.
+        geometry->vertices = BasicBuffer<Policy>::create_transfer_destination(
+            physical_device,
+            logical_device,
+            vertex_count,
+            reinterpret_cast<const Vertex*>(region->data));
+        with_single_use_command_buffer(logical_device,
+                                       command_pool,
+                                       graphics_queue,
+                                       record_copy);
+    } catch (const std::exception&) {
+        release();
+        throw;
+    }
+    release();
+    geometry->ranges = std::move(ranges);
+    return geometry;
+}
+
+}
@@ -0,0 +1,135 @@
+#pragma once
+/** *******************************************************************
+ * @file GpuCulling.hpp
+ * @brief Frustum culling on the GPU, writing the indirect draws of visible objects.
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "ComputePipeline.hpp"
+#include "Frustum.hpp"
+#include "GLM.hpp"
+#include "IndirectDraw.hpp"
+#include "TypeTraits.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace ArcGraphics {
+
+/**
+ * @brief An object to cull, laid out for a std430 storage buffer.
+ * The culling shader writes the object index as firstInstance, so the vertex
+ * shader reads model from the object buffer at gl_InstanceIndex.
+ */
+struct CullObject {
+    glm::mat4 model{1.0f};
+    /** @brief Bounding sphere in object space, center in xyz and radius in w. */
+    glm::vec4 bounds{0.0f, 0.0f, 0.0f, 1.0f};
+    uint32_t index_count{0};
+    uint32_t first_index{0};
+    int32_t vertex_offset{0};
+    uint32_t padding{0};
+};
+
+/**
+ * @brief Push constants of the culling shader.
+ */
+struct CullParameters {
+    glm::vec4 planes[6];
+    uint32_t object_count;
+    /** @brief 1 to compact visible draws behind a count, 0 to write every draw in place. */
+    uint32_t compact;
+};
+
+/**
+ * @brief Culls objects against the camera frustum in a compute shader.
+ *
+ * Every frame in flight has its own object buffer, which the CPU writes, and
+ * its own command and count buffers, which the shader writes. Visible objects
+ * are appended to the command buffer with an atomic counter and drawn with
+ * vkCmdDrawIndexedIndirectCount. Without VK_KHR_draw_indirect_count every object
+ * keeps its command slot, with an instanceCount of 0 when culled, and all of
+ * them are drawn with multi draw indirect. Either way the CPU cost of a frame
+ * does not depend on the number of objects.
+ *
+ * The shader is expected to use local_size_x = 64 and the bindings
+ * 0: objects, 1: commands, 2: count.
+ */
+class GpuCulling : public IsNotLvalueCopyable
+{
+public:
+    static constexpr uint32_t local_size = 64;
+
+    /**
+     * @param capacity objects per frame.
+     * @param frames_in_flight should match the RenderPipeline drawing the objects.
+     * @throw std::runtime_error if the device lacks drawIndirectFirstInstance.
+     */
+    GpuCulling(Device* device,
+               Renderer* renderer,
+               const DrawSubmitter& submitter,
+               const ShaderBytecode cull_bytecode,
+               const uint32_t capacity,
+               const uint32_t frames_in_flight);
+
+    /**
+     * @brief Get the objects of a frame, written by the CPU before cull().
+     */
+    [[nodiscard]]
+    CullObject* objects(const uint32_t flight_frame);
+
+    /**
+     * @brief Get the object buffer of a frame, for the vertex shader to read transforms from.
+     */
+    [[nodiscard]]
+    VkDescriptorBufferInfo object_buffer_info(const uint32_t flight_frame) const;
+
+    /**
+     * @brief Cull the first object_count objects of a frame.
+     * @return the timeline point the graphics submission of the frame must wait for.
+     * @see ArcGraphics::RenderPipeline::wait_for_timeline
+     */
+    TimelinePoint cull(const uint32_t flight_frame,
+                       const glm::mat4& view_projection,
+                       const uint32_t object_count);
+
+    /**
+     * @brief Draw the visible objects of a frame, inside the render pass.
+     */
+    void draw(VkCommandBuffer command_buffer, const uint32_t flight_frame) const;
+
+    [[nodiscard]]
+    uint32_t capacity() const;
+
+    [[nodiscard]]
+    const ComputePipeline& pipeline() const;
+
+    void destroy();
+
+private:
+    struct FrameBuffers {
+        VkBuffer objects{VK_NULL_HANDLE};
+        VkDeviceMemory objects_memory{VK_NULL_HANDLE};
+        CullObject* objects_mapping{nullptr};
+        VkBuffer commands{VK_NULL_HANDLE};
+        VkDeviceMemory commands_memory{VK_NULL_HANDLE};
+        VkBuffer count{VK_NULL_HANDLE};
+        VkDeviceMemory count_memory{VK_NULL_HANDLE};
+        VkDescriptorSet descriptor_set{VK_NULL_HANDLE};
+        uint32_t object_count{0};
+    };
+
+    Device* m_device{nullptr};
+    DrawSubmitter m_submitter;
+    VkDescriptorSetLayout m_descriptorset_layout{VK_NULL_HANDLE};
+    VkDescriptorPool m_descriptor_pool{VK_NULL_HANDLE};
+    ComputePipeline m_pipeline;
+    std::vector<FrameBuffers> m_frames{};
+    uint32_t m_capacity;
+    bool m_compact;
+};
+
+}
@@ -0,0 +1,168 @@
+#pragma once
+/** *******************************************************************
+ * @file GpuTimeline.hpp
+ * @brief Increasing counters of GPU progress, one per queue submitted to.
+ *
+ * Every submission through the timeline signals the next value of its queue,
+ * so "is the work of (queue, N) done" replaces a fence per submission. Values
+ * of a queue complete in order: when N is complete, so is everything submitted
+ * to the queue before it.
+ *
+ * Queues do not wait on each other unless a submission asks to, with a
+ * TimelineWait on a point of another queue, so async compute overlaps graphics.
+ *
+ * With VK_KHR_timeline_semaphore every queue gets a timeline semaphore, queried
+ * and waited on without locks from any thread. Without it, every submission
+ * gets a fence from a recycled pool and the values are tracked on the CPU.
+ *
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "TypeTraits.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace ArcGraphics {
+
+/**
+ * @brief A submission on the timeline, done once its queue reaches value.
+ * The default point, with no queue, is always complete.
+ */
+struct TimelinePoint {
+    VkQueue queue{VK_NULL_HANDLE};
+    uint64_t value{0};
+};
+
+/**
+ * @brief A point a submission waits for before stage.
+ */
+struct TimelineWait {
+    TimelinePoint point;
+    VkPipelineStageFlags stage;
+};
+
+class GpuTimeline : public IsNotLvalueCopyable
+{
+public:
+    /**
+     * @param timeline_semaphore whether the timeline semaphore feature is
+     * enabled on logical_device, fences are used otherwise.
+     */
+    GpuTimeline(const VkDevice logical_device, const bool timeline_semaphore);
+
+    /**
+     * @brief Submit a batch that signals the next value of queue when it completes.
+     * The semaphores and pNext chain of submit_info are kept.
+     *
+     * Without timeline semaphores the waits can not be made on the GPU, so the
+     * points are waited for on the CPU before submitting.
+     * @param waits points of this or other queues the batch waits for, nothing else is waited for.
+     * @return the point signaled by the batch.
+     * @throw std::out_of_range if a waited point has not been submitted.
+     * @throw std::runtime_error if the submission failed.
+     */
+    TimelinePoint submit(const VkQueue queue,
+                         const VkSubmitInfo& submit_info,
+                         const std::vector<TimelineWait>& waits = {});
+
+    /**
+     * @brief Get the highest value of queue whose work, and all work before it, is done.
+     */
+    [[nodiscard]]
+    uint64_t completed_value(const VkQueue queue) const;
+
+    [[nodiscard]]
+    bool is_complete(const TimelinePoint& point) const;
+
+    [[nodiscard]]
+    bool is_complete(const std::vector<TimelinePoint>& points) const;
+
+    /**
+     * @brief Block until point is complete.
+     * @param timeout in nanoseconds, 0 polls.
+     * @return false if the timeout expired first.
+     * @throw std::out_of_range if point has not been submitted.
+     */
+    bool wait(const TimelinePoint& point, const uint64_t timeout = UINT64_MAX) const;
+
+    /**
+     * @brief Block until every point is complete, with timeout for all of them together.
+     */
+    bool wait(const std::vector<TimelinePoint>& points, const uint64_t timeout = UINT64_MAX) const;
+
+    /**
+     * @brief Get the point of the latest submission to queue, value 0 before any.
+     */
+    [[nodiscard]]
+    TimelinePoint last_submitted(const VkQueue queue) const;
+
+    [[nodiscard]]
+    bool has_timeline_semaphore() const;
+
+    /**
+     * @brief Get the timeline semaphore of queue, created by its first submission.
+     * @return VK_NULL_HANDLE when falling back to fences or before queue was submitted to.
+     */
+    [[nodiscard]]
+    VkSemaphore semaphore(const VkQueue queue) const;
+
+    /**
+     * @brief Wait for every submission and release the semaphores or fences.
+     */
+    void destroy();
+
+private:
+    struct PendingFence {
+        uint64_t value;
+        VkFence fence;
+    };
+
+    struct QueueTimeline {
+        VkSemaphore semaphore{VK_NULL_HANDLE};
+        /** @brief Held from picking a value until it is submitted, so values are submitted in order. */
+        std::mutex submit_mutex{};
+        std::atomic<uint64_t> last_submitted{0};
+        /** @brief Latest known completed value, saves querying the device for old values. */
+        std::atomic<uint64_t> completed{0};
+        /** @brief Fences of the submissions not known to be done, guarded by m_mutex. */
+        std::deque<PendingFence> pending_fences{};
+    };
+
+    /** @brief Find the timeline of queue, nullptr before its first submission. */
+    QueueTimeline* find(const VkQueue queue) const;
+
+    /** @brief Retire signaled fences of timeline in order, m_mutex must be held. */
+    void retire_fences(QueueTimeline& timeline) const;
+
+    /** @brief Recycle a signaled fence, or hold it back while fences are waited on. m_mutex must be held. */
+    void recycle_fence(const VkFence fence) const;
+
+    /** @brief Wait for points with the fences of their queues, without holding m_mutex while waiting. */
+    bool wait_fences(const std::vector<TimelinePoint>& points, const uint64_t timeout) const;
+
+    VkDevice m_logical_device;
+    bool m_timeline_semaphore{false};
+    PFN_vkVoidFunction m_get_semaphore_counter_value{nullptr};
+    PFN_vkVoidFunction m_wait_semaphores{nullptr};
+
+    /** @brief Guards the queue map and the fences. */
+    mutable std::mutex m_mutex{};
+    std::unordered_map<VkQueue, std::unique_ptr<QueueTimeline>> m_queues{};
+
+    mutable std::vector<VkFence> m_free_fences{};
+    /** @brief Signaled fences that may still be waited on, recycled once nobody waits. */
+    mutable std::vector<VkFence> m_retired_fences{};
+    /** @brief Threads in vkWaitForFences, which must not see their fences reset. */
+    mutable uint32_t m_fence_waiters{0};
+};
+
+}
@@ -0,0 +1,196 @@
+#pragma once
+/** *******************************************************************
+ * @file IndirectDraw.hpp
+ * @brief Indirect and multi draw submission of many meshes in shared buffers.
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "Algorithm.hpp"
+#include "BasicBuffer.hpp"
+#include "TypeTraits.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace ArcGraphics {
+
+struct IndirectBufferPolicy_DrawIndexed {
+    using value_type = VkDrawIndexedIndirectCommand;
+    static const uint32_t buffer_type_bit;
+};
+
+/**
+ * @brief Device local indirect commands that do not change, e.g. written by a compute shader
+ * or uploaded once.
+ */
+using IndirectBuffer_DrawIndexed = BasicBuffer<IndirectBufferPolicy_DrawIndexed>;
+
+/**
+ * @brief Host visible indirect commands rewritten every frame.
+ *
+ * Like InstanceWriter, the buffer holds one region of capacity commands per
+ * frame in flight, and commands are written straight into the persistently
+ * mapped memory.
+ */
+class IndirectCommandWriter : public IsNotLvalueCopyable
+{
+public:
+    /**
+     * @param capacity commands per frame.
+     */
+    IndirectCommandWriter(const VkPhysicalDevice& physical_device,
+                          const VkDevice& logical_device,
+                          const uint32_t capacity,
+                          const uint32_t frames_in_flight);
+
+    /**
+     * @brief Start writing the commands of a frame, discarding what was written
+     * the last time the frame was in flight.
+     * @param flight_frame RenderPipeline::current_flight_frame() after waiting for the frame.
+     */
+    void begin_frame(const uint32_t flight_frame);
+
+    /**
+     * @brief Add a draw of index_count indices starting at first_index.
+     * @return the index of the command, std::nullopt if the frame is full.
+     */
+    std::optional<uint32_t> add(const uint32_t index_count,
+                                const uint32_t first_index,
+                                const int32_t vertex_offset = 0,
+                                const uint32_t instance_count = 1,
+                                const uint32_t first_instance = 0);
+
+    std::optional<uint32_t> add(const VkDrawIndexedIndirectCommand& command);
+
+    /**
+     * @brief Get the commands written in the current frame.
+     * Reading goes through the mapping, which may be uncached.
+     */
+    [[nodiscard]]
+    const VkDrawIndexedIndirectCommand* commands() const;
+
+    /**
+     * @brief Check whether any command of the current frame has a firstInstance other than 0.
+     */
+    [[nodiscard]]
+    bool uses_first_instance() const;
+
+    [[nodiscard]]
+    VkBuffer buffer() const;
+
+    /**
+     * @brief Get the offset of the current frame in buffer().
+     */
+    [[nodiscard]]
+    VkDeviceSize offset() const;
+
+    /**
+     * @brief Get the number of commands written in the current frame.
+     */
+    [[nodiscard]]
+    uint32_t count() const;
+
+    [[nodiscard]]
+    uint32_t capacity() const;
+
+    void destroy(const VkDevice logical_device);
+
+private:
+    VkBuffer m_buffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_memory{VK_NULL_HANDLE};
+    VkDrawIndexedIndirectCommand* m_mapping{nullptr};
+    uint32_t m_capacity;
+    uint32_t m_frames_in_flight;
+    uint32_t m_frame{0};
+    uint32_t m_count{0};
+    bool m_first_instance{false};
+};
+
+/**
+ * @brief An index range drawn by DrawSubmitter::draw_multi_indexed.
+ * Laid out like VkMultiDrawIndexedInfoEXT, so the array is passed as is.
+ */
+struct MultiDrawIndexed {
+    uint32_t first_index;
+    uint32_t index_count;
+    int32_t vertex_offset;
+};
+
+/**
+ * @brief Issues many draws with as few calls as the device allows.
+ *
+ * Indirect draws go out as one vkCmdDrawIndexedIndirect per maxDrawIndirectCount
+ * commands with multiDrawIndirect, and one call per command without it. Index
+ * ranges known on the CPU go out with vkCmdDrawMultiIndexedEXT when VK_EXT_multi_draw
+ * is enabled, and one vkCmdDrawIndexed each otherwise.
+ */
+class DrawSubmitter
+{
+public:
+    /**
+     * @param features the features enabled on logical_device.
+     * @see ArcGraphics::Device::draw_submission_features
+     */
+    DrawSubmitter(const VkDevice& logical_device,
+                  const DrawSubmissionFeatures& features);
+
+    /**
+     * @brief Draw draw_count indirect commands stride bytes apart, starting at offset.
+     */
+    void draw_indexed_indirect(VkCommandBuffer command_buffer,
+                               const VkBuffer buffer,
+                               const VkDeviceSize offset,
+                               const uint32_t draw_count,
+                               const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand)) const;
+
+    /**
+     * @brief Draw the commands in buffer, as many as the count in count_buffer but
+     * at most max_draw_count.
+     * Without VK_KHR_draw_indirect_count all max_draw_count commands are drawn, so
+     * the commands past the count must have an instanceCount of 0.
+     */
+    void draw_indexed_indirect_count(VkCommandBuffer command_buffer,
+                                     const VkBuffer buffer,
+                                     const VkDeviceSize offset,
+                                     const VkBuffer count_buffer,
+                                     const VkDeviceSize count_offset,
+                                     const uint32_t max_draw_count,
+                                     const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand)) const;
+
+    /**
+     * @brief Draw the commands of the current frame of writer.
+     * Without drawIndirectFirstInstance, commands with a firstInstance are
+     * read back from the mapping and drawn directly.
+     */
+    void draw(VkCommandBuffer command_buffer, const IndirectCommandWriter& writer) const;
+
+    /**
+     * @brief Draw every index range with the same instances.
+     */
+    void draw_multi_indexed(VkCommandBuffer command_buffer,
+                            const MultiDrawIndexed* draws,
+                            const uint32_t draw_count,
+                            const uint32_t instance_count = 1,
+                            const uint32_t first_instance = 0) const;
+
+    void draw_multi_indexed(VkCommandBuffer command_buffer,
+                            const std::vector<MultiDrawIndexed>& draws,
+                            const uint32_t instance_count = 1,
+                            const uint32_t first_instance = 0) const;
+
+    [[nodiscard]]
+    const DrawSubmissionFeatures& features() const noexcept;
+
+private:
+    DrawSubmissionFeatures m_features;
+    /** @brief vkCmdDrawMultiIndexedEXT, nullptr without VK_EXT_multi_draw. */
+    PFN_vkVoidFunction m_draw_multi_indexed{nullptr};
+    /** @brief vkCmdDrawIndexedIndirectCountKHR, nullptr without VK_KHR_draw_indirect_count. */
+    PFN_vkCmdDrawIndexedIndirectCountKHR m_draw_indexed_indirect_count{nullptr};
+};
+
+}
@@ -0,0 +1,146 @@
+#pragma once
+/** *******************************************************************
+ * @file InstanceBuffer.hpp
+ * @brief Per instance vertex streams, for drawing many copies of a mesh in one call.
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "BasicBuffer.hpp"
+#include "GLM.hpp"
+#include "TypeTraits.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace ArcGraphics {
+
+/**
+ * @brief A model matrix and a color per instance.
+ * The matrix takes four consecutive locations, one per column.
+ */
+struct Instance_TransformColor {
+    glm::mat4 model{1.0f};
+    glm::vec4 color{1.0f};
+
+    /**
+     * @param binding the binding index of the instance stream, after the vertex bindings.
+     */
+    [[nodiscard]]
+    static VkVertexInputBindingDescription get_binding_description(const uint32_t binding = 1);
+
+    /**
+     * @param first_location the location of the first matrix column, after the vertex attributes.
+     */
+    [[nodiscard]]
+    static std::vector<VkVertexInputAttributeDescription> get_attribute_descriptions(
+        const uint32_t binding = 1,
+        const uint32_t first_location = 2);
+};
+
+struct InstanceBufferPolicy_TransformColor {
+    using value_type = Instance_TransformColor;
+    static const uint32_t buffer_type_bit;
+};
+
+/**
+ * @brief Device local instances that do not change, uploaded like vertex buffers.
+ */
+using InstanceBuffer_TransformColor = BasicBuffer<InstanceBufferPolicy_TransformColor>;
+
+/**
+ * @brief Host visible instance data rewritten every frame.
+ *
+ * The buffer holds one region of capacity instances per frame in flight, so
+ * writing the instances of a frame never touches data a previous frame may
+ * still be reading. Instances are written straight into the persistently mapped
+ * memory, and bind() binds the region of the current frame, so the index returned
+ * by write() is the firstInstance of the draw.
+ */
+class InstanceWriter : public IsNotLvalueCopyable
+{
+public:
+    /**
+     * @param instance_size size of one instance, the stride of the binding.
+     * @param capacity instances per frame.
+     */
+    InstanceWriter(const VkPhysicalDevice& physical_device,
+                   const VkDevice& logical_device,
+                   const VkDeviceSize instance_size,
+                   const uint32_t capacity,
+                   const uint32_t frames_in_flight);
+
+    /**
+     * @brief Start writing the instances of a frame, discarding what was written
+     * the last time the frame was in flight.
+     * @param flight_frame RenderPipeline::current_flight_frame() after waiting for the frame.
+     */
+    void begin_frame(const uint32_t flight_frame);
+
+    /**
+     * @brief Reserve count instances in the current frame.
+     * @return pointer to the reserved instances and the index of the first one,
+     * std::nullopt if the frame is full.
+     */
+    [[nodiscard]]
+    std::optional<std::pair<void*, uint32_t>> allocate(const uint32_t count);
+
+    /**
+     * @brief Copy instances into the current frame.
+     * @return the index of the first instance, std::nullopt if the frame is full.
+     * @throw std::invalid_argument if the instance type differs in size from the stream.
+     */
+    template <typename Instance>
+    [[nodiscard]]
+    std::optional<uint32_t> write(const Instance* instances, const uint32_t count)
+    {
+        if (sizeof(Instance) != m_instance_size)
+            throw std::invalid_argument("Instance type does not match the instance stream!");
+        const auto region = allocate(count);
+        if (!region)
+            return std::nullopt;
+        memcpy(region->first, instances, size_t(count) * sizeof(Instance));
+        return region->second;
+    }
+
+    template <typename Instance>
+    [[nodiscard]]
+    std::optional<uint32_t> write(const std::vector<Instance>& instances)
+    {
+        return write(instances.data(), static_cast<uint32_t>(instances.size()));
+    }
+
+    /**
+     * @brief Bind the instances of the current frame to binding.
+     */
+    void bind(VkCommandBuffer command_buffer, const uint32_t binding) const;
+
+    /**
+     * @brief Get the number of instances written in the current frame.
+     */
+    [[nodiscard]]
+    uint32_t count() const;
+
+    [[nodiscard]]
+    uint32_t capacity() const;
+
+    void destroy(const VkDevice logical_device);
+
+private:
+    VkBuffer m_buffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_memory{VK_NULL_HANDLE};
+    unsigned char* m_mapping{nullptr};
+    VkDeviceSize m_instance_size;
+    uint32_t m_capacity;
+    uint32_t m_frames_in_flight;
+    uint32_t m_frame{0};
+    uint32_t m_count{0};
+};
+
+}
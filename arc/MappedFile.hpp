@@ -0,0 +1,51 @@
+#pragma once
+/** *******************************************************************
+ * @file MappedFile.hpp
+ * @brief Read only memory mapping of whole files.
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "TypeTraits.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace ArcGraphics {
+
+/**
+ * @brief A file mapped read only into the address space, unmapped on destruction.
+ * Reading the mapping pulls pages straight from the page cache, so the file
+ * contents are never copied into a buffer of our own.
+ */
+class MappedFile : public IsNotLvalueCopyable
+{
+public:
+    /**
+     * @brief Map the whole file at path.
+     * @return nullptr if the file could not be opened or mapped, or is empty.
+     */
+    [[nodiscard]]
+    static std::unique_ptr<MappedFile> open(const std::string& path);
+
+    ~MappedFile();
+
+    [[nodiscard]]
+    const unsigned char* data() const;
+
+    [[nodiscard]]
+    size_t size() const;
+
+private:
+    MappedFile() = default;
+
+    const unsigned char* m_data{nullptr};
+    size_t m_size{0};
+#if defined(_WIN32)
+    void* m_file{nullptr};
+    void* m_mapping{nullptr};
+#endif
+};
+
+}
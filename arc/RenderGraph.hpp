@@ -0,0 +1,282 @@
+#pragma once
+/** *******************************************************************
+ * @file RenderGraph.hpp
+ * @brief Frame graph of passes that declare the images and buffers they use.
+ *
+ * From the declarations the graph works out:
+ *   - which passes contribute nothing to an imported resource and can be culled,
+ *   - the barriers between passes, only where a hazard or layout change needs one,
+ *     with synchronization2 stage and access masks when the device has them,
+ *   - the lifetimes of transient images, which share memory when their
+ *     lifetimes do not overlap, or get lazily allocated memory when they are
+ *     only ever used as attachments.
+ *
+ * Passes record their own commands, e.g. render passes of RenderPipeline, and
+ * run in the order they were added.
+ *
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "Device.hpp"
+#include "TypeTraits.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ArcGraphics {
+
+/**
+ * @brief How a pass uses a resource.
+ * Attachment writes include the reads of load operations and blending.
+ */
+enum class RenderAccess : uint8_t {
+    color_attachment_write,
+    depth_attachment_write,
+    depth_attachment_read,
+    fragment_sampled_read,
+    compute_sampled_read,
+    compute_storage_read,
+    compute_storage_write,
+    vertex_buffer_read,
+    index_buffer_read,
+    indirect_read,
+    uniform_read,
+    transfer_read,
+    transfer_write,
+};
+
+struct RenderGraphImage {
+    uint32_t index;
+};
+
+struct RenderGraphBuffer {
+    uint32_t index;
+};
+
+struct RenderGraphImageDescription {
+    uint32_t width;
+    uint32_t height;
+    VkFormat format;
+    VkImageAspectFlags aspect{VK_IMAGE_ASPECT_COLOR_BIT};
+};
+
+class RenderGraph : public IsNotLvalueCopyable
+{
+public:
+    class PassBuilder;
+    using ExecuteFunction = std::function<void(VkCommandBuffer, const RenderGraph&)>;
+
+    explicit RenderGraph(Device* device);
+
+    /**
+     * @brief Declare an image that only lives within the frame.
+     * Its contents are undefined at its first use in every frame.
+     */
+    RenderGraphImage create_image(const std::string& name,
+                                  const RenderGraphImageDescription& description);
+
+    /**
+     * @brief Declare an image owned outside the graph, e.g. a swap chain image.
+     * Passes writing imported images are never culled.
+     * @param final_layout the layout the image is left in after the frame.
+     */
+    RenderGraphImage import_image(const std::string& name,
+                                  const VkImage image,
+                                  const VkImageView view,
+                                  const VkImageAspectFlags aspect,
+                                  const VkImageLayout initial_layout,
+                                  const VkImageLayout final_layout);
+
+    /**
+     * @brief Declare a buffer owned outside the graph.
+     * Work before the frame, e.g. on the compute queue, must be synchronized by
+     * the caller, e.g. with RenderPipeline::wait_for_semaphore.
+     */
+    RenderGraphBuffer import_buffer(const std::string& name, const VkBuffer buffer);
+
+    /**
+     * @brief Swap the handles of an imported image, e.g. for the acquired swap chain image.
+     */
+    void set_imported_image(const RenderGraphImage image,
+                            const VkImage handle,
+                            const VkImageView view);
+
+    void set_imported_buffer(const RenderGraphBuffer buffer, const VkBuffer handle);
+
+    /**
+     * @param setup declares the resources the pass uses.
+     * @param execute records the commands of the pass.
+     */
+    void add_pass(const std::string& name,
+                  const std::function<void(PassBuilder&)>& setup,
+                  ExecuteFunction execute);
+
+    /**
+     * @brief Cull passes, create and alias the transient images and plan the barriers.
+     * Passes and resources can not be added afterwards.
+     */
+    void compile();
+
+    /**
+     * @brief Record every pass that was not culled, with its barriers.
+     */
+    void execute(VkCommandBuffer command_buffer);
+
+    [[nodiscard]]
+    VkImage image(const RenderGraphImage image) const;
+
+    [[nodiscard]]
+    VkImageView image_view(const RenderGraphImage image) const;
+
+    [[nodiscard]]
+    VkBuffer buffer(const RenderGraphBuffer buffer) const;
+
+    /**
+     * @brief Get the names of the passes that survived culling, in execution order.
+     */
+    [[nodiscard]]
+    std::vector<std::string> executed_passes() const;
+
+    /**
+     * @brief Get the memory bound to aliased transient images, and what
+     * it would have been without aliasing.
+     */
+    [[nodiscard]]
+    VkDeviceSize transient_memory_size() const;
+
+    [[nodiscard]]
+    VkDeviceSize unaliased_transient_memory_size() const;
+
+    /**
+     * @brief Get the number of barriers recorded by the last execute().
+     */
+    [[nodiscard]]
+    uint32_t barrier_count() const;
+
+    void destroy();
+
+private:
+    /** @brief Stage and access masks, in synchronization2 bits when enabled. */
+    struct AccessScope {
+        uint64_t stages{0};
+        uint64_t access{0};
+    };
+
+    struct Use {
+        uint32_t resource;
+        RenderAccess access;
+    };
+
+    struct Pass {
+        std::string name;
+        std::vector<Use> uses{};
+        bool side_effects{false};
+        bool culled{false};
+        ExecuteFunction execute;
+    };
+
+    struct Resource {
+        std::string name;
+        bool is_image;
+        bool imported;
+        RenderGraphImageDescription description{};
+        VkImage image{VK_NULL_HANDLE};
+        VkImageView view{VK_NULL_HANDLE};
+        VkBuffer buffer{VK_NULL_HANDLE};
+        VkImageLayout initial_layout{VK_IMAGE_LAYOUT_UNDEFINED};
+        VkImageLayout final_layout{VK_IMAGE_LAYOUT_UNDEFINED};
+        VkImageUsageFlags usage{0};
+        /** @brief Passes of the first and last use, after culling. */
+        uint32_t first_pass{UINT32_MAX};
+        uint32_t last_pass{0};
+        /** @brief The access of the last use, which the next frame waits for. */
+        AccessScope last_use{};
+        /** @brief Transient images sharing memory with this one. */
+        std::vector<uint32_t> aliases{};
+    };
+
+    /** @brief Synchronization state of a resource while executing. */
+    struct ResourceState {
+        VkImageLayout layout;
+        AccessScope last_write;
+        /** @brief Stages reading since the last write. */
+        uint64_t read_stages;
+        /** @brief What the last write has been made visible to. */
+        AccessScope visible;
+        bool used;
+    };
+
+    struct Barrier {
+        uint32_t resource;
+        AccessScope source;
+        AccessScope destination;
+        VkImageLayout old_layout;
+        VkImageLayout new_layout;
+    };
+
+    [[nodiscard]]
+    AccessScope scope_of(const RenderAccess access) const;
+
+    void cull_passes();
+    void create_transient_images();
+    /**
+     * @brief Plan the barrier before a pass, for the merged uses of the pass of a resource.
+     */
+    void plan_barrier(const uint32_t resource,
+                      const AccessScope& scope,
+                      const VkImageLayout layout,
+                      const bool write,
+                      std::vector<Barrier>& barriers);
+    void record_barriers(VkCommandBuffer command_buffer, const std::vector<Barrier>& barriers);
+
+    Device* m_device;
+    bool m_synchronization2;
+    PFN_vkVoidFunction m_pipeline_barrier2{nullptr};
+    bool m_compiled{false};
+    std::vector<Pass> m_passes{};
+    std::vector<Resource> m_resources{};
+    std::vector<ResourceState> m_states{};
+    std::vector<VkDeviceMemory> m_memory{};
+    VkDeviceSize m_transient_memory_size{0};
+    VkDeviceSize m_unaliased_transient_memory_size{0};
+    uint32_t m_barrier_count{0};
+};
+
+/**
+ * @brief Declares the resources of a pass, see RenderGraph::add_pass.
+ */
+class RenderGraph::PassBuilder
+{
+public:
+    /**
+     * @throws std::invalid_argument if access writes.
+     */
+    PassBuilder& read(const RenderGraphImage image, const RenderAccess access);
+    PassBuilder& read(const RenderGraphBuffer buffer, const RenderAccess access);
+
+    /**
+     * @throws std::invalid_argument if access only reads.
+     */
+    PassBuilder& write(const RenderGraphImage image, const RenderAccess access);
+    PassBuilder& write(const RenderGraphBuffer buffer, const RenderAccess access);
+
+    /**
+     * @brief Keep the pass even when nothing uses what it writes, e.g. for readbacks.
+     */
+    PassBuilder& side_effects();
+
+private:
+    friend class RenderGraph;
+    PassBuilder(RenderGraph& graph, Pass& pass);
+    PassBuilder& use(const uint32_t resource, const bool is_image, const RenderAccess access);
+
+    RenderGraph& m_graph;
+    Pass& m_pass;
+};
+
+}
@@ -7,6 +7,8 @@
 #include "UniformBuffer.hpp"
 #include "Algorithm.hpp"
 
+#include <cstdint>
+#include <functional>
 #include <vector>
 #include <string>
 
@@ -31,7 +33,25 @@ VkShaderModule compile_shader_bytecode(const VkDevice logical_device,
 struct RenderFrameLocks {
     VkSemaphore semaphore_image_available;
     VkSemaphore semaphore_rendering_finished;
-    VkFence fence_in_flight;
+    /**
+     * @brief Points of Device::timeline() signaled and waited for by the last submission
+     * of the frame, which are done before the frame slot is reused.
+     */
+    std::vector<TimelinePoint> timeline_points{};
+};
+
+enum class FrameAcquireResult : uint8_t {
+    acquired,
+    /** @brief The frame slot is still on the GPU, or no swap chain image was ready in time. */
+    not_ready,
+    /** @brief The swap chain must be recreated. */
+    out_of_date,
+};
+
+struct FrameAcquire {
+    FrameAcquireResult result;
+    /** @brief The acquired swap chain image, only valid when acquired. */
+    uint32_t image_index{0};
 };
     
 class RenderPipeline : public IsNotLvalueCopyable
@@ -55,12 +75,52 @@ public:
     uint32_t max_frames_in_flight() const;
     uint32_t current_flight_frame() const;
     const VkPipelineLayout& layout() const;
+    const VkPipeline& graphics_pipeline() const;
+
+    /**
+     * @brief Called once per frame when its slot is no longer in use by the GPU,
+     * before the swap chain image is acquired.
+     */
+    using FrameSlotCallback = std::function<void(const uint32_t flight_frame)>;
 
+    /**
+     * @brief Wait until the next frame in flight has finished on the GPU, then acquire a swap chain image.
+     * @return std::nullopt if the swap chain is out of date.
+     */
     std::optional<uint32_t> wait_for_next_frame();
+
+    /**
+     * @brief Acquire the next frame if its slot and a swap chain image are ready,
+     * so the caller can do other work while the GPU is busy and poll again.
+     * @param timeout in nanoseconds for both waits together, 0 returns immediately.
+     */
+    FrameAcquire try_begin_frame(const uint64_t timeout = 0);
+
+    void set_frame_slot_callback(FrameSlotCallback callback);
+
+    /**
+     * @brief Get the timeline point signaled by the last submitted frame, e.g.
+     * to release or read back resources once Device::timeline() reaches it.
+     */
+    [[nodiscard]]
+    TimelinePoint last_timeline_point() const;
   
     VkCommandBuffer begin_command_buffer(uint32_t image_index);
 
     void end_command_buffer(VkCommandBuffer command_buffer, uint32_t image_index);
+
+    /**
+     * @brief Make the next submission wait for semaphore before stage, e.g. for
+     * compute output the frame reads.
+     * @see ArcGraphics::ComputePipeline::end_command_buffer
+     */
+    void wait_for_semaphore(const VkSemaphore semaphore, const VkPipelineStageFlags stage);
+
+    /**
+     * @brief Make the next submission wait for a point of Device::timeline() before stage,
+     * e.g. for work of another queue the frame reads. Waiting twice is harmless.
+     */
+    void wait_for_timeline(const TimelinePoint& point, const VkPipelineStageFlags stage);
     
     ~RenderPipeline() = default;
     void destroy();
@@ -79,6 +139,13 @@ private:
     std::vector<RenderFrameLocks> m_framelocks;
     std::vector<VkCommandBuffer> m_commandbuffers;
     uint32_t m_current_flight_frame{0};
+    TimelinePoint m_last_timeline_point{};
+    FrameSlotCallback m_frame_slot_callback{};
+    /** @brief Whether the callback already ran for the slot of the current frame. */
+    bool m_frame_slot_reported{false};
+    std::vector<VkSemaphore> m_extra_wait_semaphores{};
+    std::vector<VkPipelineStageFlags> m_extra_wait_stages{};
+    std::vector<TimelineWait> m_timeline_waits{};
 
     bool m_swap_chain_framebuffer_resized{false};
     VkCommandPool m_command_pool;
@@ -107,6 +174,13 @@ public:
                               const uint32_t height);
 
     Builder& with_clear_color(const float r, const float g, const float b);
+
+    /**
+     * @brief Add another vertex input binding, e.g. a per instance stream with
+     * VK_VERTEX_INPUT_RATE_INSTANCE, along with the attributes it feeds.
+     */
+    Builder& with_vertex_binding(const VkVertexInputBindingDescription binding_description,
+                                 const std::vector<VkVertexInputAttributeDescription> attribute_descriptions);
     [[nodiscard]]
     RenderPipeline produce();
     
@@ -116,7 +190,7 @@ private:
     ShaderBytecode m_vertex_bytecode;
     ShaderBytecode m_fragment_bytecode;
     VkDescriptorSetLayout m_descriptorset_layout{};
-    VkVertexInputBindingDescription m_vertex_binding_description{};
+    std::vector<VkVertexInputBindingDescription> m_vertex_binding_descriptions{};
     std::vector<VkVertexInputAttributeDescription> m_vertex_attribute_descriptions{};
 
     uint32_t m_max_frames_in_flight{2};
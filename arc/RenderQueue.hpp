@@ -0,0 +1,162 @@
+#pragma once
+/** *******************************************************************
+ * @file RenderQueue.hpp
+ * @brief Draws sorted by packed state keys, recorded with as few binds as possible.
+ *
+ * Every draw gets a 64 bit key, most significant bits first:
+ *
+ *   opaque:      layer:4 | 0 | pipeline:11 | material:16 | mesh:16 | depth:16
+ *   transparent: layer:4 | 1 | ~depth:16   | pipeline:11 | material:16 | mesh:16
+ *
+ * so opaque draws group by state and then go front to back for early depth
+ * rejection, while transparent draws go back to front after the opaque draws
+ * of their layer.
+ *
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "TypeTraits.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ArcGraphics {
+
+struct RenderSortEntry {
+    uint64_t key;
+    /** @brief Index of the draw in the queue. */
+    uint32_t index;
+};
+
+/**
+ * @brief Stable least significant digit radix sort on the keys, 8 bits per pass.
+ * Passes where every key has the same digit are skipped, so unused high bits
+ * cost a counting pass but no scatter.
+ * @param scratch reused between calls to avoid allocation.
+ */
+void radix_sort(std::vector<RenderSortEntry>& entries, std::vector<RenderSortEntry>& scratch);
+
+enum class RenderBlend : uint8_t {
+    opaque,
+    transparent,
+};
+
+/**
+ * @brief Bind and draw counts of the last RenderQueue::record.
+ */
+struct RenderQueueStats {
+    uint32_t draws{0};
+    uint32_t pipeline_binds{0};
+    uint32_t material_binds{0};
+    uint32_t mesh_binds{0};
+};
+
+class RenderQueue : public IsNotLvalueCopyable
+{
+public:
+    static constexpr uint32_t max_layers = 1u << 4;
+    static constexpr uint32_t max_pipelines = 1u << 11;
+    static constexpr uint32_t max_materials = 1u << 16;
+    static constexpr uint32_t max_meshes = 1u << 16;
+
+    /**
+     * @brief Register a pipeline, e.g. RenderPipeline::graphics_pipeline() and layout().
+     * @return the id to submit draws with.
+     * @throws std::length_error past max_pipelines.
+     */
+    uint32_t add_pipeline(const VkPipeline pipeline, const VkPipelineLayout layout);
+
+    /**
+     * @brief Register a descriptor set bound at set index first_set.
+     * Sets below first_set, e.g. per frame data, are left to the caller.
+     */
+    uint32_t add_material(const VkDescriptorSet descriptor_set, const uint32_t first_set = 0);
+
+    /**
+     * @brief Register vertex buffers bound from binding 0 and an index buffer.
+     */
+    uint32_t add_mesh(const std::vector<VkBuffer>& vertex_buffers,
+                      const VkBuffer index_buffer,
+                      const VkIndexType index_type = VK_INDEX_TYPE_UINT32,
+                      const std::vector<VkDeviceSize>& vertex_offsets = {},
+                      const VkDeviceSize index_offset = 0);
+
+    /**
+     * @brief Replace the descriptor set of a material, e.g. for the next frame in flight.
+     */
+    void set_material(const uint32_t material, const VkDescriptorSet descriptor_set);
+
+    /**
+     * @brief Drop the draws of the last frame, registered state is kept.
+     */
+    void clear();
+
+    /**
+     * @param depth view space distance to the camera, negative values are treated as 0.
+     * @throws std::out_of_range for unknown ids or a layer past max_layers.
+     */
+    void submit(const uint32_t layer,
+                const RenderBlend blend,
+                const uint32_t pipeline,
+                const uint32_t material,
+                const uint32_t mesh,
+                const float depth,
+                const VkDrawIndexedIndirectCommand& command);
+
+    /**
+     * @brief Sort the draws and record them into command_buffer, binding a
+     * pipeline, material or mesh only when it differs from the previous draw.
+     * Must be called inside a render pass compatible with the registered pipelines.
+     */
+    RenderQueueStats record(VkCommandBuffer command_buffer);
+
+    [[nodiscard]]
+    size_t size() const;
+
+    [[nodiscard]]
+    static uint64_t make_key(const uint32_t layer,
+                             const RenderBlend blend,
+                             const uint32_t pipeline,
+                             const uint32_t material,
+                             const uint32_t mesh,
+                             const float depth);
+
+private:
+    struct Pipeline {
+        VkPipeline pipeline;
+        VkPipelineLayout layout;
+    };
+
+    struct Material {
+        VkDescriptorSet descriptor_set;
+        uint32_t first_set;
+    };
+
+    struct Mesh {
+        std::vector<VkBuffer> vertex_buffers;
+        std::vector<VkDeviceSize> vertex_offsets;
+        VkBuffer index_buffer;
+        VkDeviceSize index_offset;
+        VkIndexType index_type;
+    };
+
+    struct Draw {
+        uint32_t pipeline;
+        uint32_t material;
+        uint32_t mesh;
+        VkDrawIndexedIndirectCommand command;
+    };
+
+    std::vector<Pipeline> m_pipelines{};
+    std::vector<Material> m_materials{};
+    std::vector<Mesh> m_meshes{};
+    std::vector<Draw> m_draws{};
+    std::vector<RenderSortEntry> m_entries{};
+    std::vector<RenderSortEntry> m_scratch{};
+};
+
+}
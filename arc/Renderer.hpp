@@ -3,6 +3,7 @@
 #include "SDLVulkan.hpp"
 #include "Device.hpp"
 #include "Texture.hpp"
+#include "Timing.hpp"
 
 #include <vector>
 
@@ -26,7 +27,8 @@ public:
              const VkImage depthbuffer_image,
              const VkDeviceMemory depthbuffer_memory,
              const VkImageView depthbuffer_view,
-             const VkFormat depthbuffer_format
+             const VkFormat depthbuffer_format,
+             const PhaseTimings startup_timings
              );
 
     ~Renderer() = default;
@@ -46,6 +48,8 @@ public:
 
     VkExtent2D window_size() const;
 
+    const PhaseTimings& startup_timings() const;
+
 private:
     Device* m_device{nullptr};
     SDL_Window* m_window{nullptr};
@@ -62,6 +66,8 @@ private:
     VkDeviceMemory m_depthbuffer_memory;
     VkImageView m_depthbuffer_view;
     VkFormat m_depthbuffer_format;
+
+    PhaseTimings m_startup_timings;
 };
     
 class Renderer::Builder 
@@ -70,6 +76,12 @@ class Renderer::Builder
     Builder(Device* device);
     ~Builder() = default;
 
+    /**
+     * @brief Produce the Renderer.
+     * @note If the device was produced with a window, that window and its surface
+     * are reused and the window settings of this builder are ignored.
+     * @see ArcGraphics::Device::Builder::with_window
+     */
     [[nodiscard]]
     Renderer produce();
 
@@ -0,0 +1,65 @@
+#pragma once
+/** *******************************************************************
+ * @file SamplerCache.hpp
+ * @brief Sharing of samplers with identical settings between textures.
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "TypeTraits.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+namespace ArcGraphics {
+
+/**
+ * @brief Creates each distinct sampler once and hands out the same handle after that.
+ *
+ * Devices limit the number of live samplers (maxSamplerAllocationCount), while
+ * most textures are sampled with the same settings. Samplers from the cache are
+ * owned by it, and stay alive until destroy().
+ */
+class SamplerCache : public IsNotLvalueCopyable
+{
+public:
+    SamplerCache(const VkPhysicalDevice physical_device, const VkDevice logical_device);
+
+    /**
+     * @brief Get the sampler for info, creating it on first use.
+     * maxAnisotropy is clamped to maxSamplerAnisotropy of the device before lookup.
+     * @throw std::invalid_argument if info has a pNext chain, which can not be compared.
+     * @throw std::runtime_error if the sampler could not be created.
+     */
+    [[nodiscard]]
+    VkSampler get(const VkSamplerCreateInfo& info);
+
+    /**
+     * @brief Get the number of distinct samplers created.
+     */
+    [[nodiscard]]
+    size_t size() const;
+
+    /**
+     * @brief Destroy every sampler, textures using them must be destroyed first.
+     */
+    void destroy();
+
+private:
+    /** @brief Every field of VkSamplerCreateInfo after pNext, floats by their bits. */
+    using Key = std::array<uint32_t, 16>;
+
+    [[nodiscard]]
+    static Key make_key(const VkSamplerCreateInfo& info);
+
+    VkDevice m_logical_device;
+    float m_max_anisotropy;
+    mutable std::mutex m_mutex{};
+    std::map<Key, VkSampler> m_samplers{};
+};
+
+}
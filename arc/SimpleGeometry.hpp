@@ -3,7 +3,10 @@
 #include "IndexBuffer.hpp" 
 #include "BasicBuffer.hpp" 
 
+#include <cstdint>
+#include <functional>
 #include <tuple>
+#include <vector>
 
 namespace ArcGraphics {
     
@@ -31,5 +34,109 @@ create_unit_plane();
 [[nodiscard]]
 std::pair<VertexBuffer_PosTex::vector_type, ArcGraphics::IndexBuffer::vector_type>
 create_unit_cube();
+
+using Geometry = std::pair<VertexBuffer_PosTex::vector_type, ArcGraphics::IndexBuffer::vector_type>;
+
+/**
+ * @brief A grid of columns x rows quads in the XY plane, spanning [-0.5, 0.5] like the unit plane.
+ * @throw std::invalid_argument for this and the other generators if a resolution is too small.
+ */
+[[nodiscard]]
+Geometry create_grid(const uint32_t columns, const uint32_t rows);
+
+/**
+ * @brief A sphere of radius 0.5 with segments around the Y axis and rings from pole to pole.
+ * The seam and the poles have duplicated vertices, so the texture wraps once around.
+ */
+[[nodiscard]]
+Geometry create_uv_sphere(const uint32_t segments, const uint32_t rings);
+
+/**
+ * @brief A sphere of radius 0.5 made by splitting each face of an icosahedron into
+ * 4^subdivisions triangles, which spreads the vertices more evenly than a UV sphere.
+ * @throw std::invalid_argument if subdivisions is above 10.
+ */
+[[nodiscard]]
+Geometry create_icosphere(const uint32_t subdivisions);
+
+/**
+ * @brief A capped cylinder of radius 0.5 and height 1 along the Y axis.
+ */
+[[nodiscard]]
+Geometry create_cylinder(const uint32_t segments, const uint32_t height_segments = 1);
+
+/**
+ * @brief A torus around the Y axis, whose tube circles at major_radius.
+ */
+[[nodiscard]]
+Geometry create_torus(const uint32_t major_segments,
+                      const uint32_t minor_segments,
+                      const float major_radius = 0.375f,
+                      const float minor_radius = 0.125f);
+
+/**
+ * @brief The indices of a level of detail, within the shared buffers of a LodGeometry.
+ */
+struct GeometryLod {
+    uint32_t first_index;
+    uint32_t index_count;
+};
+
+/**
+ * @brief Every level of detail of a mesh in a single vertex and index buffer.
+ * Level 0 is the most detailed, indices are rebased so every level is drawn with
+ * a vertex offset of 0.
+ */
+struct LodGeometry {
+    VertexBuffer_PosTex::vector_type vertices{};
+    IndexBuffer::vector_type indices{};
+    std::vector<GeometryLod> levels{};
+};
+
+/**
+ * @brief Build a chain of levels by calling generate with the levels 0 to level_count - 1.
+ * Generators are expected to halve their resolution with each level.
+ */
+[[nodiscard]]
+LodGeometry create_lod_chain(const uint32_t level_count,
+                             const std::function<Geometry(const uint32_t level)>& generate);
+
+/**
+ * @brief Halve resolution once per level, without going below minimum.
+ */
+[[nodiscard]]
+uint32_t lod_resolution(const uint32_t resolution, const uint32_t level, const uint32_t minimum);
+
+[[nodiscard]]
+LodGeometry create_grid_lods(const uint32_t columns, const uint32_t rows, const uint32_t level_count);
+
+[[nodiscard]]
+LodGeometry create_uv_sphere_lods(const uint32_t segments, const uint32_t rings, const uint32_t level_count);
+
+/**
+ * @brief Icosphere levels drop one subdivision each, down to the plain icosahedron.
+ */
+[[nodiscard]]
+LodGeometry create_icosphere_lods(const uint32_t subdivisions, const uint32_t level_count);
+
+[[nodiscard]]
+LodGeometry create_cylinder_lods(const uint32_t segments, const uint32_t level_count);
+
+[[nodiscard]]
+LodGeometry create_torus_lods(const uint32_t major_segments,
+                              const uint32_t minor_segments,
+                              const uint32_t level_count);
+
+/**
+ * @brief Pick the level of detail for an object of radius seen from distance.
+ * Level 0 is used within detail_distance radii of the object, and every further
+ * level covers twice the distance of the previous one, matching levels that halve
+ * their resolution.
+ */
+[[nodiscard]]
+uint32_t select_lod(const float distance,
+                    const float radius,
+                    const uint32_t level_count,
+                    const float detail_distance = 8.0f);
     
 }
@@ -0,0 +1,83 @@
+#pragma once
+/** *******************************************************************
+ * @file StagingBuffer.hpp
+ * @brief A persistently mapped staging buffer that uploads are written into directly.
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "TypeTraits.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <optional>
+
+namespace ArcGraphics {
+
+/**
+ * @brief A range of a StagingBuffer, with its host address.
+ */
+struct StagingRegion {
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    unsigned char* data;
+};
+
+/**
+ * @brief Host visible transfer source buffer that stays mapped for its whole life.
+ *
+ * Regions are handed out front to back. Loaders decode or copy straight into a
+ * region, so no other CPU copy of the data has to exist. The buffer is created
+ * once and reused, instead of one staging buffer per upload.
+ */
+class StagingBuffer : public IsNotLvalueCopyable
+{
+public:
+    /**
+     * @throw std::runtime_error if the buffer could not be created or mapped.
+     */
+    StagingBuffer(const VkPhysicalDevice& physical_device,
+                  const VkDevice& logical_device,
+                  const VkDeviceSize capacity);
+
+    /**
+     * @brief Take the next size bytes of the buffer.
+     * @param alignment of the offset, which buffer to image copies need to be a
+     * multiple of the texel block size and of 4.
+     * @return std::nullopt if the rest of the buffer is too small.
+     */
+    [[nodiscard]]
+    std::optional<StagingRegion> allocate(const VkDeviceSize size,
+                                          const VkDeviceSize alignment = 16);
+
+    /**
+     * @brief Give back region once the transfers reading it have completed.
+     * Regions are released in reverse order of allocation, anything else waits for reset().
+     */
+    void release(const StagingRegion& region);
+
+    /**
+     * @brief Make the whole buffer available again, no transfer may be reading it.
+     */
+    void reset();
+
+    [[nodiscard]]
+    const VkBuffer& buffer() const;
+
+    [[nodiscard]]
+    VkDeviceSize capacity() const;
+
+    [[nodiscard]]
+    VkDeviceSize used() const;
+
+    void destroy(const VkDevice logical_device);
+
+private:
+    VkBuffer m_buffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_memory{VK_NULL_HANDLE};
+    unsigned char* m_mapping{nullptr};
+    VkDeviceSize m_capacity;
+    VkDeviceSize m_head{0};
+};
+
+}
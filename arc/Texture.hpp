@@ -1,20 +1,34 @@
 #pragma once
 
 #include <arc/TypeTraits.hpp>
+#include <arc/CompressedImage.hpp>
+#include <arc/SamplerCache.hpp>
+#include <arc/StagingBuffer.hpp>
 
 #include <vulkan/vulkan.h>
 
 #include <string>
 #include <vector>
 #include <memory>
+#include <optional>
 
 namespace ArcGraphics {
 
 class Image : IsNotLvalueCopyable
 {
 public:
-    static std::unique_ptr<Image> load_from_path(const std::string& path);
+    /**
+     * @brief Decode an image, keeping the channel count of the source.
+     * Three channel sources are expanded to four, since RGB formats are rarely
+     * sampleable.
+     * @param desired_channels forces a channel count, 0 keeps the source count.
+     */
+    static std::unique_ptr<Image> load_from_path(const std::string& path,
+                                                 const int desired_channels = 0);
     
+    /**
+     * @param pixels tightly packed with channels bytes per pixel, freed with stbi_image_free.
+     */
     Image(unsigned char* pixels,
           const int width,
           const int height,
@@ -32,6 +46,123 @@ public:
     int m_height;
     int m_channels;
 };
+
+/**
+ * @brief Copy image into a version with more channels.
+ * Gray is replicated to RGB and gray-alpha to (g, g, g, a), expanding gray to two
+ * channels keeps (g, a). Missing color channels are zero and missing alpha is opaque.
+ * @throw std::invalid_argument if channels is less than the channels of image.
+ */
+[[nodiscard]]
+std::unique_ptr<Image> expand_channels(const Image& image, const int channels);
+
+/**
+ * @brief A texture format for images of a given channel count.
+ */
+struct ImageFormat {
+    VkFormat format;
+    /** @brief Channels the pixels must have for the format, may exceed the source. */
+    int channels;
+};
+
+/**
+ * @brief Find the smallest 8 bit format that can be sampled for channels.
+ * R8, R8G8 and R8G8B8A8 (or their sRGB variants) are preferred in that order,
+ * falling back to R8G8B8A8 when the smaller formats are not supported.
+ */
+[[nodiscard]]
+std::optional<ImageFormat> find_image_format(const VkPhysicalDevice& physical_device,
+                                             const int channels,
+                                             const bool srgb);
+
+/**
+ * @brief Get the view swizzle that samples a texture format like the expanded RGBA image.
+ * R8 reads as (r, r, r, 1) and R8G8 as (r, r, r, g), other formats are not swizzled.
+ */
+[[nodiscard]]
+VkComponentMapping texture_swizzle(const VkFormat format);
+   
+/**
+ * @brief Get the settings of the sampler used for textures.
+ * @param max_lod limits the sampled level of detail. VK_LOD_CLAMP_NONE leaves the
+ * limit to the image view, so textures with any number of levels share the settings.
+ */
+[[nodiscard]]
+VkSamplerCreateInfo texture_sampler_info(const VkPhysicalDevice& physical_device,
+                                         const float max_lod = VK_LOD_CLAMP_NONE);
+
+/**
+ * @brief Create the sampler used for textures.
+ * @param mip_levels of the sampled textures, limits the sampled level of detail.
+ * @throw std::runtime_error if the sampler could not be created.
+ */
+[[nodiscard]]
+VkSampler create_texture_sampler(const VkPhysicalDevice& physical_device,
+                                 const VkDevice& logical_device,
+                                 const uint32_t mip_levels = 1);
+
+/**
+ * @brief Get the texture sampler from samplers, or create one when there is no cache.
+ * @return a sampler owned by samplers, or by the caller if samplers is nullptr.
+ */
+[[nodiscard]]
+VkSampler get_texture_sampler(const VkPhysicalDevice& physical_device,
+                              const VkDevice& logical_device,
+                              const uint32_t mip_levels,
+                              SamplerCache* samplers);
+
+/**
+ * @brief Get the number of levels in a full mip chain down to 1x1.
+ */
+[[nodiscard]]
+uint32_t mip_level_count(const uint32_t width, const uint32_t height);
+
+/**
+ * @brief Check if mip levels of format can be generated on the GPU with linear blits.
+ */
+[[nodiscard]]
+bool supports_linear_blit(const VkPhysicalDevice& physical_device, const VkFormat format);
+
+/**
+ * @brief Halve an image with a 2x2 box filter.
+ * For odd sizes the last row and column of the result average three source
+ * rows or columns, so no source pixel is dropped. A size of 1 is sampled
+ * twice, as with clamped sampling.
+ * @param dst must hold max(width/2, 1) * max(height/2, 1) pixels.
+ */
+void downsample_box(const unsigned char* src,
+                    const uint32_t width,
+                    const uint32_t height,
+                    const uint32_t bytes_per_pixel,
+                    unsigned char* dst);
+
+/**
+ * @brief Mip levels generated on the CPU, for formats that can not be blitted.
+ */
+struct MipChain {
+    /** @brief Levels 1 and up after each other, each starting at a multiple of 4. */
+    std::vector<unsigned char> pixels{};
+    /** @brief Offset into pixels of each level, starting with level 1. */
+    std::vector<VkDeviceSize> offsets{};
+};
+
+[[nodiscard]]
+MipChain generate_mip_chain(const Image& image, const uint32_t mip_levels);
+
+/**
+ * @brief Record the upload of a staged texture, leaving every level shader readable.
+ * @param level_offsets holds the offset in staging_buffer of each staged level,
+ * starting with level 0. Levels that are not staged are blitted from the level above.
+ * @param layer_count array layers, every staged level holds all layers after each other.
+ */
+void record_texture_upload(VkCommandBuffer command_buffer,
+                           VkBuffer staging_buffer,
+                           const std::vector<VkDeviceSize>& level_offsets,
+                           VkImage image,
+                           const uint32_t width,
+                           const uint32_t height,
+                           const uint32_t mip_levels,
+                           const uint32_t layer_count = 1);
    
 class Texture : IsNotLvalueCopyable
 {
@@ -40,7 +171,10 @@ public:
             const VkDeviceMemory memory,
             const VkFormat format,
             const VkImageView view,
-            const VkSampler sampler
+            const VkSampler sampler,
+            const uint32_t mip_levels = 1,
+            const uint32_t array_layers = 1,
+            const bool owns_sampler = true
             );
 
     void destroy(const VkDevice logical_device);
@@ -50,13 +184,78 @@ public:
      * @brief Create texture. 
      * @todo Creating textures requires a bunch of optional stuff, and should be
      * fully handled through a builder instead of here.
+     * @param generate_mipmaps creates a full mip chain, blitted on the GPU when the
+     * format supports linear filtering and box filtered on the CPU otherwise.
+     * @param samplers shares the sampler with other textures, see Device::sampler_cache.
+     * Without it the texture creates and destroys its own sampler.
      */
     static std::unique_ptr<Texture> create_staging(const VkPhysicalDevice& physical_device,
                                                    const VkDevice& logical_device,
                                                    const VkCommandPool& command_pool,
                                                    const VkQueue& graphics_queue,
                                                    const VkFormat format,
-                                                   const Image* image);
+                                                   const Image* image,
+                                                   const bool generate_mipmaps = true,
+                                                   SamplerCache* samplers = nullptr);
+
+    /**
+     * @brief Create texture in the smallest format that holds the channels of image.
+     * @see find_image_format
+     * @return nullptr if no format could be found or the texture could not be created.
+     */
+    static std::unique_ptr<Texture> create_from_image(const VkPhysicalDevice& physical_device,
+                                                      const VkDevice& logical_device,
+                                                      const VkCommandPool& command_pool,
+                                                      const VkQueue& graphics_queue,
+                                                      const Image* image,
+                                                      const bool srgb = true,
+                                                      const bool generate_mipmaps = true,
+                                                      SamplerCache* samplers = nullptr);
+
+    /**
+     * @brief Create a 2D array texture with one layer per image.
+     * The view is a VK_IMAGE_VIEW_TYPE_2D_ARRAY, to be sampled with sampler2DArray.
+     * @throw std::invalid_argument if the images differ in size or channels.
+     * @return nullptr if the texture could not be created.
+     */
+    static std::unique_ptr<Texture> create_array(const VkPhysicalDevice& physical_device,
+                                                 const VkDevice& logical_device,
+                                                 const VkCommandPool& command_pool,
+                                                 const VkQueue& graphics_queue,
+                                                 const VkFormat format,
+                                                 const std::vector<const Image*>& layers,
+                                                 const bool generate_mipmaps = true,
+                                                 SamplerCache* samplers = nullptr);
+
+    /**
+     * @brief Create texture from block compressed levels, which are uploaded as is.
+     * @return nullptr if the device can not sample the format of the image.
+     */
+    static std::unique_ptr<Texture> create_compressed(const VkPhysicalDevice& physical_device,
+                                                      const VkDevice& logical_device,
+                                                      const VkCommandPool& command_pool,
+                                                      const VkQueue& graphics_queue,
+                                                      const CompressedImage* image,
+                                                      SamplerCache* samplers = nullptr);
+
+    /**
+     * @brief Create texture from a file without keeping a CPU copy of its pixels.
+     * The file is memory mapped. KTX2 levels are copied from the mapping straight into
+     * staging, other images are decoded from the mapping and freed once staged.
+     * The upload waits for graphics_queue, after which the staging region is released.
+     * @param staging reused for every upload, a temporary buffer is created for files
+     * that do not fit in it.
+     * @return nullptr if the file could not be read or its format is not supported.
+     */
+    static std::unique_ptr<Texture> create_from_file(const VkPhysicalDevice& physical_device,
+                                                     const VkDevice& logical_device,
+                                                     const VkCommandPool& command_pool,
+                                                     const VkQueue& graphics_queue,
+                                                     StagingBuffer& staging,
+                                                     const std::string& path,
+                                                     const bool srgb = true,
+                                                     const bool generate_mipmaps = true,
+                                                     SamplerCache* samplers = nullptr);
     
     [[nodiscard]]
     const VkImage& image();
@@ -72,6 +271,12 @@ public:
 
     [[nodiscard]]
     const VkSampler& sampler();
+
+    [[nodiscard]]
+    uint32_t mip_levels();
+
+    [[nodiscard]]
+    uint32_t array_layers();
     
 private:
     VkImage m_image;
@@ -79,6 +284,9 @@ private:
     VkFormat m_format;
     VkImageView m_view;
     VkSampler m_sampler;
+    uint32_t m_mip_levels;
+    uint32_t m_array_layers;
+    bool m_owns_sampler;
 };
 
 } 
@@ -0,0 +1,135 @@
+#pragma once
+/** *******************************************************************
+ * @file TextureAtlas.hpp
+ * @brief Packing of many small images into a single array texture.
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "GLM.hpp"
+#include "Texture.hpp"
+#include "TypeTraits.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace ArcGraphics {
+
+/**
+ * @brief Where an image ended up in an atlas, sampled as vec3(uv, layer).
+ */
+struct AtlasRegion {
+    glm::vec2 uv_min;
+    glm::vec2 uv_max;
+    uint32_t layer;
+};
+
+/**
+ * @brief Top left corner of a rectangle placed by SkylinePacker, in texels.
+ */
+struct AtlasPosition {
+    uint32_t x;
+    uint32_t y;
+};
+
+/**
+ * @brief Places rectangles in a fixed size area with the bottom left skyline heuristic.
+ *
+ * The packer only tracks the upper outline of the placed rectangles, so insertion
+ * is linear in the number of outline segments. Inserting rectangles sorted by
+ * decreasing height keeps the waste below the outline small.
+ */
+class SkylinePacker
+{
+public:
+    SkylinePacker(const uint32_t width, const uint32_t height);
+
+    /**
+     * @brief Find room for a rectangle and mark it as used.
+     * @return std::nullopt if the rectangle does not fit.
+     */
+    [[nodiscard]]
+    std::optional<AtlasPosition> insert(const uint32_t width, const uint32_t height);
+
+    /**
+     * @brief Get the fraction of the area covered by inserted rectangles.
+     */
+    [[nodiscard]]
+    float occupancy() const;
+
+private:
+    struct Segment {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+    };
+
+    /**
+     * @brief Get the height a rectangle would be placed at when its left edge is at segment index.
+     */
+    [[nodiscard]]
+    std::optional<uint32_t> fit(const size_t index, const uint32_t width, const uint32_t height) const;
+
+    uint32_t m_width;
+    uint32_t m_height;
+    uint64_t m_used_area;
+    std::vector<Segment> m_skyline;
+};
+
+/**
+ * @brief An array texture holding many images, with one region per packed image.
+ */
+struct TextureAtlas : public IsNotLvalueCopyable {
+    std::unique_ptr<Texture> texture{};
+    /** @brief Regions in the order the images were given. */
+    std::vector<AtlasRegion> regions{};
+
+    void destroy(const VkDevice logical_device);
+};
+
+/**
+ * @brief Pack images of any size into the layers of a square array texture.
+ *
+ * Images are placed with SkylinePacker, starting a new layer whenever the current
+ * layers are full. Every image gets padding texels of its own edge around it, so
+ * filtering and the first mip levels do not bleed between neighbours.
+ * All images are expanded to the largest channel count among them.
+ * @param atlas_size width and height of each layer, clamped to the device limit.
+ * @throw std::invalid_argument if an image does not fit in a layer, or there are more
+ * layers than the device supports.
+ * @return nullptr if no format could be found or the texture could not be created.
+ */
+[[nodiscard]]
+std::unique_ptr<TextureAtlas> pack_atlas(const VkPhysicalDevice& physical_device,
+                                         const VkDevice& logical_device,
+                                         const VkCommandPool& command_pool,
+                                         const VkQueue& graphics_queue,
+                                         const std::vector<const Image*>& images,
+                                         const uint32_t atlas_size = 2048,
+                                         const uint32_t padding = 2,
+                                         const bool srgb = true,
+                                         const bool generate_mipmaps = true,
+                                         SamplerCache* samplers = nullptr);
+
+/**
+ * @brief Put images of the same size into an array texture, one layer each.
+ * Every region covers its whole layer.
+ * @see Texture::create_array
+ * @throw std::invalid_argument if the images differ in size.
+ * @return nullptr if no format could be found or the texture could not be created.
+ */
+[[nodiscard]]
+std::unique_ptr<TextureAtlas> pack_texture_array(const VkPhysicalDevice& physical_device,
+                                                 const VkDevice& logical_device,
+                                                 const VkCommandPool& command_pool,
+                                                 const VkQueue& graphics_queue,
+                                                 const std::vector<const Image*>& images,
+                                                 const bool srgb = true,
+                                                 const bool generate_mipmaps = true,
+                                                 SamplerCache* samplers = nullptr);
+
+}
@@ -0,0 +1,162 @@
+#pragma once
+/** *******************************************************************
+ * @file TextureResidency.hpp
+ * @brief Keeps textures within the device memory budget by degrading the least recently used.
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "Device.hpp"
+#include "Texture.hpp"
+#include "TypeTraits.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace ArcGraphics {
+
+using ResidencyHandle = uint32_t;
+
+/**
+ * @brief Manages textures whose source images stay in host memory, so they can be
+ * shrunk or evicted from device memory and restored later.
+ *
+ * Every texture is stamped with the frame it was last used in. When device local
+ * usage nears the budget reported by VK_EXT_memory_budget (or the heap size, when
+ * the extension is missing), begin_frame() drops the top mip level of the least
+ * recently used texture, and evicts it once it is as small as allowed. Degraded
+ * textures that are used again are restored to the best level the budget allows.
+ */
+class TextureResidency : public IsNotLvalueCopyable
+{
+public:
+    /**
+     * @brief Called whenever the texture of a handle is replaced, e.g. to rewrite the
+     * descriptor sets that sample it. Evicted handles get the placeholder.
+     */
+    using ChangedCallback = std::function<void(const ResidencyHandle handle, Texture& texture)>;
+
+    /**
+     * @param frames_in_flight textures used within this many frames are never degraded,
+     * since recorded command buffers may still sample them.
+     * @param budget_fraction of the device local budget that usage is kept below.
+     * @param min_dimension textures are evicted rather than shrunk below this size.
+     */
+    TextureResidency(const Device& device,
+                     const VkCommandPool& command_pool,
+                     const VkQueue& graphics_queue,
+                     const uint32_t frames_in_flight,
+                     const bool srgb = true,
+                     const float budget_fraction = 0.9f,
+                     const uint32_t min_dimension = 64);
+
+    /**
+     * @brief Take ownership of image and upload it at the best level the budget allows.
+     */
+    [[nodiscard]]
+    ResidencyHandle add(std::unique_ptr<Image> image);
+
+    /**
+     * @brief Mark handle as used this frame and get its current texture.
+     * @return the placeholder while the texture is evicted, it is restored by a later begin_frame().
+     */
+    [[nodiscard]]
+    Texture& use(const ResidencyHandle handle);
+
+    void set_changed_callback(ChangedCallback callback);
+
+    /**
+     * @brief Advance the frame, degrade textures over budget and restore used ones.
+     * Call after waiting for the frame that is about to be recorded, see RenderPipeline::wait_for_next_frame.
+     */
+    void begin_frame();
+
+    /**
+     * @brief Get the number of top mip levels the texture of handle is missing.
+     */
+    [[nodiscard]]
+    uint32_t dropped_levels(const ResidencyHandle handle) const;
+
+    [[nodiscard]]
+    bool is_evicted(const ResidencyHandle handle) const;
+
+    /**
+     * @brief Get the device memory held by the managed textures.
+     */
+    [[nodiscard]]
+    VkDeviceSize resident_bytes() const;
+
+    /**
+     * @brief Destroy every texture, the device must be idle.
+     */
+    void destroy();
+
+private:
+    struct Entry {
+        std::unique_ptr<Image> image;
+        std::unique_ptr<Texture> texture;
+        VkDeviceSize bytes;
+        uint32_t dropped_levels;
+        uint64_t last_used;
+    };
+
+    struct Retired {
+        std::unique_ptr<Texture> texture;
+        uint64_t frame;
+    };
+
+    struct Budget {
+        VkDeviceSize usage;
+        VkDeviceSize target;
+    };
+
+    [[nodiscard]]
+    Budget query_budget() const;
+
+    [[nodiscard]]
+    uint32_t max_dropped_levels(const Entry& entry) const;
+
+    /**
+     * @brief Create the texture of entry starting at mip level.
+     * @throw OutOfDeviceMemory if the texture did not fit.
+     */
+    [[nodiscard]]
+    std::unique_ptr<Texture> create_level(const Entry& entry, const uint32_t level) const;
+
+    /**
+     * @brief Shrink or evict the least recently used texture that is not in flight.
+     * @return false if no texture could be degraded.
+     */
+    bool degrade_least_recently_used(Budget& budget);
+
+    /**
+     * @brief Give handle a new texture, the old one is destroyed once no frame uses it.
+     */
+    void replace(const ResidencyHandle handle,
+                 std::unique_ptr<Texture> texture,
+                 const uint32_t dropped_levels,
+                 const bool in_flight);
+
+    void restore_used(Budget& budget);
+
+    const Device& m_device;
+    const VkCommandPool& m_command_pool;
+    const VkQueue& m_graphics_queue;
+    uint32_t m_frames_in_flight;
+    bool m_srgb;
+    float m_budget_fraction;
+    uint32_t m_min_dimension;
+
+    uint64_t m_frame{0};
+    VkDeviceSize m_resident_bytes{0};
+    std::vector<Entry> m_entries{};
+    std::vector<Retired> m_retired{};
+    std::unique_ptr<Texture> m_placeholder{};
+    ChangedCallback m_changed_callback{};
+};
+
+}
@@ -0,0 +1,173 @@
+#pragma once
+/** *******************************************************************
+ * @file TextureStreamer.hpp
+ * @brief Asynchronous texture loading that never blocks the frame loop.
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "GpuTimeline.hpp"
+#include "Texture.hpp"
+#include "ThreadPool.hpp"
+#include "TypeTraits.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ArcGraphics {
+
+using TextureHandle = uint32_t;
+
+/**
+ * @brief Streams textures in the background, handing out placeholders until they are resident.
+ *
+ * Images are decoded on the thread pool in priority order. Each call to update()
+ * uploads decoded images up to a byte budget and swaps in the textures of earlier
+ * uploads whose fence or timeline point has signaled, so no call waits on the GPU.
+ */
+class TextureStreamer : public IsNotLvalueCopyable
+{
+public:
+    /**
+     * @brief Called from update() when the real texture of a handle becomes resident,
+     * e.g. to rewrite the descriptor sets that sampled the placeholder.
+     */
+    using ResidentCallback = std::function<void(const TextureHandle handle, Texture& texture)>;
+
+    /**
+     * @param srgb selects the sRGB variants of the texture formats, which are picked
+     * per texture from its channel count with find_image_format.
+     * @param frame_byte_budget the staging bytes uploaded per update(), a single image
+     * larger than the budget is still uploaded on its own.
+     * @param samplers shares one sampler between the streamed textures, when given.
+     * @param timeline tracks the uploads by the points they signal, e.g. Device::timeline(),
+     * instead of a fence per upload.
+     */
+    TextureStreamer(ThreadPool& pool,
+                    const VkPhysicalDevice& physical_device,
+                    const VkDevice& logical_device,
+                    const VkCommandPool& command_pool,
+                    const VkQueue& graphics_queue,
+                    const bool srgb = true,
+                    const VkDeviceSize frame_byte_budget = 16 * 1024 * 1024,
+                    SamplerCache* samplers = nullptr,
+                    GpuTimeline* timeline = nullptr);
+
+    /**
+     * @brief Queue a texture for streaming, higher priorities are loaded first.
+     * @return handle that refers to the placeholder until the texture is resident.
+     */
+    [[nodiscard]]
+    TextureHandle request(const std::string& path, const int priority = 0);
+
+    /**
+     * @brief Change the priority of a texture that has not been decoded yet.
+     */
+    void set_priority(const TextureHandle handle, const int priority);
+
+    void set_resident_callback(ResidentCallback callback);
+
+    /**
+     * @brief Swap in finished uploads and start new ones, call once per frame.
+     */
+    void update();
+
+    /**
+     * @brief Get the texture of handle, which is the placeholder until it is resident.
+     */
+    [[nodiscard]]
+    Texture& texture(const TextureHandle handle);
+
+    [[nodiscard]]
+    bool is_resident(const TextureHandle handle) const;
+
+    /**
+     * @brief Get the number of requested textures that are not resident yet.
+     */
+    [[nodiscard]]
+    size_t pending_count() const;
+
+    /**
+     * @brief Wait for in-flight uploads and destroy every texture.
+     */
+    void destroy(const VkDevice logical_device);
+
+private:
+    enum class State { queued, uploading, resident, failed };
+
+    struct Entry {
+        std::string path;
+        State state;
+        std::unique_ptr<Texture> texture;
+    };
+
+    struct DecodeRequest {
+        TextureHandle handle;
+        int priority;
+        std::string path;
+    };
+
+    struct Decoded {
+        TextureHandle handle;
+        int priority;
+        std::unique_ptr<Image> image;
+        VkFormat format;
+        MipChain cpu_levels;
+        uint32_t mip_levels;
+    };
+
+    struct ChannelFormat {
+        ImageFormat format;
+        bool blit_mipmaps;
+    };
+
+    /**
+     * @brief State shared with the decode tasks, which may outlive the streamer.
+     */
+    struct Queues {
+        std::mutex mutex{};
+        std::vector<DecodeRequest> requests{};
+        std::vector<Decoded> decoded{};
+        /** @brief Texture format by the channel count of the decoded image. */
+        std::array<std::optional<ChannelFormat>, 5> formats{};
+    };
+
+    struct UploadBatch {
+        /** @brief Signaled fence or timeline point, depending on whether there is a timeline. */
+        VkFence fence{VK_NULL_HANDLE};
+        TimelinePoint timeline_point{};
+        VkCommandBuffer command_buffer;
+        VkBuffer staging_buffer;
+        VkDeviceMemory staging_memory;
+        std::vector<std::pair<TextureHandle, std::unique_ptr<Texture>>> textures;
+    };
+
+    static void decode_next(const std::shared_ptr<Queues>& queues);
+    void finish_uploads();
+    void start_uploads();
+    void release_batch(UploadBatch& batch);
+
+    ThreadPool& m_pool;
+    const VkPhysicalDevice& m_physical_device;
+    const VkDevice& m_logical_device;
+    const VkCommandPool& m_command_pool;
+    const VkQueue& m_graphics_queue;
+    VkDeviceSize m_frame_byte_budget;
+    SamplerCache* m_samplers;
+    GpuTimeline* m_timeline;
+
+    std::shared_ptr<Queues> m_queues;
+    std::vector<Entry> m_entries{};
+    std::vector<UploadBatch> m_in_flight{};
+    std::unique_ptr<Texture> m_placeholder{};
+    ResidentCallback m_resident_callback{};
+};
+
+}
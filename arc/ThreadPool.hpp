@@ -0,0 +1,85 @@
+#pragma once
+/** *******************************************************************
+ * @file ThreadPool.hpp
+ * @brief A fixed size pool of worker threads for CPU side work.
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "TypeTraits.hpp"
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace ArcGraphics {
+
+/**
+ * @brief A fixed size pool of worker threads.
+ * Tasks are run in submission order by whichever worker is free.
+ */
+class ThreadPool : public IsNotLvalueCopyable
+{
+public:
+    /**
+     * @brief Start the worker threads.
+     * @param thread_count defaults to the number of hardware threads.
+     */
+    explicit ThreadPool(const size_t thread_count = std::thread::hardware_concurrency());
+
+    /**
+     * @brief Finish the queued tasks and join the worker threads.
+     */
+    ~ThreadPool();
+
+    /**
+     * @brief Queue a task.
+     * @return future for the result of the task, exceptions are forwarded through it.
+     */
+    template <typename F>
+    [[nodiscard]]
+    auto submit(F&& f) -> std::future<std::invoke_result_t<F>>;
+
+    /**
+     * @brief Run f over [begin, end) split into chunks across the pool.
+     * f is called as f(chunk_begin, chunk_end). The calling thread takes part in
+     * the work, so it is safe to call from within a task of the same pool.
+     * @param min_chunk_size the smallest range handed to a single call of f.
+     */
+    void parallel_for(const size_t begin,
+                      const size_t end,
+                      const std::function<void(size_t, size_t)>& f,
+                      const size_t min_chunk_size = 1);
+
+    [[nodiscard]]
+    size_t thread_count() const noexcept;
+
+private:
+    void enqueue(std::function<void()>&& task);
+    void work();
+
+    std::vector<std::thread> m_threads{};
+    std::queue<std::function<void()>> m_tasks{};
+    std::mutex m_mutex{};
+    std::condition_variable m_condition{};
+    bool m_stopping{false};
+};
+
+template <typename F>
+auto ThreadPool::submit(F&& f) -> std::future<std::invoke_result_t<F>>
+{
+    using Result = std::invoke_result_t<F>;
+    // std::function must be copyable, so the packaged task is shared.
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(f));
+    auto future = task->get_future();
+    enqueue([task] { (*task)(); });
+    return future;
+}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+/** *******************************************************************
+ * @file Timing.hpp
+ * @brief Small wall-clock timing helpers for breaking down slow phases.
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace ArcGraphics {
+
+/**
+ * @brief The measured wall-clock duration of a named phase.
+ */
+struct TimedPhase {
+    std::string name;
+    std::chrono::duration<double, std::milli> duration;
+};
+
+/**
+ * @brief A collection of phases in the order they were measured.
+ */
+using PhaseTimings = std::vector<TimedPhase>;
+
+/**
+ * @brief Run f, record how long it took under name and return its result.
+ */
+template <typename F>
+auto time_phase(PhaseTimings& timings, const std::string& name, F&& f) -> decltype(f())
+{
+    const auto start = std::chrono::steady_clock::now();
+    if constexpr (std::is_void_v<decltype(f())>) {
+        f();
+        timings.push_back({name, std::chrono::steady_clock::now() - start});
+    } else {
+        auto result = f();
+        timings.push_back({name, std::chrono::steady_clock::now() - start});
+        return result;
+    }
+}
+
+/**
+ * @brief Get the summed duration of all phases.
+ */
+[[nodiscard]]
+inline std::chrono::duration<double, std::milli> total_duration(const PhaseTimings& timings)
+{
+    std::chrono::duration<double, std::milli> total{0};
+    for (const auto& phase: timings)
+        total += phase.duration;
+    return total;
+}
+
+/**
+ * @brief Stringifier for reporting, one phase per line.
+ */
+[[nodiscard]]
+inline std::string stringify(const PhaseTimings& timings)
+{
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    for (const auto& phase: timings)
+        ss << "\t" << std::left << std::setw(28) << phase.name
+           << phase.duration.count() << " ms\n";
+    ss << "\t" << std::left << std::setw(28) << "total"
+       << total_duration(timings).count() << " ms\n";
+    return ss.str();
+}
+
+}
@@ -0,0 +1,163 @@
+#pragma once
+/** *******************************************************************
+ * @file TransformHierarchy.hpp
+ * @brief Parent/child transforms updated incrementally, and written to per frame buffers.
+ *
+ * Nodes are kept as separate arrays of parents, local and world matrices, in
+ * creation order. A parent is always created before its children, so one pass
+ * in index order updates every world matrix after its parent's, and a node is
+ * only recomputed when it or an ancestor changed since the last update.
+ *
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include "GLM.hpp"
+#include "TypeTraits.hpp"
+
+#include <glm/gtc/quaternion.hpp>
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace ArcGraphics {
+
+/**
+ * @brief out = a * b, with SSE2 or NEON when available.
+ * out may be a or b.
+ */
+void multiply_matrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& out);
+
+/**
+ * @brief Get translate(position) * mat4_cast(rotation) * scale(scale), without
+ * the matrix products.
+ */
+[[nodiscard]]
+glm::mat4 compose_transform(const glm::vec3& position,
+                            const glm::quat& rotation,
+                            const glm::vec3& scale);
+
+class TransformHierarchy
+{
+public:
+    static constexpr uint32_t no_parent = std::numeric_limits<uint32_t>::max();
+    /** @brief Every frame in flight has a bit in the per node write mask. */
+    static constexpr uint32_t max_frames_in_flight = 8;
+
+    /**
+     * @param frames_in_flight number of per frame buffers the world matrices are written to.
+     */
+    explicit TransformHierarchy(const uint32_t frames_in_flight = 2);
+
+    /**
+     * @return the id of the node, which is its index in world_matrices().
+     * @throws std::out_of_range if parent does not exist yet.
+     */
+    uint32_t create(const uint32_t parent = no_parent,
+                    const glm::mat4& local = glm::mat4(1.0f));
+
+    void set_local(const uint32_t node, const glm::mat4& local);
+
+    void set_local(const uint32_t node,
+                   const glm::vec3& position,
+                   const glm::quat& rotation,
+                   const glm::vec3& scale = glm::vec3(1.0f));
+
+    /**
+     * @brief Recompute the world matrices of changed nodes and their descendants.
+     * @return the number of recomputed nodes.
+     */
+    size_t update();
+
+    /**
+     * @brief Copy the world matrices that changed since flight_frame was last
+     * written into destination, at the index of their node.
+     * @param destination the mapped buffer of the frame, with room for size() matrices.
+     * @return the number of written matrices.
+     */
+    size_t write_world_matrices(const uint32_t flight_frame, glm::mat4* destination);
+
+    [[nodiscard]]
+    const glm::mat4& local(const uint32_t node) const;
+
+    /**
+     * @brief Get the world matrix as of the last update().
+     */
+    [[nodiscard]]
+    const glm::mat4& world(const uint32_t node) const;
+
+    [[nodiscard]]
+    uint32_t parent(const uint32_t node) const;
+
+    [[nodiscard]]
+    const std::vector<glm::mat4>& world_matrices() const;
+
+    [[nodiscard]]
+    size_t size() const;
+
+    void reserve(const size_t count);
+    void clear();
+
+private:
+    uint32_t m_frames_in_flight;
+    uint8_t m_all_frames_mask;
+    std::vector<uint32_t> m_parents{};
+    std::vector<glm::mat4> m_locals{};
+    std::vector<glm::mat4> m_worlds{};
+    /** @brief Set by set_local(), and for every node recomputed during update(). */
+    std::vector<uint8_t> m_dirty{};
+    /** @brief One bit per frame in flight whose buffer is missing the world matrix. */
+    std::vector<uint8_t> m_unwritten{};
+    bool m_any_dirty{false};
+};
+
+/**
+ * @brief Host visible storage buffer holding the world matrices of a
+ * TransformHierarchy, one region per frame in flight.
+ * A uniform buffer is too small for hierarchies of this size, so shaders index
+ * the matrices by node, e.g. through firstInstance. The buffer can also be
+ * bound as a per instance vertex stream of mat4.
+ */
+class TransformBuffer : public IsNotLvalueCopyable
+{
+public:
+    /**
+     * @param capacity matrices per frame.
+     */
+    TransformBuffer(const VkPhysicalDevice& physical_device,
+                    const VkDevice& logical_device,
+                    const uint32_t capacity,
+                    const uint32_t frames_in_flight);
+
+    /**
+     * @brief Write the matrices of hierarchy that the region of flight_frame is missing.
+     * @throws std::length_error if the hierarchy has more nodes than capacity.
+     */
+    size_t write(TransformHierarchy& hierarchy, const uint32_t flight_frame);
+
+    [[nodiscard]]
+    VkDescriptorBufferInfo descriptor_buffer_info(const uint32_t flight_frame) const;
+
+    void bind(VkCommandBuffer command_buffer,
+              const uint32_t binding,
+              const uint32_t flight_frame) const;
+
+    [[nodiscard]]
+    uint32_t capacity() const;
+
+    void destroy(const VkDevice logical_device);
+
+private:
+    VkBuffer m_buffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_memory{VK_NULL_HANDLE};
+    unsigned char* m_mapping{nullptr};
+    uint32_t m_capacity;
+    uint32_t m_frames_in_flight;
+    /** @brief Bytes between frames, aligned for storage buffer descriptors. */
+    VkDeviceSize m_region_size;
+};
+
+}
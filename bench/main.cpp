@@ -0,0 +1,759 @@
+/** *******************************************************************
+ * @file main.cpp
+ * @brief Micro-benchmarks for the resource creation and upload paths.
+ *
+ * The resource benchmarks run on a headless Vulkan device, so they work
+ * against a software ICD without any display, e.g:
+ *
+ *   VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ./arc_bench
+ *
+ * RenderPipeline::Builder::produce needs a window and swap chain, so it is
+ * only measured when SDL can open a (hidden) Vulkan window, otherwise it is
+ * reported as skipped.
+ *
+ * Results are written as JSON (default: arc_bench.json) so they can be
+ * compared release over release.
+ *
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include <arc/Device.hpp>
+#include <arc/Renderer.hpp>
+#include <arc/RenderPipeline.hpp>
+#include <arc/BasicBuffer.hpp>
+#include <arc/IndexBuffer.hpp>
+#include <arc/Texture.hpp>
+#include <arc/SimpleGeometry.hpp>
+#include <arc/CpuCulling.hpp>
+#include <arc/Bvh.hpp>
+#include <arc/RenderQueue.hpp>
+#include <arc/TransformHierarchy.hpp>
+#include <arc/ThreadPool.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef ARC_BENCH_SHADER_DIR
+#define ARC_BENCH_SHADER_DIR "."
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Timing summary of a single benchmark case.
+ */
+struct BenchResult {
+    std::string name;
+    std::vector<std::pair<std::string, uint64_t>> params{};
+    size_t iterations{0};
+    double min_us{0.0};
+    double median_us{0.0};
+    double mean_us{0.0};
+    double max_us{0.0};
+    std::optional<uint64_t> bytes{};          /// bytes processed per iteration
+    std::optional<std::string> skipped{};     /// reason, if the case could not run
+};
+
+/**
+ * @brief Headless device used by the resource benchmarks.
+ */
+struct HeadlessDevice {
+    VkInstance instance{VK_NULL_HANDLE};
+    VkPhysicalDevice physical_device{VK_NULL_HANDLE};
+    VkDevice logical_device{VK_NULL_HANDLE};
+    VkQueue graphics_queue{VK_NULL_HANDLE};
+    VkCommandPool command_pool{VK_NULL_HANDLE};
+    VkPhysicalDeviceProperties properties{};
+};
+
+double to_us(const Clock::duration duration)
+{
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+BenchResult summarize(const std::string& name,
+                      std::vector<std::pair<std::string, uint64_t>> params,
+                      std::vector<double> samples_us,
+                      std::optional<uint64_t> bytes = std::nullopt)
+{
+    BenchResult result{};
+    result.name = name;
+    result.params = std::move(params);
+    result.bytes = bytes;
+    result.iterations = samples_us.size();
+    if (samples_us.empty())
+        return result;
+
+    std::sort(samples_us.begin(), samples_us.end());
+    result.min_us = samples_us.front();
+    result.max_us = samples_us.back();
+    result.median_us = samples_us[samples_us.size() / 2];
+    result.mean_us = std::accumulate(samples_us.begin(), samples_us.end(), 0.0)
+                   / static_cast<double>(samples_us.size());
+    return result;
+}
+
+/**
+ * @brief Run a benchmark where the measured region is the whole body.
+ * @param teardown is run outside of the measured region, after each iteration.
+ */
+BenchResult run_bench(const std::string& name,
+                      std::vector<std::pair<std::string, uint64_t>> params,
+                      const size_t iterations,
+                      std::optional<uint64_t> bytes,
+                      const std::function<void()>& body,
+                      const std::function<void()>& teardown = {})
+{
+    // A single warm-up run so lazy driver initialization is not measured.
+    body();
+    if (teardown) teardown();
+
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    for (size_t i = 0; i < iterations; i++) {
+        const auto start = Clock::now();
+        body();
+        samples.push_back(to_us(Clock::now() - start));
+        if (teardown) teardown();
+    }
+    return summarize(name, std::move(params), std::move(samples), bytes);
+}
+
+BenchResult skipped(const std::string& name, const std::string& reason)
+{
+    BenchResult result{};
+    result.name = name;
+    result.skipped = reason;
+    return result;
+}
+
+std::string json_escape(const std::string& str)
+{
+    std::stringstream ss;
+    for (const char c: str) {
+        switch (c) {
+        case '"':  ss << "\\\""; break;
+        case '\\': ss << "\\\\"; break;
+        case '\n': ss << "\\n"; break;
+        case '\t': ss << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+                ss << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                   << static_cast<int>(c) << std::dec;
+            else
+                ss << c;
+        }
+    }
+    return ss.str();
+}
+
+std::string device_type_name(const VkPhysicalDeviceType type)
+{
+    switch (type) {
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated_gpu";
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:   return "discrete_gpu";
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:    return "virtual_gpu";
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:            return "cpu";
+    default:                                     return "other";
+    }
+}
+
+void write_json(std::ostream& os,
+                const VkPhysicalDeviceProperties& properties,
+                const std::vector<BenchResult>& results)
+{
+    os << std::setprecision(3) << std::fixed;
+    os << "{\n";
+    os << "  \"framework\": \"ArcFramework\",\n";
+    os << "  \"device\": {\n"
+       << "    \"name\": \"" << json_escape(properties.deviceName) << "\",\n"
+       << "    \"type\": \"" << device_type_name(properties.deviceType) << "\",\n"
+       << "    \"vendor_id\": " << properties.vendorID << ",\n"
+       << "    \"device_id\": " << properties.deviceID << ",\n"
+       << "    \"driver_version\": " << properties.driverVersion << ",\n"
+       << "    \"api_version\": \""
+       << VK_VERSION_MAJOR(properties.apiVersion) << "."
+       << VK_VERSION_MINOR(properties.apiVersion) << "."
+       << VK_VERSION_PATCH(properties.apiVersion) << "\"\n"
+       << "  },\n";
+    os << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& result = results[i];
+        os << "    {\"name\": \"" << json_escape(result.name) << "\"";
+        if (result.skipped) {
+            os << ", \"skipped\": \"" << json_escape(*result.skipped) << "\"}";
+        } else {
+            os << ", \"params\": {";
+            for (size_t p = 0; p < result.params.size(); p++) {
+                os << (p ? ", " : "") << "\"" << json_escape(result.params[p].first)
+                   << "\": " << result.params[p].second;
+            }
+            os << "}"
+               << ", \"iterations\": " << result.iterations
+               << ", \"min_us\": " << result.min_us
+               << ", \"median_us\": " << result.median_us
+               << ", \"mean_us\": " << result.mean_us
+               << ", \"max_us\": " << result.max_us;
+            if (result.bytes && result.median_us > 0.0) {
+                const double mib = static_cast<double>(*result.bytes) / (1024.0 * 1024.0);
+                os << ", \"median_mib_per_s\": " << mib / (result.median_us * 1e-6);
+            }
+            os << "}";
+        }
+        os << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    os << "  ]\n";
+    os << "}\n";
+}
+
+/* ===================================================================
+ * Headless Device
+ */
+
+HeadlessDevice create_headless_device()
+{
+    HeadlessDevice headless{};
+
+    const auto app_info = ArcGraphics::create_app_info("arc_bench");
+    const std::vector<const char*> no_extensions{};
+    const auto instance_info = ArcGraphics::create_instance_info(no_extensions, &app_info);
+    auto status = vkCreateInstance(&instance_info, nullptr, &headless.instance);
+    if (status != VK_SUCCESS)
+        throw std::runtime_error("vkCreateInstance() returned non-ok");
+
+    std::optional<uint32_t> graphics_index{};
+    for (const auto& device: ArcGraphics::get_available_physical_devices(headless.instance)) {
+        const auto families = ArcGraphics::get_queue_families(device);
+        for (uint32_t i = 0; i < families.size(); i++) {
+            if (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+                graphics_index = i;
+                break;
+            }
+        }
+        if (graphics_index) {
+            headless.physical_device = device;
+            break;
+        }
+    }
+    if (!graphics_index)
+        throw std::runtime_error("Failed to find a device with a graphics queue!");
+
+    headless.properties = ArcGraphics::get_physical_device_properties(headless.physical_device);
+    const auto features = ArcGraphics::get_physical_device_features(headless.physical_device);
+
+    VkDeviceQueueCreateInfo queue_info{};
+    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info.queueFamilyIndex = *graphics_index;
+    queue_info.queueCount = 1;
+    float queue_priority = 1.0f;
+    queue_info.pQueuePriorities = &queue_priority;
+
+    // Texture::create_staging always requests anisotropic filtering.
+    VkPhysicalDeviceFeatures enabled_features{};
+    enabled_features.samplerAnisotropy = features.samplerAnisotropy;
+
+    VkDeviceCreateInfo device_info{};
+    device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_info.pQueueCreateInfos = &queue_info;
+    device_info.queueCreateInfoCount = 1;
+    device_info.pEnabledFeatures = &enabled_features;
+    status = vkCreateDevice(headless.physical_device,
+                            &device_info,
+                            nullptr,
+                            &headless.logical_device);
+    if (status != VK_SUCCESS)
+        throw std::runtime_error("failed to create logical device!");
+
+    vkGetDeviceQueue(headless.logical_device, *graphics_index, 0, &headless.graphics_queue);
+
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = *graphics_index;
+    status = vkCreateCommandPool(headless.logical_device,
+                                 &pool_info,
+                                 nullptr,
+                                 &headless.command_pool);
+    if (status != VK_SUCCESS)
+        throw std::runtime_error("Failed to create command pool!");
+
+    return headless;
+}
+
+void destroy_headless_device(HeadlessDevice& headless)
+{
+    vkDeviceWaitIdle(headless.logical_device);
+    vkDestroyCommandPool(headless.logical_device, headless.command_pool, nullptr);
+    vkDestroyDevice(headless.logical_device, nullptr);
+    vkDestroyInstance(headless.instance, nullptr);
+}
+
+std::tuple<std::vector<VkDescriptorSetLayoutBinding>, VkDescriptorSetLayout>
+create_bindings_and_descriptorset_layout(const VkDevice& logical_device)
+{
+    VkDescriptorSetLayoutBinding uniform_binding{};
+    uniform_binding.binding = 0;
+    uniform_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    uniform_binding.descriptorCount = 1;
+    uniform_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutBinding sampler_binding{};
+    sampler_binding.binding = 1;
+    sampler_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    sampler_binding.descriptorCount = 1;
+    sampler_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    const std::vector<VkDescriptorSetLayoutBinding> bindings = {uniform_binding,
+                                                                sampler_binding};
+
+    VkDescriptorSetLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
+    layout_info.pBindings = bindings.data();
+
+    VkDescriptorSetLayout layout{};
+    const auto status = vkCreateDescriptorSetLayout(logical_device, &layout_info, nullptr, &layout);
+    if (status != VK_SUCCESS)
+        throw std::runtime_error("failed to create descriptor set layout!");
+    return {bindings, layout};
+}
+
+/* ===================================================================
+ * Benchmarks
+ */
+
+const std::vector<uint64_t> buffer_sizes = {
+    4 * 1024,
+    64 * 1024,
+    1024 * 1024,
+    16 * 1024 * 1024
+};
+
+size_t iterations_for_size(const uint64_t size)
+{
+    return size >= 16 * 1024 * 1024 ? 20 : 100;
+}
+
+void bench_create_buffer(const HeadlessDevice& dev, std::vector<BenchResult>& results)
+{
+    for (const auto size: buffer_sizes) {
+        VkBufferCreateInfo info{};
+        VkBuffer buffer{};
+        VkDeviceMemory memory{};
+        results.push_back(run_bench(
+            "create_buffer", {{"bytes", size}}, iterations_for_size(size), size,
+            [&] {
+                ArcGraphics::create_buffer(dev.physical_device,
+                                           dev.logical_device,
+                                           size,
+                                           VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                                           | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                           info,
+                                           buffer,
+                                           memory);
+            },
+            [&] {
+                vkDestroyBuffer(dev.logical_device, buffer, nullptr);
+                vkFreeMemory(dev.logical_device, memory, nullptr);
+            }));
+    }
+}
+
+void bench_basic_buffer(const HeadlessDevice& dev, std::vector<BenchResult>& results)
+{
+    using ArcGraphics::VertexBuffer_PosTex;
+
+    for (const auto size: buffer_sizes) {
+        const VertexBuffer_PosTex::vector_type vertices(size / sizeof(ArcGraphics::Vertex_PosTex));
+        const uint64_t bytes = vertices.size() * sizeof(ArcGraphics::Vertex_PosTex);
+        std::unique_ptr<VertexBuffer_PosTex> buffer{};
+
+        results.push_back(run_bench(
+            "BasicBuffer::create", {{"bytes", bytes}}, iterations_for_size(size), bytes,
+            [&] {
+                buffer = VertexBuffer_PosTex::create(dev.physical_device,
+                                                     dev.logical_device,
+                                                     vertices);
+            },
+            [&] { buffer.reset(); }));
+
+        results.push_back(run_bench(
+            "BasicBuffer::create_staging", {{"bytes", bytes}}, iterations_for_size(size), bytes,
+            [&] {
+                buffer = VertexBuffer_PosTex::create_staging(dev.physical_device,
+                                                             dev.logical_device,
+                                                             dev.command_pool,
+                                                             dev.graphics_queue,
+                                                             vertices);
+            },
+            [&] { buffer.reset(); }));
+    }
+}
+
+void bench_texture(const HeadlessDevice& dev, std::vector<BenchResult>& results)
+{
+    for (const int extent: {256, 1024, 2048}) {
+        const size_t memsize = static_cast<size_t>(extent) * extent * 4;
+        // Image takes ownership of the pixels and releases them through stb (free).
+        auto pixels = static_cast<unsigned char*>(std::malloc(memsize));
+        if (!pixels)
+            throw std::runtime_error("Failed to allocate benchmark image!");
+        for (size_t i = 0; i < memsize; i++)
+            pixels[i] = static_cast<unsigned char>(i * 31);
+        const ArcGraphics::Image image(pixels, extent, extent, 4);
+
+        std::unique_ptr<ArcGraphics::Texture> texture{};
+        results.push_back(run_bench(
+            "Texture::create_staging",
+            {{"width", extent}, {"height", extent}},
+            extent >= 2048 ? 10 : 30,
+            memsize,
+            [&] {
+                texture = ArcGraphics::Texture::create_staging(dev.physical_device,
+                                                               dev.logical_device,
+                                                               dev.command_pool,
+                                                               dev.graphics_queue,
+                                                               VK_FORMAT_R8G8B8A8_UNORM,
+                                                               &image);
+                if (!texture)
+                    throw std::runtime_error("Failed to create texture from image!");
+            },
+            [&] {
+                texture->destroy(dev.logical_device);
+                texture.reset();
+            }));
+    }
+}
+
+void bench_descriptor_allocation(const HeadlessDevice& dev, std::vector<BenchResult>& results)
+{
+    const auto [bindings, layout] = create_bindings_and_descriptorset_layout(dev.logical_device);
+
+    for (const uint32_t set_count: {1u, 64u, 1024u}) {
+        const auto pool_sizes = ArcGraphics::create_descriptor_pool_sizes(bindings, set_count);
+
+        VkDescriptorPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+        pool_info.pPoolSizes = pool_sizes.data();
+        pool_info.maxSets = set_count;
+
+        VkDescriptorPool pool{};
+        if (vkCreateDescriptorPool(dev.logical_device, &pool_info, nullptr, &pool) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create descriptor pool!");
+
+        const std::vector<VkDescriptorSetLayout> layouts(set_count, layout);
+        std::vector<VkDescriptorSet> sets(set_count);
+
+        VkDescriptorSetAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        alloc_info.descriptorPool = pool;
+        alloc_info.descriptorSetCount = set_count;
+        alloc_info.pSetLayouts = layouts.data();
+
+        results.push_back(run_bench(
+            "vkAllocateDescriptorSets", {{"sets", set_count}}, 200, std::nullopt,
+            [&] {
+                if (vkAllocateDescriptorSets(dev.logical_device, &alloc_info, sets.data()) != VK_SUCCESS)
+                    throw std::runtime_error("Failed to allocate descriptor sets!");
+            },
+            [&] { vkResetDescriptorPool(dev.logical_device, pool, 0); }));
+
+        vkDestroyDescriptorPool(dev.logical_device, pool, nullptr);
+    }
+    vkDestroyDescriptorSetLayout(dev.logical_device, layout, nullptr);
+}
+
+void bench_memory_mapping(const HeadlessDevice& dev, std::vector<BenchResult>& results)
+{
+    for (const auto size: buffer_sizes) {
+        VkBufferCreateInfo info{};
+        VkBuffer buffer{};
+        VkDeviceMemory memory{};
+        ArcGraphics::create_buffer(dev.physical_device,
+                                   dev.logical_device,
+                                   size,
+                                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                                   | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                   info,
+                                   buffer,
+                                   memory);
+
+        results.push_back(run_bench(
+            "with_memory_mapping", {{"bytes", size}}, 200, std::nullopt,
+            [&] {
+                ArcGraphics::with_memory_mapping(dev.logical_device, size, memory,
+                                                 [] (void* mapping) { (void)mapping; });
+            }));
+
+        const std::vector<char> src(size, 0x5a);
+        results.push_back(run_bench(
+            "memcopy_to_buffer", {{"bytes", size}}, iterations_for_size(size), size,
+            [&] {
+                ArcGraphics::memcopy_to_buffer(dev.logical_device, src.data(), size, memory);
+            }));
+
+        vkDestroyBuffer(dev.logical_device, buffer, nullptr);
+        vkFreeMemory(dev.logical_device, memory, nullptr);
+    }
+}
+
+void bench_cpu_culling(std::vector<BenchResult>& results)
+{
+    constexpr size_t object_count = 1000000;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> radius(0.5f, 4.0f);
+
+    ArcGraphics::CpuCulling culling{};
+    culling.reserve(object_count);
+    for (size_t i = 0; i < object_count; i++)
+        culling.add({{position(rng), position(rng), position(rng)}, radius(rng)});
+
+    const auto projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 400.0f);
+    const auto view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const auto frustum = ArcGraphics::extract_frustum(projection * view);
+
+    std::vector<uint8_t> visible;
+    results.push_back(run_bench(
+        "CpuCulling::cull", {{"objects", object_count}, {"threads", 1}}, 50,
+        object_count * 4 * sizeof(float),
+        [&] { culling.cull(frustum, visible); }));
+
+    ArcGraphics::ThreadPool pool{};
+    results.push_back(run_bench(
+        "CpuCulling::cull", {{"objects", object_count}, {"threads", pool.thread_count()}}, 50,
+        object_count * 4 * sizeof(float),
+        [&] { culling.cull(frustum, visible, &pool); }));
+
+    std::vector<uint32_t> ids;
+    results.push_back(run_bench(
+        "CpuCulling::cull_ids", {{"objects", object_count}, {"threads", pool.thread_count()}}, 50,
+        object_count * 4 * sizeof(float),
+        [&] { culling.cull_ids(frustum, ids, &pool); }));
+}
+
+void bench_bvh(std::vector<BenchResult>& results)
+{
+    constexpr size_t object_count = 100000;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> half_extent(0.5f, 4.0f);
+
+    std::vector<ArcGraphics::BoundingBox> boxes(object_count);
+    for (auto& box: boxes) {
+        const glm::vec3 center(position(rng), position(rng), position(rng));
+        const glm::vec3 extent(half_extent(rng), half_extent(rng), half_extent(rng));
+        box = {center - extent, center + extent};
+    }
+
+    ArcGraphics::Bvh bvh{};
+    results.push_back(run_bench(
+        "Bvh::build", {{"objects", object_count}}, 20, std::nullopt,
+        [&] { bvh.build(boxes); }));
+
+    const auto projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 400.0f);
+    const auto view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const auto frustum = ArcGraphics::extract_frustum(projection * view);
+    std::vector<uint32_t> visible;
+    results.push_back(run_bench(
+        "Bvh::query_frustum", {{"objects", object_count}}, 200, std::nullopt,
+        [&] { visible.clear(); bvh.query_frustum(frustum, visible); }));
+
+    results.push_back(run_bench(
+        "Bvh::move", {{"objects", object_count}}, 20, std::nullopt,
+        [&] {
+            for (uint32_t object = 0; object < object_count; object++) {
+                auto box = boxes[object];
+                box.min.x += 0.5f;
+                box.max.x += 0.5f;
+                bvh.move(object, box);
+            }
+        },
+        [&] { bvh.build(boxes); }));
+}
+
+void bench_render_queue_sort(std::vector<BenchResult>& results)
+{
+    std::mt19937 rng(42);
+    for (const size_t draw_count: {size_t(1000), size_t(100000)}) {
+        std::uniform_int_distribution<uint32_t> state(0, 63);
+        std::uniform_real_distribution<float> depth(0.1f, 400.0f);
+        std::vector<ArcGraphics::RenderSortEntry> keys(draw_count);
+        for (uint32_t i = 0; i < draw_count; i++) {
+            const auto blend = i % 8 == 0 ? ArcGraphics::RenderBlend::transparent
+                                          : ArcGraphics::RenderBlend::opaque;
+            keys[i] = {ArcGraphics::RenderQueue::make_key(0, blend, state(rng) % 8, state(rng), state(rng), depth(rng)), i};
+        }
+
+        std::vector<ArcGraphics::RenderSortEntry> entries;
+        std::vector<ArcGraphics::RenderSortEntry> scratch;
+        results.push_back(run_bench(
+            "radix_sort", {{"draws", draw_count}}, 100, std::nullopt,
+            [&] { ArcGraphics::radix_sort(entries, scratch); },
+            [&] { entries = keys; }));
+        results.push_back(run_bench(
+            "std::stable_sort", {{"draws", draw_count}}, 100, std::nullopt,
+            [&] {
+                std::stable_sort(entries.begin(), entries.end(), [] (const auto& a, const auto& b) {
+                    return a.key < b.key;
+                });
+            },
+            [&] { entries = keys; }));
+    }
+}
+
+void bench_transform_hierarchy(std::vector<BenchResult>& results)
+{
+    // 1000 roots, each with 10 children that have 9 children of their own.
+    constexpr size_t node_count = 100000;
+    ArcGraphics::TransformHierarchy hierarchy{};
+    hierarchy.reserve(node_count);
+    std::vector<uint32_t> roots;
+    while (hierarchy.size() < node_count) {
+        const uint32_t root = hierarchy.create();
+        roots.push_back(root);
+        for (int i = 0; i < 10 && hierarchy.size() < node_count; i++) {
+            const uint32_t child = hierarchy.create(root);
+            for (int j = 0; j < 9 && hierarchy.size() < node_count; j++)
+                (void)hierarchy.create(child);
+        }
+    }
+    std::vector<glm::mat4> destination(node_count);
+    const auto animate = [&](const size_t stride, const float angle) {
+        for (size_t node = 0; node < node_count; node += stride)
+            hierarchy.set_local(static_cast<uint32_t>(node),
+                                glm::vec3(1.0f, 0.0f, 0.0f),
+                                glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+    };
+
+    float angle = 0.0f;
+    for (const size_t stride: {size_t(1), size_t(100)}) {
+        results.push_back(run_bench(
+            "TransformHierarchy::update", {{"nodes", node_count}, {"changed_every", stride}}, 50, std::nullopt,
+            [&] {
+                (void)hierarchy.update();
+                (void)hierarchy.write_world_matrices(0, destination.data());
+            },
+            [&] { animate(stride, angle += 0.01f); }));
+    }
+}
+
+void bench_render_pipeline(std::vector<BenchResult>& results)
+{
+    const std::string name = "RenderPipeline::Builder::produce";
+    try {
+        const auto vert = ArcGraphics::read_shader_bytecode(
+            std::string(ARC_BENCH_SHADER_DIR) + "/texture.vert.spv");
+        const auto frag = ArcGraphics::read_shader_bytecode(
+            std::string(ARC_BENCH_SHADER_DIR) + "/texture.frag.spv");
+
+        auto device = ArcGraphics::Device::Builder().produce();
+        auto renderer = ArcGraphics::Renderer::Builder(&device)
+            .with_window_name("arc_bench")
+            .with_window_flags(SDL_WINDOW_HIDDEN)
+            .produce();
+        const auto layout = std::get<1>(create_bindings_and_descriptorset_layout(device.logical_device()));
+
+        // RenderPipeline is not movable, so the measured region is managed by hand
+        // to keep the destruction out of it.
+        const size_t iterations = 20;
+        std::vector<double> samples;
+        for (size_t i = 0; i < iterations + 1; i++) {
+            const auto start = Clock::now();
+            auto pipeline = ArcGraphics::RenderPipeline::Builder(&device,
+                    &renderer,
+                    vert,
+                    frag,
+                    layout,
+                    ArcGraphics::Vertex_PosTex::get_binding_description(),
+                    ArcGraphics::Vertex_PosTex::get_attribute_descriptions())
+                .produce();
+            const auto elapsed = to_us(Clock::now() - start);
+            if (i > 0)
+                samples.push_back(elapsed);
+            pipeline.destroy();
+        }
+        results.push_back(summarize(name, {{"frames_in_flight", 2}}, std::move(samples)));
+
+        vkDestroyDescriptorSetLayout(device.logical_device(), layout, nullptr);
+        renderer.destroy();
+        device.destroy();
+    }
+    catch (const std::exception& e) {
+        results.push_back(skipped(name, e.what()));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string output_path = "arc_bench.json";
+    bool with_pipeline = true;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--output" && i + 1 < argc)
+            output_path = argv[++i];
+        else if (arg == "--no-pipeline")
+            with_pipeline = false;
+        else {
+            std::cerr << "usage: " << argv[0] << " [--output results.json] [--no-pipeline]\n";
+            return 1;
+        }
+    }
+
+    auto dev = create_headless_device();
+    std::cout << "Benchmarking on: " << dev.properties.deviceName << std::endl;
+
+    std::vector<BenchResult> results;
+    bench_create_buffer(dev, results);
+    bench_basic_buffer(dev, results);
+    bench_texture(dev, results);
+    bench_descriptor_allocation(dev, results);
+    bench_memory_mapping(dev, results);
+    bench_cpu_culling(results);
+    bench_bvh(results);
+    bench_render_queue_sort(results);
+    bench_transform_hierarchy(results);
+    if (with_pipeline)
+        bench_render_pipeline(results);
+    else
+        results.push_back(skipped("RenderPipeline::Builder::produce", "disabled"));
+
+    for (const auto& result: results) {
+        std::cout << std::left << std::setw(36) << result.name;
+        if (result.skipped) {
+            std::cout << "skipped: " << *result.skipped << "\n";
+            continue;
+        }
+        for (const auto& [key, value]: result.params)
+            std::cout << key << "=" << value << " ";
+        std::cout << " median " << std::fixed << std::setprecision(1)
+                  << result.median_us << "us\n";
+    }
+
+    std::ofstream file(output_path);
+    if (!file.is_open()) {
+        std::cerr << "failed to open " << output_path << " for writing" << std::endl;
+        destroy_headless_device(dev);
+        return 1;
+    }
+    write_json(file, dev.properties, results);
+    std::cout << "Wrote results to " << output_path << std::endl;
+
+    destroy_headless_device(dev);
+    return 0;
+}
@@ -80,12 +80,11 @@ int main(int argc, char** argv) {
     
     auto device = ArcGraphics::Device::Builder()
         .add_khronos_validation_layer()
+        .with_window("Textures", 1200, 800, SDL_WINDOW_BORDERLESS | SDL_WINDOW_SHOWN)
+        .with_device_cache("device.cache")
         .produce();
    
     auto renderer = ArcGraphics::Renderer::Builder(&device)
-        .with_wanted_window_size(1200, 800)
-        .with_window_name("Textures")
-        .with_window_flags(SDL_WINDOW_BORDERLESS | SDL_WINDOW_SHOWN)
         .produce();
     
     const auto [bindings, descriptorset_layout] = create_bindings_and_descriptorset_layout(device.logical_device());
@@ -135,12 +134,14 @@ int main(int argc, char** argv) {
     if (!image)
         throw std::runtime_error("Failed to load image from path!");
     
-    auto texture = ArcGraphics::Texture::create_staging(device.physical_device(),
-                                                        device.logical_device(),
-                                                        pipeline.command_pool(),
-                                                        renderer.graphics_queue(),
-                                                        VK_FORMAT_R8G8B8A8_SRGB,
-                                                        image.get());
+    auto texture = ArcGraphics::Texture::create_from_image(device.physical_device(),
+                                                           device.logical_device(),
+                                                           pipeline.command_pool(),
+                                                           renderer.graphics_queue(),
+                                                           image.get(),
+                                                           true,
+                                                           true,
+                                                           &device.sampler_cache());
     if (!texture)
         throw std::runtime_error("Failed to create texture from image!");
     
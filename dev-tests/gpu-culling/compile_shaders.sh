@@ -0,0 +1,5 @@
+#!/bin/bash
+
+glslc cull.comp -o cull.comp.spv
+glslc culled.vert -o culled.vert.spv
+glslc culled.frag -o culled.frag.spv
@@ -0,0 +1,29 @@
+#version 450
+
+layout(set=0, binding=0) uniform ViewPort {
+    mat4 view;
+    mat4 proj;
+}viewport;
+
+struct CullObject {
+    mat4 model;
+    vec4 bounds;
+    uint index_count;
+    uint first_index;
+    int vertex_offset;
+    uint padding;
+};
+
+layout(std430, set=0, binding=1) readonly buffer Objects { CullObject objects[]; };
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+
+layout(location = 0) out vec4 fragColor;
+
+void main() {
+    const mat4 model = objects[gl_InstanceIndex].model;
+    gl_Position = viewport.proj * viewport.view * model * vec4(inPosition, 1.0);
+    const vec3 tint = fract(model[3].xyz * 0.05);
+    fragColor = vec4((0.3 + 0.7 * tint) * (0.6 + 0.4 * inTexCoord.x * inTexCoord.y), 1.0);
+}
@@ -0,0 +1,304 @@
+#include <arc/Device.hpp>
+#include <arc/Renderer.hpp>
+#include <arc/RenderPipeline.hpp>
+#include <arc/IndexBuffer.hpp>
+#include <arc/GpuCulling.hpp>
+#include <arc/SimpleGeometry.hpp>
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+
+// 64 x 64 x 24 objects around the camera, most of them outside the frustum at any time.
+#define GRID_X 64
+#define GRID_Y 64
+#define GRID_Z 24
+#define OBJECT_COUNT (GRID_X * GRID_Y * GRID_Z)
+#define SPACING 3.0f
+
+struct ViewPort {
+    glm::mat4 view;
+    glm::mat4 proj;
+};
+
+std::tuple<std::vector<VkDescriptorSetLayoutBinding>, VkDescriptorSetLayout>
+create_bindings_and_descriptorset_layout(const VkDevice& logical_device)
+{
+    VkDescriptorSetLayoutBinding viewport_layout_binding{};
+    viewport_layout_binding.binding = 0;
+    viewport_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    viewport_layout_binding.descriptorCount = 1;
+    viewport_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutBinding objects_layout_binding{};
+    objects_layout_binding.binding = 1;
+    objects_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    objects_layout_binding.descriptorCount = 1;
+    objects_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    const std::vector<VkDescriptorSetLayoutBinding> bindings = {viewport_layout_binding,
+                                                                objects_layout_binding};
+
+    VkDescriptorSetLayoutCreateInfo descriptorset_layout_info{};
+    descriptorset_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptorset_layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
+    descriptorset_layout_info.pBindings = bindings.data();
+
+    VkDescriptorSetLayout descriptorset_layout{};
+    auto status = vkCreateDescriptorSetLayout(logical_device,
+                                              &descriptorset_layout_info,
+                                              nullptr,
+                                              &descriptorset_layout);
+
+    if (status != VK_SUCCESS)
+        throw std::runtime_error("failed to create descriptor set layout!");
+    return {bindings, descriptorset_layout};
+}
+
+/**
+ * @brief Fill the objects of a frame, alternating between the cube and the sphere.
+ */
+void write_objects(ArcGraphics::CullObject* objects,
+                   const ArcGraphics::GeometryLod& cube,
+                   const ArcGraphics::GeometryLod& sphere,
+                   const int32_t sphere_vertex_offset)
+{
+    uint32_t i = 0;
+    for (uint32_t z = 0; z < GRID_Z; z++) {
+        for (uint32_t y = 0; y < GRID_Y; y++) {
+            for (uint32_t x = 0; x < GRID_X; x++, i++) {
+                const glm::vec3 position((float(x) - GRID_X * 0.5f) * SPACING,
+                                         (float(y) - GRID_Y * 0.5f) * SPACING,
+                                         (float(z) - GRID_Z * 0.5f) * SPACING);
+                auto& object = objects[i];
+                object.model = glm::translate(glm::mat4(1.0f), position);
+                const bool is_sphere = (x + y + z) % 2 == 1;
+                const auto& mesh = is_sphere ? sphere : cube;
+                // Both meshes fit in a sphere of radius sqrt(3) / 2 around their origin.
+                object.bounds = glm::vec4(0.0f, 0.0f, 0.0f, 0.87f);
+                object.index_count = mesh.index_count;
+                object.first_index = mesh.first_index;
+                object.vertex_offset = is_sphere ? sphere_vertex_offset : 0;
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+
+    auto device = ArcGraphics::Device::Builder()
+        .add_khronos_validation_layer()
+        .with_window("GPU Culling", 1200, 800, SDL_WINDOW_BORDERLESS | SDL_WINDOW_SHOWN)
+        .with_device_cache("device.cache")
+        .produce();
+
+    auto renderer = ArcGraphics::Renderer::Builder(&device)
+        .produce();
+
+    const auto [bindings, descriptorset_layout] = create_bindings_and_descriptorset_layout(device.logical_device());
+
+    const auto vert = ArcGraphics::read_shader_bytecode("../culled.vert.spv");
+    const auto frag = ArcGraphics::read_shader_bytecode("../culled.frag.spv");
+    auto pipeline =
+        ArcGraphics::RenderPipeline::Builder(&device,
+            &renderer,
+            vert,
+            frag,
+            descriptorset_layout,
+            ArcGraphics::Vertex_PosTex::get_binding_description(),
+            ArcGraphics::Vertex_PosTex::get_attribute_descriptions()
+            )
+        .with_frames_in_flight(2)
+        .with_clear_color(0.1f, 0.1f, 0.15f)
+        .produce();
+
+    const ArcGraphics::DrawSubmitter submitter(device.logical_device(),
+                                               device.draw_submission_features());
+    ArcGraphics::GpuCulling culling(&device,
+                                    &renderer,
+                                    submitter,
+                                    ArcGraphics::read_shader_bytecode("../cull.comp.spv"),
+                                    OBJECT_COUNT,
+                                    pipeline.max_frames_in_flight());
+    std::cout << "culled draws are "
+              << (submitter.features().draw_indirect_count ? "compacted behind a count" : "written in place")
+              << std::endl;
+
+    /* ===================================================================
+     * Shared Geometry, a cube followed by a sphere
+     */
+    auto [vertices, indices] = ArcGraphics::create_unit_cube();
+    const auto [sphere_vertices, sphere_indices] = ArcGraphics::create_uv_sphere(16, 12);
+    const ArcGraphics::GeometryLod cube{0, static_cast<uint32_t>(indices.size())};
+    const ArcGraphics::GeometryLod sphere{static_cast<uint32_t>(indices.size()),
+                                          static_cast<uint32_t>(sphere_indices.size())};
+    const auto sphere_vertex_offset = static_cast<int32_t>(vertices.size());
+    vertices.insert(vertices.end(), sphere_vertices.begin(), sphere_vertices.end());
+    indices.insert(indices.end(), sphere_indices.begin(), sphere_indices.end());
+
+    auto vertex_buffer =
+        ArcGraphics::VertexBuffer_PosTex::create_staging(device.physical_device(),
+                                                         device.logical_device(),
+                                                         pipeline.command_pool(),
+                                                         renderer.graphics_queue(),
+                                                         vertices);
+    if (!vertex_buffer)
+        throw std::runtime_error("Failed to create vertex buffer!");
+
+    auto index_buffer = ArcGraphics::IndexBuffer::create(device.physical_device(),
+                                                         device.logical_device(),
+                                                         indices);
+    if (!index_buffer)
+        throw std::runtime_error("Failed to create index buffer!");
+
+    // The objects do not move, so every frame gets them once up front.
+    for (uint32_t frame = 0; frame < pipeline.max_frames_in_flight(); frame++)
+        write_objects(culling.objects(frame), cube, sphere, sphere_vertex_offset);
+
+    /* ===================================================================
+     * Create Descriptor Sets
+     */
+    std::vector<VkDescriptorPoolSize> descriptor_pool_sizes =
+        ArcGraphics::create_descriptor_pool_sizes(bindings,
+                                                  pipeline.max_frames_in_flight());
+
+    VkDescriptorPoolCreateInfo descriptor_pool_info{};
+    descriptor_pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptor_pool_info.poolSizeCount = static_cast<uint32_t>(descriptor_pool_sizes.size());
+    descriptor_pool_info.pPoolSizes = descriptor_pool_sizes.data();
+    descriptor_pool_info.maxSets = pipeline.max_frames_in_flight();
+
+    VkDescriptorPool descriptor_pool{};
+    auto status = vkCreateDescriptorPool(device.logical_device(),
+                                         &descriptor_pool_info,
+                                         nullptr,
+                                         &descriptor_pool);
+    if (status != VK_SUCCESS)
+        throw std::runtime_error("Failed to create descriptor pool!");
+
+    std::vector<VkDescriptorSetLayout> descriptorset_layouts(pipeline.max_frames_in_flight(),
+                                                             descriptorset_layout);
+
+    VkDescriptorSetAllocateInfo descriptor_pool_alloc_info{};
+    descriptor_pool_alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptor_pool_alloc_info.descriptorPool = descriptor_pool;
+    descriptor_pool_alloc_info.descriptorSetCount =
+        static_cast<uint32_t>(descriptorset_layouts.size());
+    descriptor_pool_alloc_info.pSetLayouts = descriptorset_layouts.data();
+
+    std::vector<VkDescriptorSet> descriptorsets(pipeline.max_frames_in_flight());
+    status = vkAllocateDescriptorSets(device.logical_device(),
+                                      &descriptor_pool_alloc_info,
+                                      descriptorsets.data());
+    if (status != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate descriptor sets!");
+
+    /* ===================================================================
+     * Create Uniform Buffers, and point the vertex shader at the culled objects
+     */
+    std::vector<std::unique_ptr<ArcGraphics::BasicUniformBuffer>> uniform_viewports;
+    for (uint32_t i = 0; i < pipeline.max_frames_in_flight(); i++) {
+        uniform_viewports.push_back(ArcGraphics::BasicUniformBuffer::create(device.physical_device(),
+                                                                            device.logical_device(),
+                                                                            sizeof(ViewPort)));
+        const auto viewport_info = uniform_viewports[i]->descriptor_buffer_info();
+        const auto objects_info = culling.object_buffer_info(i);
+
+        std::array<VkWriteDescriptorSet, 2> descriptor_writes{};
+        descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_writes[0].dstSet = descriptorsets[i];
+        descriptor_writes[0].dstBinding = 0;
+        descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptor_writes[0].descriptorCount = 1;
+        descriptor_writes[0].pBufferInfo = &viewport_info;
+
+        descriptor_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_writes[1].dstSet = descriptorsets[i];
+        descriptor_writes[1].dstBinding = 1;
+        descriptor_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptor_writes[1].descriptorCount = 1;
+        descriptor_writes[1].pBufferInfo = &objects_info;
+
+        vkUpdateDescriptorSets(device.logical_device(),
+                               static_cast<uint32_t>(descriptor_writes.size()),
+                               descriptor_writes.data(),
+                               0,
+                               nullptr);
+    }
+
+    const auto rendersize = pipeline.render_size();
+    ViewPort viewport{};
+    viewport.proj = glm::perspective(glm::radians(60.0f),
+                                     rendersize.width / (float)rendersize.height,
+                                     0.1f,
+                                     200.0f);
+    viewport.proj[1][1] *= -1;
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    bool exit = false;
+    SDL_Event event;
+    while (!exit) {
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT)
+                exit = true;
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE)
+                exit = true;
+        }
+
+        const auto frameindex = pipeline.wait_for_next_frame();
+        const auto flight_frame = pipeline.current_flight_frame();
+        if (!frameindex)
+            break;
+
+        auto currentTime = std::chrono::high_resolution_clock::now();
+        float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+
+        // Look around from the middle of the grid.
+        const glm::vec3 direction(std::cos(time * 0.3f), std::sin(time * 0.3f), 0.2f * std::sin(time * 0.7f));
+        viewport.view = glm::lookAt(glm::vec3(0.0f), direction, glm::vec3(0.0f, 0.0f, 1.0f));
+
+        /* =======================================================
+         * Cull on the compute queue, then draw what survived
+         */
+        const auto culled = culling.cull(flight_frame, viewport.proj * viewport.view, OBJECT_COUNT);
+        pipeline.wait_for_timeline(culled, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+
+        auto command_buffer = pipeline.begin_command_buffer(*frameindex);
+
+        vkCmdBindDescriptorSets(command_buffer,
+                                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                pipeline.layout(),
+                                0,
+                                1,
+                                &descriptorsets[flight_frame],
+                                0,
+                                nullptr);
+        uniform_viewports[flight_frame]->set_uniform(&viewport);
+
+        VkBuffer vertex_buffers[] = {vertex_buffer->get_buffer()};
+        VkDeviceSize offsets[] = {0};
+        vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
+        vkCmdBindIndexBuffer(command_buffer,
+                             index_buffer->get_buffer(),
+                             0,
+                             VK_INDEX_TYPE_UINT32);
+
+        culling.draw(command_buffer, flight_frame);
+
+        pipeline.end_command_buffer(command_buffer, *frameindex);
+    }
+
+    vkDeviceWaitIdle(device.logical_device());
+    for (auto& uniform: uniform_viewports)
+        uniform->destroy(device.logical_device());
+    culling.destroy();
+    vkDestroyDescriptorPool(device.logical_device(), descriptor_pool, nullptr);
+    vkDestroyDescriptorSetLayout(device.logical_device(), descriptorset_layout, nullptr);
+
+    pipeline.destroy();
+    renderer.destroy();
+    device.destroy();
+}
@@ -0,0 +1,109 @@
+#include <arc/Device.hpp>
+#include <arc/Texture.hpp>
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+/*
+ * Round trips gray and gray-alpha images through the texture path: the pixels are
+ * expanded to the format picked for the device, and read back through the view
+ * swizzle of that format the way a shader would sample them. Every texel must read
+ * as (g, g, g, a), with a = 255 for gray, whether the device uses R8, R8G8 or the
+ * R8G8B8A8 fallback.
+ */
+
+using Texel = std::array<unsigned char, 4>;
+
+unsigned char read_component(const VkComponentSwizzle swizzle,
+                             const int component,
+                             const unsigned char* texel,
+                             const int channels)
+{
+    switch (swizzle) {
+    case VK_COMPONENT_SWIZZLE_IDENTITY:
+        if (component < channels)
+            return texel[component];
+        return component == 3 ? 255 : 0;
+    case VK_COMPONENT_SWIZZLE_ZERO:
+        return 0;
+    case VK_COMPONENT_SWIZZLE_ONE:
+        return 255;
+    default: {
+        const int source = swizzle - VK_COMPONENT_SWIZZLE_R;
+        if (source < channels)
+            return texel[source];
+        return source == 3 ? 255 : 0;
+    }
+    }
+}
+
+Texel sample(const ArcGraphics::Image& image, const VkFormat format, const size_t index)
+{
+    const auto swizzle = ArcGraphics::texture_swizzle(format);
+    const unsigned char* texel = image.pixels() + index * image.channels();
+    return {read_component(swizzle.r, 0, texel, image.channels()),
+            read_component(swizzle.g, 1, texel, image.channels()),
+            read_component(swizzle.b, 2, texel, image.channels()),
+            read_component(swizzle.a, 3, texel, image.channels())};
+}
+
+std::unique_ptr<ArcGraphics::Image> create_image(const int width, const int height, const int channels)
+{
+    const size_t pixel_count = size_t(width) * height;
+    // Image frees its pixels with stbi_image_free, which is free.
+    auto pixels = static_cast<unsigned char*>(malloc(pixel_count * channels));
+    for (size_t i = 0; i < pixel_count; i++) {
+        pixels[i * channels] = static_cast<unsigned char>(i * 7);
+        if (channels == 2)
+            pixels[i * channels + 1] = static_cast<unsigned char>(255 - i * 3);
+    }
+    return std::make_unique<ArcGraphics::Image>(pixels, width, height, channels);
+}
+
+int round_trip(const ArcGraphics::Image& image, const ArcGraphics::ImageFormat& format)
+{
+    const auto expanded = ArcGraphics::expand_channels(image, format.channels);
+    const size_t pixel_count = size_t(image.width()) * image.height();
+    int mismatches = 0;
+    for (size_t i = 0; i < pixel_count; i++) {
+        const unsigned char gray = image.pixels()[i * image.channels()];
+        const unsigned char alpha = image.channels() == 2 ? image.pixels()[i * 2 + 1] : 255;
+        const Texel expected{gray, gray, gray, alpha};
+        const auto sampled = sample(*expanded, format.format, i);
+        if (sampled != expected)
+            mismatches++;
+    }
+    std::cout << "  " << image.channels() << " channels as format " << format.format
+              << " (" << format.channels << " channels): "
+              << (mismatches == 0 ? "ok" : std::to_string(mismatches) + " mismatches") << std::endl;
+    return mismatches;
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+
+    const auto device = ArcGraphics::Device::Builder()
+        .add_khronos_validation_layer()
+        .produce();
+
+    int mismatches = 0;
+    for (const int channels: {1, 2}) {
+        const auto image = create_image(13, 7, channels);
+        for (const bool srgb: {false, true}) {
+            const auto format = ArcGraphics::find_image_format(device.physical_device(), channels, srgb);
+            if (!format) {
+                std::cout << "  no format for " << channels << " channels" << std::endl;
+                return EXIT_FAILURE;
+            }
+            mismatches += round_trip(*image, *format);
+        }
+        // The fallback when the device can not sample the smaller formats.
+        mismatches += round_trip(*image, {VK_FORMAT_R8G8B8A8_UNORM, 4});
+    }
+
+    std::cout << (mismatches == 0 ? "passed" : "failed") << std::endl;
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,4 @@
+#!/bin/bash
+
+glslc instanced.vert -o instanced.vert.spv
+glslc instanced.frag -o instanced.frag.spv
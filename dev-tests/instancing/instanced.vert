@@ -0,0 +1,21 @@
+#version 450
+
+layout(set=0, binding=0) uniform ViewPort {
+    mat4 view;
+    mat4 proj;
+}viewport;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+
+// Per instance, a mat4 takes the four locations 2 to 5.
+layout(location = 2) in mat4 inModel;
+layout(location = 6) in vec4 inColor;
+
+layout(location = 0) out vec4 fragColor;
+
+void main() {
+    gl_Position = viewport.proj * viewport.view * inModel * vec4(inPosition, 1.0);
+    // Darken towards one corner of each face, so the cubes read as solids.
+    fragColor = vec4(inColor.rgb * (0.6 + 0.4 * inTexCoord.x * inTexCoord.y), inColor.a);
+}
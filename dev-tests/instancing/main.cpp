@@ -0,0 +1,266 @@
+#include <arc/Device.hpp>
+#include <arc/Renderer.hpp>
+#include <arc/RenderPipeline.hpp>
+#include <arc/IndexBuffer.hpp>
+#include <arc/InstanceBuffer.hpp>
+#include <arc/SimpleGeometry.hpp>
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+
+// 320 x 320 cubes, a little over 100k instances drawn with a single call.
+#define GRID_SIZE 320
+#define INSTANCE_COUNT (GRID_SIZE * GRID_SIZE)
+
+struct ViewPort {
+    glm::mat4 view;
+    glm::mat4 proj;
+};
+
+std::tuple<std::vector<VkDescriptorSetLayoutBinding>, VkDescriptorSetLayout>
+create_bindings_and_descriptorset_layout(const VkDevice& logical_device)
+{
+    VkDescriptorSetLayoutBinding viewport_layout_binding{};
+    viewport_layout_binding.binding = 0;
+    viewport_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    viewport_layout_binding.descriptorCount = 1;
+    viewport_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    const std::vector<VkDescriptorSetLayoutBinding> bindings = {viewport_layout_binding};
+
+    VkDescriptorSetLayoutCreateInfo descriptorset_layout_info{};
+    descriptorset_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptorset_layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
+    descriptorset_layout_info.pBindings = bindings.data();
+
+    VkDescriptorSetLayout descriptorset_layout{};
+    auto status = vkCreateDescriptorSetLayout(logical_device,
+                                              &descriptorset_layout_info,
+                                              nullptr,
+                                              &descriptorset_layout);
+
+    if (status != VK_SUCCESS)
+        throw std::runtime_error("failed to create descriptor set layout!");
+    return {bindings, descriptorset_layout};
+}
+
+/**
+ * @brief Write the instances of the grid, each cube spinning around Z at its own phase.
+ */
+void write_instances(ArcGraphics::Instance_TransformColor* instances, const float time)
+{
+    const float half = GRID_SIZE * 0.5f;
+    for (uint32_t y = 0; y < GRID_SIZE; y++) {
+        for (uint32_t x = 0; x < GRID_SIZE; x++) {
+            auto& instance = instances[y * GRID_SIZE + x];
+            const float angle = time + 0.05f * float(x + y);
+            const float c = 0.5f * std::cos(angle);
+            const float s = 0.5f * std::sin(angle);
+            instance.model = glm::mat4(c,    s,    0.0f, 0.0f,
+                                       -s,   c,    0.0f, 0.0f,
+                                       0.0f, 0.0f, 0.5f, 0.0f,
+                                       float(x) - half, float(y) - half, 0.0f, 1.0f);
+            instance.color = glm::vec4(float(x) / GRID_SIZE, float(y) / GRID_SIZE, 0.6f, 1.0f);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+
+    auto device = ArcGraphics::Device::Builder()
+        .add_khronos_validation_layer()
+        .with_window("Instancing", 1200, 800, SDL_WINDOW_BORDERLESS | SDL_WINDOW_SHOWN)
+        .with_device_cache("device.cache")
+        .produce();
+
+    auto renderer = ArcGraphics::Renderer::Builder(&device)
+        .produce();
+
+    const auto [bindings, descriptorset_layout] = create_bindings_and_descriptorset_layout(device.logical_device());
+
+    const auto vert = ArcGraphics::read_shader_bytecode("../instanced.vert.spv");
+    const auto frag = ArcGraphics::read_shader_bytecode("../instanced.frag.spv");
+    auto pipeline =
+        ArcGraphics::RenderPipeline::Builder(&device,
+            &renderer,
+            vert,
+            frag,
+            descriptorset_layout,
+            ArcGraphics::Vertex_PosTex::get_binding_description(),
+            ArcGraphics::Vertex_PosTex::get_attribute_descriptions()
+            )
+        .with_vertex_binding(ArcGraphics::Instance_TransformColor::get_binding_description(1),
+                             ArcGraphics::Instance_TransformColor::get_attribute_descriptions(1, 2))
+        .with_frames_in_flight(3)
+        .with_clear_color(0.1f, 0.1f, 0.15f)
+        .produce();
+
+    const auto [vertices, indices] = ArcGraphics::create_unit_cube();
+
+    auto vertex_buffer =
+        ArcGraphics::VertexBuffer_PosTex::create_staging(device.physical_device(),
+                                                         device.logical_device(),
+                                                         pipeline.command_pool(),
+                                                         renderer.graphics_queue(),
+                                                         vertices);
+    if (!vertex_buffer)
+        throw std::runtime_error("Failed to create vertex buffer!");
+
+    auto index_buffer = ArcGraphics::IndexBuffer::create(device.physical_device(),
+                                                         device.logical_device(),
+                                                         indices);
+    if (!index_buffer)
+        throw std::runtime_error("Failed to create index buffer!");
+
+    ArcGraphics::InstanceWriter instances(device.physical_device(),
+                                          device.logical_device(),
+                                          sizeof(ArcGraphics::Instance_TransformColor),
+                                          INSTANCE_COUNT,
+                                          pipeline.max_frames_in_flight());
+
+    /* ===================================================================
+     * Create Descriptor Sets
+     */
+    std::vector<VkDescriptorPoolSize> descriptor_pool_sizes =
+        ArcGraphics::create_descriptor_pool_sizes(bindings,
+                                                  pipeline.max_frames_in_flight());
+
+    VkDescriptorPoolCreateInfo descriptor_pool_info{};
+    descriptor_pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptor_pool_info.poolSizeCount = static_cast<uint32_t>(descriptor_pool_sizes.size());
+    descriptor_pool_info.pPoolSizes = descriptor_pool_sizes.data();
+    descriptor_pool_info.maxSets = pipeline.max_frames_in_flight();
+
+    VkDescriptorPool descriptor_pool{};
+    auto status = vkCreateDescriptorPool(device.logical_device(),
+                                         &descriptor_pool_info,
+                                         nullptr,
+                                         &descriptor_pool);
+    if (status != VK_SUCCESS)
+        throw std::runtime_error("Failed to create descriptor pool for uniform buffer!");
+
+    std::vector<VkDescriptorSetLayout> descriptorset_layouts(pipeline.max_frames_in_flight(),
+                                                             descriptorset_layout);
+
+    VkDescriptorSetAllocateInfo descriptor_pool_alloc_info{};
+    descriptor_pool_alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptor_pool_alloc_info.descriptorPool = descriptor_pool;
+    descriptor_pool_alloc_info.descriptorSetCount =
+        static_cast<uint32_t>(descriptorset_layouts.size());
+    descriptor_pool_alloc_info.pSetLayouts = descriptorset_layouts.data();
+
+    std::vector<VkDescriptorSet> descriptorsets(pipeline.max_frames_in_flight());
+    status = vkAllocateDescriptorSets(device.logical_device(),
+                                      &descriptor_pool_alloc_info,
+                                      descriptorsets.data());
+    if (status != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate descriptor sets!");
+
+    /* ===================================================================
+     * Create Uniform Buffers
+     */
+    std::vector<std::unique_ptr<ArcGraphics::BasicUniformBuffer>> uniform_viewports;
+    for (size_t i = 0; i < pipeline.max_frames_in_flight(); i++) {
+        uniform_viewports.push_back(ArcGraphics::BasicUniformBuffer::create(device.physical_device(),
+                                                                            device.logical_device(),
+                                                                            sizeof(ViewPort)));
+        const auto buffer_info = uniform_viewports[i]->descriptor_buffer_info();
+        VkWriteDescriptorSet descriptor_write{};
+        descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_write.dstSet = descriptorsets[i];
+        descriptor_write.dstBinding = 0;
+        descriptor_write.dstArrayElement = 0;
+        descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptor_write.descriptorCount = 1;
+        descriptor_write.pBufferInfo = &buffer_info;
+        vkUpdateDescriptorSets(device.logical_device(), 1, &descriptor_write, 0, nullptr);
+    }
+
+    const auto rendersize = pipeline.render_size();
+    ViewPort viewport{};
+    viewport.view = glm::lookAt(glm::vec3(0.0f, -220.0f, 160.0f),
+                                glm::vec3(0.0f, 0.0f, 0.0f),
+                                glm::vec3(0.0f, 0.0f, 1.0f));
+    viewport.proj = glm::perspective(glm::radians(45.0f),
+                                     rendersize.width / (float)rendersize.height,
+                                     1.0f,
+                                     1000.0f);
+    viewport.proj[1][1] *= -1;
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    bool exit = false;
+    SDL_Event event;
+    while (!exit) {
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT)
+                exit = true;
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE)
+                exit = true;
+        }
+
+        /* =======================================================
+         * Start Command Buffer
+         */
+        const auto frameindex = pipeline.wait_for_next_frame();
+        const auto flight_frame = pipeline.current_flight_frame();
+        if (!frameindex)
+            break;
+        auto command_buffer = pipeline.begin_command_buffer(*frameindex);
+
+        auto currentTime = std::chrono::high_resolution_clock::now();
+        float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+
+        /* Write the instances of this frame straight into the mapped instance stream.
+         */
+        instances.begin_frame(flight_frame);
+        const auto region = instances.allocate(INSTANCE_COUNT);
+        if (!region)
+            throw std::runtime_error("Instance stream is too small!");
+        write_instances(static_cast<ArcGraphics::Instance_TransformColor*>(region->first), time);
+
+        vkCmdBindDescriptorSets(command_buffer,
+                                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                pipeline.layout(),
+                                0,
+                                1,
+                                &descriptorsets[flight_frame],
+                                0,
+                                nullptr);
+        uniform_viewports[flight_frame]->set_uniform(&viewport);
+
+        /* Binding 0 steps per vertex, binding 1 per instance.
+         */
+        VkBuffer vertex_buffers[] = {vertex_buffer->get_buffer()};
+        VkDeviceSize offsets[] = {0};
+        vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
+        instances.bind(command_buffer, 1);
+        vkCmdBindIndexBuffer(command_buffer,
+                             index_buffer->get_buffer(),
+                             0,
+                             VK_INDEX_TYPE_UINT32);
+
+        vkCmdDrawIndexed(command_buffer,
+                         index_buffer->get_count(),
+                         instances.count(),
+                         0,
+                         0,
+                         region->second);
+
+        pipeline.end_command_buffer(command_buffer, *frameindex);
+    }
+
+    vkDeviceWaitIdle(device.logical_device());
+    for (auto& uniform: uniform_viewports)
+        uniform->destroy(device.logical_device());
+    instances.destroy(device.logical_device());
+    vkDestroyDescriptorPool(device.logical_device(), descriptor_pool, nullptr);
+    vkDestroyDescriptorSetLayout(device.logical_device(), descriptorset_layout, nullptr);
+
+    pipeline.destroy();
+    renderer.destroy();
+    device.destroy();
+}
@@ -0,0 +1,136 @@
+#include <arc/Algorithm.hpp>
+#include <arc/BasicBuffer.hpp>
+#include <arc/Device.hpp>
+#include <arc/RenderGraph.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+ * Compiles a small graph and records it without submitting:
+ *
+ *   draw a      -> a
+ *   draw unused -> unused      (nothing reads it, culled)
+ *   reduce a    a -> out
+ *   draw b      -> b
+ *   reduce b    b -> out
+ *
+ * a and b are the same size and live in passes that do not overlap, so they must
+ * share one block of memory. Every frame needs one barrier per transient image
+ * use (layout changes and the hazard of b overwriting the memory of a) and one
+ * for the second write to out, 5 in total.
+ */
+
+constexpr uint32_t expected_barriers = 5;
+
+int check(const bool passed, const std::string& what)
+{
+    std::cout << "  " << what << ": " << (passed ? "ok" : "failed") << std::endl;
+    return passed ? 0 : 1;
+}
+
+uint32_t find_graphics_family(const VkPhysicalDevice physical_device)
+{
+    const auto families = ArcGraphics::get_queue_families(physical_device);
+    for (uint32_t i = 0; i < families.size(); i++)
+        if (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+            return i;
+    throw std::runtime_error("No graphics queue family!");
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+
+    auto device = ArcGraphics::Device::Builder()
+        .add_khronos_validation_layer()
+        .produce();
+    const auto logical_device = device.logical_device();
+
+    VkBuffer out_buffer;
+    VkBufferCreateInfo out_buffer_info;
+    VkDeviceMemory out_memory;
+    ArcGraphics::create_buffer(device.physical_device(),
+                               logical_device,
+                               256,
+                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                               out_buffer_info,
+                               out_buffer,
+                               out_memory);
+
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = find_graphics_family(device.physical_device());
+    VkCommandPool command_pool{};
+    if (vkCreateCommandPool(logical_device, &pool_info, nullptr, &command_pool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create command pool!");
+
+    VkCommandBufferAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandPool = command_pool;
+    alloc_info.commandBufferCount = 1;
+    VkCommandBuffer command_buffer{};
+    if (vkAllocateCommandBuffers(logical_device, &alloc_info, &command_buffer) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate command buffer!");
+
+    ArcGraphics::RenderGraph graph(&device);
+    using ArcGraphics::RenderAccess;
+    const auto out = graph.import_buffer("out", out_buffer);
+    const ArcGraphics::RenderGraphImageDescription description{64, 64, VK_FORMAT_R8G8B8A8_UNORM};
+    const auto a = graph.create_image("a", description);
+    const auto b = graph.create_image("b", description);
+    const auto unused = graph.create_image("unused", description);
+    const auto record_nothing = [](VkCommandBuffer, const ArcGraphics::RenderGraph&) {};
+    graph.add_pass("draw a", [&](auto& pass) {
+        pass.write(a, RenderAccess::color_attachment_write);
+    }, record_nothing);
+    graph.add_pass("draw unused", [&](auto& pass) {
+        pass.write(unused, RenderAccess::color_attachment_write);
+    }, record_nothing);
+    graph.add_pass("reduce a", [&](auto& pass) {
+        pass.read(a, RenderAccess::compute_sampled_read)
+            .write(out, RenderAccess::compute_storage_write);
+    }, record_nothing);
+    graph.add_pass("draw b", [&](auto& pass) {
+        pass.write(b, RenderAccess::color_attachment_write);
+    }, record_nothing);
+    graph.add_pass("reduce b", [&](auto& pass) {
+        pass.read(b, RenderAccess::compute_sampled_read)
+            .write(out, RenderAccess::compute_storage_write);
+    }, record_nothing);
+    graph.compile();
+
+    int failures = 0;
+    const std::vector<std::string> expected_passes{"draw a", "reduce a", "draw b", "reduce b"};
+    failures += check(graph.executed_passes() == expected_passes, "unused pass culled");
+    failures += check(graph.image(unused) == VK_NULL_HANDLE, "no image for the culled pass");
+    failures += check(graph.transient_memory_size() * 2 == graph.unaliased_transient_memory_size(),
+                      "a and b share memory");
+
+    // The second frame also waits for the previous one, which must not add barriers.
+    for (int frame = 0; frame < 2; frame++) {
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        vkBeginCommandBuffer(command_buffer, &begin_info);
+        graph.execute(command_buffer);
+        vkEndCommandBuffer(command_buffer);
+        vkResetCommandBuffer(command_buffer, 0);
+        failures += check(graph.barrier_count() == expected_barriers,
+                          "frame " + std::to_string(frame) + " has " + std::to_string(graph.barrier_count())
+                          + " barriers, expected " + std::to_string(expected_barriers));
+    }
+
+    graph.destroy();
+    vkDestroyCommandPool(logical_device, command_pool, nullptr);
+    vkDestroyBuffer(logical_device, out_buffer, nullptr);
+    vkFreeMemory(logical_device, out_memory, nullptr);
+
+    std::cout << (failures == 0 ? "passed" : "failed") << std::endl;
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -5,6 +5,8 @@
 #include <vulkan/vulkan.h>
 
 #include <algorithm>
+#include <fstream>
+#include <iomanip>
 #include <map>
 #include <set>
 #include <iostream>
@@ -166,8 +168,24 @@ find_graphics_present_indices(const std::vector<VkQueueFamilyProperties> familie
             break;
         i++;
     }
+    indices.compute = find_compute_index(families);
     return indices;
 }
+
+std::optional<uint32_t>
+find_compute_index(const std::vector<VkQueueFamilyProperties>& families)
+{
+    std::optional<uint32_t> shared{};
+    for (uint32_t i = 0; i < families.size(); i++) {
+        if (!(families[i].queueFlags & VK_QUEUE_COMPUTE_BIT))
+            continue;
+        if (!(families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+            return i;
+        if (!shared)
+            shared = i;
+    }
+    return shared;
+}
     
 [[nodiscard]]
 std::vector<VkQueueFamilyProperties> get_queue_families(const VkPhysicalDevice& device)
@@ -383,6 +401,109 @@ remove_zero_score_devices(const std::vector<ScoredDevice>& score_devices)
     return nonzero;
 }
 
+[[nodiscard]]
+std::string stringify_uuid(const uint8_t* uuid)
+{
+    std::stringstream ss;
+    ss << std::hex << std::setfill('0');
+    for (size_t i = 0; i < VK_UUID_SIZE; i++)
+        ss << std::setw(2) << static_cast<uint32_t>(uuid[i]);
+    return ss.str();
+}
+
+[[nodiscard]]
+std::optional<CachedDeviceSelection> read_device_selection_cache(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+        return std::nullopt;
+
+    std::map<std::string, std::string> entries;
+    std::string line;
+    while (std::getline(file, line)) {
+        const auto separator = line.find('=');
+        if (separator == std::string::npos)
+            continue;
+        entries[line.substr(0, separator)] = line.substr(separator + 1);
+    }
+
+    const char* keys[] = {"vendor_id", "device_id", "driver_version",
+                          "pipeline_cache_uuid", "graphics_index", "present_index"};
+    for (const auto key: keys)
+        if (entries.find(key) == entries.end())
+            return std::nullopt;
+
+    try {
+        CachedDeviceSelection cache{};
+        cache.vendor_id = static_cast<uint32_t>(std::stoul(entries["vendor_id"]));
+        cache.device_id = static_cast<uint32_t>(std::stoul(entries["device_id"]));
+        cache.driver_version = static_cast<uint32_t>(std::stoul(entries["driver_version"]));
+        cache.pipeline_cache_uuid = entries["pipeline_cache_uuid"];
+        cache.graphics_index = static_cast<uint32_t>(std::stoul(entries["graphics_index"]));
+        cache.present_index = static_cast<uint32_t>(std::stoul(entries["present_index"]));
+        return cache;
+    }
+    catch (const std::logic_error&) {
+    }
+    return std::nullopt;
+}
+
+void write_device_selection_cache(const std::string& path,
+                                  const VkPhysicalDevice device,
+                                  const QueueFamilyIndices& indices)
+{
+    if (!indices.graphics || !indices.present)
+        return;
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        std::cout << "Could not write device cache: " << path << std::endl;
+        return;
+    }
+    const auto properties = get_physical_device_properties(device);
+    file << "device_name=" << properties.deviceName << "\n"
+         << "vendor_id=" << properties.vendorID << "\n"
+         << "device_id=" << properties.deviceID << "\n"
+         << "driver_version=" << properties.driverVersion << "\n"
+         << "pipeline_cache_uuid=" << stringify_uuid(properties.pipelineCacheUUID) << "\n"
+         << "graphics_index=" << *indices.graphics << "\n"
+         << "present_index=" << *indices.present << "\n";
+}
+
+[[nodiscard]]
+std::optional<VkPhysicalDevice>
+find_cached_physical_device(const VkInstance instance,
+                            const VkSurfaceKHR window_surface,
+                            const CachedDeviceSelection& cache)
+{
+    for (const auto& device: get_available_physical_devices(instance)) {
+        const auto properties = get_physical_device_properties(device);
+        if (properties.vendorID != cache.vendor_id
+         || properties.deviceID != cache.device_id
+         || properties.driverVersion != cache.driver_version
+         || stringify_uuid(properties.pipelineCacheUUID) != cache.pipeline_cache_uuid)
+            continue;
+
+        const auto families = get_queue_families(device);
+        if (cache.graphics_index >= families.size() || cache.present_index >= families.size())
+            return std::nullopt;
+        if (!(families[cache.graphics_index].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+            return std::nullopt;
+
+        VkBool32 present_support = false;
+        vkGetPhysicalDeviceSurfaceSupportKHR(device,
+                                             cache.present_index,
+                                             window_surface,
+                                             &present_support);
+        if (!present_support)
+            return std::nullopt;
+
+        std::cout << "Cached Device: " << properties.deviceName << "\n";
+        return device;
+    }
+    return std::nullopt;
+}
+
 VkExtent2D get_window_size(const VkDevice logical_device, SDL_Window* window)
 {
     int width, height;
@@ -418,6 +539,70 @@ uint32_t find_memory_type(const VkPhysicalDeviceMemoryProperties mem_properties,
     throw std::runtime_error("failed to find suitable memory type!");
 }
 
+bool is_instance_extension_available(const char* extension)
+{
+    for (const auto& properties: get_available_extension_properties())
+        if (strcmp(properties.extensionName, extension) == 0)
+            return true;
+    return false;
+}
+
+std::vector<MemoryHeapBudget> get_memory_heap_budgets(const VkInstance instance,
+                                                      const VkPhysicalDevice device,
+                                                      const bool memory_budget)
+{
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties{};
+    budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    VkPhysicalDeviceMemoryProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties.pNext = &budget_properties;
+
+    // The instance targets Vulkan 1.0, so the query comes from the KHR extension.
+    const auto get_memory_properties2 = memory_budget
+        ? reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(
+              vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR"))
+        : nullptr;
+    const bool measured = get_memory_properties2 != nullptr;
+    if (measured)
+        get_memory_properties2(device, &properties);
+    else
+        properties.memoryProperties = get_physical_device_memory_properties(device);
+
+    std::vector<MemoryHeapBudget> budgets{};
+    for (uint32_t i = 0; i < properties.memoryProperties.memoryHeapCount; i++) {
+        const auto& heap = properties.memoryProperties.memoryHeaps[i];
+        budgets.push_back({
+            measured ? budget_properties.heapBudget[i] : heap.size,
+            measured ? budget_properties.heapUsage[i] : 0,
+            (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0,
+            measured
+        });
+    }
+    return budgets;
+}
+
+[[nodiscard]]
+std::optional<VkFormat> find_supported_texture_format(const VkPhysicalDevice& physical_device,
+                                                      const std::vector<VkFormat>& candidates,
+                                                      const VkImageTiling tiling,
+                                                      const VkFormatFeatureFlags features) 
+{
+    for (const VkFormat format : candidates) {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(physical_device, format, &props);
+
+        if (tiling == VK_IMAGE_TILING_LINEAR 
+        && (props.linearTilingFeatures & features) == features) {
+            return format;
+        }
+        else if (tiling == VK_IMAGE_TILING_OPTIMAL 
+            && (props.optimalTilingFeatures & features) == features) {
+            return format;
+        }
+    }
+    return std::nullopt;
+}
+
 void create_image(const VkPhysicalDevice physical_device,
                   const VkDevice logical_device,
                   const uint32_t width,
@@ -427,7 +612,9 @@ void create_image(const VkPhysicalDevice physical_device,
                   const VkImageUsageFlags usage,
                   const VkMemoryPropertyFlags properties,
                   VkImage& image,
-                  VkDeviceMemory& memory)
+                  VkDeviceMemory& memory,
+                  const uint32_t mip_levels,
+                  const uint32_t array_layers)
 {
     VkImageCreateInfo image_info{};
     image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -435,8 +622,8 @@ void create_image(const VkPhysicalDevice physical_device,
     image_info.extent.width = width;
     image_info.extent.height = height;
     image_info.extent.depth = 1;
-    image_info.mipLevels = 1;
-    image_info.arrayLayers = 1;
+    image_info.mipLevels = mip_levels;
+    image_info.arrayLayers = array_layers;
     image_info.format = format;
     image_info.tiling = tiling;
     //VK_IMAGE_TILING_LINEAR:
@@ -466,8 +653,11 @@ void create_image(const VkPhysicalDevice physical_device,
                                                   properties);
 
     status = vkAllocateMemory(logical_device, &alloc_info, nullptr, &memory);
-    if (status != VK_SUCCESS)
-        throw std::runtime_error("failed to allocate image memory!");
+    if (status != VK_SUCCESS) {
+        vkDestroyImage(logical_device, image, nullptr);
+        image = VK_NULL_HANDLE;
+        throw OutOfDeviceMemory("failed to allocate image memory!");
+    }
 
     vkBindImageMemory(logical_device, image, memory, 0);
 }
@@ -476,24 +666,25 @@ void create_image(const VkPhysicalDevice physical_device,
 std::optional<VkImageView> create_image_view(const VkDevice& device,
                                              const VkImage image,
                                              const VkFormat format,
-                                             const VkImageAspectFlags aspect)
+                                             const VkImageAspectFlags aspect,
+                                             const uint32_t mip_levels,
+                                             const uint32_t array_layers,
+                                             const VkImageViewType view_type,
+                                             const VkComponentMapping& components)
 {
     VkImageViewCreateInfo create_info{};
     create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     create_info.image = image;
-    create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    create_info.viewType = view_type;
     create_info.format = format;
-    // Note that VK_COMPONENT_SWIZZLE_IDENTITY is specified as 0, and it is therefore
-    // not fully nessecary to set the components of ImageViewCreateInfo
-    create_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-    create_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-    create_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-    create_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    // Note that VK_COMPONENT_SWIZZLE_IDENTITY is specified as 0, so the default
+    // constructed components are the identity swizzle.
+    create_info.components = components;
     create_info.subresourceRange.aspectMask = aspect;
     create_info.subresourceRange.baseMipLevel = 0;
-    create_info.subresourceRange.levelCount = 1;
+    create_info.subresourceRange.levelCount = mip_levels;
     create_info.subresourceRange.baseArrayLayer = 0;
-    create_info.subresourceRange.layerCount = 1;
+    create_info.subresourceRange.layerCount = array_layers;
     
     VkImageView view;
     const auto status = vkCreateImageView(device, &create_info, nullptr, &view);
@@ -636,9 +827,115 @@ VkPhysicalDevice get_best_physical_device(const VkInstance instance,
     
 
 [[nodiscard]]
+DrawSubmissionFeatures get_draw_submission_features(const VkInstance instance,
+                                                    const VkPhysicalDevice device)
+{
+    const auto features = get_physical_device_features(device);
+    DrawSubmissionFeatures draw_features{};
+    draw_features.multi_draw_indirect = features.multiDrawIndirect == VK_TRUE;
+    draw_features.draw_indirect_first_instance = features.drawIndirectFirstInstance == VK_TRUE;
+    draw_features.max_draw_indirect_count = draw_features.multi_draw_indirect
+        ? get_physical_device_properties(device).limits.maxDrawIndirectCount
+        : 1;
+    draw_features.draw_indirect_count =
+        is_device_extensions_supported(device, {VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME});
+
+#ifdef VK_EXT_multi_draw
+    if (!is_instance_extension_available(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)
+        || !is_device_extensions_supported(device, {VK_EXT_MULTI_DRAW_EXTENSION_NAME}))
+        return draw_features;
+
+    // The instance targets Vulkan 1.0, so the queries come from the KHR extension.
+    const auto get_features2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+        vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+    const auto get_properties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2KHR>(
+        vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2KHR"));
+    if (!get_features2 || !get_properties2)
+        return draw_features;
+
+    VkPhysicalDeviceMultiDrawFeaturesEXT multi_draw_features{};
+    multi_draw_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTI_DRAW_FEATURES_EXT;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &multi_draw_features;
+    get_features2(device, &features2);
+
+    VkPhysicalDeviceMultiDrawPropertiesEXT multi_draw_properties{};
+    multi_draw_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTI_DRAW_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &multi_draw_properties;
+    get_properties2(device, &properties2);
+
+    draw_features.multi_draw = multi_draw_features.multiDraw == VK_TRUE
+        && multi_draw_properties.maxMultiDrawCount > 0;
+    draw_features.max_multi_draw_count = multi_draw_properties.maxMultiDrawCount;
+#else
+    (void)instance;
+#endif
+    return draw_features;
+}
+
+bool is_synchronization2_supported(const VkInstance instance,
+                                   const VkPhysicalDevice device)
+{
+#ifdef VK_KHR_synchronization2
+    if (!is_instance_extension_available(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)
+        || !is_device_extensions_supported(device, {VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME}))
+        return false;
+
+    const auto get_features2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+        vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+    if (!get_features2)
+        return false;
+
+    VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2_features{};
+    synchronization2_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &synchronization2_features;
+    get_features2(device, &features2);
+    return synchronization2_features.synchronization2 == VK_TRUE;
+#else
+    (void)instance;
+    (void)device;
+    return false;
+#endif
+}
+
+bool is_timeline_semaphore_supported(const VkInstance instance,
+                                     const VkPhysicalDevice device)
+{
+#ifdef VK_KHR_timeline_semaphore
+    if (!is_instance_extension_available(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)
+        || !is_device_extensions_supported(device, {VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME}))
+        return false;
+
+    const auto get_features2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+        vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+    if (!get_features2)
+        return false;
+
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_features{};
+    timeline_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &timeline_features;
+    get_features2(device, &features2);
+    return timeline_features.timelineSemaphore == VK_TRUE;
+#else
+    (void)instance;
+    (void)device;
+    return false;
+#endif
+}
+
 VkDevice get_logical_device(const VkPhysicalDevice physical_device,
                             const VkSurfaceKHR window_surface,
-                            const DeviceExtensions extensions)
+                            const DeviceExtensions extensions,
+                            const DrawSubmissionFeatures& draw_features,
+                            const bool synchronization2,
+                            const bool timeline_semaphore)
 {   
     const auto queue_families = get_queue_families(physical_device);
     auto render_present_indices = find_graphics_present_indices(queue_families,
@@ -648,26 +945,76 @@ VkDevice get_logical_device(const VkPhysicalDevice physical_device,
     if (!render_present_indices.is_complete())
         throw std::runtime_error("Failed to find complete queue family in device!");
  
-    VkDeviceQueueCreateInfo queue_create_info{};
-    queue_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    queue_create_info.queueFamilyIndex = render_present_indices.graphics.value();
-    queue_create_info.queueCount = 1;
+    std::vector<VkDeviceQueueCreateInfo> queue_create_infos(1);
+    queue_create_infos[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_create_infos[0].queueFamilyIndex = render_present_indices.graphics.value();
+    queue_create_infos[0].queueCount = 1;
     float queue_priority = 1.0f;
-    queue_create_info.pQueuePriorities = &queue_priority;
+    queue_create_infos[0].pQueuePriorities = &queue_priority;
+
+    // A separate compute family gets a queue of its own, for ComputePipeline.
+    if (render_present_indices.compute
+        && *render_present_indices.compute != *render_present_indices.graphics) {
+        auto compute_create_info = queue_create_infos[0];
+        compute_create_info.queueFamilyIndex = *render_present_indices.compute;
+        queue_create_infos.push_back(compute_create_info);
+    }
 
     VkPhysicalDeviceFeatures device_features{};
     // TODO: this is an optional thing but i do not know if it is strictly required
     // for the program to work or if there is an alternative?
     device_features.samplerAnisotropy = VK_TRUE;
+    // Block compressed textures are optional, Texture::create_compressed checks
+    // the format support before using them.
+    device_features.textureCompressionBC =
+        get_physical_device_features(physical_device).textureCompressionBC;
+    // Without these, DrawSubmitter issues indirect draws one command at a time.
+    device_features.multiDrawIndirect = draw_features.multi_draw_indirect ? VK_TRUE : VK_FALSE;
+    device_features.drawIndirectFirstInstance =
+        draw_features.draw_indirect_first_instance ? VK_TRUE : VK_FALSE;
 
     VkDeviceCreateInfo device_create_info{};
     device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    device_create_info.pQueueCreateInfos = &queue_create_info;
-    device_create_info.queueCreateInfoCount = 1;
+    device_create_info.pQueueCreateInfos = queue_create_infos.data();
+    device_create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
     device_create_info.pEnabledFeatures = &device_features;
     // Enable extensions
     device_create_info.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
     device_create_info.ppEnabledExtensionNames = extensions.data();
+    // Optional feature structs are chained in front of each other.
+    void* features_chain = nullptr;
+#ifdef VK_EXT_multi_draw
+    VkPhysicalDeviceMultiDrawFeaturesEXT multi_draw_features{};
+    multi_draw_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTI_DRAW_FEATURES_EXT;
+    multi_draw_features.multiDraw = VK_TRUE;
+    if (draw_features.multi_draw) {
+        multi_draw_features.pNext = features_chain;
+        features_chain = &multi_draw_features;
+    }
+#endif
+#ifdef VK_KHR_synchronization2
+    VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2_features{};
+    synchronization2_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+    synchronization2_features.synchronization2 = VK_TRUE;
+    if (synchronization2) {
+        synchronization2_features.pNext = features_chain;
+        features_chain = &synchronization2_features;
+    }
+#else
+    (void)synchronization2;
+#endif
+#ifdef VK_KHR_timeline_semaphore
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_features{};
+    timeline_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+    timeline_features.timelineSemaphore = VK_TRUE;
+    if (timeline_semaphore) {
+        timeline_features.pNext = features_chain;
+        features_chain = &timeline_features;
+    }
+#else
+    (void)timeline_semaphore;
+#endif
+    device_create_info.pNext = features_chain;
 
     VkDevice logical_device;
     auto status = vkCreateDevice(physical_device,
@@ -684,7 +1031,10 @@ VkInstance create_instance(SDL_Window* window,
                            const ValidationLayers& validation_layers)
 {
     const auto app_info = create_app_info("noname");
-    const auto extensions = get_available_extensions(window);
+    auto extensions = get_available_extensions(window);
+    // Needed to query heap budgets with VK_EXT_memory_budget.
+    if (is_instance_extension_available(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME))
+        extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
     auto instance_info = create_instance_info(extensions, &app_info);
     std::cout << "Provided Validation Layers:\n";
     for (const auto& layer: validation_layers) {
@@ -0,0 +1,410 @@
+#include "../arc/AssetArchive.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace ArcGraphics {
+
+static constexpr char archive_magic[8] = {'A', 'R', 'C', 'P', 'A', 'C', 'K', '\0'};
+static constexpr uint32_t archive_version = 1;
+
+// Blobs start at cache line boundaries, levels within textures at the bufferOffset
+// alignment of every supported block size, so they can be staged at the same offsets.
+static constexpr uint64_t blob_alignment = 64;
+static constexpr VkDeviceSize level_alignment = 16;
+
+[[nodiscard]]
+static uint64_t align_up(const uint64_t value, const uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * @brief Check that [offset, offset + size) lies within a file of file_size bytes.
+ */
+[[nodiscard]]
+static bool in_bounds(const uint64_t offset, const uint64_t size, const uint64_t file_size)
+{
+    return offset <= file_size && size <= file_size - offset;
+}
+
+/**
+ * @brief Check that the levels of a texture entry are its mip chain, packed in its data.
+ * Level l must be the block compressed size of (width >> l, height >> l) and start at the
+ * aligned end of the level before it, the first at the start of the data, so the data can
+ * be staged with a single copy.
+ */
+[[nodiscard]]
+static bool texture_levels_valid(const ArchiveEntry& entry, const ArchiveLevel* levels)
+{
+    const auto format = static_cast<VkFormat>(entry.format);
+    if (entry.width == 0 || entry.height == 0 || block_byte_size(format) == 0
+        || entry.level_count == 0 || entry.level_count > mip_level_count(entry.width, entry.height))
+        return false;
+
+    uint64_t offset = 0;
+    for (uint32_t level = 0; level < entry.level_count; level++) {
+        const auto& archive_level = levels[level];
+        const uint32_t width = std::max(entry.width >> level, 1u);
+        const uint32_t height = std::max(entry.height >> level, 1u);
+        if (archive_level.width != width || archive_level.height != height
+            || archive_level.size != block_compressed_size(format, width, height)
+            || archive_level.offset != entry.data_offset + offset
+            || !in_bounds(offset, archive_level.size, entry.data_size))
+            return false;
+        offset = align_up(offset + archive_level.size, level_alignment);
+    }
+    return true;
+}
+
+uint64_t hash_asset_name(const std::string_view name)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const char c: name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+AssetArchive::AssetArchive(std::unique_ptr<MappedFile> file)
+    : m_file(std::move(file))
+    , m_header(reinterpret_cast<const ArchiveHeader*>(m_file->data()))
+{
+}
+
+std::unique_ptr<AssetArchive> AssetArchive::open(const std::string& path)
+{
+    auto file = MappedFile::open(path);
+    if (!file)
+        return nullptr;
+
+    // Everything is validated once, so lookups can trust the tables.
+    const auto invalid = [&](const char* reason) {
+        std::cout << "Invalid asset archive " << path << ": " << reason << std::endl;
+        return nullptr;
+    };
+    const uint64_t size = file->size();
+    if (size < sizeof(ArchiveHeader))
+        return invalid("too small");
+    const auto header = reinterpret_cast<const ArchiveHeader*>(file->data());
+    if (memcmp(header->magic, archive_magic, sizeof(archive_magic)) != 0)
+        return invalid("bad magic");
+    if (header->version != archive_version)
+        return invalid("unsupported version");
+    if (header->file_size != size)
+        return invalid("truncated");
+    if (header->entries_offset % alignof(ArchiveEntry) != 0
+        || header->levels_offset % alignof(ArchiveLevel) != 0)
+        return invalid("misaligned tables");
+    if (!in_bounds(header->entries_offset, uint64_t(header->entry_count) * sizeof(ArchiveEntry), size)
+        || !in_bounds(header->levels_offset, uint64_t(header->level_count) * sizeof(ArchiveLevel), size)
+        || !in_bounds(header->names_offset, header->names_size, size))
+        return invalid("tables out of bounds");
+
+    const auto entries = reinterpret_cast<const ArchiveEntry*>(file->data() + header->entries_offset);
+    const auto levels = reinterpret_cast<const ArchiveLevel*>(file->data() + header->levels_offset);
+    for (uint32_t i = 0; i < header->entry_count; i++) {
+        const auto& entry = entries[i];
+        if (i > 0 && entries[i - 1].name_hash >= entry.name_hash)
+            return invalid("entries not sorted");
+        if (!in_bounds(entry.name_offset, entry.name_size, header->names_size)
+            || !in_bounds(entry.data_offset, entry.data_size, size)
+            || !in_bounds(entry.first_level, entry.level_count, header->level_count))
+            return invalid("entry out of bounds");
+        if (entry.type == AssetType::texture && !texture_levels_valid(entry, levels + entry.first_level))
+            return invalid("texture levels do not match the texture");
+    }
+
+    return std::unique_ptr<AssetArchive>(new AssetArchive(std::move(file)));
+}
+
+const ArchiveEntry* AssetArchive::entries() const
+{
+    return reinterpret_cast<const ArchiveEntry*>(m_file->data() + m_header->entries_offset);
+}
+
+size_t AssetArchive::entry_count() const
+{
+    return m_header->entry_count;
+}
+
+const ArchiveEntry* AssetArchive::find(const std::string_view name) const
+{
+    const uint64_t hash = hash_asset_name(name);
+    const auto first = entries();
+    const auto last = first + m_header->entry_count;
+    const auto found = std::lower_bound(first, last, hash, [](const ArchiveEntry& entry, const uint64_t value) {
+        return entry.name_hash < value;
+    });
+    if (found == last || found->name_hash != hash || this->name(*found) != name)
+        return nullptr;
+    return found;
+}
+
+const unsigned char* AssetArchive::data(const ArchiveEntry& entry) const
+{
+    return m_file->data() + entry.data_offset;
+}
+
+std::string_view AssetArchive::name(const ArchiveEntry& entry) const
+{
+    const auto names = reinterpret_cast<const char*>(m_file->data() + m_header->names_offset);
+    return {names + entry.name_offset, entry.name_size};
+}
+
+const ArchiveLevel* AssetArchive::levels(const ArchiveEntry& entry) const
+{
+    const auto levels = reinterpret_cast<const ArchiveLevel*>(m_file->data() + m_header->levels_offset);
+    return levels + entry.first_level;
+}
+
+ShaderBytecode AssetArchive::shader_bytecode(const std::string_view name) const
+{
+    const auto entry = find(name);
+    if (!entry || entry->type != AssetType::shader)
+        throw std::runtime_error("Asset archive has no shader " + std::string(name) + "!");
+    const auto begin = reinterpret_cast<const char*>(data(*entry));
+    return ShaderBytecode(begin, begin + entry->data_size);
+}
+
+void ArchiveWriter::add(Asset asset)
+{
+    asset.entry.name_hash = hash_asset_name(asset.name);
+    if (!m_hashes.insert(asset.entry.name_hash).second)
+        throw std::invalid_argument("Asset " + asset.name + " is already in the archive!");
+    asset.entry.name_size = static_cast<uint32_t>(asset.name.size());
+    asset.entry.data_size = asset.data.size();
+    m_assets.push_back(std::move(asset));
+}
+
+void ArchiveWriter::add_shader(const std::string& name, const ShaderBytecode& bytecode)
+{
+    if (bytecode.size() % 4 != 0)
+        throw std::invalid_argument("Shader " + name + " is not SPIR-V!");
+    Asset asset{name, {}, {bytecode.begin(), bytecode.end()}, {}};
+    asset.entry.type = AssetType::shader;
+    add(std::move(asset));
+}
+
+void ArchiveWriter::add_buffer(const std::string& name,
+                               const AssetType type,
+                               const void* data,
+                               const size_t size,
+                               const uint32_t stride)
+{
+    if (type != AssetType::vertices && type != AssetType::indices)
+        throw std::invalid_argument("Buffer " + name + " must hold vertices or indices!");
+    if (stride == 0 || size % stride != 0)
+        throw std::invalid_argument("Buffer " + name + " is not a whole number of elements!");
+    const auto bytes = static_cast<const unsigned char*>(data);
+    Asset asset{name, {}, {bytes, bytes + size}, {}};
+    asset.entry.type = type;
+    asset.entry.stride = stride;
+    add(std::move(asset));
+}
+
+void ArchiveWriter::add_texture(const std::string& name,
+                                const VkFormat format,
+                                const uint32_t width,
+                                const uint32_t height,
+                                const std::vector<CompressedLevel>& levels,
+                                const unsigned char* data)
+{
+    if (levels.empty())
+        throw std::invalid_argument("Texture " + name + " has no levels!");
+    if (block_byte_size(format) == 0 || levels.size() > mip_level_count(width, height))
+        throw std::invalid_argument("Texture " + name + " is not a block compressed mip chain!");
+    for (size_t level = 0; level < levels.size(); level++) {
+        const uint32_t level_width = std::max(width >> level, 1u);
+        const uint32_t level_height = std::max(height >> level, 1u);
+        if (levels[level].width != level_width || levels[level].height != level_height
+            || levels[level].size != block_compressed_size(format, level_width, level_height))
+            throw std::invalid_argument("Texture " + name + " is not a block compressed mip chain!");
+    }
+    Asset asset{name, {}, {}, {}};
+    asset.entry.type = AssetType::texture;
+    asset.entry.format = static_cast<uint32_t>(format);
+    asset.entry.width = width;
+    asset.entry.height = height;
+    asset.entry.level_count = static_cast<uint32_t>(levels.size());
+    for (const auto& level: levels) {
+        const auto offset = align_up(asset.data.size(), level_alignment);
+        asset.data.resize(static_cast<size_t>(offset + level.size), 0);
+        memcpy(asset.data.data() + offset, data + level.offset, static_cast<size_t>(level.size));
+        asset.levels.push_back({offset, level.size, level.width, level.height});
+    }
+    add(std::move(asset));
+}
+
+void ArchiveWriter::add_blob(const std::string& name, const void* data, const size_t size)
+{
+    const auto bytes = static_cast<const unsigned char*>(data);
+    Asset asset{name, {}, {bytes, bytes + size}, {}};
+    asset.entry.type = AssetType::blob;
+    add(std::move(asset));
+}
+
+bool ArchiveWriter::write(const std::string& path) const
+{
+    std::vector<const Asset*> sorted{};
+    for (const auto& asset: m_assets)
+        sorted.push_back(&asset);
+    std::sort(sorted.begin(), sorted.end(), [](const Asset* a, const Asset* b) {
+        return a->entry.name_hash < b->entry.name_hash;
+    });
+
+    ArchiveHeader header{};
+    memcpy(header.magic, archive_magic, sizeof(archive_magic));
+    header.version = archive_version;
+    header.entry_count = static_cast<uint32_t>(sorted.size());
+    header.entries_offset = sizeof(ArchiveHeader);
+    header.levels_offset = header.entries_offset + sorted.size() * sizeof(ArchiveEntry);
+
+    std::vector<ArchiveEntry> entries{};
+    std::vector<ArchiveLevel> levels{};
+    std::string names{};
+    for (const auto asset: sorted) {
+        auto entry = asset->entry;
+        entry.name_offset = static_cast<uint32_t>(names.size());
+        entry.first_level = static_cast<uint32_t>(levels.size());
+        names += asset->name;
+        levels.insert(levels.end(), asset->levels.begin(), asset->levels.end());
+        entries.push_back(entry);
+    }
+    header.level_count = static_cast<uint32_t>(levels.size());
+    header.names_offset = header.levels_offset + levels.size() * sizeof(ArchiveLevel);
+    header.names_size = static_cast<uint32_t>(names.size());
+
+    // Place the blobs and make the level offsets absolute.
+    uint64_t file_size = header.names_offset + names.size();
+    for (size_t i = 0; i < sorted.size(); i++) {
+        auto& entry = entries[i];
+        entry.data_offset = align_up(file_size, blob_alignment);
+        file_size = entry.data_offset + entry.data_size;
+        for (uint32_t level = 0; level < entry.level_count; level++)
+            levels[entry.first_level + level].offset += entry.data_offset;
+    }
+    header.file_size = file_size;
+
+    std::vector<unsigned char> out(static_cast<size_t>(file_size), 0);
+    memcpy(out.data(), &header, sizeof(header));
+    if (!entries.empty())
+        memcpy(out.data() + header.entries_offset, entries.data(), entries.size() * sizeof(ArchiveEntry));
+    if (!levels.empty())
+        memcpy(out.data() + header.levels_offset, levels.data(), levels.size() * sizeof(ArchiveLevel));
+    memcpy(out.data() + header.names_offset, names.data(), names.size());
+    for (size_t i = 0; i < sorted.size(); i++)
+        std::copy(sorted[i]->data.begin(), sorted[i]->data.end(), out.begin() + entries[i].data_offset);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+    return file.good();
+}
+
+std::unique_ptr<Texture> upload_archive_texture(const VkPhysicalDevice& physical_device,
+                                                const VkDevice& logical_device,
+                                                const VkCommandPool& command_pool,
+                                                const VkQueue& graphics_queue,
+                                                StagingBuffer& staging,
+                                                const AssetArchive& archive,
+                                                const ArchiveEntry& entry,
+                                                SamplerCache* samplers)
+{
+    if (entry.type != AssetType::texture || entry.level_count == 0)
+        return nullptr;
+
+    const auto format = static_cast<VkFormat>(entry.format);
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physical_device, format, &properties);
+    if (!(properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+        std::cout << "Archive texture " << archive.name(entry) << " has format " << format
+                  << ", which is not supported by the device" << std::endl;
+        return nullptr;
+    }
+
+    // The levels are packed in the archive as they are staged, so this is a single copy.
+    const auto levels = archive.levels(entry);
+    const VkDeviceSize first = levels[0].offset;
+    const VkDeviceSize size = levels[entry.level_count - 1].offset + levels[entry.level_count - 1].size - first;
+    // AssetArchive::open checked the levels, this guards entries that did not come from it.
+    if (first != entry.data_offset || size > entry.data_size)
+        return nullptr;
+
+    std::optional<StagingBuffer> temporary{};
+    auto region = staging.allocate(size, level_alignment);
+    if (!region) {
+        temporary.emplace(physical_device, logical_device, size);
+        region = temporary->allocate(size, level_alignment);
+    }
+    const auto release = [&] {
+        if (temporary)
+            temporary->destroy(logical_device);
+        else
+            staging.release(*region);
+    };
+    memcpy(region->data, archive.data(entry), static_cast<size_t>(size));
+
+    std::vector<VkDeviceSize> level_offsets{};
+    for (uint32_t level = 0; level < entry.level_count; level++)
+        level_offsets.push_back(region->offset + levels[level].offset - first);
+
+    VkImage texture{};
+    VkDeviceMemory texture_memory;
+    try {
+        create_image(physical_device,
+                     logical_device,
+                     entry.width,
+                     entry.height,
+                     format,
+                     VK_IMAGE_TILING_OPTIMAL,
+                     VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                     texture,
+                     texture_memory,
+                     entry.level_count);
+    } catch (const OutOfDeviceMemory&) {
+        release();
+        throw;
+    }
+
+    const VkBuffer staging_buffer = temporary ? temporary->buffer() : staging.buffer();
+    const auto record_upload = [&](VkCommandBuffer& command_buffer) {
+        record_texture_upload(command_buffer,
+                              staging_buffer,
+                              level_offsets,
+                              texture,
+                              entry.width,
+                              entry.height,
+                              entry.level_count);
+    };
+    with_single_use_command_buffer(logical_device,
+                                   command_pool,
+                                   graphics_queue,
+                                   record_upload);
+    release();
+
+    const auto view = create_image_view(logical_device,
+                                        texture,
+                                        format,
+                                        VK_IMAGE_ASPECT_COLOR_BIT,
+                                        entry.level_count);
+    if (!view)
+        return nullptr;
+
+    const auto sampler = get_texture_sampler(physical_device, logical_device, entry.level_count, samplers);
+
+    return std::make_unique<Texture>(texture,
+                                     texture_memory,
+                                     format,
+                                     *view,
+                                     sampler,
+                                     entry.level_count,
+                                     1,
+                                     samplers == nullptr);
+}
+
+}
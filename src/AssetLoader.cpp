@@ -0,0 +1,323 @@
+#include "../arc/AssetLoader.hpp"
+#include "../arc/BasicBuffer.hpp"
+#include "../arc/Algorithm.hpp"
+
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <queue>
+
+namespace ArcGraphics {
+
+BatchLoader::BatchLoader(ThreadPool& pool)
+    : m_pool(pool)
+{
+}
+
+BatchLoader& BatchLoader::add_image(const std::string& name, const std::string& path)
+{
+    m_requests.push_back({AssetKind::image, name, path, {}});
+    return *this;
+}
+
+BatchLoader& BatchLoader::add_shader(const std::string& name, const std::string& path)
+{
+    m_requests.push_back({AssetKind::shader, name, path, {}});
+    return *this;
+}
+
+BatchLoader& BatchLoader::add_geometry(const std::string& name,
+                                       std::function<LoadedGeometry()> generator)
+{
+    m_requests.push_back({AssetKind::geometry, name, {}, std::move(generator)});
+    return *this;
+}
+
+LoadedAssets BatchLoader::load(const LoadProgressCallback& progress)
+{
+    struct Result {
+        std::unique_ptr<Image> image{};
+        ShaderBytecode shader{};
+        LoadedGeometry geometry{};
+        bool ok{false};
+    };
+
+    // Every request owns its result slot, so the workers never share a container.
+    // Only the indices of finished requests go through the lock.
+    std::vector<Result> results(m_requests.size());
+    std::queue<size_t> finished{};
+    std::mutex mutex{};
+    std::condition_variable condition{};
+
+    for (size_t i = 0; i < m_requests.size(); i++) {
+        const auto load_request = [&, i] {
+            const auto& request = m_requests[i];
+            auto& result = results[i];
+            try {
+                switch (request.kind) {
+                case AssetKind::image:
+                    result.image = Image::load_from_path(request.path);
+                    result.ok = result.image != nullptr;
+                    break;
+                case AssetKind::shader:
+                    result.shader = read_shader_bytecode(request.path);
+                    result.ok = true;
+                    break;
+                case AssetKind::geometry:
+                    result.geometry = request.generator();
+                    result.ok = true;
+                    break;
+                }
+            }
+            catch (const std::exception& e) {
+                std::cout << "Failed to load asset " << request.name
+                          << ": " << e.what() << std::endl;
+            }
+            // Notify under the lock, load() may return as soon as it can take it.
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push(i);
+            condition.notify_one();
+        };
+        // The futures are not needed, completion is reported through the queue.
+        (void)m_pool.submit(load_request);
+    }
+
+    LoadedAssets assets{};
+    for (size_t done = 0; done < m_requests.size();) {
+        size_t index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&] { return !finished.empty(); });
+            index = finished.front();
+            finished.pop();
+        }
+        done++;
+
+        auto& request = m_requests[index];
+        auto& result = results[index];
+        if (!result.ok) {
+            assets.failed.push_back(request.name);
+        } else {
+            switch (request.kind) {
+            case AssetKind::image:
+                assets.images[request.name] = std::move(result.image);
+                break;
+            case AssetKind::shader:
+                assets.shaders[request.name] = std::move(result.shader);
+                break;
+            case AssetKind::geometry:
+                assets.geometry[request.name] = std::move(result.geometry);
+                break;
+            }
+        }
+
+        if (progress)
+            progress(done, m_requests.size(), request.name);
+    }
+
+    m_requests.clear();
+    return assets;
+}
+
+void UploadedAssets::destroy(const VkDevice logical_device)
+{
+    for (auto& [name, texture]: textures)
+        texture->destroy(logical_device);
+    textures.clear();
+    geometry.clear();
+}
+
+[[nodiscard]]
+static VkDeviceSize align_offset(const VkDeviceSize offset, const VkDeviceSize alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+UploadedAssets upload_assets(const VkPhysicalDevice& physical_device,
+                             const VkDevice& logical_device,
+                             const VkCommandPool& command_pool,
+                             const VkQueue& graphics_queue,
+                             const LoadedAssets& assets,
+                             const bool srgb,
+                             const bool generate_mipmaps,
+                             SamplerCache* samplers)
+{
+    // Buffer to image copies need offsets that are a multiple of the texel size,
+    // 16 covers every uncompressed format.
+    constexpr VkDeviceSize staging_alignment = 16;
+
+    struct ImageUpload {
+        const std::string* name;
+        const Image* image;
+        std::unique_ptr<Image> expanded;
+        VkFormat format;
+        uint32_t mip_levels;
+        MipChain cpu_levels;
+        std::vector<VkDeviceSize> level_offsets;
+        VkImage texture;
+        VkDeviceMemory memory;
+    };
+    struct BufferUpload {
+        const void* data;
+        VkDeviceSize size;
+        VkDeviceSize offset;
+        VkBuffer buffer;
+    };
+
+    VkDeviceSize staging_size = 0;
+    std::vector<ImageUpload> image_uploads{};
+    image_uploads.reserve(assets.images.size());
+    for (const auto& [name, loaded]: assets.images) {
+        const auto format = find_image_format(physical_device, loaded->channels(), srgb);
+        if (!format)
+            throw std::runtime_error("No supported texture format for " + name);
+
+        ImageUpload upload{&name, loaded.get(), nullptr, format->format,
+                           1, {}, {}, VK_NULL_HANDLE, VK_NULL_HANDLE};
+        if (format->channels != loaded->channels()) {
+            upload.expanded = expand_channels(*loaded, format->channels);
+            upload.image = upload.expanded.get();
+        }
+        const Image* image = upload.image;
+
+        if (generate_mipmaps)
+            upload.mip_levels = mip_level_count(static_cast<uint32_t>(image->width()),
+                                                static_cast<uint32_t>(image->height()));
+        if (upload.mip_levels > 1 && !supports_linear_blit(physical_device, upload.format))
+            upload.cpu_levels = generate_mip_chain(*image, upload.mip_levels);
+
+        upload.level_offsets.push_back(staging_size);
+        staging_size = align_offset(staging_size + image->device_size(), staging_alignment);
+        const VkDeviceSize cpu_levels_offset = staging_size;
+        for (const auto offset: upload.cpu_levels.offsets)
+            upload.level_offsets.push_back(cpu_levels_offset + offset);
+        staging_size = align_offset(staging_size + upload.cpu_levels.pixels.size(),
+                                    staging_alignment);
+        image_uploads.push_back(std::move(upload));
+    }
+
+    UploadedAssets uploaded{};
+    std::vector<BufferUpload> buffer_uploads{};
+    buffer_uploads.reserve(assets.geometry.size() * 2);
+    for (const auto& [name, geometry]: assets.geometry) {
+        auto vertices = VertexBuffer_PosTex::create_transfer_destination(physical_device,
+                                                                         logical_device,
+                                                                         geometry.vertices.size(),
+                                                                         geometry.vertices.data());
+        auto indices = IndexBuffer::create_transfer_destination(physical_device,
+                                                                logical_device,
+                                                                geometry.indices.size());
+        const VkDeviceSize vertices_size = vertices->get_memsize();
+        const VkDeviceSize indices_size = indices->get_memsize();
+        buffer_uploads.push_back({geometry.vertices.data(), vertices_size,
+                                  staging_size, vertices->get_buffer()});
+        staging_size = align_offset(staging_size + vertices_size, staging_alignment);
+        buffer_uploads.push_back({geometry.indices.data(), indices_size,
+                                  staging_size, indices->get_buffer()});
+        staging_size = align_offset(staging_size + indices_size, staging_alignment);
+        uploaded.geometry[name] = {std::move(vertices), std::move(indices)};
+    }
+
+    if (staging_size == 0)
+        return uploaded;
+
+    VkBuffer staging_buffer;
+    VkBufferCreateInfo staging_buffer_info;
+    VkDeviceMemory staging_buffer_memory;
+    create_buffer(physical_device,
+                  logical_device,
+                  staging_size,
+                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                  | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                  staging_buffer_info,
+                  staging_buffer,
+                  staging_buffer_memory);
+
+    // One mapping for everything instead of one per asset.
+    const auto fill_staging = [&](void* mapping) {
+        auto dst = static_cast<unsigned char*>(mapping);
+        for (const auto& upload: image_uploads) {
+            memcpy(dst + upload.level_offsets[0],
+                   upload.image->pixels(),
+                   upload.image->device_size());
+            if (!upload.cpu_levels.pixels.empty())
+                memcpy(dst + upload.level_offsets[1],
+                       upload.cpu_levels.pixels.data(),
+                       upload.cpu_levels.pixels.size());
+        }
+        for (const auto& upload: buffer_uploads)
+            memcpy(dst + upload.offset, upload.data, upload.size);
+    };
+    with_memory_mapping(logical_device, staging_size, staging_buffer_memory, fill_staging);
+
+    for (auto& upload: image_uploads)
+        create_image(physical_device,
+                     logical_device,
+                     static_cast<uint32_t>(upload.image->width()),
+                     static_cast<uint32_t>(upload.image->height()),
+                     upload.format,
+                     VK_IMAGE_TILING_OPTIMAL,
+                     VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+                     | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+                     | VK_IMAGE_USAGE_SAMPLED_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                     upload.texture,
+                     upload.memory,
+                     upload.mip_levels);
+
+    const auto record_uploads = [&](VkCommandBuffer& command_buffer) {
+        for (const auto& upload: image_uploads)
+            record_texture_upload(command_buffer,
+                                  staging_buffer,
+                                  upload.level_offsets,
+                                  upload.texture,
+                                  static_cast<uint32_t>(upload.image->width()),
+                                  static_cast<uint32_t>(upload.image->height()),
+                                  upload.mip_levels);
+        for (const auto& upload: buffer_uploads) {
+            VkBufferCopy command{};
+            command.srcOffset = upload.offset;
+            command.dstOffset = 0;
+            command.size = upload.size;
+            vkCmdCopyBuffer(command_buffer, staging_buffer, upload.buffer, 1, &command);
+        }
+    };
+    with_single_use_command_buffer(logical_device,
+                                   command_pool,
+                                   graphics_queue,
+                                   record_uploads);
+
+    vkDestroyBuffer(logical_device, staging_buffer, nullptr);
+    vkFreeMemory(logical_device, staging_buffer_memory, nullptr);
+
+    for (auto& upload: image_uploads) {
+        const auto view = create_image_view(logical_device,
+                                            upload.texture,
+                                            upload.format,
+                                            VK_IMAGE_ASPECT_COLOR_BIT,
+                                            upload.mip_levels,
+                                            1,
+                                            VK_IMAGE_VIEW_TYPE_2D,
+                                            texture_swizzle(upload.format));
+        if (!view)
+            throw std::runtime_error("Failed to create image view for " + *upload.name);
+        const auto sampler = get_texture_sampler(physical_device,
+                                                 logical_device,
+                                                 upload.mip_levels,
+                                                 samplers);
+        uploaded.textures[*upload.name] = std::make_unique<Texture>(upload.texture,
+                                                                    upload.memory,
+                                                                    upload.format,
+                                                                    *view,
+                                                                    sampler,
+                                                                    upload.mip_levels,
+                                                                    1,
+                                                                    samplers == nullptr);
+    }
+
+    return uploaded;
+}
+
+}
@@ -10,7 +10,8 @@ void create_buffer(const VkPhysicalDevice& physical_device,
                    const VkMemoryPropertyFlags properties,
                    VkBufferCreateInfo& out_info,
                    VkBuffer& out_buffer,
-                   VkDeviceMemory& out_memory)
+                   VkDeviceMemory& out_memory,
+                   const std::vector<uint32_t>& queue_families)
 {
     out_info = VkBufferCreateInfo{};
     out_buffer = VkBuffer{};
@@ -20,6 +21,11 @@ void create_buffer(const VkPhysicalDevice& physical_device,
     out_info.size = size;
     out_info.usage = usage;
     out_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (queue_families.size() > 1) {
+        out_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        out_info.queueFamilyIndexCount = static_cast<uint32_t>(queue_families.size());
+        out_info.pQueueFamilyIndices = queue_families.data();
+    }
     auto status = vkCreateBuffer(logical_device, &out_info, nullptr, &out_buffer);
     if (status != VK_SUCCESS)
         throw std::runtime_error("Failed to create buffer!");
@@ -42,9 +48,11 @@ void create_buffer(const VkPhysicalDevice& physical_device,
                               &memalloc_info,
                               nullptr,
                               &out_memory);
-    if (status != VK_SUCCESS)
-        throw std::runtime_error("failed to allocate buffer memory!"
-                                 " now you have a leak because we did not clean up anyhting..");
+    if (status != VK_SUCCESS) {
+        vkDestroyBuffer(logical_device, out_buffer, nullptr);
+        out_buffer = VK_NULL_HANDLE;
+        throw OutOfDeviceMemory("failed to allocate buffer memory!");
+    }
     
     vkBindBufferMemory(logical_device,
                        out_buffer,
@@ -122,6 +130,104 @@ void copy_buffer(const VkDevice& logical_device,
                                    copy_entire_region);
 }
     
+void record_transition_image_layout(VkCommandBuffer command_buffer,
+                                    VkImage image,
+                                    VkImageLayout old_layout,
+                                    VkImageLayout new_layout,
+                                    uint32_t base_mip_level,
+                                    uint32_t level_count,
+                                    uint32_t layer_count)
+{
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = old_layout;
+    barrier.newLayout = new_layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = base_mip_level;
+    barrier.subresourceRange.levelCount = level_count;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = layer_count;
+    
+    VkPipelineStageFlags source_stage;
+    VkPipelineStageFlags destination_stage;
+    if (old_layout == VK_IMAGE_LAYOUT_UNDEFINED 
+     && new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        
+        source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        destination_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    } else if (old_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL 
+            && new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        
+        source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        destination_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    } else if (old_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL 
+            && new_layout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+        // A written mip level becomes the blit source of the next level.
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        
+        source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        destination_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    } else if (old_layout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL 
+            && new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        
+        source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        destination_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    } else {
+        throw std::invalid_argument("unsupported layout transition!");
+    }
+
+    vkCmdPipelineBarrier(command_buffer,
+                         source_stage,
+                         destination_stage,
+                         0,
+                         0, nullptr,
+                         0, nullptr,
+                         1, &barrier);
+}
+
+void record_copy_buffer_to_image(VkCommandBuffer command_buffer,
+                                 VkBuffer buffer,
+                                 VkDeviceSize offset,
+                                 VkImage image,
+                                 uint32_t width,
+                                 uint32_t height,
+                                 uint32_t mip_level,
+                                 uint32_t layer_count)
+{
+    VkBufferImageCopy region{};
+    region.bufferOffset = offset;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = mip_level;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = layer_count;
+    
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {
+        width,
+        height,
+        1
+    };
+    vkCmdCopyBufferToImage(command_buffer,
+                           buffer,
+                           image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           1,
+                           &region);
+}
+    
 void transition_image_layout(const VkDevice& logical_device,
                              const VkCommandPool& command_pool,
                              const VkQueue& graphics_queue,
@@ -139,46 +245,7 @@ UNASSIGNED-CoreValidation-DrawState-InvalidImageLayout(ERROR / SPEC): msgNum: 13
      */
 
     const auto transition = [&] (VkCommandBuffer& command_buffer) {
-        VkImageMemoryBarrier barrier{};
-        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.oldLayout = oldLayout;
-        barrier.newLayout = newLayout;
-        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.image = image;
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        barrier.subresourceRange.baseMipLevel = 0;
-        barrier.subresourceRange.levelCount = 1;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount = 1;
-        
-        VkPipelineStageFlags source_stage;
-        VkPipelineStageFlags destination_stage;
-        if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED 
-         && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            
-            source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destination_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL 
-                && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-            
-            source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            destination_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-        } else {
-            throw std::invalid_argument("unsupported layout transition!");
-        }
-
-        vkCmdPipelineBarrier(command_buffer,
-                             source_stage,
-                             destination_stage,
-                             0,
-                             0, nullptr,
-                             0, nullptr,
-                             1, &barrier);
+        record_transition_image_layout(command_buffer, image, oldLayout, newLayout);
     };
 
     with_single_use_command_buffer(logical_device,
@@ -196,28 +263,7 @@ void copy_buffer_to_image(const VkDevice& logical_device,
                           uint32_t height) 
 {
     const auto copy = [&] (VkCommandBuffer& command_buffer) {
-        VkBufferImageCopy region{};
-        region.bufferOffset = 0;
-        region.bufferRowLength = 0;
-        region.bufferImageHeight = 0;
-        
-        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel = 0;
-        region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount = 1;
-        
-        region.imageOffset = {0, 0, 0};
-        region.imageExtent = {
-            width,
-            height,
-            1
-        };
-        vkCmdCopyBufferToImage(command_buffer,
-                               buffer,
-                               image,
-                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                               1,
-                               &region);
+        record_copy_buffer_to_image(command_buffer, buffer, 0, image, width, height);
     };
 
     with_single_use_command_buffer(logical_device,
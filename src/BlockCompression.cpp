@@ -0,0 +1,284 @@
+#include "../arc/BlockCompression.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace ArcGraphics {
+
+// The encoders fit endpoints to the bounding box of the block, which is the
+// approach of stb_dxt and most real time encoders. It is far from the quality
+// of an exhaustive search, but fast enough to bake large asset sets.
+
+struct BlockBounds {
+    unsigned char min[4];
+    unsigned char max[4];
+};
+
+/**
+ * @brief Get the per channel minimum and maximum of a 4x4 RGBA8 block.
+ */
+[[nodiscard]]
+static BlockBounds find_block_bounds(const unsigned char* rgba)
+{
+    BlockBounds bounds;
+#if defined(__SSE2__)
+    // Each row of the block is exactly one register.
+    const auto row = [&](const int i) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + i * 16));
+    };
+    __m128i lo = _mm_min_epu8(_mm_min_epu8(row(0), row(1)), _mm_min_epu8(row(2), row(3)));
+    __m128i hi = _mm_max_epu8(_mm_max_epu8(row(0), row(1)), _mm_max_epu8(row(2), row(3)));
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 8));
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 4));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 8));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 4));
+    const int packed_min = _mm_cvtsi128_si32(lo);
+    const int packed_max = _mm_cvtsi128_si32(hi);
+    memcpy(bounds.min, &packed_min, 4);
+    memcpy(bounds.max, &packed_max, 4);
+#else
+    for (int c = 0; c < 4; c++) {
+        bounds.min[c] = 255;
+        bounds.max[c] = 0;
+    }
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) {
+            bounds.min[c] = std::min(bounds.min[c], rgba[i * 4 + c]);
+            bounds.max[c] = std::max(bounds.max[c], rgba[i * 4 + c]);
+        }
+    }
+#endif
+    return bounds;
+}
+
+[[nodiscard]]
+static uint16_t pack_565(const int r, const int g, const int b)
+{
+    return static_cast<uint16_t>(((r * 31 + 127) / 255) << 11
+                               | ((g * 63 + 127) / 255) << 5
+                               | ((b * 31 + 127) / 255));
+}
+
+static void unpack_565(const uint16_t color, int* rgb)
+{
+    const int r = (color >> 11) & 31;
+    const int g = (color >> 5) & 63;
+    const int b = color & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+static void write_u16(unsigned char* dst, const uint16_t value)
+{
+    dst[0] = static_cast<unsigned char>(value & 0xFF);
+    dst[1] = static_cast<unsigned char>(value >> 8);
+}
+
+/**
+ * @brief Encode the 8 byte color part shared by BC1 and BC3, always in four color mode.
+ */
+static void encode_color_block(const unsigned char* rgba,
+                               const BlockBounds& bounds,
+                               unsigned char* dst)
+{
+    // Insetting the box by 1/16 of its range moves the endpoints closer to the
+    // bulk of the colors, which lowers the average error.
+    int high[3];
+    int low[3];
+    for (int c = 0; c < 3; c++) {
+        const int inset = (bounds.max[c] - bounds.min[c]) / 16;
+        high[c] = bounds.max[c] - inset;
+        low[c] = bounds.min[c] + inset;
+    }
+
+    uint16_t color0 = pack_565(high[0], high[1], high[2]);
+    uint16_t color1 = pack_565(low[0], low[1], low[2]);
+    if (color0 < color1)
+        std::swap(color0, color1);
+    write_u16(dst, color0);
+    write_u16(dst + 2, color1);
+
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        int palette[4][3];
+        unpack_565(color0, palette[0]);
+        unpack_565(color1, palette[1]);
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++) {
+            const unsigned char* pixel = rgba + i * 4;
+            int best_index = 0;
+            int best_error = INT32_MAX;
+            for (int p = 0; p < 4; p++) {
+                const int dr = pixel[0] - palette[p][0];
+                const int dg = pixel[1] - palette[p][1];
+                const int db = pixel[2] - palette[p][2];
+                const int error = dr * dr + dg * dg + db * db;
+                if (error < best_error) {
+                    best_error = error;
+                    best_index = p;
+                }
+            }
+            indices |= static_cast<uint32_t>(best_index) << (i * 2);
+        }
+    }
+    for (int i = 0; i < 4; i++)
+        dst[4 + i] = static_cast<unsigned char>(indices >> (i * 8));
+}
+
+/**
+ * @brief Encode one channel of the block as an 8 byte BC4 block, used by BC3 alpha and BC5.
+ */
+static void encode_channel_block(const unsigned char* rgba,
+                                 const int channel,
+                                 const unsigned char high,
+                                 const unsigned char low,
+                                 unsigned char* dst)
+{
+    dst[0] = high;
+    dst[1] = low;
+
+    uint64_t indices = 0;
+    if (high != low) {
+        // With the first endpoint larger, the palette interpolates six values between them.
+        int palette[8];
+        palette[0] = high;
+        palette[1] = low;
+        for (int i = 1; i < 7; i++)
+            palette[i + 1] = ((7 - i) * high + i * low) / 7;
+        for (int i = 0; i < 16; i++) {
+            const int value = rgba[i * 4 + channel];
+            int best_index = 0;
+            int best_error = INT32_MAX;
+            for (int p = 0; p < 8; p++) {
+                const int error = std::abs(value - palette[p]);
+                if (error < best_error) {
+                    best_error = error;
+                    best_index = p;
+                }
+            }
+            indices |= static_cast<uint64_t>(best_index) << (i * 3);
+        }
+    }
+    for (int i = 0; i < 6; i++)
+        dst[2 + i] = static_cast<unsigned char>(indices >> (i * 8));
+}
+
+void encode_bc1_block(const unsigned char* rgba, unsigned char* dst)
+{
+    encode_color_block(rgba, find_block_bounds(rgba), dst);
+}
+
+void encode_bc3_block(const unsigned char* rgba, unsigned char* dst)
+{
+    const auto bounds = find_block_bounds(rgba);
+    encode_channel_block(rgba, 3, bounds.max[3], bounds.min[3], dst);
+    encode_color_block(rgba, bounds, dst + 8);
+}
+
+void encode_bc5_block(const unsigned char* rgba, unsigned char* dst)
+{
+    const auto bounds = find_block_bounds(rgba);
+    encode_channel_block(rgba, 0, bounds.max[0], bounds.min[0], dst);
+    encode_channel_block(rgba, 1, bounds.max[1], bounds.min[1], dst + 8);
+}
+
+std::unique_ptr<CompressedImage> compress_image(const Image& image,
+                                                const VkFormat format,
+                                                const bool generate_mipmaps,
+                                                ThreadPool* pool)
+{
+    void (*encode_block)(const unsigned char*, unsigned char*);
+    switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        encode_block = encode_bc1_block;
+        break;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        encode_block = encode_bc3_block;
+        break;
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+        encode_block = encode_bc5_block;
+        break;
+    default:
+        throw std::invalid_argument("Unsupported block compression format!");
+    }
+
+    // The encoders work on RGBA blocks, so one and two channel images are expanded.
+    std::unique_ptr<Image> expanded{};
+    if (image.channels() != 4)
+        expanded = expand_channels(image, 4);
+    const Image& source = expanded ? *expanded : image;
+
+    const auto width = static_cast<uint32_t>(source.width());
+    const auto height = static_cast<uint32_t>(source.height());
+    const uint32_t mip_levels = generate_mipmaps ? mip_level_count(width, height) : 1;
+    const auto mip_chain = generate_mip_chain(source, mip_levels);
+
+    std::vector<CompressedLevel> levels{};
+    VkDeviceSize data_size = 0;
+    for (uint32_t level = 0; level < mip_levels; level++) {
+        const uint32_t level_width = std::max(width >> level, 1u);
+        const uint32_t level_height = std::max(height >> level, 1u);
+        const auto size = block_compressed_size(format, level_width, level_height);
+        levels.push_back({data_size, size, level_width, level_height});
+        data_size = (data_size + size + 15) / 16 * 16;
+    }
+    std::vector<unsigned char> data(data_size, 0);
+
+    const uint32_t block_size = block_byte_size(format);
+    for (uint32_t level = 0; level < mip_levels; level++) {
+        const auto& info = levels[level];
+        const unsigned char* pixels = level == 0
+            ? source.pixels()
+            : mip_chain.pixels.data() + mip_chain.offsets[level - 1];
+        const uint32_t blocks_x = (info.width + 3) / 4;
+        const uint32_t blocks_y = (info.height + 3) / 4;
+        unsigned char* level_data = data.data() + info.offset;
+
+        const auto encode_rows = [&](const size_t begin, const size_t end) {
+            unsigned char block[64];
+            for (size_t by = begin; by < end; by++) {
+                for (uint32_t bx = 0; bx < blocks_x; bx++) {
+                    // Blocks over the edge repeat the last row and column.
+                    for (uint32_t y = 0; y < 4; y++) {
+                        const uint32_t src_y = std::min(uint32_t(by) * 4 + y, info.height - 1);
+                        for (uint32_t x = 0; x < 4; x++) {
+                            const uint32_t src_x = std::min(bx * 4 + x, info.width - 1);
+                            memcpy(block + (y * 4 + x) * 4,
+                                   pixels + (size_t(src_y) * info.width + src_x) * 4,
+                                   4);
+                        }
+                    }
+                    encode_block(block, level_data + (by * blocks_x + bx) * block_size);
+                }
+            }
+        };
+
+        if (pool)
+            pool->parallel_for(0, blocks_y, encode_rows);
+        else
+            encode_rows(0, blocks_y);
+    }
+
+    return std::make_unique<CompressedImage>(format,
+                                             width,
+                                             height,
+                                             std::move(levels),
+                                             std::move(data));
+}
+
+}
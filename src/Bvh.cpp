@@ -0,0 +1,545 @@
+#include "../arc/Bvh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <utility>
+
+namespace ArcGraphics {
+
+/** @brief Centroid bins per split in the SAH build. */
+static constexpr size_t sah_bin_count = 16;
+
+/**
+ * @brief Get the distance at which a ray enters a box, or std::nullopt if it
+ * misses it or enters beyond max_distance.
+ */
+[[nodiscard]]
+static std::optional<float> ray_box_entry(const glm::vec3& origin,
+                                          const glm::vec3& inverse_direction,
+                                          const BoundingBox& box,
+                                          const float max_distance)
+{
+    const glm::vec3 t0 = (box.min - origin) * inverse_direction;
+    const glm::vec3 t1 = (box.max - origin) * inverse_direction;
+    const glm::vec3 near = glm::min(t0, t1);
+    const glm::vec3 far = glm::max(t0, t1);
+    const float entry = std::max({near.x, near.y, near.z, 0.0f});
+    const float exit = std::min({far.x, far.y, far.z, max_distance});
+    if (entry > exit)
+        return std::nullopt;
+    return entry;
+}
+
+Bvh::Bvh(const float margin)
+    : m_margin(margin)
+{
+    if (margin < 0.0f)
+        throw std::invalid_argument("Bvh margin can not be negative!");
+}
+
+void Bvh::build(const std::vector<BoundingBox>& boxes)
+{
+    clear();
+    std::vector<BuildItem> items(boxes.size());
+    for (uint32_t i = 0; i < boxes.size(); i++)
+        items[i] = {i, boxes[i], boxes[i].center()};
+    m_objects.resize(boxes.size());
+    build_items(items);
+}
+
+void Bvh::rebuild()
+{
+    std::vector<BuildItem> items{};
+    items.reserve(m_count);
+    for (uint32_t object = 0; object < m_objects.size(); object++) {
+        const auto& entry = m_objects[object];
+        if (entry.leaf != null_node)
+            items.push_back({object, entry.box, entry.box.center()});
+    }
+    m_nodes.clear();
+    m_root = null_node;
+    m_free = null_node;
+    build_items(items);
+}
+
+void Bvh::build_items(std::vector<BuildItem>& items)
+{
+    m_count = items.size();
+    if (items.empty())
+        return;
+    m_nodes.reserve(2 * items.size() - 1);
+
+    // Nodes are allocated in pre-order, so a left child follows its parent and
+    // every child has a larger index than its parent.
+    struct Range {
+        size_t begin;
+        size_t count;
+        uint32_t parent;
+        bool is_left;
+    };
+    std::vector<Range> stack{{0, items.size(), null_node, false}};
+    while (!stack.empty()) {
+        const auto range = stack.back();
+        stack.pop_back();
+
+        const uint32_t node = allocate_node();
+        m_nodes[node].parent = range.parent;
+        if (range.parent == null_node)
+            m_root = node;
+        else if (range.is_left)
+            m_nodes[range.parent].left = node;
+        else
+            m_nodes[range.parent].right = node;
+
+        BuildItem* first = items.data() + range.begin;
+        if (range.count == 1) {
+            m_nodes[node].box = grow(first->box);
+            m_nodes[node].right = first->object;
+            m_objects[first->object] = {node, first->box};
+            continue;
+        }
+
+        BoundingBox centroids{first->centroid, first->centroid};
+        for (size_t i = 1; i < range.count; i++) {
+            centroids.min = glm::min(centroids.min, first[i].centroid);
+            centroids.max = glm::max(centroids.max, first[i].centroid);
+        }
+        const glm::vec3 extent = centroids.extent();
+        const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+
+        size_t split = range.count / 2;
+        if (extent[axis] > 0.0f) {
+            const float scale = static_cast<float>(sah_bin_count) / extent[axis];
+            const auto bin_of = [&](const BuildItem& item) {
+                const auto bin = static_cast<size_t>((item.centroid[axis] - centroids.min[axis]) * scale);
+                return std::min(bin, sah_bin_count - 1);
+            };
+
+            std::array<size_t, sah_bin_count> bin_counts{};
+            std::array<BoundingBox, sah_bin_count> bin_boxes{};
+            for (size_t i = 0; i < range.count; i++) {
+                const size_t bin = bin_of(first[i]);
+                bin_boxes[bin] = bin_counts[bin] ? merge(bin_boxes[bin], first[i].box) : first[i].box;
+                bin_counts[bin]++;
+            }
+
+            // Cost of splitting after bin i is the item count times the area on either side.
+            std::array<float, sah_bin_count - 1> left_costs{};
+            size_t count = 0;
+            BoundingBox box{};
+            for (size_t i = 0; i + 1 < sah_bin_count; i++) {
+                if (bin_counts[i])
+                    box = count ? merge(box, bin_boxes[i]) : bin_boxes[i];
+                count += bin_counts[i];
+                left_costs[i] = count ? static_cast<float>(count) * box.half_area() : 0.0f;
+            }
+            float best_cost = std::numeric_limits<float>::max();
+            size_t best_bin = sah_bin_count;
+            count = 0;
+            for (size_t i = sah_bin_count - 1; i > 0; i--) {
+                if (bin_counts[i])
+                    box = count ? merge(box, bin_boxes[i]) : bin_boxes[i];
+                count += bin_counts[i];
+                if (count == 0 || count == range.count)
+                    continue;
+                const float cost = left_costs[i - 1] + static_cast<float>(count) * box.half_area();
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_bin = i;
+                }
+            }
+            if (best_bin != sah_bin_count) {
+                const auto middle = std::partition(first, first + range.count, [&](const BuildItem& item) {
+                    return bin_of(item) < best_bin;
+                });
+                split = static_cast<size_t>(middle - first);
+            }
+        }
+        // Identical centroids or a failed SAH split fall back to the median.
+        if (split == 0 || split == range.count || extent[axis] <= 0.0f) {
+            split = range.count / 2;
+            std::nth_element(first, first + split, first + range.count,
+                             [axis](const BuildItem& a, const BuildItem& b) {
+                                 return a.centroid[axis] < b.centroid[axis];
+                             });
+        }
+
+        stack.push_back({range.begin + split, range.count - split, node, false});
+        stack.push_back({range.begin, split, node, true});
+    }
+
+    for (uint32_t node = static_cast<uint32_t>(m_nodes.size()); node-- > 0;)
+        if (!is_leaf(node))
+            refit(node);
+}
+
+void Bvh::insert(const uint32_t object, const BoundingBox& box)
+{
+    if (contains(object))
+        throw std::invalid_argument("Object is already in the Bvh!");
+    if (object >= m_objects.size())
+        m_objects.resize(static_cast<size_t>(object) + 1);
+
+    const uint32_t leaf = allocate_node();
+    m_nodes[leaf].box = grow(box);
+    m_nodes[leaf].right = object;
+    m_objects[object] = {leaf, box};
+    m_count++;
+    insert_leaf(leaf);
+}
+
+void Bvh::move(const uint32_t object, const BoundingBox& box)
+{
+    if (!contains(object))
+        throw std::out_of_range("Object is not in the Bvh!");
+    auto& entry = m_objects[object];
+    entry.box = box;
+    const uint32_t leaf = entry.leaf;
+    if (m_nodes[leaf].box.contains(box))
+        return;
+
+    const BoundingBox grown = grow(box);
+    // A jump leaves the old place of the leaf in the tree meaningless, so it
+    // is inserted again, while a short move refits the path to the root.
+    if (!m_nodes[leaf].box.overlaps(grown)) {
+        remove_leaf(leaf);
+        m_nodes[leaf].box = grown;
+        insert_leaf(leaf);
+        return;
+    }
+    m_nodes[leaf].box = grown;
+    refit_from(m_nodes[leaf].parent);
+}
+
+void Bvh::remove(const uint32_t object)
+{
+    if (!contains(object))
+        throw std::out_of_range("Object is not in the Bvh!");
+    const uint32_t leaf = m_objects[object].leaf;
+    remove_leaf(leaf);
+    free_node(leaf);
+    m_objects[object].leaf = null_node;
+    m_count--;
+}
+
+void Bvh::clear()
+{
+    m_nodes.clear();
+    m_objects.clear();
+    m_root = null_node;
+    m_free = null_node;
+    m_count = 0;
+}
+
+bool Bvh::contains(const uint32_t object) const
+{
+    return object < m_objects.size() && m_objects[object].leaf != null_node;
+}
+
+size_t Bvh::size() const
+{
+    return m_count;
+}
+
+uint32_t Bvh::height() const
+{
+    return m_root == null_node ? 0 : m_nodes[m_root].height;
+}
+
+void Bvh::query_frustum(const Frustum& frustum, std::vector<uint32_t>& objects) const
+{
+    if (m_root == null_node)
+        return;
+
+    // Planes a node is fully inside of are not tested again for its children.
+    std::vector<std::pair<uint32_t, uint32_t>> stack{{m_root, all_frustum_planes}};
+    std::vector<uint32_t> inside{};
+    while (!stack.empty()) {
+        auto [node, mask] = stack.back();
+        stack.pop_back();
+        const auto& current = m_nodes[node];
+        if (is_leaf(node)) {
+            const uint32_t object = current.right;
+            if (classify_box_in_frustum(frustum, m_objects[object].box, &mask) != FrustumContainment::outside)
+                objects.push_back(object);
+            continue;
+        }
+
+        const auto containment = classify_box_in_frustum(frustum, current.box, &mask);
+        if (containment == FrustumContainment::outside)
+            continue;
+        if (containment == FrustumContainment::intersecting) {
+            stack.push_back({current.right, mask});
+            stack.push_back({current.left, mask});
+            continue;
+        }
+
+        inside.push_back(node);
+        while (!inside.empty()) {
+            const uint32_t subtree = inside.back();
+            inside.pop_back();
+            if (is_leaf(subtree)) {
+                objects.push_back(m_nodes[subtree].right);
+                continue;
+            }
+            inside.push_back(m_nodes[subtree].right);
+            inside.push_back(m_nodes[subtree].left);
+        }
+    }
+}
+
+void Bvh::query_overlap(const BoundingBox& box, std::vector<uint32_t>& objects) const
+{
+    if (m_root == null_node)
+        return;
+
+    std::vector<uint32_t> stack{m_root};
+    while (!stack.empty()) {
+        const uint32_t node = stack.back();
+        stack.pop_back();
+        const auto& current = m_nodes[node];
+        if (is_leaf(node)) {
+            if (m_objects[current.right].box.overlaps(box))
+                objects.push_back(current.right);
+            continue;
+        }
+        if (!current.box.overlaps(box))
+            continue;
+        stack.push_back(current.right);
+        stack.push_back(current.left);
+    }
+}
+
+std::optional<BvhRayHit> Bvh::ray_cast(
+    const glm::vec3& origin,
+    const glm::vec3& direction,
+    const float max_distance,
+    const std::function<std::optional<float>(uint32_t)>& hit_test) const
+{
+    if (m_root == null_node)
+        return std::nullopt;
+
+    const glm::vec3 inverse_direction = 1.0f / direction;
+    std::optional<BvhRayHit> closest{};
+    float limit = max_distance;
+
+    const auto root_entry = ray_box_entry(origin, inverse_direction, m_nodes[m_root].box, limit);
+    if (!root_entry)
+        return std::nullopt;
+
+    // Children are visited nearest first, so far subtrees are mostly skipped
+    // once a hit has shortened the ray.
+    std::vector<std::pair<uint32_t, float>> stack{{m_root, *root_entry}};
+    while (!stack.empty()) {
+        const auto [node, entry] = stack.back();
+        stack.pop_back();
+        if (entry > limit)
+            continue;
+        const auto& current = m_nodes[node];
+        if (is_leaf(node)) {
+            const uint32_t object = current.right;
+            const auto box_entry = ray_box_entry(origin, inverse_direction, m_objects[object].box, limit);
+            if (!box_entry)
+                continue;
+            const auto distance = hit_test ? hit_test(object) : box_entry;
+            if (distance && *distance >= 0.0f && *distance <= limit) {
+                limit = *distance;
+                closest = BvhRayHit{object, *distance};
+            }
+            continue;
+        }
+
+        auto left = ray_box_entry(origin, inverse_direction, m_nodes[current.left].box, limit);
+        auto right = ray_box_entry(origin, inverse_direction, m_nodes[current.right].box, limit);
+        uint32_t near_child = current.left;
+        uint32_t far_child = current.right;
+        if (left && right && *right < *left) {
+            std::swap(left, right);
+            std::swap(near_child, far_child);
+        }
+        if (right)
+            stack.push_back({far_child, *right});
+        if (left)
+            stack.push_back({near_child, *left});
+    }
+    return closest;
+}
+
+bool Bvh::is_leaf(const uint32_t node) const
+{
+    return m_nodes[node].left == null_node;
+}
+
+BoundingBox Bvh::grow(const BoundingBox& box) const
+{
+    return {box.min - glm::vec3(m_margin), box.max + glm::vec3(m_margin)};
+}
+
+uint32_t Bvh::allocate_node()
+{
+    if (m_free == null_node) {
+        m_nodes.emplace_back();
+        return static_cast<uint32_t>(m_nodes.size() - 1);
+    }
+    const uint32_t node = m_free;
+    m_free = m_nodes[node].parent;
+    m_nodes[node] = Node{};
+    return node;
+}
+
+void Bvh::free_node(const uint32_t node)
+{
+    m_nodes[node] = Node{};
+    m_nodes[node].parent = m_free;
+    m_free = node;
+}
+
+void Bvh::insert_leaf(const uint32_t leaf)
+{
+    if (m_root == null_node) {
+        m_root = leaf;
+        m_nodes[leaf].parent = null_node;
+        return;
+    }
+
+    // Walk down towards the sibling whose box grows the least, counting the
+    // growth of every ancestor on the way, as in Box2D's b2DynamicTree.
+    const BoundingBox box = m_nodes[leaf].box;
+    uint32_t sibling = m_root;
+    while (!is_leaf(sibling)) {
+        const auto& current = m_nodes[sibling];
+        const float area = current.box.half_area();
+        const float combined_area = merge(current.box, box).half_area();
+        const float cost = 2.0f * combined_area;
+        const float inheritance_cost = 2.0f * (combined_area - area);
+
+        const auto child_cost = [&](const uint32_t child) {
+            const float grown_area = merge(m_nodes[child].box, box).half_area();
+            if (is_leaf(child))
+                return grown_area + inheritance_cost;
+            return grown_area - m_nodes[child].box.half_area() + inheritance_cost;
+        };
+        const float left_cost = child_cost(current.left);
+        const float right_cost = child_cost(current.right);
+        if (cost < left_cost && cost < right_cost)
+            break;
+        sibling = left_cost < right_cost ? current.left : current.right;
+    }
+
+    const uint32_t old_parent = m_nodes[sibling].parent;
+    const uint32_t new_parent = allocate_node();
+    m_nodes[new_parent].parent = old_parent;
+    m_nodes[new_parent].left = sibling;
+    m_nodes[new_parent].right = leaf;
+    m_nodes[sibling].parent = new_parent;
+    m_nodes[leaf].parent = new_parent;
+    if (old_parent == null_node)
+        m_root = new_parent;
+    else if (m_nodes[old_parent].left == sibling)
+        m_nodes[old_parent].left = new_parent;
+    else
+        m_nodes[old_parent].right = new_parent;
+
+    refit_from(new_parent);
+}
+
+void Bvh::remove_leaf(const uint32_t leaf)
+{
+    if (leaf == m_root) {
+        m_root = null_node;
+        return;
+    }
+
+    const uint32_t parent = m_nodes[leaf].parent;
+    const uint32_t grandparent = m_nodes[parent].parent;
+    const uint32_t sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+    m_nodes[sibling].parent = grandparent;
+    m_nodes[leaf].parent = null_node;
+    free_node(parent);
+
+    if (grandparent == null_node) {
+        m_root = sibling;
+        return;
+    }
+    if (m_nodes[grandparent].left == parent)
+        m_nodes[grandparent].left = sibling;
+    else
+        m_nodes[grandparent].right = sibling;
+    refit_from(grandparent);
+}
+
+void Bvh::refit_from(uint32_t node)
+{
+    while (node != null_node) {
+        rotate(node);
+        refit(node);
+        node = m_nodes[node].parent;
+    }
+}
+
+void Bvh::rotate(const uint32_t node)
+{
+    // Try swapping a child with a grandchild under the other child, keeping the
+    // swap that shrinks the box of that other child the most. The box of node
+    // itself is the same either way. See Kensler, "Tree Rotations for
+    // Improving Bounding Volume Hierarchies", 2008.
+    const uint32_t left = m_nodes[node].left;
+    const uint32_t right = m_nodes[node].right;
+    if (is_leaf(node) || (is_leaf(left) && is_leaf(right)))
+        return;
+
+    float best_gain = 0.0f;
+    std::array<uint32_t, 3> best{null_node, null_node, null_node};
+    const auto consider = [&](const uint32_t child, const uint32_t other) {
+        if (is_leaf(other))
+            return;
+        const auto& parent = m_nodes[other];
+        const float area = parent.box.half_area();
+        const auto& child_box = m_nodes[child].box;
+        const float gain_left = area - merge(child_box, m_nodes[parent.right].box).half_area();
+        const float gain_right = area - merge(child_box, m_nodes[parent.left].box).half_area();
+        if (gain_left > best_gain) {
+            best_gain = gain_left;
+            best = {child, other, parent.left};
+        }
+        if (gain_right > best_gain) {
+            best_gain = gain_right;
+            best = {child, other, parent.right};
+        }
+    };
+    consider(left, right);
+    consider(right, left);
+    if (best[0] != null_node)
+        swap_grandchild(node, best[0], best[1], best[2]);
+}
+
+void Bvh::swap_grandchild(const uint32_t node,
+                          const uint32_t child,
+                          const uint32_t other,
+                          const uint32_t grandchild)
+{
+    if (m_nodes[node].left == child)
+        m_nodes[node].left = grandchild;
+    else
+        m_nodes[node].right = grandchild;
+    m_nodes[grandchild].parent = node;
+
+    if (m_nodes[other].left == grandchild)
+        m_nodes[other].left = child;
+    else
+        m_nodes[other].right = child;
+    m_nodes[child].parent = other;
+    refit(other);
+}
+
+void Bvh::refit(const uint32_t node)
+{
+    auto& current = m_nodes[node];
+    const auto& left = m_nodes[current.left];
+    const auto& right = m_nodes[current.right];
+    current.box = merge(left.box, right.box);
+    current.height = 1 + std::max(left.height, right.height);
+}
+
+}
@@ -0,0 +1,290 @@
+#include "../arc/CompressedImage.hpp"
+#include "../arc/MappedFile.hpp"
+#include "../arc/Texture.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace ArcGraphics {
+
+// https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+// All fields are little endian, which is assumed to match the host.
+static constexpr std::array<unsigned char, 12> ktx2_identifier{
+    0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+static constexpr size_t ktx2_header_size = 80;
+static constexpr size_t ktx2_level_index_entry_size = 24;
+
+// Levels are kept at offsets that satisfy the bufferOffset alignment of every
+// supported block size, so they can be copied straight out of data.
+static constexpr VkDeviceSize level_alignment = 16;
+
+uint32_t block_byte_size(const VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        return 8;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+VkDeviceSize block_compressed_size(const VkFormat format,
+                                   const uint32_t width,
+                                   const uint32_t height)
+{
+    const VkDeviceSize blocks_x = (width + 3) / 4;
+    const VkDeviceSize blocks_y = (height + 3) / 4;
+    return blocks_x * blocks_y * block_byte_size(format);
+}
+
+[[nodiscard]]
+static VkDeviceSize align_up(const VkDeviceSize value, const VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+template <typename T>
+[[nodiscard]]
+static T read_field(const unsigned char* data, const size_t offset)
+{
+    T value;
+    memcpy(&value, data + offset, sizeof(T));
+    return value;
+}
+
+template <typename T>
+static void write_field(std::vector<unsigned char>& out, const size_t offset, const T value)
+{
+    memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+std::optional<Ktx2Layout> read_ktx2_layout(const unsigned char* data, const size_t size)
+{
+    if (size < ktx2_header_size
+     || !std::equal(ktx2_identifier.begin(), ktx2_identifier.end(), data))
+        return std::nullopt;
+
+    const auto format = static_cast<VkFormat>(read_field<uint32_t>(data, 12));
+    const auto width = read_field<uint32_t>(data, 20);
+    const auto height = read_field<uint32_t>(data, 24);
+    const auto depth = read_field<uint32_t>(data, 28);
+    const auto layer_count = read_field<uint32_t>(data, 32);
+    const auto face_count = read_field<uint32_t>(data, 36);
+    // A level count of 0 asks for mips to be generated, only level 0 is stored then.
+    const auto level_count = std::max(read_field<uint32_t>(data, 40), 1u);
+    const auto supercompression = read_field<uint32_t>(data, 44);
+
+    if (block_byte_size(format) == 0 || width == 0 || height == 0 || depth != 0
+     || layer_count > 1 || face_count != 1 || supercompression != 0)
+        return std::nullopt;
+    // Also keeps the shifts by level below 32.
+    if (level_count > mip_level_count(width, height))
+        return std::nullopt;
+    if (size < ktx2_header_size + level_count * ktx2_level_index_entry_size)
+        return std::nullopt;
+
+    Ktx2Layout layout{format, width, height, {}, {}, 0};
+    layout.levels.reserve(level_count);
+    layout.source_offsets.reserve(level_count);
+    for (uint32_t level = 0; level < level_count; level++) {
+        const size_t entry = ktx2_header_size + level * ktx2_level_index_entry_size;
+        const auto byte_offset = read_field<uint64_t>(data, entry);
+        const auto byte_length = read_field<uint64_t>(data, entry + 8);
+        const uint32_t level_width = std::max(width >> level, 1u);
+        const uint32_t level_height = std::max(height >> level, 1u);
+        if (byte_length != block_compressed_size(format, level_width, level_height)
+         || byte_offset > size || byte_length > size - byte_offset)
+            return std::nullopt;
+        // The file stores the smallest level first, the packed levels keep level 0 first.
+        layout.levels.push_back({layout.data_size, byte_length, level_width, level_height});
+        layout.source_offsets.push_back(byte_offset);
+        layout.data_size = align_up(layout.data_size + byte_length, level_alignment);
+    }
+    return layout;
+}
+
+std::unique_ptr<CompressedImage> CompressedImage::load_from_path(const std::string& path)
+{
+    const auto file = MappedFile::open(path);
+    if (!file)
+        return nullptr;
+    auto image = parse_ktx2(file->data(), file->size());
+    if (!image)
+        std::cout << "Unsupported KTX2 file: " << path << std::endl;
+    return image;
+}
+
+std::unique_ptr<CompressedImage> CompressedImage::parse_ktx2(const unsigned char* data,
+                                                             const size_t size)
+{
+    auto layout = read_ktx2_layout(data, size);
+    if (!layout)
+        return nullptr;
+
+    std::vector<unsigned char> level_data(layout->data_size);
+    for (size_t level = 0; level < layout->levels.size(); level++)
+        memcpy(level_data.data() + layout->levels[level].offset,
+               data + layout->source_offsets[level],
+               static_cast<size_t>(layout->levels[level].size));
+
+    return std::make_unique<CompressedImage>(layout->format,
+                                             layout->width,
+                                             layout->height,
+                                             std::move(layout->levels),
+                                             std::move(level_data));
+}
+
+/**
+ * @brief Build the basic data format descriptor of a block compressed format.
+ */
+[[nodiscard]]
+static std::vector<unsigned char> create_data_format_descriptor(const VkFormat format)
+{
+    // khr_df_model_e and khr_df_model_channels_e from the Khronos data format spec.
+    struct Sample { uint16_t bit_offset; uint8_t channel; uint8_t bit_length; };
+    uint8_t color_model;
+    uint8_t transfer = 1; // KHR_DF_TRANSFER_LINEAR
+    std::vector<Sample> samples{};
+    switch (format) {
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        transfer = 2; // KHR_DF_TRANSFER_SRGB
+        break;
+    default:
+        break;
+    }
+    switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        color_model = 128;
+        samples = {{0, 0, 63}};
+        break;
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        color_model = 128;
+        samples = {{0, 15, 63}};
+        break;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        color_model = 130;
+        samples = {{0, 15, 63}, {64, 0, 63}};
+        break;
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+        color_model = 132;
+        samples = {{0, 0, 63}, {64, 1, 63}};
+        break;
+    default:
+        color_model = 133;
+        samples = {{0, 0, 127}};
+        break;
+    }
+
+    const uint32_t block_size = 24 + 16 * static_cast<uint32_t>(samples.size());
+    std::vector<unsigned char> dfd(4 + block_size, 0);
+    write_field<uint32_t>(dfd, 0, static_cast<uint32_t>(dfd.size()));
+    write_field<uint32_t>(dfd, 4, 0); // Khronos vendor, basic descriptor type
+    write_field<uint16_t>(dfd, 8, 2); // version 1.3
+    write_field<uint16_t>(dfd, 10, static_cast<uint16_t>(block_size));
+    dfd[12] = color_model;
+    dfd[13] = 1; // KHR_DF_PRIMARIES_BT709
+    dfd[14] = transfer;
+    dfd[15] = 0;
+    dfd[16] = 3; // texel block dimensions are stored minus one
+    dfd[17] = 3;
+    dfd[20] = static_cast<unsigned char>(block_byte_size(format));
+    for (size_t i = 0; i < samples.size(); i++) {
+        const size_t sample = 28 + i * 16;
+        write_field<uint16_t>(dfd, sample, samples[i].bit_offset);
+        dfd[sample + 2] = samples[i].bit_length;
+        dfd[sample + 3] = samples[i].channel;
+        write_field<uint32_t>(dfd, sample + 8, 0);
+        write_field<uint32_t>(dfd, sample + 12, UINT32_MAX);
+    }
+    return dfd;
+}
+
+bool CompressedImage::write_ktx2(const std::string& path) const
+{
+    const auto dfd = create_data_format_descriptor(m_format);
+    const size_t level_count = m_levels.size();
+    const size_t dfd_offset = ktx2_header_size + level_count * ktx2_level_index_entry_size;
+
+    // Level data follows the descriptor, smallest level first.
+    VkDeviceSize file_size = dfd_offset + dfd.size();
+    std::vector<VkDeviceSize> file_offsets(level_count);
+    for (size_t level = level_count; level-- > 0;) {
+        file_offsets[level] = align_up(file_size, level_alignment);
+        file_size = file_offsets[level] + m_levels[level].size;
+    }
+
+    std::vector<unsigned char> out(static_cast<size_t>(file_size), 0);
+    std::copy(ktx2_identifier.begin(), ktx2_identifier.end(), out.begin());
+    write_field<uint32_t>(out, 12, static_cast<uint32_t>(m_format));
+    write_field<uint32_t>(out, 16, 1); // typeSize
+    write_field<uint32_t>(out, 20, m_width);
+    write_field<uint32_t>(out, 24, m_height);
+    write_field<uint32_t>(out, 28, 0); // pixelDepth
+    write_field<uint32_t>(out, 32, 0); // layerCount
+    write_field<uint32_t>(out, 36, 1); // faceCount
+    write_field<uint32_t>(out, 40, static_cast<uint32_t>(level_count));
+    write_field<uint32_t>(out, 44, 0); // supercompressionScheme
+    write_field<uint32_t>(out, 48, static_cast<uint32_t>(dfd_offset));
+    write_field<uint32_t>(out, 52, static_cast<uint32_t>(dfd.size()));
+    // Key/value and supercompression global data are left empty.
+
+    for (size_t level = 0; level < level_count; level++) {
+        const size_t entry = ktx2_header_size + level * ktx2_level_index_entry_size;
+        write_field<uint64_t>(out, entry, file_offsets[level]);
+        write_field<uint64_t>(out, entry + 8, m_levels[level].size);
+        write_field<uint64_t>(out, entry + 16, m_levels[level].size);
+        memcpy(out.data() + file_offsets[level],
+               m_data.data() + m_levels[level].offset,
+               static_cast<size_t>(m_levels[level].size));
+    }
+    std::copy(dfd.begin(), dfd.end(), out.begin() + dfd_offset);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+    return file.good();
+}
+
+CompressedImage::CompressedImage(const VkFormat format,
+                                 const uint32_t width,
+                                 const uint32_t height,
+                                 std::vector<CompressedLevel> levels,
+                                 std::vector<unsigned char> data)
+    : m_format(format)
+    , m_width(width)
+    , m_height(height)
+    , m_levels(std::move(levels))
+    , m_data(std::move(data))
+{
+}
+
+VkFormat CompressedImage::format() const { return m_format; }
+uint32_t CompressedImage::width() const { return m_width; }
+uint32_t CompressedImage::height() const { return m_height; }
+const std::vector<CompressedLevel>& CompressedImage::levels() const { return m_levels; }
+const unsigned char* CompressedImage::data() const { return m_data.data(); }
+VkDeviceSize CompressedImage::device_size() const { return m_data.size(); }
+
+}
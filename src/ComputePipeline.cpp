@@ -0,0 +1,338 @@
+#include "../arc/ComputePipeline.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+namespace ArcGraphics {
+
+ComputePipeline::ComputePipeline(Device* device,
+                                 const VkPipelineLayout pipeline_layout,
+                                 const VkPipeline pipeline,
+                                 const VkQueue compute_queue,
+                                 const uint32_t compute_family,
+                                 const uint32_t graphics_family,
+                                 const std::vector<ComputeFrameLocks> framelocks,
+                                 const std::vector<VkCommandBuffer> commandbuffers,
+                                 const VkCommandPool command_pool,
+                                 const uint32_t push_constant_size)
+    : m_device(device)
+    , m_pipeline_layout(pipeline_layout)
+    , m_pipeline(pipeline)
+    , m_compute_queue(compute_queue)
+    , m_compute_family(compute_family)
+    , m_graphics_family(graphics_family)
+    , m_framelocks(framelocks)
+    , m_commandbuffers(commandbuffers)
+    , m_command_pool(command_pool)
+    , m_push_constant_size(push_constant_size)
+{
+    if (!m_device)
+        throw std::runtime_error("ComputePipeline() device was nullptr!");
+}
+
+uint32_t ComputePipeline::max_frames_in_flight() const
+{
+    return static_cast<uint32_t>(m_framelocks.size());
+}
+
+uint32_t ComputePipeline::current_flight_frame() const
+{
+    return m_current_flight_frame;
+}
+
+const VkPipelineLayout& ComputePipeline::layout() const
+{
+    return m_pipeline_layout;
+}
+
+const VkCommandPool& ComputePipeline::command_pool() const
+{
+    return m_command_pool;
+}
+
+const VkQueue& ComputePipeline::queue() const
+{
+    return m_compute_queue;
+}
+
+uint32_t ComputePipeline::queue_family() const
+{
+    return m_compute_family;
+}
+
+bool ComputePipeline::has_dedicated_queue() const
+{
+    return m_compute_family != m_graphics_family;
+}
+
+std::vector<uint32_t> ComputePipeline::sharing_queue_families() const
+{
+    if (has_dedicated_queue())
+        return {m_compute_family, m_graphics_family};
+    return {m_compute_family};
+}
+
+VkCommandBuffer ComputePipeline::begin_command_buffer()
+{
+    const auto& locks = m_framelocks[m_current_flight_frame];
+    m_device->timeline().wait(locks.timeline_point);
+
+    const auto command_buffer = m_commandbuffers[m_current_flight_frame];
+    vkResetCommandBuffer(command_buffer, 0);
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS)
+        throw std::runtime_error("Failed to begin compute command buffer!");
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    return command_buffer;
+}
+
+void ComputePipeline::bind_descriptor_set(VkCommandBuffer command_buffer,
+                                          const VkDescriptorSet descriptor_set) const
+{
+    vkCmdBindDescriptorSets(command_buffer,
+                            VK_PIPELINE_BIND_POINT_COMPUTE,
+                            m_pipeline_layout,
+                            0,
+                            1,
+                            &descriptor_set,
+                            0,
+                            nullptr);
+}
+
+void ComputePipeline::push_constants(VkCommandBuffer command_buffer,
+                                     const void* data,
+                                     const uint32_t size,
+                                     const uint32_t offset) const
+{
+    if (size > m_push_constant_size || offset > m_push_constant_size - size)
+        throw std::invalid_argument("Push constants are beyond the range of the compute pipeline!");
+    vkCmdPushConstants(command_buffer,
+                       m_pipeline_layout,
+                       VK_SHADER_STAGE_COMPUTE_BIT,
+                       offset,
+                       size,
+                       data);
+}
+
+void ComputePipeline::dispatch(VkCommandBuffer command_buffer,
+                               const uint32_t group_count_x,
+                               const uint32_t group_count_y,
+                               const uint32_t group_count_z) const
+{
+    vkCmdDispatch(command_buffer, group_count_x, group_count_y, group_count_z);
+}
+
+void ComputePipeline::dispatch_elements(VkCommandBuffer command_buffer,
+                                        const uint32_t element_count,
+                                        const uint32_t local_size) const
+{
+    if (local_size == 0)
+        throw std::invalid_argument("Compute local size can not be 0!");
+    if (element_count == 0)
+        return;
+    vkCmdDispatch(command_buffer, (element_count + local_size - 1) / local_size, 1, 1);
+}
+
+void ComputePipeline::dispatch_indirect(VkCommandBuffer command_buffer,
+                                        const VkBuffer buffer,
+                                        const VkDeviceSize offset) const
+{
+    vkCmdDispatchIndirect(command_buffer, buffer, offset);
+}
+
+TimelinePoint ComputePipeline::end_command_buffer(VkCommandBuffer command_buffer)
+{
+    if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+        throw std::runtime_error("Failed to record compute command buffer!");
+
+    auto& locks = m_framelocks[m_current_flight_frame];
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &command_buffer;
+
+    m_last_timeline_point = m_device->timeline().submit(m_compute_queue, submit_info);
+    locks.timeline_point = m_last_timeline_point;
+
+    m_current_flight_frame = (m_current_flight_frame + 1) % m_framelocks.size();
+    return m_last_timeline_point;
+}
+
+TimelinePoint ComputePipeline::last_timeline_point() const
+{
+    return m_last_timeline_point;
+}
+
+void ComputePipeline::destroy()
+{
+    const auto logical_device = m_device->logical_device();
+    vkDeviceWaitIdle(logical_device);
+
+    vkDestroyCommandPool(logical_device, m_command_pool, nullptr);
+    vkDestroyPipeline(logical_device, m_pipeline, nullptr);
+    vkDestroyPipelineLayout(logical_device, m_pipeline_layout, nullptr);
+}
+
+ComputePipeline::Builder::Builder(Device* device,
+                                  Renderer* renderer,
+                                  const ShaderBytecode compute_bytecode,
+                                  const VkDescriptorSetLayout descriptorset_layout)
+    : m_device(device)
+    , m_renderer(renderer)
+    , m_compute_bytecode(compute_bytecode)
+    , m_descriptorset_layout(descriptorset_layout)
+{
+    if (!m_device)
+        throw std::runtime_error("ComputePipeline::Builder() device was nullptr!");
+    if (!m_renderer)
+        throw std::runtime_error("ComputePipeline::Builder() renderer was nullptr!");
+}
+
+ComputePipeline::Builder& ComputePipeline::Builder::with_frames_in_flight(const uint32_t frames)
+{
+    m_max_frames_in_flight = frames;
+    return *this;
+}
+
+ComputePipeline::Builder& ComputePipeline::Builder::with_push_constants(const uint32_t size)
+{
+    m_push_constant_size = size;
+    return *this;
+}
+
+ComputePipeline::Builder& ComputePipeline::Builder::with_graphics_queue()
+{
+    m_use_graphics_queue = true;
+    return *this;
+}
+
+ComputePipeline ComputePipeline::Builder::produce()
+{
+    std::cout << "==================================================\n"
+              << " Producing ComputePipeline\n"
+              << "=================================================="
+              << std::endl;
+
+    if (m_max_frames_in_flight == 0)
+        throw std::invalid_argument("ComputePipeline needs at least one frame in flight!");
+    if (m_push_constant_size % 4 != 0)
+        throw std::invalid_argument("Push constant size must be a multiple of 4!");
+
+    const auto logical_device = m_device->logical_device();
+
+    /* ===================================================================
+     * Find Queues
+     */
+    const auto queue_families = get_queue_families(m_device->physical_device());
+    const auto indices = find_graphics_present_indices(queue_families,
+                                                       m_device->physical_device(),
+                                                       m_renderer->window_surface());
+    const uint32_t graphics_family = indices.graphics.value();
+    const uint32_t compute_family = m_use_graphics_queue
+        ? graphics_family
+        : indices.compute.value_or(graphics_family);
+    if (!(queue_families[compute_family].queueFlags & VK_QUEUE_COMPUTE_BIT))
+        throw std::runtime_error("The device has no queue family supporting compute!");
+
+    VkQueue compute_queue{};
+    vkGetDeviceQueue(logical_device, compute_family, 0, &compute_queue);
+    std::cout << "Compute queue family: " << compute_family
+              << (compute_family != graphics_family ? " (dedicated)" : " (shared with graphics)")
+              << std::endl;
+
+    /* ===================================================================
+     * Create Pipeline
+     */
+    VkPushConstantRange push_constant_range{};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = m_push_constant_size;
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info{};
+    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts = &m_descriptorset_layout;
+    pipeline_layout_info.pushConstantRangeCount = m_push_constant_size > 0 ? 1 : 0;
+    pipeline_layout_info.pPushConstantRanges = m_push_constant_size > 0 ? &push_constant_range : nullptr;
+
+    VkPipelineLayout pipeline_layout{};
+    auto status = vkCreatePipelineLayout(logical_device,
+                                         &pipeline_layout_info,
+                                         nullptr,
+                                         &pipeline_layout);
+    if (status != VK_SUCCESS)
+        throw std::runtime_error("Failed to create compute pipeline layout!");
+
+    const auto compute_module = compile_shader_bytecode(logical_device, m_compute_bytecode);
+
+    VkComputePipelineCreateInfo pipeline_info{};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = compute_module;
+    pipeline_info.stage.pName = "main";
+    pipeline_info.layout = pipeline_layout;
+
+    VkPipeline pipeline{};
+    status = vkCreateComputePipelines(logical_device,
+                                      VK_NULL_HANDLE,
+                                      1,
+                                      &pipeline_info,
+                                      nullptr,
+                                      &pipeline);
+    vkDestroyShaderModule(logical_device, compute_module, nullptr);
+    if (status != VK_SUCCESS) {
+        vkDestroyPipelineLayout(logical_device, pipeline_layout, nullptr);
+        throw std::runtime_error("Failed to create compute pipeline!");
+    }
+
+    /* ===================================================================
+     * Create Command Pool & Buffers
+     */
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = compute_family;
+
+    VkCommandPool command_pool{};
+    status = vkCreateCommandPool(logical_device, &pool_info, nullptr, &command_pool);
+    if (status != VK_SUCCESS) {
+        vkDestroyPipeline(logical_device, pipeline, nullptr);
+        vkDestroyPipelineLayout(logical_device, pipeline_layout, nullptr);
+        throw std::runtime_error("Failed to create compute command pool!");
+    }
+
+    VkCommandBufferAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.commandPool = command_pool;
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    std::vector<VkCommandBuffer> commandbuffers(m_max_frames_in_flight);
+    alloc_info.commandBufferCount = static_cast<uint32_t>(commandbuffers.size());
+    status = vkAllocateCommandBuffers(logical_device, &alloc_info, commandbuffers.data());
+    if (status != VK_SUCCESS) {
+        vkDestroyCommandPool(logical_device, command_pool, nullptr);
+        vkDestroyPipeline(logical_device, pipeline, nullptr);
+        vkDestroyPipelineLayout(logical_device, pipeline_layout, nullptr);
+        throw std::runtime_error("Failed to allocate compute command buffers!");
+    }
+
+    // Graphics waits for the compute work on the timeline, so frames need no semaphores.
+    std::vector<ComputeFrameLocks> framelocks(m_max_frames_in_flight);
+
+    return ComputePipeline(m_device,
+                           pipeline_layout,
+                           pipeline,
+                           compute_queue,
+                           compute_family,
+                           graphics_family,
+                           framelocks,
+                           commandbuffers,
+                           command_pool,
+                           m_push_constant_size);
+}
+
+}
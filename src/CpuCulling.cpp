@@ -0,0 +1,222 @@
+#include "../arc/CpuCulling.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace ArcGraphics {
+
+void cull_spheres(const Frustum& frustum,
+                  const float* center_x,
+                  const float* center_y,
+                  const float* center_z,
+                  const float* radius,
+                  const size_t count,
+                  uint8_t* visible)
+{
+    size_t i = 0;
+
+#if defined(__AVX__)
+    __m256 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+    for (int p = 0; p < 6; p++) {
+        plane_x[p] = _mm256_set1_ps(frustum.planes[p].x);
+        plane_y[p] = _mm256_set1_ps(frustum.planes[p].y);
+        plane_z[p] = _mm256_set1_ps(frustum.planes[p].z);
+        plane_w[p] = _mm256_set1_ps(frustum.planes[p].w);
+    }
+    const __m256 zero = _mm256_setzero_ps();
+    for (; i + 8 <= count; i += 8) {
+        const __m256 x = _mm256_loadu_ps(center_x + i);
+        const __m256 y = _mm256_loadu_ps(center_y + i);
+        const __m256 z = _mm256_loadu_ps(center_z + i);
+        const __m256 negative_radius = _mm256_sub_ps(zero, _mm256_loadu_ps(radius + i));
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            const __m256 distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(plane_x[p], x), _mm256_mul_ps(plane_y[p], y)),
+                _mm256_add_ps(_mm256_mul_ps(plane_z[p], z), plane_w[p]));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negative_radius, _CMP_GE_OQ));
+        }
+        const int mask = _mm256_movemask_ps(inside);
+        for (int lane = 0; lane < 8; lane++)
+            visible[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+    }
+#elif defined(__SSE2__)
+    __m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+    for (int p = 0; p < 6; p++) {
+        plane_x[p] = _mm_set1_ps(frustum.planes[p].x);
+        plane_y[p] = _mm_set1_ps(frustum.planes[p].y);
+        plane_z[p] = _mm_set1_ps(frustum.planes[p].z);
+        plane_w[p] = _mm_set1_ps(frustum.planes[p].w);
+    }
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x = _mm_loadu_ps(center_x + i);
+        const __m128 y = _mm_loadu_ps(center_y + i);
+        const __m128 z = _mm_loadu_ps(center_z + i);
+        const __m128 negative_radius = _mm_sub_ps(zero, _mm_loadu_ps(radius + i));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            const __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(plane_x[p], x), _mm_mul_ps(plane_y[p], y)),
+                _mm_add_ps(_mm_mul_ps(plane_z[p], z), plane_w[p]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negative_radius));
+        }
+        const int mask = _mm_movemask_ps(inside);
+        for (int lane = 0; lane < 4; lane++)
+            visible[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+    }
+#elif defined(__ARM_NEON)
+    float32x4_t plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+    for (int p = 0; p < 6; p++) {
+        plane_x[p] = vdupq_n_f32(frustum.planes[p].x);
+        plane_y[p] = vdupq_n_f32(frustum.planes[p].y);
+        plane_z[p] = vdupq_n_f32(frustum.planes[p].z);
+        plane_w[p] = vdupq_n_f32(frustum.planes[p].w);
+    }
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t x = vld1q_f32(center_x + i);
+        const float32x4_t y = vld1q_f32(center_y + i);
+        const float32x4_t z = vld1q_f32(center_z + i);
+        const float32x4_t negative_radius = vnegq_f32(vld1q_f32(radius + i));
+        uint32x4_t inside = vdupq_n_u32(0xffffffffu);
+        for (int p = 0; p < 6; p++) {
+            float32x4_t distance = vmlaq_f32(plane_w[p], plane_x[p], x);
+            distance = vmlaq_f32(distance, plane_y[p], y);
+            distance = vmlaq_f32(distance, plane_z[p], z);
+            inside = vandq_u32(inside, vcgeq_f32(distance, negative_radius));
+        }
+        visible[i + 0] = static_cast<uint8_t>(vgetq_lane_u32(inside, 0) & 1);
+        visible[i + 1] = static_cast<uint8_t>(vgetq_lane_u32(inside, 1) & 1);
+        visible[i + 2] = static_cast<uint8_t>(vgetq_lane_u32(inside, 2) & 1);
+        visible[i + 3] = static_cast<uint8_t>(vgetq_lane_u32(inside, 3) & 1);
+    }
+#endif
+
+    for (; i < count; i++)
+        visible[i] = is_sphere_in_frustum(frustum,
+                                          glm::vec3(center_x[i], center_y[i], center_z[i]),
+                                          radius[i]) ? 1 : 0;
+}
+
+uint32_t CpuCulling::add(const BoundingSphere& world)
+{
+    const auto id = static_cast<uint32_t>(m_radius.size());
+    m_center_x.push_back(world.center.x);
+    m_center_y.push_back(world.center.y);
+    m_center_z.push_back(world.center.z);
+    m_radius.push_back(world.radius);
+    return id;
+}
+
+uint32_t CpuCulling::add(const BoundingSphere& local, const glm::mat4& model)
+{
+    return add(transform_bounding_sphere(local, model));
+}
+
+void CpuCulling::set(const uint32_t id, const BoundingSphere& world)
+{
+    if (id >= m_radius.size())
+        throw std::out_of_range("CpuCulling object id out of range!");
+    m_center_x[id] = world.center.x;
+    m_center_y[id] = world.center.y;
+    m_center_z[id] = world.center.z;
+    m_radius[id] = world.radius;
+}
+
+void CpuCulling::reserve(const size_t count)
+{
+    m_center_x.reserve(count);
+    m_center_y.reserve(count);
+    m_center_z.reserve(count);
+    m_radius.reserve(count);
+}
+
+void CpuCulling::clear()
+{
+    m_center_x.clear();
+    m_center_y.clear();
+    m_center_z.clear();
+    m_radius.clear();
+}
+
+size_t CpuCulling::size() const
+{
+    return m_radius.size();
+}
+
+void CpuCulling::cull(const Frustum& frustum,
+                      std::vector<uint8_t>& visible,
+                      ThreadPool* pool) const
+{
+    const size_t count = size();
+    visible.resize(count);
+    const auto cull_range = [&](const size_t begin, const size_t end) {
+        cull_spheres(frustum,
+                     m_center_x.data() + begin,
+                     m_center_y.data() + begin,
+                     m_center_z.data() + begin,
+                     m_radius.data() + begin,
+                     end - begin,
+                     visible.data() + begin);
+    };
+    if (!pool || count <= block_size) {
+        cull_range(0, count);
+        return;
+    }
+    pool->parallel_for(0, count, cull_range, block_size);
+}
+
+void CpuCulling::cull_ids(const Frustum& frustum,
+                          std::vector<uint32_t>& ids,
+                          ThreadPool* pool) const
+{
+    // Scratch of this call, so concurrent calls do not share it.
+    std::vector<uint8_t> visible_flags{};
+    cull(frustum, visible_flags, pool);
+
+    // Every block counts its visible objects, then writes them from its offset.
+    const size_t count = visible_flags.size();
+    const size_t block_count = (count + block_size - 1) / block_size;
+    std::vector<size_t> offsets(block_count + 1, 0);
+    const auto for_blocks = [&](const std::function<void(size_t)>& f) {
+        if (!pool || block_count <= 1) {
+            for (size_t block = 0; block < block_count; block++)
+                f(block);
+            return;
+        }
+        pool->parallel_for(0, block_count, [&](const size_t begin, const size_t end) {
+            for (size_t block = begin; block < end; block++)
+                f(block);
+        });
+    };
+
+    for_blocks([&](const size_t block) {
+        const size_t end = std::min(count, (block + 1) * block_size);
+        size_t visible = 0;
+        for (size_t i = block * block_size; i < end; i++)
+            visible += visible_flags[i];
+        offsets[block + 1] = visible;
+    });
+    for (size_t block = 0; block < block_count; block++)
+        offsets[block + 1] += offsets[block];
+
+    ids.resize(offsets[block_count]);
+    for_blocks([&](const size_t block) {
+        const size_t end = std::min(count, (block + 1) * block_size);
+        uint32_t* out = ids.data() + offsets[block];
+        for (size_t i = block * block_size; i < end; i++)
+            if (visible_flags[i])
+                *out++ = static_cast<uint32_t>(i);
+    });
+}
+
+}
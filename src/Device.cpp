@@ -7,7 +7,7 @@ namespace ArcGraphics {
     
 Device::Builder::Builder()
 {
-    GlobalContext::Initialize();
+    time_phase(m_timings, "sdl_init", [] { GlobalContext::Initialize(); });
 }
 
 Device::Builder& Device::Builder::add_validation_layers(const ValidationLayers layers)
@@ -22,6 +22,21 @@ Device::Builder& Device::Builder::add_khronos_validation_layer()
     return *this;
 }
 
+Device::Builder& Device::Builder::with_window(const std::string& name,
+                                              const uint32_t width,
+                                              const uint32_t height,
+                                              const uint32_t flags)
+{
+    m_window = WindowSettings{name, width, height, flags};
+    return *this;
+}
+
+Device::Builder& Device::Builder::with_device_cache(const std::string& path)
+{
+    m_device_cache_path = path;
+    return *this;
+}
+
 Device Device::Builder::produce()
 {
 
@@ -34,48 +49,151 @@ Device Device::Builder::produce()
         VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
 
-   auto tmp_window = SDL_CreateWindow("Unnamed Window",
-                                       SDL_WINDOWPOS_UNDEFINED,
-                                       SDL_WINDOWPOS_UNDEFINED,
-                                       50,
-                                       50,
-                                       SDL_WINDOW_MINIMIZED
-                                       | SDL_WINDOW_VULKAN);
+    auto timings = m_timings;
+
+    /* =============================================================
+     * Use the real window if we have one, otherwise a temporary window is
+     * needed to get the surface that devices are scored against.
+     */
+    const bool owns_window = m_window.has_value();
+    auto window = time_phase(timings, "create_window", [&] {
+        if (owns_window)
+            return SDL_CreateWindow(m_window->name.c_str(),
+                                    SDL_WINDOWPOS_UNDEFINED,
+                                    SDL_WINDOWPOS_UNDEFINED,
+                                    m_window->width,
+                                    m_window->height,
+                                    m_window->flags | SDL_WINDOW_VULKAN);
+        return SDL_CreateWindow("Unnamed Window",
+                                SDL_WINDOWPOS_UNDEFINED,
+                                SDL_WINDOWPOS_UNDEFINED,
+                                50,
+                                50,
+                                SDL_WINDOW_MINIMIZED
+                                | SDL_WINDOW_VULKAN);
+    });
    
-   if (!tmp_window)
-       throw std::runtime_error("could not create temporary window");
+    if (!window)
+        throw std::runtime_error(owns_window ? "could not create window"
+                                             : "could not create temporary window");
     
-    const auto extension_properties = get_available_extension_properties();
-    std::cout << "Supported Extensions:\n";
-    for (const auto& property: extension_properties) {
-        std::cout << "\t" << property.extensionName << "\n";
+    // Listing every extension is only of use when debugging with validation layers.
+    if (!m_validation_layers.empty()) {
+        const auto extension_properties = get_available_extension_properties();
+        std::cout << "Supported Extensions:\n";
+        for (const auto& property: extension_properties) {
+            std::cout << "\t" << property.extensionName << "\n";
+        }
     }
 
-    auto instance = create_instance(tmp_window, m_validation_layers);
+    auto instance = time_phase(timings, "create_instance", [&] {
+        return create_instance(window, m_validation_layers);
+    });
     
-    VkSurfaceKHR tmp_window_surface;
-    SDL_Vulkan_CreateSurface(tmp_window,
-                             instance, 
-                             &tmp_window_surface);
+    VkSurfaceKHR window_surface{};
+    time_phase(timings, "create_surface", [&] {
+        if (!SDL_Vulkan_CreateSurface(window, instance, &window_surface))
+            throw std::runtime_error("could not create window surface");
+    });
     
-    auto physical_device = get_best_physical_device(instance,
-                                                    tmp_window_surface,
-                                                    device_extensions);
+    /* =============================================================
+     * Select Physical Device, from the cache if it is still valid
+     */
+    VkPhysicalDevice physical_device{VK_NULL_HANDLE};
+    if (m_device_cache_path) {
+        const auto cache = read_device_selection_cache(*m_device_cache_path);
+        if (cache) {
+            physical_device = time_phase(timings, "select_physical_device (cached)", [&] {
+                return find_cached_physical_device(instance, window_surface, *cache)
+                    .value_or(VK_NULL_HANDLE);
+            });
+        }
+    }
+
+    if (physical_device == VK_NULL_HANDLE) {
+        physical_device = time_phase(timings, "select_physical_device", [&] {
+            return get_best_physical_device(instance,
+                                            window_surface,
+                                            device_extensions);
+        });
+
+        if (m_device_cache_path) {
+            const auto queue_families = get_queue_families(physical_device);
+            const auto indices = find_graphics_present_indices(queue_families,
+                                                               physical_device,
+                                                               window_surface);
+            write_device_selection_cache(*m_device_cache_path, physical_device, indices);
+        }
+    }
     
-    auto logical_device = get_logical_device(physical_device,
-                                             tmp_window_surface,
-                                             device_extensions);
+    // Heap budgets are optional, without them residency falls back to tracked usage.
+    auto enabled_extensions = device_extensions;
+    const bool memory_budget =
+        is_instance_extension_available(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)
+        && is_device_extensions_supported(physical_device, {VK_EXT_MEMORY_BUDGET_EXTENSION_NAME});
+    if (memory_budget)
+        enabled_extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    // Multi draw is optional as well, draws are looped on the CPU without it.
+    const auto draw_features = get_draw_submission_features(instance, physical_device);
+    if (draw_features.draw_indirect_count)
+        enabled_extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+#ifdef VK_EXT_multi_draw
+    if (draw_features.multi_draw)
+        enabled_extensions.push_back(VK_EXT_MULTI_DRAW_EXTENSION_NAME);
+#endif
+
+    // Without synchronization2, RenderGraph records legacy barriers.
+    const bool synchronization2 = is_synchronization2_supported(instance, physical_device);
+#ifdef VK_KHR_synchronization2
+    if (synchronization2)
+        enabled_extensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+#endif
+
+    // Without timeline semaphores, the GpuTimeline tracks its values with fences.
+    const bool timeline_semaphore = is_timeline_semaphore_supported(instance, physical_device);
+#ifdef VK_KHR_timeline_semaphore
+    if (timeline_semaphore)
+        enabled_extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+#endif
+
+    auto logical_device = time_phase(timings, "create_logical_device", [&] {
+        return get_logical_device(physical_device,
+                                  window_surface,
+                                  enabled_extensions,
+                                  draw_features,
+                                  synchronization2,
+                                  timeline_semaphore);
+    });
     
-    auto capabilities = get_rendering_capabilities(physical_device,
-                                                   tmp_window_surface);
+    auto capabilities = time_phase(timings, "query_capabilities", [&] {
+        return get_rendering_capabilities(physical_device,
+                                          window_surface);
+    });
 
     /* =============================================================
      * Cleanup Temporary Window and Window-Surface
      */
-    vkDestroySurfaceKHR(instance, tmp_window_surface, nullptr);
-    SDL_DestroyWindow(tmp_window);
+    if (!owns_window) {
+        vkDestroySurfaceKHR(instance, window_surface, nullptr);
+        SDL_DestroyWindow(window);
+        window_surface = VK_NULL_HANDLE;
+        window = nullptr;
+    }
+
+    std::cout << "Device startup timings:\n" << stringify(timings);
     
-    return Device(instance, physical_device, logical_device, capabilities);
+    return Device(instance,
+                  physical_device,
+                  logical_device,
+                  capabilities,
+                  window,
+                  window_surface,
+                  timings,
+                  memory_budget,
+                  draw_features,
+                  synchronization2,
+                  timeline_semaphore);
 }
 
 const VkInstance& Device::instance() const noexcept
@@ -98,21 +216,87 @@ const DeviceRenderingCapabilities& Device::capabilities() const noexcept
 {
     return m_capabilities;
 }
+
+SDL_Window* Device::window() const noexcept
+{
+    return m_window;
+}
+
+const VkSurfaceKHR& Device::window_surface() const noexcept
+{
+    return m_window_surface;
+}
+
+const PhaseTimings& Device::startup_timings() const noexcept
+{
+    return m_startup_timings;
+}
+
+SamplerCache& Device::sampler_cache() const noexcept
+{
+    return m_sampler_cache;
+}
+
+bool Device::has_memory_budget() const noexcept
+{
+    return m_memory_budget;
+}
+
+std::vector<MemoryHeapBudget> Device::memory_heap_budgets() const
+{
+    return get_memory_heap_budgets(m_instance, m_physical_device, m_memory_budget);
+}
+
+const DrawSubmissionFeatures& Device::draw_submission_features() const noexcept
+{
+    return m_draw_features;
+}
+
+bool Device::has_synchronization2() const noexcept
+{
+    return m_synchronization2;
+}
+
+GpuTimeline& Device::timeline() const noexcept
+{
+    return m_timeline;
+}
     
 Device::Device(const VkInstance instance,
                const VkPhysicalDevice physical_device,
                const VkDevice logical_device,
-               const DeviceRenderingCapabilities capabilities)
+               const DeviceRenderingCapabilities capabilities,
+               SDL_Window* window,
+               const VkSurfaceKHR window_surface,
+               const PhaseTimings startup_timings,
+               const bool memory_budget,
+               const DrawSubmissionFeatures draw_features,
+               const bool synchronization2,
+               const bool timeline_semaphore)
     : m_instance(instance)
     , m_physical_device(physical_device)
     , m_logical_device(logical_device)
     , m_capabilities(capabilities)
+    , m_window(window)
+    , m_window_surface(window_surface)
+    , m_startup_timings(startup_timings)
+    , m_sampler_cache(physical_device, logical_device)
+    , m_memory_budget(memory_budget)
+    , m_draw_features(draw_features)
+    , m_synchronization2(synchronization2)
+    , m_timeline(logical_device, timeline_semaphore)
 {
 }
 
 void Device::destroy()
 {
+    m_timeline.destroy();
+    m_sampler_cache.destroy();
     vkDestroyDevice(m_logical_device, nullptr);
+    if (m_window_surface != VK_NULL_HANDLE)
+        vkDestroySurfaceKHR(m_instance, m_window_surface, nullptr);
+    if (m_window)
+        SDL_DestroyWindow(m_window);
     vkDestroyInstance(m_instance, nullptr);
 }
 
@@ -0,0 +1,67 @@
+#include "../arc/Frustum.hpp"
+
+namespace ArcGraphics {
+
+Frustum extract_frustum(const glm::mat4& view_projection)
+{
+    // glm is column major, so row i of the matrix is m[0][i], m[1][i], m[2][i], m[3][i].
+    const auto row = [&](const int i) {
+        return glm::vec4(view_projection[0][i],
+                         view_projection[1][i],
+                         view_projection[2][i],
+                         view_projection[3][i]);
+    };
+
+    Frustum frustum{};
+    frustum.planes[0] = row(3) + row(0);
+    frustum.planes[1] = row(3) - row(0);
+    frustum.planes[2] = row(3) + row(1);
+    frustum.planes[3] = row(3) - row(1);
+    frustum.planes[4] = row(2);
+    frustum.planes[5] = row(3) - row(2);
+    for (auto& plane: frustum.planes) {
+        const float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f)
+            plane /= length;
+    }
+    return frustum;
+}
+
+bool is_sphere_in_frustum(const Frustum& frustum,
+                          const glm::vec3& center,
+                          const float radius)
+{
+    for (const auto& plane: frustum.planes)
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            return false;
+    return true;
+}
+
+FrustumContainment classify_box_in_frustum(const Frustum& frustum,
+                                           const BoundingBox& box,
+                                           uint32_t* plane_mask)
+{
+    const glm::vec3 center = box.center();
+    const glm::vec3 half_extent = box.extent() * 0.5f;
+    uint32_t mask = plane_mask ? *plane_mask : all_frustum_planes;
+    auto containment = FrustumContainment::inside;
+    for (uint32_t i = 0; i < frustum.planes.size(); i++) {
+        if (!(mask & (1u << i)))
+            continue;
+        const auto& plane = frustum.planes[i];
+        const glm::vec3 normal(plane);
+        const float distance = glm::dot(normal, center) + plane.w;
+        const float reach = glm::dot(glm::abs(normal), half_extent);
+        if (distance < -reach)
+            return FrustumContainment::outside;
+        if (distance < reach)
+            containment = FrustumContainment::intersecting;
+        else
+            mask &= ~(1u << i);
+    }
+    if (plane_mask)
+        *plane_mask = mask;
+    return containment;
+}
+
+}
@@ -6,7 +6,9 @@ std::unique_ptr<GlobalContextInstance> GlobalContext::instance = nullptr;
     
 GlobalContextInstance::GlobalContextInstance()
 {
-    SDL_Init(SDL_INIT_EVERYTHING);
+    // Only video is needed for windows and vulkan surfaces (it implies events),
+    // bringing up audio, joysticks and haptics only costs startup time.
+    SDL_Init(SDL_INIT_VIDEO);
     SDL_Vulkan_LoadLibrary(nullptr);
 }
 
@@ -0,0 +1,684 @@
+#include "../arc/GltfLoader.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+namespace ArcGraphics {
+
+// https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html
+static constexpr uint32_t glb_magic = 0x46546C67;      // "glTF"
+static constexpr uint32_t glb_chunk_json = 0x4E4F534A; // "JSON"
+static constexpr uint32_t glb_chunk_bin = 0x004E4942;  // "BIN\0"
+static constexpr uint32_t gltf_triangles = 4;
+
+static constexpr uint32_t gltf_byte = 5120;
+static constexpr uint32_t gltf_unsigned_byte = 5121;
+static constexpr uint32_t gltf_short = 5122;
+static constexpr uint32_t gltf_unsigned_short = 5123;
+static constexpr uint32_t gltf_unsigned_int = 5125;
+static constexpr uint32_t gltf_float = 5126;
+
+/**
+ * @brief A parsed JSON value. Object members are children with a key.
+ */
+struct JsonValue {
+    enum class Kind { null, boolean, number, string, array, object };
+
+    Kind kind{Kind::null};
+    bool boolean{false};
+    double number{0.0};
+    std::string string{};
+    std::string key{};
+    std::vector<JsonValue> children{};
+
+    [[nodiscard]]
+    const JsonValue* get(const std::string_view name) const
+    {
+        if (kind != Kind::object)
+            return nullptr;
+        for (const auto& child: children)
+            if (child.key == name)
+                return &child;
+        return nullptr;
+    }
+
+    [[nodiscard]]
+    std::optional<uint64_t> get_uint(const std::string_view name) const
+    {
+        const auto value = get(name);
+        if (!value || value->kind != Kind::number || value->number < 0)
+            return std::nullopt;
+        return static_cast<uint64_t>(value->number);
+    }
+};
+
+/**
+ * @brief Recursive descent parser for the JSON chunk of a glTF file.
+ * @throw std::runtime_error on malformed input.
+ */
+class JsonParser
+{
+public:
+    explicit JsonParser(const std::string_view text)
+        : m_text(text)
+    {
+    }
+
+    [[nodiscard]]
+    JsonValue parse()
+    {
+        auto value = parse_value(0);
+        skip_whitespace();
+        if (m_position != m_text.size())
+            fail("trailing characters");
+        return value;
+    }
+
+private:
+    // Deeper nesting than any glTF file has is rejected rather than overflowing the stack.
+    static constexpr size_t max_depth = 64;
+
+    [[noreturn]]
+    void fail(const char* reason) const
+    {
+        throw std::runtime_error("JSON error at " + std::to_string(m_position) + ": " + reason);
+    }
+
+    void skip_whitespace()
+    {
+        while (m_position < m_text.size()
+            && (m_text[m_position] == ' ' || m_text[m_position] == '\t'
+                || m_text[m_position] == '\n' || m_text[m_position] == '\r'))
+            m_position++;
+    }
+
+    [[nodiscard]]
+    char peek()
+    {
+        skip_whitespace();
+        if (m_position >= m_text.size())
+            fail("unexpected end");
+        return m_text[m_position];
+    }
+
+    void expect(const char c)
+    {
+        if (peek() != c)
+            fail("unexpected character");
+        m_position++;
+    }
+
+    bool consume_literal(const std::string_view literal)
+    {
+        if (m_text.substr(m_position, literal.size()) != literal)
+            return false;
+        m_position += literal.size();
+        return true;
+    }
+
+    [[nodiscard]]
+    JsonValue parse_value(const size_t depth)
+    {
+        if (depth > max_depth)
+            fail("nested too deep");
+
+        JsonValue value{};
+        const char c = peek();
+        if (c == '{') {
+            value.kind = JsonValue::Kind::object;
+            m_position++;
+            if (peek() == '}') {
+                m_position++;
+                return value;
+            }
+            for (;;) {
+                auto key = parse_string();
+                expect(':');
+                value.children.push_back(parse_value(depth + 1));
+                value.children.back().key = std::move(key);
+                if (peek() == '}') {
+                    m_position++;
+                    return value;
+                }
+                expect(',');
+            }
+        }
+        if (c == '[') {
+            value.kind = JsonValue::Kind::array;
+            m_position++;
+            if (peek() == ']') {
+                m_position++;
+                return value;
+            }
+            for (;;) {
+                value.children.push_back(parse_value(depth + 1));
+                if (peek() == ']') {
+                    m_position++;
+                    return value;
+                }
+                expect(',');
+            }
+        }
+        if (c == '"') {
+            value.kind = JsonValue::Kind::string;
+            value.string = parse_string();
+            return value;
+        }
+        if (consume_literal("true")) {
+            value.kind = JsonValue::Kind::boolean;
+            value.boolean = true;
+            return value;
+        }
+        if (consume_literal("false")) {
+            value.kind = JsonValue::Kind::boolean;
+            return value;
+        }
+        if (consume_literal("null"))
+            return value;
+
+        value.kind = JsonValue::Kind::number;
+        const auto begin = m_text.data() + m_position;
+        const auto result = std::from_chars(begin, m_text.data() + m_text.size(), value.number);
+        if (result.ec != std::errc())
+            fail("invalid value");
+        m_position += static_cast<size_t>(result.ptr - begin);
+        return value;
+    }
+
+    [[nodiscard]]
+    std::string parse_string()
+    {
+        expect('"');
+        std::string result{};
+        while (m_position < m_text.size()) {
+            const char c = m_text[m_position++];
+            if (c == '"')
+                return result;
+            if (c != '\\') {
+                result += c;
+                continue;
+            }
+            if (m_position >= m_text.size())
+                break;
+            const char escaped = m_text[m_position++];
+            switch (escaped) {
+            case 'b': result += '\b'; break;
+            case 'f': result += '\f'; break;
+            case 'n': result += '\n'; break;
+            case 'r': result += '\r'; break;
+            case 't': result += '\t'; break;
+            case 'u': append_code_point(result); break;
+            default: result += escaped; break;
+            }
+        }
+        fail("unterminated string");
+    }
+
+    void append_code_point(std::string& out)
+    {
+        if (m_position + 4 > m_text.size())
+            fail("short unicode escape");
+        uint32_t code = 0;
+        const auto begin = m_text.data() + m_position;
+        const auto result = std::from_chars(begin, begin + 4, code, 16);
+        if (result.ec != std::errc() || result.ptr != begin + 4)
+            fail("invalid unicode escape");
+        m_position += 4;
+
+        // Surrogate pairs are not combined, names in glTF files are rarely outside the BMP.
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    std::string_view m_text;
+    size_t m_position{0};
+};
+
+/**
+ * @brief Decode the payload of a base64 data URI.
+ */
+[[nodiscard]]
+static std::optional<std::vector<unsigned char>> decode_base64(const std::string_view text)
+{
+    const auto value_of = [](const char c) -> int {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+') return 62;
+        if (c == '/') return 63;
+        return -1;
+    };
+
+    std::vector<unsigned char> out{};
+    out.reserve(text.size() / 4 * 3);
+    uint32_t bits = 0;
+    int bit_count = 0;
+    for (const char c: text) {
+        if (c == '=')
+            break;
+        const int value = value_of(c);
+        if (value < 0)
+            return std::nullopt;
+        bits = (bits << 6) | uint32_t(value);
+        bit_count += 6;
+        if (bit_count >= 8) {
+            bit_count -= 8;
+            out.push_back(static_cast<unsigned char>(bits >> bit_count));
+        }
+    }
+    return out;
+}
+
+[[nodiscard]]
+static uint32_t component_count(const std::string_view type)
+{
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    if (type == "MAT2") return 4;
+    if (type == "MAT3") return 9;
+    if (type == "MAT4") return 16;
+    return 0;
+}
+
+[[nodiscard]]
+static uint32_t component_size(const uint32_t component_type)
+{
+    switch (component_type) {
+    case gltf_byte:
+    case gltf_unsigned_byte:
+        return 1;
+    case gltf_short:
+    case gltf_unsigned_short:
+        return 2;
+    case gltf_unsigned_int:
+    case gltf_float:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+[[nodiscard]]
+static uint32_t read_u32(const unsigned char* data)
+{
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+const GltfAccessor* GltfPrimitive::attribute(const std::string_view semantic) const
+{
+    for (const auto& [name, accessor]: attributes)
+        if (name == semantic)
+            return &accessor;
+    return nullptr;
+}
+
+uint32_t GltfPrimitive::vertex_count() const
+{
+    const auto position = attribute("POSITION");
+    return position ? position->count : 0;
+}
+
+uint32_t GltfPrimitive::index_count() const
+{
+    return indices ? indices->count : vertex_count();
+}
+
+std::unique_ptr<GltfModel> GltfModel::open(const std::string& path)
+{
+    auto file = MappedFile::open(path);
+    if (!file)
+        return nullptr;
+
+    const auto invalid = [&](const std::string& reason) {
+        std::cout << "Invalid glTF file " << path << ": " << reason << std::endl;
+        return nullptr;
+    };
+
+    // A .glb is a header followed by a JSON chunk and an optional binary chunk.
+    std::string_view json_text{};
+    const unsigned char* glb_binary = nullptr;
+    size_t glb_binary_size = 0;
+    if (file->size() >= 12 && read_u32(file->data()) == glb_magic) {
+        const auto data = file->data();
+        const size_t length = std::min<size_t>(read_u32(data + 8), file->size());
+        size_t offset = 12;
+        while (offset + 8 <= length) {
+            const size_t chunk_size = read_u32(data + offset);
+            const uint32_t chunk_type = read_u32(data + offset + 4);
+            offset += 8;
+            if (chunk_size > length - offset)
+                return invalid("chunk out of bounds");
+            if (chunk_type == glb_chunk_json && json_text.empty())
+                json_text = {reinterpret_cast<const char*>(data + offset), chunk_size};
+            else if (chunk_type == glb_chunk_bin && !glb_binary) {
+                glb_binary = data + offset;
+                glb_binary_size = chunk_size;
+            }
+            offset += (chunk_size + 3) / 4 * 4;
+        }
+        if (json_text.empty())
+            return invalid("no JSON chunk");
+    } else {
+        json_text = {reinterpret_cast<const char*>(file->data()), file->size()};
+    }
+
+    JsonValue root;
+    try {
+        root = JsonParser(json_text).parse();
+    } catch (const std::runtime_error& error) {
+        return invalid(error.what());
+    }
+    const auto version = root.get("asset") ? root.get("asset")->get("version") : nullptr;
+    if (!version || version->kind != JsonValue::Kind::string || version->string.substr(0, 2) != "2.")
+        return invalid("not glTF 2.0");
+
+    auto model = std::unique_ptr<GltfModel>(new GltfModel());
+    model->m_file = std::move(file);
+    const auto directory = std::filesystem::path(path).parent_path();
+
+    // Resolve every buffer to memory that lives as long as the model.
+    struct BufferSpan {
+        const unsigned char* data;
+        size_t size;
+    };
+    std::vector<BufferSpan> buffers{};
+    if (const auto json_buffers = root.get("buffers")) {
+        for (const auto& buffer: json_buffers->children) {
+            const auto byte_length = buffer.get_uint("byteLength").value_or(0);
+            const auto uri = buffer.get("uri");
+            BufferSpan span{nullptr, 0};
+            if (!uri) {
+                if (!glb_binary)
+                    return invalid("buffer without uri outside of a .glb");
+                span = {glb_binary, glb_binary_size};
+            } else if (uri->string.rfind("data:", 0) == 0) {
+                const auto comma = uri->string.find(";base64,");
+                if (comma == std::string::npos)
+                    return invalid("unsupported data uri");
+                auto decoded = decode_base64(std::string_view(uri->string).substr(comma + 8));
+                if (!decoded)
+                    return invalid("invalid base64 data");
+                model->m_decoded_buffers.push_back(std::move(*decoded));
+                span = {model->m_decoded_buffers.back().data(), model->m_decoded_buffers.back().size()};
+            } else {
+                auto external = MappedFile::open((directory / uri->string).string());
+                if (!external)
+                    return invalid("could not map buffer " + uri->string);
+                span = {external->data(), external->size()};
+                model->m_external_buffers.push_back(std::move(external));
+            }
+            if (span.size < byte_length)
+                return invalid("buffer shorter than its byteLength");
+            buffers.push_back(span);
+        }
+    }
+
+    struct ViewSpan {
+        const unsigned char* data;
+        size_t size;
+        uint32_t stride;
+    };
+    std::vector<ViewSpan> views{};
+    if (const auto json_views = root.get("bufferViews")) {
+        for (const auto& view: json_views->children) {
+            const auto buffer = view.get_uint("buffer");
+            const auto offset = view.get_uint("byteOffset").value_or(0);
+            const auto length = view.get_uint("byteLength").value_or(0);
+            if (!buffer || *buffer >= buffers.size()
+                || offset > buffers[*buffer].size || length > buffers[*buffer].size - offset)
+                return invalid("buffer view out of bounds");
+            const auto stride = static_cast<uint32_t>(view.get_uint("byteStride").value_or(0));
+            views.push_back({buffers[*buffer].data + offset, static_cast<size_t>(length), stride});
+        }
+    }
+
+    std::vector<GltfAccessor> accessors{};
+    if (const auto json_accessors = root.get("accessors")) {
+        for (const auto& json_accessor: json_accessors->children) {
+            if (json_accessor.get("sparse"))
+                return invalid("sparse accessors are not supported");
+            GltfAccessor accessor{};
+            accessor.count = static_cast<uint32_t>(json_accessor.get_uint("count").value_or(0));
+            accessor.component_type = static_cast<uint32_t>(json_accessor.get_uint("componentType").value_or(0));
+            const auto type = json_accessor.get("type");
+            accessor.components = type ? component_count(type->string) : 0;
+            const auto normalized = json_accessor.get("normalized");
+            accessor.normalized = normalized && normalized->boolean;
+            const uint32_t element_size = component_size(accessor.component_type) * accessor.components;
+            if (element_size == 0)
+                return invalid("unknown accessor type");
+
+            if (const auto view_index = json_accessor.get_uint("bufferView")) {
+                if (*view_index >= views.size())
+                    return invalid("accessor refers to a missing buffer view");
+                const auto& view = views[*view_index];
+                const auto offset = json_accessor.get_uint("byteOffset").value_or(0);
+                accessor.stride = view.stride ? view.stride : element_size;
+                accessor.buffer_view = static_cast<int32_t>(*view_index);
+                const uint64_t end = accessor.count == 0
+                    ? offset
+                    : offset + uint64_t(accessor.stride) * (accessor.count - 1) + element_size;
+                if (end > view.size)
+                    return invalid("accessor out of bounds");
+                accessor.data = view.data + offset;
+            }
+            accessors.push_back(accessor);
+        }
+    }
+
+    const auto json_meshes = root.get("meshes");
+    if (!json_meshes)
+        return model;
+    for (const auto& mesh: json_meshes->children) {
+        const auto mesh_index = static_cast<uint32_t>(model->m_mesh_names.size());
+        const auto name = mesh.get("name");
+        model->m_mesh_names.push_back(name ? name->string : std::string());
+        const auto json_primitives = mesh.get("primitives");
+        if (!json_primitives)
+            continue;
+
+        for (const auto& json_primitive: json_primitives->children) {
+            if (json_primitive.get_uint("mode").value_or(gltf_triangles) != gltf_triangles) {
+                std::cout << "Skipping non triangle primitive of mesh " << mesh_index
+                          << " in " << path << std::endl;
+                continue;
+            }
+            GltfPrimitive primitive{};
+            primitive.mesh = mesh_index;
+            const auto material = json_primitive.get_uint("material");
+            primitive.material = material ? static_cast<int32_t>(*material) : -1;
+
+            const auto attributes = json_primitive.get("attributes");
+            if (!attributes)
+                return invalid("primitive without attributes");
+            for (const auto& attribute: attributes->children) {
+                const auto index = attribute.kind == JsonValue::Kind::number
+                    ? static_cast<size_t>(attribute.number)
+                    : accessors.size();
+                if (index >= accessors.size())
+                    return invalid("attribute refers to a missing accessor");
+                primitive.attributes.emplace_back(attribute.key, accessors[index]);
+            }
+            if (!primitive.attribute("POSITION"))
+                return invalid("primitive without positions");
+
+            if (const auto indices = json_primitive.get_uint("indices")) {
+                if (*indices >= accessors.size())
+                    return invalid("indices refer to a missing accessor");
+                const auto& accessor = accessors[*indices];
+                if (accessor.components != 1
+                    || (accessor.component_type != gltf_unsigned_byte
+                        && accessor.component_type != gltf_unsigned_short
+                        && accessor.component_type != gltf_unsigned_int))
+                    return invalid("indices must be unsigned scalars");
+                primitive.indices = accessor;
+            }
+            model->m_primitives.push_back(std::move(primitive));
+        }
+    }
+
+    return model;
+}
+
+const std::vector<GltfPrimitive>& GltfModel::primitives() const
+{
+    return m_primitives;
+}
+
+const std::vector<std::string>& GltfModel::mesh_names() const
+{
+    return m_mesh_names;
+}
+
+/**
+ * @brief Read component of element as a float, applying the normalization rules of glTF.
+ */
+[[nodiscard]]
+static float read_component(const unsigned char* element,
+                            const uint32_t component,
+                            const uint32_t component_type,
+                            const bool normalized)
+{
+    switch (component_type) {
+    case gltf_float: {
+        float value;
+        memcpy(&value, element + component * 4, sizeof(value));
+        return value;
+    }
+    case gltf_unsigned_byte: {
+        const float value = element[component];
+        return normalized ? value / 255.0f : value;
+    }
+    case gltf_byte: {
+        const float value = static_cast<int8_t>(element[component]);
+        return normalized ? std::max(value / 127.0f, -1.0f) : value;
+    }
+    case gltf_unsigned_short: {
+        uint16_t value;
+        memcpy(&value, element + component * 2, sizeof(value));
+        return normalized ? float(value) / 65535.0f : float(value);
+    }
+    case gltf_short: {
+        int16_t value;
+        memcpy(&value, element + component * 2, sizeof(value));
+        return normalized ? std::max(float(value) / 32767.0f, -1.0f) : float(value);
+    }
+    default:
+        throw std::invalid_argument("Accessor component type can not be read as float!");
+    }
+}
+
+void read_gltf_floats(const GltfAccessor* accessor,
+                      const uint32_t count,
+                      const uint32_t components,
+                      unsigned char* out,
+                      const size_t out_stride)
+{
+    const uint32_t available = accessor && accessor->data ? std::min(accessor->count, count) : 0;
+    const uint32_t read_components = accessor ? std::min(accessor->components, components) : 0;
+    const size_t row_size = size_t(components) * sizeof(float);
+
+    if (available > 0 && accessor->component_type == gltf_float && read_components == components) {
+        for (uint32_t i = 0; i < available; i++)
+            memcpy(out + i * out_stride, accessor->data + size_t(i) * accessor->stride, row_size);
+    } else {
+        for (uint32_t i = 0; i < available; i++) {
+            const auto element = accessor->data + size_t(i) * accessor->stride;
+            float values[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            for (uint32_t c = 0; c < read_components && c < 4; c++)
+                values[c] = read_component(element, c, accessor->component_type, accessor->normalized);
+            memcpy(out + i * out_stride, values, std::min<size_t>(row_size, sizeof(values)));
+        }
+    }
+    for (uint32_t i = available; i < count; i++)
+        memset(out + i * out_stride, 0, row_size);
+}
+
+void read_gltf_indices(const GltfPrimitive& primitive,
+                       const uint32_t base_vertex,
+                       uint32_t* out)
+{
+    const uint32_t count = primitive.index_count();
+    const uint32_t vertex_count = primitive.vertex_count();
+    if (!primitive.indices) {
+        for (uint32_t i = 0; i < count; i++)
+            out[i] = base_vertex + i;
+        return;
+    }
+
+    // Indices past the vertices of the primitive would read the vertices of another one,
+    // or past the end of the shared vertex buffer.
+    const auto out_of_range = [] {
+        return std::out_of_range("glTF index is out of range of the vertices of its primitive!");
+    };
+    const auto& accessor = *primitive.indices;
+    if (!accessor.data) {
+        if (count > 0 && vertex_count == 0)
+            throw out_of_range();
+        std::fill(out, out + count, base_vertex);
+        return;
+    }
+    if (accessor.component_type == gltf_unsigned_int && accessor.stride == 4 && base_vertex == 0) {
+        memcpy(out, accessor.data, size_t(count) * sizeof(uint32_t));
+        if (count > 0 && *std::max_element(out, out + count) >= vertex_count)
+            throw out_of_range();
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        const auto element = accessor.data + size_t(i) * accessor.stride;
+        uint32_t index;
+        if (accessor.component_type == gltf_unsigned_byte) {
+            index = element[0];
+        } else if (accessor.component_type == gltf_unsigned_short) {
+            uint16_t value;
+            memcpy(&value, element, sizeof(value));
+            index = value;
+        } else {
+            memcpy(&index, element, sizeof(index));
+        }
+        if (index >= vertex_count)
+            throw out_of_range();
+        out[i] = base_vertex + index;
+    }
+}
+
+std::vector<GltfDrawRange> plan_gltf_ranges(const GltfModel& model)
+{
+    std::vector<GltfDrawRange> ranges{};
+    ranges.reserve(model.primitives().size());
+    // Summed in 64 bits, so a model too large for 32 bit offsets is caught instead of wrapping.
+    uint64_t first_index = 0;
+    uint64_t first_vertex = 0;
+    for (const auto& primitive: model.primitives()) {
+        const uint32_t index_count = primitive.index_count();
+        const uint32_t vertex_count = primitive.vertex_count();
+        if (first_index + index_count > UINT32_MAX || first_vertex + vertex_count > UINT32_MAX)
+            throw std::length_error("glTF model has too many indices or vertices for 32 bit offsets!");
+        ranges.push_back({primitive.mesh,
+                          primitive.material,
+                          static_cast<uint32_t>(first_index),
+                          index_count,
+                          static_cast<uint32_t>(first_vertex),
+                          vertex_count});
+        first_index += index_count;
+        first_vertex += vertex_count;
+    }
+    return ranges;
+}
+
+}
@@ -0,0 +1,254 @@
+#include "../arc/GpuCulling.hpp"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace ArcGraphics {
+
+[[nodiscard]]
+static VkDescriptorSetLayout create_cull_descriptorset_layout(const Device* device)
+{
+    if (!device)
+        throw std::runtime_error("GpuCulling() device was nullptr!");
+
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
+    layout_info.pBindings = bindings.data();
+
+    VkDescriptorSetLayout layout{};
+    const auto status = vkCreateDescriptorSetLayout(device->logical_device(),
+                                                    &layout_info,
+                                                    nullptr,
+                                                    &layout);
+    if (status != VK_SUCCESS)
+        throw std::runtime_error("Failed to create culling descriptor set layout!");
+    return layout;
+}
+
+GpuCulling::GpuCulling(Device* device,
+                       Renderer* renderer,
+                       const DrawSubmitter& submitter,
+                       const ShaderBytecode cull_bytecode,
+                       const uint32_t capacity,
+                       const uint32_t frames_in_flight)
+    : m_device(device)
+    , m_submitter(submitter)
+    , m_descriptorset_layout(create_cull_descriptorset_layout(device))
+    , m_pipeline(ComputePipeline::Builder(device, renderer, cull_bytecode, m_descriptorset_layout)
+                 .with_frames_in_flight(frames_in_flight)
+                 .with_push_constants(sizeof(CullParameters))
+                 .produce())
+    , m_capacity(capacity)
+    , m_compact(submitter.features().draw_indirect_count)
+{
+    if (capacity == 0)
+        throw std::invalid_argument("GpuCulling capacity can not be 0!");
+    // The object index is passed to the vertex shader as firstInstance.
+    if (!submitter.features().draw_indirect_first_instance)
+        throw std::runtime_error("GpuCulling requires drawIndirectFirstInstance!");
+
+    const auto physical_device = m_device->physical_device();
+    const auto logical_device = m_device->logical_device();
+    const auto queue_families = m_pipeline.sharing_queue_families();
+
+    /* ===================================================================
+     * Create Buffers
+     */
+    m_frames.resize(frames_in_flight);
+    for (auto& frame: m_frames) {
+        VkBufferCreateInfo buffer_info;
+        create_buffer(physical_device,
+                      logical_device,
+                      VkDeviceSize(sizeof(CullObject)) * capacity,
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                      | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                      buffer_info,
+                      frame.objects,
+                      frame.objects_memory,
+                      queue_families);
+        void* mapping = nullptr;
+        if (vkMapMemory(logical_device, frame.objects_memory, 0, VK_WHOLE_SIZE, 0, &mapping) != VK_SUCCESS)
+            throw std::runtime_error("Failed to map culling object buffer!");
+        frame.objects_mapping = static_cast<CullObject*>(mapping);
+
+        create_buffer(physical_device,
+                      logical_device,
+                      VkDeviceSize(sizeof(VkDrawIndexedIndirectCommand)) * capacity,
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                      buffer_info,
+                      frame.commands,
+                      frame.commands_memory,
+                      queue_families);
+
+        create_buffer(physical_device,
+                      logical_device,
+                      sizeof(uint32_t),
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+                      | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+                      | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                      buffer_info,
+                      frame.count,
+                      frame.count_memory,
+                      queue_families);
+    }
+
+    /* ===================================================================
+     * Create Descriptor Sets
+     */
+    VkDescriptorPoolSize pool_size{};
+    pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pool_size.descriptorCount = 3 * frames_in_flight;
+
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes = &pool_size;
+    pool_info.maxSets = frames_in_flight;
+    if (vkCreateDescriptorPool(logical_device, &pool_info, nullptr, &m_descriptor_pool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create culling descriptor pool!");
+
+    const std::vector<VkDescriptorSetLayout> layouts(frames_in_flight, m_descriptorset_layout);
+    VkDescriptorSetAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorPool = m_descriptor_pool;
+    alloc_info.descriptorSetCount = frames_in_flight;
+    alloc_info.pSetLayouts = layouts.data();
+    std::vector<VkDescriptorSet> descriptor_sets(frames_in_flight);
+    if (vkAllocateDescriptorSets(logical_device, &alloc_info, descriptor_sets.data()) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate culling descriptor sets!");
+
+    for (uint32_t i = 0; i < frames_in_flight; i++) {
+        auto& frame = m_frames[i];
+        frame.descriptor_set = descriptor_sets[i];
+        const std::array<VkDescriptorBufferInfo, 3> buffer_infos = {{
+            {frame.objects, 0, VK_WHOLE_SIZE},
+            {frame.commands, 0, VK_WHOLE_SIZE},
+            {frame.count, 0, VK_WHOLE_SIZE},
+        }};
+        std::array<VkWriteDescriptorSet, 3> writes{};
+        for (uint32_t binding = 0; binding < writes.size(); binding++) {
+            writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[binding].dstSet = frame.descriptor_set;
+            writes[binding].dstBinding = binding;
+            writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[binding].descriptorCount = 1;
+            writes[binding].pBufferInfo = &buffer_infos[binding];
+        }
+        vkUpdateDescriptorSets(logical_device,
+                               static_cast<uint32_t>(writes.size()),
+                               writes.data(),
+                               0,
+                               nullptr);
+    }
+}
+
+CullObject* GpuCulling::objects(const uint32_t flight_frame)
+{
+    return m_frames.at(flight_frame).objects_mapping;
+}
+
+VkDescriptorBufferInfo GpuCulling::object_buffer_info(const uint32_t flight_frame) const
+{
+    return {m_frames.at(flight_frame).objects, 0, VK_WHOLE_SIZE};
+}
+
+TimelinePoint GpuCulling::cull(const uint32_t flight_frame,
+                               const glm::mat4& view_projection,
+                               const uint32_t object_count)
+{
+    if (object_count > m_capacity)
+        throw std::invalid_argument("More objects to cull than GpuCulling has room for!");
+    // The command buffer and timeline point of the compute pipeline follow its own frame counter.
+    if (flight_frame != m_pipeline.current_flight_frame())
+        throw std::logic_error("GpuCulling::cull() must be called once for every frame in order!");
+
+    auto& frame = m_frames[flight_frame];
+    frame.object_count = object_count;
+
+    CullParameters parameters{};
+    const auto frustum = extract_frustum(view_projection);
+    memcpy(parameters.planes, frustum.planes.data(), sizeof(parameters.planes));
+    parameters.object_count = object_count;
+    parameters.compact = m_compact ? 1 : 0;
+
+    const auto command_buffer = m_pipeline.begin_command_buffer();
+
+    // The count is accumulated with atomics, so it starts from 0 every frame.
+    vkCmdFillBuffer(command_buffer, frame.count, 0, sizeof(uint32_t), 0);
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(command_buffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0,
+                         1,
+                         &barrier,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr);
+
+    m_pipeline.bind_descriptor_set(command_buffer, frame.descriptor_set);
+    m_pipeline.push_constants(command_buffer, parameters);
+    m_pipeline.dispatch_elements(command_buffer, object_count, local_size);
+    return m_pipeline.end_command_buffer(command_buffer);
+}
+
+void GpuCulling::draw(VkCommandBuffer command_buffer, const uint32_t flight_frame) const
+{
+    const auto& frame = m_frames.at(flight_frame);
+    if (frame.object_count == 0)
+        return;
+    m_submitter.draw_indexed_indirect_count(command_buffer,
+                                            frame.commands,
+                                            0,
+                                            frame.count,
+                                            0,
+                                            frame.object_count);
+}
+
+uint32_t GpuCulling::capacity() const
+{
+    return m_capacity;
+}
+
+const ComputePipeline& GpuCulling::pipeline() const
+{
+    return m_pipeline;
+}
+
+void GpuCulling::destroy()
+{
+    m_pipeline.destroy();
+    const auto logical_device = m_device->logical_device();
+    for (auto& frame: m_frames) {
+        if (frame.objects_mapping)
+            vkUnmapMemory(logical_device, frame.objects_memory);
+        vkDestroyBuffer(logical_device, frame.objects, nullptr);
+        vkFreeMemory(logical_device, frame.objects_memory, nullptr);
+        vkDestroyBuffer(logical_device, frame.commands, nullptr);
+        vkFreeMemory(logical_device, frame.commands_memory, nullptr);
+        vkDestroyBuffer(logical_device, frame.count, nullptr);
+        vkFreeMemory(logical_device, frame.count_memory, nullptr);
+    }
+    m_frames.clear();
+    vkDestroyDescriptorPool(logical_device, m_descriptor_pool, nullptr);
+    vkDestroyDescriptorSetLayout(logical_device, m_descriptorset_layout, nullptr);
+}
+
+}
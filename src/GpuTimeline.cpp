@@ -0,0 +1,360 @@
+#include "../arc/GpuTimeline.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ArcGraphics {
+
+GpuTimeline::GpuTimeline(const VkDevice logical_device, const bool timeline_semaphore)
+    : m_logical_device(logical_device)
+{
+#ifdef VK_KHR_timeline_semaphore
+    if (!timeline_semaphore)
+        return;
+    // The instance is Vulkan 1.0, so the entry points come from the extension.
+    m_get_semaphore_counter_value = vkGetDeviceProcAddr(logical_device, "vkGetSemaphoreCounterValueKHR");
+    m_wait_semaphores = vkGetDeviceProcAddr(logical_device, "vkWaitSemaphoresKHR");
+    m_timeline_semaphore = m_get_semaphore_counter_value && m_wait_semaphores;
+#else
+    (void)timeline_semaphore;
+#endif
+}
+
+[[nodiscard]]
+static VkSemaphore create_timeline_semaphore(const VkDevice logical_device)
+{
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+#ifdef VK_KHR_timeline_semaphore
+    VkSemaphoreTypeCreateInfoKHR type_info{};
+    type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+    type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+    type_info.initialValue = 0;
+    VkSemaphoreCreateInfo semaphore_info{};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_info.pNext = &type_info;
+    if (vkCreateSemaphore(logical_device, &semaphore_info, nullptr, &semaphore) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create timeline semaphore!");
+#else
+    (void)logical_device;
+#endif
+    return semaphore;
+}
+
+/**
+ * @brief Raise known to value, unless another thread already raised it further.
+ */
+static void raise_completed(std::atomic<uint64_t>& known, const uint64_t value)
+{
+    uint64_t current = known.load();
+    while (current < value && !known.compare_exchange_weak(current, value)) {}
+}
+
+GpuTimeline::QueueTimeline* GpuTimeline::find(const VkQueue queue) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto found = m_queues.find(queue);
+    return found != m_queues.end() ? found->second.get() : nullptr;
+}
+
+TimelinePoint GpuTimeline::submit(const VkQueue queue,
+                                  const VkSubmitInfo& submit_info,
+                                  const std::vector<TimelineWait>& waits)
+{
+    for (const auto& wait: waits)
+        if (wait.point.value > last_submitted(wait.point.queue).value)
+            throw std::out_of_range("Waited GPU timeline point has not been submitted!");
+
+    QueueTimeline* timeline = find(queue);
+    if (!timeline) {
+        auto created = std::make_unique<QueueTimeline>();
+        if (m_timeline_semaphore)
+            created->semaphore = create_timeline_semaphore(m_logical_device);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& slot = m_queues[queue];
+        // Another thread may have made the first submission to queue meanwhile.
+        if (slot && created->semaphore != VK_NULL_HANDLE)
+            vkDestroySemaphore(m_logical_device, created->semaphore, nullptr);
+        if (!slot)
+            slot = std::move(created);
+        timeline = slot.get();
+    }
+
+#ifdef VK_KHR_timeline_semaphore
+    if (m_timeline_semaphore) {
+        // Binary semaphores of the batch take the same slots in the value arrays, which ignore them.
+        std::vector<VkSemaphore> wait_semaphores(submit_info.pWaitSemaphores,
+                                                 submit_info.pWaitSemaphores + submit_info.waitSemaphoreCount);
+        std::vector<VkPipelineStageFlags> wait_stages(submit_info.pWaitDstStageMask,
+                                                      submit_info.pWaitDstStageMask + submit_info.waitSemaphoreCount);
+        std::vector<uint64_t> wait_values(wait_semaphores.size(), 0);
+        for (const auto& wait: waits) {
+            if (wait.point.queue == VK_NULL_HANDLE || wait.point.value == 0)
+                continue;
+            wait_semaphores.push_back(semaphore(wait.point.queue));
+            wait_stages.push_back(wait.stage);
+            wait_values.push_back(wait.point.value);
+        }
+
+        std::lock_guard<std::mutex> submit_lock(timeline->submit_mutex);
+        const uint64_t value = timeline->last_submitted.load() + 1;
+        std::vector<VkSemaphore> signal_semaphores(submit_info.pSignalSemaphores,
+                                                   submit_info.pSignalSemaphores + submit_info.signalSemaphoreCount);
+        std::vector<uint64_t> signal_values(signal_semaphores.size(), 0);
+        signal_semaphores.push_back(timeline->semaphore);
+        signal_values.push_back(value);
+
+        VkTimelineSemaphoreSubmitInfoKHR timeline_info{};
+        timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+        timeline_info.pNext = submit_info.pNext;
+        timeline_info.waitSemaphoreValueCount = static_cast<uint32_t>(wait_values.size());
+        timeline_info.pWaitSemaphoreValues = wait_values.data();
+        timeline_info.signalSemaphoreValueCount = static_cast<uint32_t>(signal_values.size());
+        timeline_info.pSignalSemaphoreValues = signal_values.data();
+
+        VkSubmitInfo timeline_submit = submit_info;
+        timeline_submit.pNext = &timeline_info;
+        timeline_submit.waitSemaphoreCount = static_cast<uint32_t>(wait_semaphores.size());
+        timeline_submit.pWaitSemaphores = wait_semaphores.data();
+        timeline_submit.pWaitDstStageMask = wait_stages.data();
+        timeline_submit.signalSemaphoreCount = static_cast<uint32_t>(signal_semaphores.size());
+        timeline_submit.pSignalSemaphores = signal_semaphores.data();
+
+        if (vkQueueSubmit(queue, 1, &timeline_submit, VK_NULL_HANDLE) != VK_SUCCESS)
+            throw std::runtime_error("Failed to submit to the GPU timeline!");
+        timeline->last_submitted.store(value);
+        return {queue, value};
+    }
+#endif
+
+    // Fences can not be waited on by the GPU, so the waits are made here.
+    for (const auto& wait: waits)
+        this->wait(wait.point);
+
+    std::lock_guard<std::mutex> submit_lock(timeline->submit_mutex);
+    const uint64_t value = timeline->last_submitted.load() + 1;
+    VkFence fence = VK_NULL_HANDLE;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_free_fences.empty()) {
+            fence = m_free_fences.back();
+            m_free_fences.pop_back();
+        }
+    }
+    if (fence == VK_NULL_HANDLE) {
+        VkFenceCreateInfo fence_info{};
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(m_logical_device, &fence_info, nullptr, &fence) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create GPU timeline fence!");
+    }
+    if (vkQueueSubmit(queue, 1, &submit_info, fence) != VK_SUCCESS) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_free_fences.push_back(fence);
+        throw std::runtime_error("Failed to submit to the GPU timeline!");
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        timeline->pending_fences.push_back({value, fence});
+    }
+    timeline->last_submitted.store(value);
+    return {queue, value};
+}
+
+void GpuTimeline::recycle_fence(const VkFence fence) const
+{
+    if (m_fence_waiters > 0) {
+        m_retired_fences.push_back(fence);
+        return;
+    }
+    vkResetFences(m_logical_device, 1, &fence);
+    m_free_fences.push_back(fence);
+}
+
+void GpuTimeline::retire_fences(QueueTimeline& timeline) const
+{
+    // The fence of a submission also covers everything submitted to the queue before it.
+    while (!timeline.pending_fences.empty()
+           && vkGetFenceStatus(m_logical_device, timeline.pending_fences.front().fence) == VK_SUCCESS) {
+        const auto pending = timeline.pending_fences.front();
+        timeline.pending_fences.pop_front();
+        recycle_fence(pending.fence);
+        raise_completed(timeline.completed, pending.value);
+    }
+}
+
+uint64_t GpuTimeline::completed_value(const VkQueue queue) const
+{
+    const auto timeline = find(queue);
+    if (!timeline)
+        return 0;
+#ifdef VK_KHR_timeline_semaphore
+    if (m_timeline_semaphore) {
+        uint64_t value = 0;
+        const auto get_counter_value =
+            reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(m_get_semaphore_counter_value);
+        if (get_counter_value(m_logical_device, timeline->semaphore, &value) != VK_SUCCESS)
+            throw std::runtime_error("Failed to query the GPU timeline!");
+        // Keep the cache from going backwards when threads race on it.
+        raise_completed(timeline->completed, value);
+        return timeline->completed.load();
+    }
+#endif
+    std::lock_guard<std::mutex> lock(m_mutex);
+    retire_fences(*timeline);
+    return timeline->completed.load();
+}
+
+bool GpuTimeline::is_complete(const TimelinePoint& point) const
+{
+    if (point.queue == VK_NULL_HANDLE || point.value == 0)
+        return true;
+    const auto timeline = find(point.queue);
+    if (!timeline)
+        return false;
+    return point.value <= timeline->completed.load() || point.value <= completed_value(point.queue);
+}
+
+bool GpuTimeline::is_complete(const std::vector<TimelinePoint>& points) const
+{
+    return std::all_of(points.begin(), points.end(), [&](const TimelinePoint& point) {
+        return is_complete(point);
+    });
+}
+
+bool GpuTimeline::wait(const TimelinePoint& point, const uint64_t timeout) const
+{
+    return wait(std::vector<TimelinePoint>{point}, timeout);
+}
+
+bool GpuTimeline::wait(const std::vector<TimelinePoint>& points, const uint64_t timeout) const
+{
+    std::vector<TimelinePoint> pending{};
+    std::vector<QueueTimeline*> timelines{};
+    for (const auto& point: points) {
+        if (point.queue == VK_NULL_HANDLE || point.value == 0)
+            continue;
+        const auto timeline = find(point.queue);
+        if (!timeline || point.value > timeline->last_submitted.load())
+            throw std::out_of_range("GPU timeline point has not been submitted!");
+        if (point.value <= timeline->completed.load())
+            continue;
+        pending.push_back(point);
+        timelines.push_back(timeline);
+    }
+    if (pending.empty())
+        return true;
+
+#ifdef VK_KHR_timeline_semaphore
+    if (m_timeline_semaphore) {
+        std::vector<VkSemaphore> semaphores{};
+        std::vector<uint64_t> values{};
+        for (size_t i = 0; i < pending.size(); i++) {
+            semaphores.push_back(timelines[i]->semaphore);
+            values.push_back(pending[i].value);
+        }
+        VkSemaphoreWaitInfoKHR wait_info{};
+        wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+        wait_info.semaphoreCount = static_cast<uint32_t>(semaphores.size());
+        wait_info.pSemaphores = semaphores.data();
+        wait_info.pValues = values.data();
+        const auto wait_semaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(m_wait_semaphores);
+        const auto status = wait_semaphores(m_logical_device, &wait_info, timeout);
+        if (status == VK_TIMEOUT)
+            return false;
+        if (status != VK_SUCCESS)
+            throw std::runtime_error("Failed to wait for the GPU timeline!");
+        for (size_t i = 0; i < pending.size(); i++)
+            raise_completed(timelines[i]->completed, pending[i].value);
+        return true;
+    }
+#endif
+    return wait_fences(pending, timeout);
+}
+
+bool GpuTimeline::wait_fences(const std::vector<TimelinePoint>& points, const uint64_t timeout) const
+{
+    std::vector<QueueTimeline*> timelines{};
+    for (const auto& point: points)
+        timelines.push_back(find(point.queue));
+
+    std::vector<VkFence> fences{};
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < points.size(); i++) {
+            retire_fences(*timelines[i]);
+            for (const auto& pending: timelines[i]->pending_fences)
+                if (pending.value <= points[i].value)
+                    fences.push_back(pending.fence);
+        }
+        if (fences.empty())
+            return true;
+        m_fence_waiters++;
+    }
+
+    // No fence is reset while there are waiters, so the lock is not held across the wait
+    // and other threads keep submitting and polling.
+    const auto status = vkWaitForFences(m_logical_device,
+                                        static_cast<uint32_t>(fences.size()),
+                                        fences.data(),
+                                        VK_TRUE,
+                                        timeout);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_fence_waiters--;
+    for (const auto timeline: timelines)
+        retire_fences(*timeline);
+    if (m_fence_waiters == 0) {
+        for (const auto fence: m_retired_fences)
+            recycle_fence(fence);
+        m_retired_fences.clear();
+    }
+    if (status == VK_TIMEOUT)
+        return false;
+    if (status != VK_SUCCESS)
+        throw std::runtime_error("Failed to wait for the GPU timeline!");
+    return true;
+}
+
+TimelinePoint GpuTimeline::last_submitted(const VkQueue queue) const
+{
+    const auto timeline = find(queue);
+    return {queue, timeline ? timeline->last_submitted.load() : 0};
+}
+
+bool GpuTimeline::has_timeline_semaphore() const
+{
+    return m_timeline_semaphore;
+}
+
+VkSemaphore GpuTimeline::semaphore(const VkQueue queue) const
+{
+    const auto timeline = find(queue);
+    return timeline ? timeline->semaphore : VK_NULL_HANDLE;
+}
+
+void GpuTimeline::destroy()
+{
+    std::vector<TimelinePoint> last{};
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& [queue, timeline]: m_queues)
+            last.push_back({queue, timeline->last_submitted.load()});
+    }
+    wait(last);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& [queue, timeline]: m_queues) {
+        if (timeline->semaphore != VK_NULL_HANDLE)
+            vkDestroySemaphore(m_logical_device, timeline->semaphore, nullptr);
+        for (const auto& pending: timeline->pending_fences)
+            vkDestroyFence(m_logical_device, pending.fence, nullptr);
+    }
+    for (const auto fence: m_free_fences)
+        vkDestroyFence(m_logical_device, fence, nullptr);
+    for (const auto fence: m_retired_fences)
+        vkDestroyFence(m_logical_device, fence, nullptr);
+    m_queues.clear();
+    m_free_fences.clear();
+    m_retired_fences.clear();
+}
+
+}
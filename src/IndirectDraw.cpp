@@ -0,0 +1,227 @@
+#include "../arc/IndirectDraw.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ArcGraphics {
+
+const uint32_t IndirectBufferPolicy_DrawIndexed::buffer_type_bit = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+
+IndirectCommandWriter::IndirectCommandWriter(const VkPhysicalDevice& physical_device,
+                                             const VkDevice& logical_device,
+                                             const uint32_t capacity,
+                                             const uint32_t frames_in_flight)
+    : m_capacity(capacity)
+    , m_frames_in_flight(frames_in_flight)
+{
+    if (capacity == 0 || frames_in_flight == 0)
+        throw std::invalid_argument("Indirect command stream can not be empty!");
+
+    const VkDeviceSize size =
+        VkDeviceSize(sizeof(VkDrawIndexedIndirectCommand)) * capacity * frames_in_flight;
+    VkBufferCreateInfo buffer_info;
+    create_buffer(physical_device,
+                  logical_device,
+                  size,
+                  VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                  | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                  buffer_info,
+                  m_buffer,
+                  m_memory);
+
+    void* mapping = nullptr;
+    if (vkMapMemory(logical_device, m_memory, 0, size, 0, &mapping) != VK_SUCCESS) {
+        vkDestroyBuffer(logical_device, m_buffer, nullptr);
+        vkFreeMemory(logical_device, m_memory, nullptr);
+        throw std::runtime_error("Failed to map indirect command buffer!");
+    }
+    m_mapping = static_cast<VkDrawIndexedIndirectCommand*>(mapping);
+}
+
+void IndirectCommandWriter::begin_frame(const uint32_t flight_frame)
+{
+    if (flight_frame >= m_frames_in_flight)
+        throw std::invalid_argument("Flight frame is beyond the frames of the indirect command stream!");
+    m_frame = flight_frame;
+    m_count = 0;
+    m_first_instance = false;
+}
+
+std::optional<uint32_t> IndirectCommandWriter::add(const uint32_t index_count,
+                                                   const uint32_t first_index,
+                                                   const int32_t vertex_offset,
+                                                   const uint32_t instance_count,
+                                                   const uint32_t first_instance)
+{
+    VkDrawIndexedIndirectCommand command{};
+    command.indexCount = index_count;
+    command.instanceCount = instance_count;
+    command.firstIndex = first_index;
+    command.vertexOffset = vertex_offset;
+    command.firstInstance = first_instance;
+    return add(command);
+}
+
+std::optional<uint32_t> IndirectCommandWriter::add(const VkDrawIndexedIndirectCommand& command)
+{
+    if (m_count == m_capacity)
+        return std::nullopt;
+    m_mapping[size_t(m_frame) * m_capacity + m_count] = command;
+    m_first_instance = m_first_instance || command.firstInstance != 0;
+    return m_count++;
+}
+
+const VkDrawIndexedIndirectCommand* IndirectCommandWriter::commands() const
+{
+    return m_mapping + size_t(m_frame) * m_capacity;
+}
+
+bool IndirectCommandWriter::uses_first_instance() const { return m_first_instance; }
+VkBuffer IndirectCommandWriter::buffer() const { return m_buffer; }
+
+VkDeviceSize IndirectCommandWriter::offset() const
+{
+    return VkDeviceSize(m_frame) * m_capacity * sizeof(VkDrawIndexedIndirectCommand);
+}
+
+uint32_t IndirectCommandWriter::count() const { return m_count; }
+uint32_t IndirectCommandWriter::capacity() const { return m_capacity; }
+
+void IndirectCommandWriter::destroy(const VkDevice logical_device)
+{
+    if (m_mapping)
+        vkUnmapMemory(logical_device, m_memory);
+    m_mapping = nullptr;
+    vkDestroyBuffer(logical_device, m_buffer, nullptr);
+    vkFreeMemory(logical_device, m_memory, nullptr);
+    m_buffer = VK_NULL_HANDLE;
+    m_memory = VK_NULL_HANDLE;
+    m_count = 0;
+}
+
+DrawSubmitter::DrawSubmitter(const VkDevice& logical_device,
+                             const DrawSubmissionFeatures& features)
+    : m_features(features)
+{
+    if (m_features.multi_draw)
+        m_draw_multi_indexed = vkGetDeviceProcAddr(logical_device, "vkCmdDrawMultiIndexedEXT");
+    m_features.multi_draw = m_draw_multi_indexed != nullptr;
+    if (m_features.draw_indirect_count)
+        m_draw_indexed_indirect_count = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+            vkGetDeviceProcAddr(logical_device, "vkCmdDrawIndexedIndirectCountKHR"));
+    m_features.draw_indirect_count = m_draw_indexed_indirect_count != nullptr;
+}
+
+void DrawSubmitter::draw_indexed_indirect(VkCommandBuffer command_buffer,
+                                          const VkBuffer buffer,
+                                          const VkDeviceSize offset,
+                                          const uint32_t draw_count,
+                                          const uint32_t stride) const
+{
+    // Without multiDrawIndirect drawCount must be 0 or 1.
+    const uint32_t batch = m_features.multi_draw_indirect
+        ? std::max(m_features.max_draw_indirect_count, 1u)
+        : 1u;
+    for (uint32_t first = 0; first < draw_count; first += batch) {
+        vkCmdDrawIndexedIndirect(command_buffer,
+                                 buffer,
+                                 offset + VkDeviceSize(first) * stride,
+                                 std::min(batch, draw_count - first),
+                                 stride);
+    }
+}
+
+void DrawSubmitter::draw_indexed_indirect_count(VkCommandBuffer command_buffer,
+                                                const VkBuffer buffer,
+                                                const VkDeviceSize offset,
+                                                const VkBuffer count_buffer,
+                                                const VkDeviceSize count_offset,
+                                                const uint32_t max_draw_count,
+                                                const uint32_t stride) const
+{
+    if (m_draw_indexed_indirect_count) {
+        m_draw_indexed_indirect_count(command_buffer,
+                                      buffer,
+                                      offset,
+                                      count_buffer,
+                                      count_offset,
+                                      max_draw_count,
+                                      stride);
+        return;
+    }
+    draw_indexed_indirect(command_buffer, buffer, offset, max_draw_count, stride);
+}
+
+void DrawSubmitter::draw(VkCommandBuffer command_buffer, const IndirectCommandWriter& writer) const
+{
+    if (writer.count() == 0)
+        return;
+    if (writer.uses_first_instance() && !m_features.draw_indirect_first_instance) {
+        const auto commands = writer.commands();
+        for (uint32_t i = 0; i < writer.count(); i++) {
+            vkCmdDrawIndexed(command_buffer,
+                             commands[i].indexCount,
+                             commands[i].instanceCount,
+                             commands[i].firstIndex,
+                             commands[i].vertexOffset,
+                             commands[i].firstInstance);
+        }
+        return;
+    }
+    draw_indexed_indirect(command_buffer, writer.buffer(), writer.offset(), writer.count());
+}
+
+void DrawSubmitter::draw_multi_indexed(VkCommandBuffer command_buffer,
+                                       const MultiDrawIndexed* draws,
+                                       const uint32_t draw_count,
+                                       const uint32_t instance_count,
+                                       const uint32_t first_instance) const
+{
+#ifdef VK_EXT_multi_draw
+    static_assert(sizeof(MultiDrawIndexed) == sizeof(VkMultiDrawIndexedInfoEXT),
+                  "MultiDrawIndexed must match VkMultiDrawIndexedInfoEXT");
+    if (m_draw_multi_indexed) {
+        const auto draw_multi_indexed =
+            reinterpret_cast<PFN_vkCmdDrawMultiIndexedEXT>(m_draw_multi_indexed);
+        const uint32_t batch = m_features.max_multi_draw_count;
+        for (uint32_t first = 0; first < draw_count; first += batch) {
+            draw_multi_indexed(command_buffer,
+                               std::min(batch, draw_count - first),
+                               reinterpret_cast<const VkMultiDrawIndexedInfoEXT*>(draws + first),
+                               instance_count,
+                               first_instance,
+                               sizeof(MultiDrawIndexed),
+                               nullptr);
+        }
+        return;
+    }
+#endif
+    for (uint32_t i = 0; i < draw_count; i++) {
+        vkCmdDrawIndexed(command_buffer,
+                         draws[i].index_count,
+                         instance_count,
+                         draws[i].first_index,
+                         draws[i].vertex_offset,
+                         first_instance);
+    }
+}
+
+void DrawSubmitter::draw_multi_indexed(VkCommandBuffer command_buffer,
+                                       const std::vector<MultiDrawIndexed>& draws,
+                                       const uint32_t instance_count,
+                                       const uint32_t first_instance) const
+{
+    draw_multi_indexed(command_buffer,
+                       draws.data(),
+                       static_cast<uint32_t>(draws.size()),
+                       instance_count,
+                       first_instance);
+}
+
+const DrawSubmissionFeatures& DrawSubmitter::features() const noexcept
+{
+    return m_features;
+}
+
+}
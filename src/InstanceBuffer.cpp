@@ -0,0 +1,111 @@
+#include "../arc/InstanceBuffer.hpp"
+
+#include <cstddef>
+
+namespace ArcGraphics {
+
+const uint32_t InstanceBufferPolicy_TransformColor::buffer_type_bit = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+
+VkVertexInputBindingDescription Instance_TransformColor::get_binding_description(const uint32_t binding)
+{
+    VkVertexInputBindingDescription binding_description{};
+    binding_description.binding = binding;
+    binding_description.stride = sizeof(Instance_TransformColor);
+    binding_description.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    return binding_description;
+}
+
+std::vector<VkVertexInputAttributeDescription> Instance_TransformColor::get_attribute_descriptions(
+    const uint32_t binding,
+    const uint32_t first_location)
+{
+    // A mat4 input is four vec4 inputs at consecutive locations.
+    std::vector<VkVertexInputAttributeDescription> attribute_descriptions(5);
+    for (uint32_t column = 0; column < 4; column++) {
+        attribute_descriptions[column].binding = binding;
+        attribute_descriptions[column].location = first_location + column;
+        attribute_descriptions[column].offset =
+            static_cast<uint32_t>(offsetof(Instance_TransformColor, model) + column * sizeof(glm::vec4));
+        attribute_descriptions[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    }
+
+    attribute_descriptions[4].binding = binding;
+    attribute_descriptions[4].location = first_location + 4;
+    attribute_descriptions[4].offset = offsetof(Instance_TransformColor, color);
+    attribute_descriptions[4].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    return attribute_descriptions;
+}
+
+InstanceWriter::InstanceWriter(const VkPhysicalDevice& physical_device,
+                               const VkDevice& logical_device,
+                               const VkDeviceSize instance_size,
+                               const uint32_t capacity,
+                               const uint32_t frames_in_flight)
+    : m_instance_size(instance_size)
+    , m_capacity(capacity)
+    , m_frames_in_flight(frames_in_flight)
+{
+    if (instance_size == 0 || capacity == 0 || frames_in_flight == 0)
+        throw std::invalid_argument("Instance stream can not be empty!");
+
+    const VkDeviceSize size = instance_size * capacity * frames_in_flight;
+    VkBufferCreateInfo buffer_info;
+    create_buffer(physical_device,
+                  logical_device,
+                  size,
+                  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                  | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                  buffer_info,
+                  m_buffer,
+                  m_memory);
+
+    void* mapping = nullptr;
+    if (vkMapMemory(logical_device, m_memory, 0, size, 0, &mapping) != VK_SUCCESS) {
+        vkDestroyBuffer(logical_device, m_buffer, nullptr);
+        vkFreeMemory(logical_device, m_memory, nullptr);
+        throw std::runtime_error("Failed to map instance buffer!");
+    }
+    m_mapping = static_cast<unsigned char*>(mapping);
+}
+
+void InstanceWriter::begin_frame(const uint32_t flight_frame)
+{
+    if (flight_frame >= m_frames_in_flight)
+        throw std::invalid_argument("Flight frame is beyond the frames of the instance stream!");
+    m_frame = flight_frame;
+    m_count = 0;
+}
+
+std::optional<std::pair<void*, uint32_t>> InstanceWriter::allocate(const uint32_t count)
+{
+    if (count > m_capacity - m_count)
+        return std::nullopt;
+    const uint32_t first = m_count;
+    m_count += count;
+    const VkDeviceSize offset = (VkDeviceSize(m_frame) * m_capacity + first) * m_instance_size;
+    return std::make_pair(static_cast<void*>(m_mapping + offset), first);
+}
+
+void InstanceWriter::bind(VkCommandBuffer command_buffer, const uint32_t binding) const
+{
+    const VkDeviceSize offset = VkDeviceSize(m_frame) * m_capacity * m_instance_size;
+    vkCmdBindVertexBuffers(command_buffer, binding, 1, &m_buffer, &offset);
+}
+
+uint32_t InstanceWriter::count() const { return m_count; }
+uint32_t InstanceWriter::capacity() const { return m_capacity; }
+
+void InstanceWriter::destroy(const VkDevice logical_device)
+{
+    if (m_mapping)
+        vkUnmapMemory(logical_device, m_memory);
+    m_mapping = nullptr;
+    vkDestroyBuffer(logical_device, m_buffer, nullptr);
+    vkFreeMemory(logical_device, m_memory, nullptr);
+    m_buffer = VK_NULL_HANDLE;
+    m_memory = VK_NULL_HANDLE;
+    m_count = 0;
+}
+
+}
@@ -0,0 +1,96 @@
+#include "../arc/MappedFile.hpp"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ArcGraphics {
+
+#if defined(_WIN32)
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::string& path)
+{
+    const HANDLE file = CreateFileA(path.c_str(),
+                                    GENERIC_READ,
+                                    FILE_SHARE_READ,
+                                    nullptr,
+                                    OPEN_EXISTING,
+                                    FILE_FLAG_SEQUENTIAL_SCAN,
+                                    nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    std::unique_ptr<MappedFile> mapped(new MappedFile());
+    mapped->m_file = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+        return nullptr;
+
+    mapped->m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapped->m_mapping)
+        return nullptr;
+    mapped->m_data = static_cast<const unsigned char*>(
+        MapViewOfFile(mapped->m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!mapped->m_data)
+        return nullptr;
+    mapped->m_size = static_cast<size_t>(size.QuadPart);
+    return mapped;
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+    if (m_file)
+        CloseHandle(m_file);
+}
+
+#else
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::string& path)
+{
+    const int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        return nullptr;
+
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || status.st_size <= 0) {
+        close(descriptor);
+        return nullptr;
+    }
+
+    const auto size = static_cast<size_t>(status.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    // The mapping keeps its own reference to the file.
+    close(descriptor);
+    if (data == MAP_FAILED)
+        return nullptr;
+    // Decoders and copies walk the file front to back.
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    std::unique_ptr<MappedFile> mapped(new MappedFile());
+    mapped->m_data = static_cast<const unsigned char*>(data);
+    mapped->m_size = size;
+    return mapped;
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data)
+        munmap(const_cast<unsigned char*>(m_data), m_size);
+}
+
+#endif
+
+const unsigned char* MappedFile::data() const { return m_data; }
+size_t MappedFile::size() const { return m_size; }
+
+}
@@ -0,0 +1,818 @@
+#include "../arc/RenderGraph.hpp"
+#include "../arc/Algorithm.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace ArcGraphics {
+
+/**
+ * @brief What an access means for synchronization and image creation.
+ */
+struct RenderAccessInfo {
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+    VkImageLayout layout;
+    VkImageUsageFlags usage;
+    bool write;
+};
+
+[[nodiscard]]
+static RenderAccessInfo get_access_info(const RenderAccess access)
+{
+    constexpr auto fragment_tests = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+                                  | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    switch (access) {
+    case RenderAccess::color_attachment_write:
+        return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                true};
+    case RenderAccess::depth_attachment_write:
+        return {fragment_tests,
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                true};
+    case RenderAccess::depth_attachment_read:
+        return {fragment_tests,
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                false};
+    case RenderAccess::fragment_sampled_read:
+        return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_IMAGE_USAGE_SAMPLED_BIT,
+                false};
+    case RenderAccess::compute_sampled_read:
+        return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_IMAGE_USAGE_SAMPLED_BIT,
+                false};
+    case RenderAccess::compute_storage_read:
+        return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT,
+                VK_IMAGE_LAYOUT_GENERAL,
+                VK_IMAGE_USAGE_STORAGE_BIT,
+                false};
+    case RenderAccess::compute_storage_write:
+        return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_GENERAL,
+                VK_IMAGE_USAGE_STORAGE_BIT,
+                true};
+    case RenderAccess::vertex_buffer_read:
+        return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+                VK_IMAGE_LAYOUT_UNDEFINED,
+                0,
+                false};
+    case RenderAccess::index_buffer_read:
+        return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                VK_ACCESS_INDEX_READ_BIT,
+                VK_IMAGE_LAYOUT_UNDEFINED,
+                0,
+                false};
+    case RenderAccess::indirect_read:
+        return {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+                VK_IMAGE_LAYOUT_UNDEFINED,
+                0,
+                false};
+    case RenderAccess::uniform_read:
+        return {VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                VK_ACCESS_UNIFORM_READ_BIT,
+                VK_IMAGE_LAYOUT_UNDEFINED,
+                0,
+                false};
+    case RenderAccess::transfer_read:
+        return {VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_ACCESS_TRANSFER_READ_BIT,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                false};
+    case RenderAccess::transfer_write:
+        return {VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                true};
+    }
+    throw std::invalid_argument("Unknown render graph access!");
+}
+
+#ifdef VK_KHR_synchronization2
+/**
+ * @brief Get the narrower synchronization2 masks of an access, where the
+ * legacy masks lump e.g. index and vertex fetch or sampled and storage reads.
+ */
+[[nodiscard]]
+static std::pair<VkPipelineStageFlags2KHR, VkAccessFlags2KHR> get_access_masks2(const RenderAccess access)
+{
+    switch (access) {
+    case RenderAccess::fragment_sampled_read:
+        return {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR};
+    case RenderAccess::compute_sampled_read:
+        return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR};
+    case RenderAccess::compute_storage_read:
+        return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR};
+    case RenderAccess::compute_storage_write:
+        return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR,
+                VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR};
+    case RenderAccess::vertex_buffer_read:
+        return {VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT_KHR, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT_KHR};
+    case RenderAccess::index_buffer_read:
+        return {VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT_KHR, VK_ACCESS_2_INDEX_READ_BIT_KHR};
+    case RenderAccess::transfer_read:
+        return {VK_PIPELINE_STAGE_2_COPY_BIT_KHR | VK_PIPELINE_STAGE_2_BLIT_BIT_KHR,
+                VK_ACCESS_2_TRANSFER_READ_BIT_KHR};
+    case RenderAccess::transfer_write:
+        return {VK_PIPELINE_STAGE_2_COPY_BIT_KHR | VK_PIPELINE_STAGE_2_BLIT_BIT_KHR
+                | VK_PIPELINE_STAGE_2_CLEAR_BIT_KHR,
+                VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR};
+    default: {
+        // The remaining legacy bits have the same values in synchronization2.
+        const auto info = get_access_info(access);
+        return {info.stages, info.access};
+    }
+    }
+}
+#endif
+
+/* ===================================================================
+ * PassBuilder
+ */
+
+RenderGraph::PassBuilder::PassBuilder(RenderGraph& graph, Pass& pass)
+    : m_graph(graph)
+    , m_pass(pass)
+{
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::read(const RenderGraphImage image,
+                                                         const RenderAccess access)
+{
+    if (get_access_info(access).write)
+        throw std::invalid_argument("Render graph read declared with a writing access!");
+    return use(image.index, true, access);
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::read(const RenderGraphBuffer buffer,
+                                                         const RenderAccess access)
+{
+    if (get_access_info(access).write)
+        throw std::invalid_argument("Render graph read declared with a writing access!");
+    return use(buffer.index, false, access);
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::write(const RenderGraphImage image,
+                                                          const RenderAccess access)
+{
+    if (!get_access_info(access).write)
+        throw std::invalid_argument("Render graph write declared with a reading access!");
+    return use(image.index, true, access);
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::write(const RenderGraphBuffer buffer,
+                                                          const RenderAccess access)
+{
+    if (!get_access_info(access).write)
+        throw std::invalid_argument("Render graph write declared with a reading access!");
+    return use(buffer.index, false, access);
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::side_effects()
+{
+    m_pass.side_effects = true;
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::use(const uint32_t resource,
+                                                        const bool is_image,
+                                                        const RenderAccess access)
+{
+    if (resource >= m_graph.m_resources.size() || m_graph.m_resources[resource].is_image != is_image)
+        throw std::out_of_range("Unknown render graph resource!");
+
+    const auto info = get_access_info(access);
+    if (is_image && info.usage == 0)
+        throw std::invalid_argument("Render graph access can not be used on images!");
+    // An image has one layout at a time, so every use within a pass must agree.
+    for (const auto& other: m_pass.uses)
+        if (is_image && other.resource == resource && get_access_info(other.access).layout != info.layout)
+            throw std::invalid_argument("Pass uses image " + m_graph.m_resources[resource].name
+                                        + " in two layouts!");
+
+    m_pass.uses.push_back({resource, access});
+    m_graph.m_resources[resource].usage |= info.usage;
+    return *this;
+}
+
+/* ===================================================================
+ * RenderGraph
+ */
+
+RenderGraph::RenderGraph(Device* device)
+    : m_device(device)
+    , m_synchronization2(false)
+{
+    if (!device)
+        throw std::runtime_error("RenderGraph() device was nullptr!");
+#ifdef VK_KHR_synchronization2
+    if (device->has_synchronization2()) {
+        m_pipeline_barrier2 = vkGetDeviceProcAddr(device->logical_device(), "vkCmdPipelineBarrier2KHR");
+        m_synchronization2 = m_pipeline_barrier2 != nullptr;
+    }
+#endif
+}
+
+RenderGraphImage RenderGraph::create_image(const std::string& name,
+                                           const RenderGraphImageDescription& description)
+{
+    if (m_compiled)
+        throw std::logic_error("Render graph resources can not be added after compile()!");
+    if (description.width == 0 || description.height == 0)
+        throw std::invalid_argument("Render graph image " + name + " is empty!");
+    Resource resource{};
+    resource.name = name;
+    resource.is_image = true;
+    resource.imported = false;
+    resource.description = description;
+    m_resources.push_back(resource);
+    return {static_cast<uint32_t>(m_resources.size() - 1)};
+}
+
+RenderGraphImage RenderGraph::import_image(const std::string& name,
+                                           const VkImage image,
+                                           const VkImageView view,
+                                           const VkImageAspectFlags aspect,
+                                           const VkImageLayout initial_layout,
+                                           const VkImageLayout final_layout)
+{
+    if (m_compiled)
+        throw std::logic_error("Render graph resources can not be added after compile()!");
+    Resource resource{};
+    resource.name = name;
+    resource.is_image = true;
+    resource.imported = true;
+    resource.description.aspect = aspect;
+    resource.image = image;
+    resource.view = view;
+    resource.initial_layout = initial_layout;
+    resource.final_layout = final_layout;
+    m_resources.push_back(resource);
+    return {static_cast<uint32_t>(m_resources.size() - 1)};
+}
+
+RenderGraphBuffer RenderGraph::import_buffer(const std::string& name, const VkBuffer buffer)
+{
+    if (m_compiled)
+        throw std::logic_error("Render graph resources can not be added after compile()!");
+    Resource resource{};
+    resource.name = name;
+    resource.is_image = false;
+    resource.imported = true;
+    resource.buffer = buffer;
+    m_resources.push_back(resource);
+    return {static_cast<uint32_t>(m_resources.size() - 1)};
+}
+
+void RenderGraph::set_imported_image(const RenderGraphImage image,
+                                     const VkImage handle,
+                                     const VkImageView view)
+{
+    auto& resource = m_resources.at(image.index);
+    if (!resource.imported)
+        throw std::invalid_argument("Render graph image " + resource.name + " is not imported!");
+    resource.image = handle;
+    resource.view = view;
+}
+
+void RenderGraph::set_imported_buffer(const RenderGraphBuffer buffer, const VkBuffer handle)
+{
+    m_resources.at(buffer.index).buffer = handle;
+}
+
+void RenderGraph::add_pass(const std::string& name,
+                           const std::function<void(PassBuilder&)>& setup,
+                           ExecuteFunction execute)
+{
+    if (m_compiled)
+        throw std::logic_error("Render graph passes can not be added after compile()!");
+    Pass pass{};
+    pass.name = name;
+    pass.execute = std::move(execute);
+    PassBuilder builder(*this, pass);
+    setup(builder);
+    m_passes.push_back(std::move(pass));
+}
+
+RenderGraph::AccessScope RenderGraph::scope_of(const RenderAccess access) const
+{
+#ifdef VK_KHR_synchronization2
+    if (m_synchronization2) {
+        const auto [stages, access_mask] = get_access_masks2(access);
+        return {stages, access_mask};
+    }
+#endif
+    const auto info = get_access_info(access);
+    return {info.stages, info.access};
+}
+
+void RenderGraph::cull_passes()
+{
+    // Walking backwards, a pass is needed when it has side effects, writes an
+    // imported resource, or writes something a needed later pass uses. Writes
+    // count as uses too, since attachments may be loaded or blended onto.
+    std::vector<bool> needed(m_resources.size(), false);
+    for (auto pass = m_passes.rbegin(); pass != m_passes.rend(); pass++) {
+        bool keep = pass->side_effects;
+        for (const auto& use: pass->uses) {
+            const auto& resource = m_resources[use.resource];
+            if (get_access_info(use.access).write && (resource.imported || needed[use.resource]))
+                keep = true;
+        }
+        pass->culled = !keep;
+        if (!keep)
+            continue;
+        for (const auto& use: pass->uses)
+            needed[use.resource] = true;
+    }
+
+    for (uint32_t pass = 0; pass < m_passes.size(); pass++) {
+        if (m_passes[pass].culled)
+            continue;
+        for (const auto& use: m_passes[pass].uses) {
+            auto& resource = m_resources[use.resource];
+            if (resource.first_pass == UINT32_MAX)
+                resource.first_pass = pass;
+            if (resource.last_pass != pass)
+                resource.last_use = {};
+            resource.last_pass = pass;
+            const auto scope = scope_of(use.access);
+            resource.last_use.stages |= scope.stages;
+            resource.last_use.access |= scope.access;
+        }
+    }
+}
+
+void RenderGraph::create_transient_images()
+{
+    const auto physical_device = m_device->physical_device();
+    const auto logical_device = m_device->logical_device();
+    const auto memory_properties = get_physical_device_memory_properties(physical_device);
+    constexpr VkImageUsageFlags attachment_usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+                                                 | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+                                                 | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+    struct Placement {
+        uint32_t resource;
+        VkMemoryRequirements requirements;
+        uint32_t memory_type;
+        VkDeviceSize offset;
+    };
+    std::vector<Placement> placements{};
+
+    for (uint32_t index = 0; index < m_resources.size(); index++) {
+        auto& resource = m_resources[index];
+        if (resource.imported || resource.first_pass == UINT32_MAX)
+            continue;
+
+        // Images only ever used as attachments may never need backing memory on tilers.
+        const bool attachment_only = (resource.usage & ~attachment_usage) == 0;
+        VkImageCreateInfo image_info{};
+        image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        image_info.imageType = VK_IMAGE_TYPE_2D;
+        image_info.extent = {resource.description.width, resource.description.height, 1};
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.format = resource.description.format;
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        image_info.usage = resource.usage
+            | (attachment_only ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+        image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (vkCreateImage(logical_device, &image_info, nullptr, &resource.image) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create render graph image " + resource.name + "!");
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(logical_device, resource.image, &requirements);
+        m_unaliased_transient_memory_size += requirements.size;
+
+        if (attachment_only) {
+            try {
+                const auto lazy_type = find_memory_type(memory_properties,
+                                                        requirements.memoryTypeBits,
+                                                        VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+                VkMemoryAllocateInfo alloc_info{};
+                alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+                alloc_info.allocationSize = requirements.size;
+                alloc_info.memoryTypeIndex = lazy_type;
+                VkDeviceMemory memory{};
+                if (vkAllocateMemory(logical_device, &alloc_info, nullptr, &memory) != VK_SUCCESS)
+                    throw std::runtime_error("Failed to allocate lazy render graph memory!");
+                m_memory.push_back(memory);
+                if (vkBindImageMemory(logical_device, resource.image, memory, 0) != VK_SUCCESS)
+                    throw std::runtime_error("Failed to bind lazy render graph memory!");
+                m_transient_memory_size += requirements.size;
+                continue;
+            } catch (const std::runtime_error&) {
+                // No lazily allocated memory on this device, alias it like the rest.
+            }
+        }
+
+        const auto memory_type = find_memory_type(memory_properties,
+                                                  requirements.memoryTypeBits,
+                                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        placements.push_back({index, requirements, memory_type, 0});
+    }
+
+    // Largest first, every image goes to the lowest offset that does not overlap
+    // an image of the same memory type whose passes overlap its own.
+    std::sort(placements.begin(), placements.end(), [] (const Placement& a, const Placement& b) {
+        return a.requirements.size > b.requirements.size;
+    });
+    const auto lifetimes_overlap = [&](const uint32_t a, const uint32_t b) {
+        return m_resources[a].first_pass <= m_resources[b].last_pass
+            && m_resources[b].first_pass <= m_resources[a].last_pass;
+    };
+    const auto memory_overlaps = [](const Placement& a, const Placement& b) {
+        return a.offset < b.offset + b.requirements.size && b.offset < a.offset + a.requirements.size;
+    };
+    for (size_t i = 0; i < placements.size(); i++) {
+        auto& placement = placements[i];
+        std::vector<VkDeviceSize> candidates{0};
+        for (size_t j = 0; j < i; j++)
+            if (placements[j].memory_type == placement.memory_type)
+                candidates.push_back(placements[j].offset + placements[j].requirements.size);
+        std::sort(candidates.begin(), candidates.end());
+
+        const VkDeviceSize alignment = std::max<VkDeviceSize>(placement.requirements.alignment, 1);
+        for (const auto candidate: candidates) {
+            placement.offset = (candidate + alignment - 1) / alignment * alignment;
+            bool fits = true;
+            for (size_t j = 0; j < i && fits; j++)
+                fits = placements[j].memory_type != placement.memory_type
+                    || !lifetimes_overlap(placement.resource, placements[j].resource)
+                    || !memory_overlaps(placement, placements[j]);
+            if (fits)
+                break;
+        }
+    }
+
+    // One allocation per memory type.
+    std::vector<uint32_t> memory_types{};
+    for (const auto& placement: placements)
+        if (std::find(memory_types.begin(), memory_types.end(), placement.memory_type) == memory_types.end())
+            memory_types.push_back(placement.memory_type);
+    for (const auto memory_type: memory_types) {
+        VkDeviceSize size = 0;
+        for (const auto& placement: placements)
+            if (placement.memory_type == memory_type)
+                size = std::max(size, placement.offset + placement.requirements.size);
+
+        VkMemoryAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        alloc_info.allocationSize = size;
+        alloc_info.memoryTypeIndex = memory_type;
+        VkDeviceMemory memory{};
+        if (vkAllocateMemory(logical_device, &alloc_info, nullptr, &memory) != VK_SUCCESS)
+            throw std::runtime_error("Failed to allocate render graph memory!");
+        m_memory.push_back(memory);
+        m_transient_memory_size += size;
+
+        for (const auto& placement: placements) {
+            if (placement.memory_type != memory_type)
+                continue;
+            const auto& resource = m_resources[placement.resource];
+            if (vkBindImageMemory(logical_device, resource.image, memory, placement.offset) != VK_SUCCESS)
+                throw std::runtime_error("Failed to bind render graph image " + resource.name + "!");
+            for (const auto& other: placements)
+                if (other.resource != placement.resource
+                    && other.memory_type == memory_type
+                    && memory_overlaps(placement, other))
+                    m_resources[placement.resource].aliases.push_back(other.resource);
+        }
+    }
+
+    for (auto& resource: m_resources) {
+        if (resource.imported || resource.first_pass == UINT32_MAX)
+            continue;
+        const auto view = create_image_view(logical_device,
+                                            resource.image,
+                                            resource.description.format,
+                                            resource.description.aspect);
+        if (!view)
+            throw std::runtime_error("Failed to create render graph image view " + resource.name + "!");
+        resource.view = *view;
+    }
+}
+
+void RenderGraph::compile()
+{
+    if (m_compiled)
+        throw std::logic_error("Render graph is already compiled!");
+    cull_passes();
+    create_transient_images();
+    m_states.resize(m_resources.size());
+    m_compiled = true;
+
+    std::cout << "RenderGraph: " << executed_passes().size() << "/" << m_passes.size()
+              << " passes, transient memory " << m_transient_memory_size
+              << " bytes (" << m_unaliased_transient_memory_size << " without aliasing)\n";
+}
+
+void RenderGraph::plan_barrier(const uint32_t index,
+                               const AccessScope& scope,
+                               const VkImageLayout layout,
+                               const bool write,
+                               std::vector<Barrier>& barriers)
+{
+    const auto& resource = m_resources[index];
+    auto& state = m_states[index];
+    Barrier barrier{index, {}, scope, state.layout, resource.is_image ? layout : VK_IMAGE_LAYOUT_UNDEFINED};
+    bool needed = false;
+
+    if (!state.used) {
+        state.used = true;
+        if (!resource.imported) {
+            // The contents are discarded, but the last frame and the images sharing
+            // the memory may still be using it.
+            barrier.old_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.source = resource.last_use;
+            for (const auto alias: resource.aliases) {
+                barrier.source.stages |= m_resources[alias].last_use.stages;
+                barrier.source.access |= m_resources[alias].last_use.access;
+            }
+            needed = true;
+        } else if (resource.is_image && state.layout != layout) {
+            // Waiting on the stage itself chains with a semaphore wait at that stage,
+            // e.g. for an acquired swap chain image.
+            barrier.source = {scope.stages, 0};
+            needed = true;
+        }
+    } else if (resource.is_image && state.layout != layout) {
+        barrier.source = {state.last_write.stages | state.read_stages, state.last_write.access};
+        needed = true;
+    } else if (write) {
+        if (state.last_write.stages || state.read_stages) {
+            barrier.source = {state.last_write.stages | state.read_stages, state.last_write.access};
+            needed = true;
+        }
+    } else if (state.last_write.stages
+               && ((scope.stages & ~state.visible.stages) || (scope.access & ~state.visible.access))) {
+        barrier.source = state.last_write;
+        needed = true;
+    }
+
+    if (needed)
+        barriers.push_back(barrier);
+
+    const bool transitioned = needed && resource.is_image && barrier.old_layout != barrier.new_layout;
+    if (write) {
+        state.last_write = scope;
+        state.read_stages = 0;
+        state.visible = {};
+    } else if (transitioned) {
+        // The transition is a write made visible to this access only.
+        state.last_write = {scope.stages, 0};
+        state.read_stages = scope.stages;
+        state.visible = scope;
+    } else {
+        state.read_stages |= scope.stages;
+        if (needed) {
+            state.visible.stages |= scope.stages;
+            state.visible.access |= scope.access;
+        }
+    }
+    if (resource.is_image)
+        state.layout = layout;
+}
+
+void RenderGraph::record_barriers(VkCommandBuffer command_buffer, const std::vector<Barrier>& barriers)
+{
+    if (barriers.empty())
+        return;
+    m_barrier_count += static_cast<uint32_t>(barriers.size());
+
+    const auto subresource_range = [&](const Resource& resource) {
+        VkImageSubresourceRange range{};
+        range.aspectMask = resource.description.aspect;
+        range.baseMipLevel = 0;
+        range.levelCount = VK_REMAINING_MIP_LEVELS;
+        range.baseArrayLayer = 0;
+        range.layerCount = VK_REMAINING_ARRAY_LAYERS;
+        return range;
+    };
+
+#ifdef VK_KHR_synchronization2
+    if (m_synchronization2) {
+        std::vector<VkImageMemoryBarrier2KHR> image_barriers{};
+        std::vector<VkMemoryBarrier2KHR> memory_barriers{};
+        for (const auto& barrier: barriers) {
+            const auto& resource = m_resources[barrier.resource];
+            if (!resource.is_image) {
+                VkMemoryBarrier2KHR memory_barrier{};
+                memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2_KHR;
+                memory_barrier.srcStageMask = barrier.source.stages;
+                memory_barrier.srcAccessMask = barrier.source.access;
+                memory_barrier.dstStageMask = barrier.destination.stages;
+                memory_barrier.dstAccessMask = barrier.destination.access;
+                memory_barriers.push_back(memory_barrier);
+                continue;
+            }
+            VkImageMemoryBarrier2KHR image_barrier{};
+            image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR;
+            image_barrier.srcStageMask = barrier.source.stages;
+            image_barrier.srcAccessMask = barrier.source.access;
+            image_barrier.dstStageMask = barrier.destination.stages;
+            image_barrier.dstAccessMask = barrier.destination.access;
+            image_barrier.oldLayout = barrier.old_layout;
+            image_barrier.newLayout = barrier.new_layout;
+            image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            image_barrier.image = resource.image;
+            image_barrier.subresourceRange = subresource_range(resource);
+            image_barriers.push_back(image_barrier);
+        }
+
+        VkDependencyInfoKHR dependency_info{};
+        dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR;
+        dependency_info.memoryBarrierCount = static_cast<uint32_t>(memory_barriers.size());
+        dependency_info.pMemoryBarriers = memory_barriers.data();
+        dependency_info.imageMemoryBarrierCount = static_cast<uint32_t>(image_barriers.size());
+        dependency_info.pImageMemoryBarriers = image_barriers.data();
+        reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(m_pipeline_barrier2)(command_buffer, &dependency_info);
+        return;
+    }
+#endif
+
+    // Legacy barriers share one pair of stage masks, and buffers share one memory barrier.
+    VkPipelineStageFlags source_stages = 0;
+    VkPipelineStageFlags destination_stages = 0;
+    VkMemoryBarrier memory_barrier{};
+    memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    bool has_memory_barrier = false;
+    std::vector<VkImageMemoryBarrier> image_barriers{};
+    for (const auto& barrier: barriers) {
+        const auto& resource = m_resources[barrier.resource];
+        source_stages |= static_cast<VkPipelineStageFlags>(barrier.source.stages);
+        destination_stages |= static_cast<VkPipelineStageFlags>(barrier.destination.stages);
+        if (!resource.is_image) {
+            memory_barrier.srcAccessMask |= static_cast<VkAccessFlags>(barrier.source.access);
+            memory_barrier.dstAccessMask |= static_cast<VkAccessFlags>(barrier.destination.access);
+            has_memory_barrier = true;
+            continue;
+        }
+        VkImageMemoryBarrier image_barrier{};
+        image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        image_barrier.srcAccessMask = static_cast<VkAccessFlags>(barrier.source.access);
+        image_barrier.dstAccessMask = static_cast<VkAccessFlags>(barrier.destination.access);
+        image_barrier.oldLayout = barrier.old_layout;
+        image_barrier.newLayout = barrier.new_layout;
+        image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        image_barrier.image = resource.image;
+        image_barrier.subresourceRange = subresource_range(resource);
+        image_barriers.push_back(image_barrier);
+    }
+    if (source_stages == 0)
+        source_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    if (destination_stages == 0)
+        destination_stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    vkCmdPipelineBarrier(command_buffer,
+                         source_stages,
+                         destination_stages,
+                         0,
+                         has_memory_barrier ? 1 : 0,
+                         &memory_barrier,
+                         0,
+                         nullptr,
+                         static_cast<uint32_t>(image_barriers.size()),
+                         image_barriers.data());
+}
+
+void RenderGraph::execute(VkCommandBuffer command_buffer)
+{
+    if (!m_compiled)
+        throw std::logic_error("RenderGraph::execute() called before compile()!");
+
+    for (uint32_t index = 0; index < m_resources.size(); index++)
+        m_states[index] = {m_resources[index].initial_layout, {}, 0, {}, false};
+    m_barrier_count = 0;
+
+    std::vector<Barrier> barriers{};
+    std::vector<Use> merged{};
+    for (const auto& pass: m_passes) {
+        if (pass.culled)
+            continue;
+
+        // A resource used several ways within a pass gets one barrier for all of them.
+        merged.clear();
+        for (const auto& use: pass.uses) {
+            const auto same = std::find_if(merged.begin(), merged.end(), [&](const Use& other) {
+                return other.resource == use.resource;
+            });
+            if (same == merged.end())
+                merged.push_back(use);
+        }
+        barriers.clear();
+        for (const auto& first_use: merged) {
+            AccessScope scope{};
+            bool write = false;
+            VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            for (const auto& use: pass.uses) {
+                if (use.resource != first_use.resource)
+                    continue;
+                const auto use_scope = scope_of(use.access);
+                const auto info = get_access_info(use.access);
+                scope.stages |= use_scope.stages;
+                scope.access |= use_scope.access;
+                write = write || info.write;
+                layout = info.layout;
+            }
+            plan_barrier(first_use.resource, scope, layout, write, barriers);
+        }
+        record_barriers(command_buffer, barriers);
+        pass.execute(command_buffer, *this);
+    }
+
+    // Imported images are handed back in the layout they were imported with.
+    barriers.clear();
+    for (uint32_t index = 0; index < m_resources.size(); index++) {
+        const auto& resource = m_resources[index];
+        const auto& state = m_states[index];
+        if (!resource.imported || !resource.is_image || !state.used || state.layout == resource.final_layout)
+            continue;
+        const AccessScope destination{m_synchronization2 ? 0u : uint64_t(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT), 0};
+        barriers.push_back({index,
+                            {state.last_write.stages | state.read_stages, state.last_write.access},
+                            destination,
+                            state.layout,
+                            resource.final_layout});
+    }
+    record_barriers(command_buffer, barriers);
+}
+
+VkImage RenderGraph::image(const RenderGraphImage image) const
+{
+    return m_resources.at(image.index).image;
+}
+
+VkImageView RenderGraph::image_view(const RenderGraphImage image) const
+{
+    return m_resources.at(image.index).view;
+}
+
+VkBuffer RenderGraph::buffer(const RenderGraphBuffer buffer) const
+{
+    return m_resources.at(buffer.index).buffer;
+}
+
+std::vector<std::string> RenderGraph::executed_passes() const
+{
+    std::vector<std::string> names{};
+    for (const auto& pass: m_passes)
+        if (!pass.culled)
+            names.push_back(pass.name);
+    return names;
+}
+
+VkDeviceSize RenderGraph::transient_memory_size() const
+{
+    return m_transient_memory_size;
+}
+
+VkDeviceSize RenderGraph::unaliased_transient_memory_size() const
+{
+    return m_unaliased_transient_memory_size;
+}
+
+uint32_t RenderGraph::barrier_count() const
+{
+    return m_barrier_count;
+}
+
+void RenderGraph::destroy()
+{
+    const auto logical_device = m_device->logical_device();
+    for (auto& resource: m_resources) {
+        if (resource.imported)
+            continue;
+        vkDestroyImageView(logical_device, resource.view, nullptr);
+        vkDestroyImage(logical_device, resource.image, nullptr);
+        resource.view = VK_NULL_HANDLE;
+        resource.image = VK_NULL_HANDLE;
+    }
+    for (const auto memory: m_memory)
+        vkFreeMemory(logical_device, memory, nullptr);
+    m_memory.clear();
+}
+
+}
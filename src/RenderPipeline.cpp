@@ -1,5 +1,7 @@
 #include "../arc/RenderPipeline.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 
@@ -102,41 +104,79 @@ const VkPipelineLayout& RenderPipeline::layout() const
     return m_graphics_pipeline_layout;
 }
 
+const VkPipeline& RenderPipeline::graphics_pipeline() const
+{
+    return m_graphics_pipeline;
+}
+
+TimelinePoint RenderPipeline::last_timeline_point() const
+{
+    return m_last_timeline_point;
+}
+
 std::optional<uint32_t> RenderPipeline::wait_for_next_frame()
 {
-    vkWaitForFences(m_device->logical_device(),
-                    1,
-                    &m_framelocks[m_current_flight_frame].fence_in_flight,
-                    VK_TRUE,
-                    UINT64_MAX);
-    
+    const auto frame = try_begin_frame(UINT64_MAX);
+    if (frame.result != FrameAcquireResult::acquired)
+        return std::nullopt; //TODO call resizing
+    return frame.image_index;
+}
+
+FrameAcquire RenderPipeline::try_begin_frame(const uint64_t timeout)
+{
+    const auto& timeline = m_device->timeline();
+    const auto& frame_points = m_framelocks[m_current_flight_frame].timeline_points;
+    const auto wait_start = std::chrono::steady_clock::now();
+    const bool slot_ready = timeout == 0
+        ? timeline.is_complete(frame_points)
+        : timeline.wait(frame_points, timeout);
+    if (!slot_ready)
+        return {FrameAcquireResult::not_ready};
+
+    // Both waits share the timeout, UINT64_MAX waits for as long as it takes.
+    uint64_t acquire_timeout = timeout;
+    if (timeout != 0 && timeout != UINT64_MAX) {
+        const auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - wait_start).count();
+        acquire_timeout = timeout > uint64_t(waited) ? timeout - uint64_t(waited) : 0;
+    }
+
+    if (!m_frame_slot_reported) {
+        m_frame_slot_reported = true;
+        if (m_frame_slot_callback)
+            m_frame_slot_callback(m_current_flight_frame);
+    }
+
     if (m_swap_chain_framebuffer_resized) {
     //    recreate_swap_chain();
-        return std::nullopt; //TODO call resizing
+        return {FrameAcquireResult::out_of_date};
     }
 
+    // The semaphore is only signaled when an image is returned, so a timeout can be retried.
     uint32_t image_index;
     auto status = vkAcquireNextImageKHR(m_device->logical_device(),
                                         m_renderer->swapchain(),
-                                        UINT64_MAX,
+                                        acquire_timeout,
                                         m_framelocks[m_current_flight_frame].semaphore_image_available,
                                         VK_NULL_HANDLE,
                                         &image_index);
 
+    if (status == VK_TIMEOUT || status == VK_NOT_READY)
+        return {FrameAcquireResult::not_ready};
     if (status == VK_ERROR_OUT_OF_DATE_KHR || m_swap_chain_framebuffer_resized) {
         //recreate_swap_chain();
-        return std::nullopt; //TODO call resizing
+        return {FrameAcquireResult::out_of_date};
     } 
     else if (status != VK_SUCCESS && status != VK_SUBOPTIMAL_KHR)
         throw std::runtime_error("Failed to acquire swap chain image!");
-    
-    // Reset fences now we could get next image to draw on
-    vkResetFences(m_device->logical_device(),
-                  1,
-                  &m_framelocks[m_current_flight_frame].fence_in_flight);
 
     vkResetCommandBuffer(m_commandbuffers[m_current_flight_frame], 0);
-    return image_index;
+    return {FrameAcquireResult::acquired, image_index};
+}
+
+void RenderPipeline::set_frame_slot_callback(FrameSlotCallback callback)
+{
+    m_frame_slot_callback = std::move(callback);
 }
 
 VkCommandBuffer RenderPipeline::begin_command_buffer(uint32_t image_index)
@@ -224,11 +264,17 @@ void RenderPipeline::end_command_buffer(VkCommandBuffer command_buffer, uint32_t
 
     std::vector<VkSemaphore> waitSemaphores =
         {m_framelocks[m_current_flight_frame].semaphore_image_available};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    std::vector<VkPipelineStageFlags> waitStages = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    waitSemaphores.insert(waitSemaphores.end(),
+                          m_extra_wait_semaphores.begin(),
+                          m_extra_wait_semaphores.end());
+    waitStages.insert(waitStages.end(), m_extra_wait_stages.begin(), m_extra_wait_stages.end());
+    m_extra_wait_semaphores.clear();
+    m_extra_wait_stages.clear();
 
     submit_info.waitSemaphoreCount = waitSemaphores.size();
     submit_info.pWaitSemaphores = waitSemaphores.data();
-    submit_info.pWaitDstStageMask = waitStages;
+    submit_info.pWaitDstStageMask = waitStages.data();
     submit_info.commandBufferCount = 1;
     submit_info.pCommandBuffers = &m_commandbuffers[m_current_flight_frame];
     
@@ -237,12 +283,15 @@ void RenderPipeline::end_command_buffer(VkCommandBuffer command_buffer, uint32_t
     submit_info.signalSemaphoreCount = signalSemaphores.size();
     submit_info.pSignalSemaphores = signalSemaphores.data();
 
-    status = vkQueueSubmit(m_renderer->graphics_queue(),
-                           1,
-                           &submit_info,
-                           m_framelocks[m_current_flight_frame].fence_in_flight); 
-    if (status != VK_SUCCESS)
-        throw std::runtime_error("Failed to submit draw command buffer!");
+    m_last_timeline_point = m_device->timeline().submit(m_renderer->graphics_queue(),
+                                                        submit_info,
+                                                        m_timeline_waits);
+    auto& frame_points = m_framelocks[m_current_flight_frame].timeline_points;
+    frame_points = {m_last_timeline_point};
+    for (const auto& wait: m_timeline_waits)
+        frame_points.push_back(wait.point);
+    m_timeline_waits.clear();
+    m_frame_slot_reported = false;
     
     /* ===================================================================
      * Presentation
@@ -269,6 +318,18 @@ void RenderPipeline::end_command_buffer(VkCommandBuffer command_buffer, uint32_t
     m_current_flight_frame = (m_current_flight_frame + 1) % m_framelocks.size();
 }
  
+void RenderPipeline::wait_for_semaphore(const VkSemaphore semaphore,
+                                        const VkPipelineStageFlags stage)
+{
+    m_extra_wait_semaphores.push_back(semaphore);
+    m_extra_wait_stages.push_back(stage);
+}
+
+void RenderPipeline::wait_for_timeline(const TimelinePoint& point, const VkPipelineStageFlags stage)
+{
+    m_timeline_waits.push_back({point, stage});
+}
+ 
 RenderPipeline::RenderPipeline(Device* device,
                                Renderer* renderer,
                                const VkRenderPass render_pass,
@@ -314,7 +375,6 @@ void RenderPipeline::destroy()
         vkDestroySemaphore(logical_device,
                            m_framelocks[i].semaphore_rendering_finished,
                            nullptr);
-        vkDestroyFence(logical_device, m_framelocks[i].fence_in_flight, nullptr);
     }
 
     vkDestroyCommandPool(logical_device, m_command_pool, nullptr);
@@ -337,7 +397,7 @@ RenderPipeline::Builder::Builder(Device* device,
     , m_vertex_bytecode(vertex_bytecode)
     , m_fragment_bytecode(fragment_bytecode)
     , m_descriptorset_layout(descriptorset_layout)
-    , m_vertex_binding_description(vertex_binding_description)
+    , m_vertex_binding_descriptions{vertex_binding_description}
     , m_vertex_attribute_descriptions(vertex_attribute_descriptions)
 {
     if (!m_device)
@@ -380,6 +440,44 @@ RenderPipeline::Builder& RenderPipeline::Builder::with_clear_color(const float r
     return *this;
 }
 
+RenderPipeline::Builder& RenderPipeline::Builder::with_vertex_binding(
+    const VkVertexInputBindingDescription binding_description,
+    const std::vector<VkVertexInputAttributeDescription> attribute_descriptions)
+{
+    m_vertex_binding_descriptions.push_back(binding_description);
+    m_vertex_attribute_descriptions.insert(m_vertex_attribute_descriptions.end(),
+                                           attribute_descriptions.begin(),
+                                           attribute_descriptions.end());
+    return *this;
+}
+
+/**
+ * @brief Check that bindings are unique and every attribute has a binding and a location of its own.
+ * @throw std::runtime_error if the vertex input state is inconsistent.
+ */
+static void validate_vertex_input(const std::vector<VkVertexInputBindingDescription>& bindings,
+                                  const std::vector<VkVertexInputAttributeDescription>& attributes)
+{
+    for (size_t i = 0; i < bindings.size(); i++)
+        for (size_t j = i + 1; j < bindings.size(); j++)
+            if (bindings[i].binding == bindings[j].binding)
+                throw std::runtime_error("RenderPipeline::Builder() vertex binding "
+                                         + std::to_string(bindings[i].binding) + " was added twice!");
+
+    for (size_t i = 0; i < attributes.size(); i++) {
+        const auto has_binding = std::any_of(bindings.begin(), bindings.end(), [&](const auto& binding) {
+            return binding.binding == attributes[i].binding;
+        });
+        if (!has_binding)
+            throw std::runtime_error("RenderPipeline::Builder() vertex attribute at location "
+                                     + std::to_string(attributes[i].location) + " has no binding!");
+        for (size_t j = i + 1; j < attributes.size(); j++)
+            if (attributes[i].location == attributes[j].location)
+                throw std::runtime_error("RenderPipeline::Builder() vertex location "
+                                         + std::to_string(attributes[i].location) + " is used twice!");
+    }
+}
+
 RenderPipeline RenderPipeline::Builder::produce()
 {
     std::cout << "==================================================\n"
@@ -387,6 +485,9 @@ RenderPipeline RenderPipeline::Builder::produce()
               << "=================================================="
               << std::endl;
 
+    // Checked before any Vulkan object is created, so a bad layout has nothing to leak.
+    validate_vertex_input(m_vertex_binding_descriptions, m_vertex_attribute_descriptions);
+
     const auto vert_module = compile_shader_bytecode(m_device->logical_device(),
                                                      m_vertex_bytecode);
 
@@ -576,14 +677,15 @@ RenderPipeline RenderPipeline::Builder::produce()
     const auto color_blending =
         create_color_blend_state_info(color_blending_attachment_state);
     
-    std::cout << "vertex attribute descriptions count: " << m_vertex_attribute_descriptions.size()
+    std::cout << "vertex binding descriptions count: " << m_vertex_binding_descriptions.size()
+        << "\nvertex attribute descriptions count: " << m_vertex_attribute_descriptions.size()
         << std::endl;
     
     VkPipelineVertexInputStateCreateInfo vertex_input_info{};
     vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    //NOTE this can be a vector
-    vertex_input_info.vertexBindingDescriptionCount = 1;
-    vertex_input_info.pVertexBindingDescriptions = &m_vertex_binding_description;
+    vertex_input_info.vertexBindingDescriptionCount =
+        static_cast<uint32_t>(m_vertex_binding_descriptions.size());
+    vertex_input_info.pVertexBindingDescriptions = m_vertex_binding_descriptions.data();
     vertex_input_info.vertexAttributeDescriptionCount =
         static_cast<uint32_t>(m_vertex_attribute_descriptions.size());
     vertex_input_info.pVertexAttributeDescriptions =
@@ -726,10 +828,7 @@ RenderPipeline RenderPipeline::Builder::produce()
     VkSemaphoreCreateInfo semaphore_info{};
     semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fence_info{};
-    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
+    // Frames wait for their timeline points instead of a fence, none are waited for at the start.
     for (size_t i = 0; i < framelocks.size(); i++) {
         status = vkCreateSemaphore(m_device->logical_device(),
                                    &semaphore_info,
@@ -746,14 +845,6 @@ RenderPipeline RenderPipeline::Builder::produce()
         if (status != VK_SUCCESS)
             throw std::runtime_error("failed to create rendering finished semaphore["
                                      + std::to_string(i) + "]");
-
-        status = vkCreateFence(m_device->logical_device(),
-                            &fence_info,
-                            nullptr,
-                            &framelocks[i].fence_in_flight);
-        if (status != VK_SUCCESS)
-            throw std::runtime_error("failed to create fence in flight ["
-                                     + std::to_string(i) + "]");
     }
     
     std::cout << "Created synchronization objects" << std::endl;
@@ -0,0 +1,215 @@
+#include "../arc/RenderQueue.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <stdexcept>
+#include <utility>
+
+namespace ArcGraphics {
+
+void radix_sort(std::vector<RenderSortEntry>& entries, std::vector<RenderSortEntry>& scratch)
+{
+    constexpr uint32_t digit_bits = 8;
+    constexpr uint32_t digit_count = 1u << digit_bits;
+    constexpr uint32_t pass_count = 64 / digit_bits;
+
+    const size_t count = entries.size();
+    if (count < 2)
+        return;
+
+    // Count every digit of every pass in a single read of the keys.
+    std::array<std::array<uint32_t, digit_count>, pass_count> histograms{};
+    for (const auto& entry: entries)
+        for (uint32_t pass = 0; pass < pass_count; pass++)
+            histograms[pass][(entry.key >> (pass * digit_bits)) & (digit_count - 1)]++;
+
+    scratch.resize(count);
+    auto* source = &entries;
+    auto* destination = &scratch;
+    for (uint32_t pass = 0; pass < pass_count; pass++) {
+        auto& histogram = histograms[pass];
+        const uint32_t shift = pass * digit_bits;
+        if (histogram[(source->front().key >> shift) & (digit_count - 1)] == count)
+            continue;
+
+        uint32_t offset = 0;
+        for (auto& bucket: histogram) {
+            const uint32_t bucket_count = bucket;
+            bucket = offset;
+            offset += bucket_count;
+        }
+        for (const auto& entry: *source)
+            (*destination)[histogram[(entry.key >> shift) & (digit_count - 1)]++] = entry;
+        std::swap(source, destination);
+    }
+    if (source != &entries)
+        entries.swap(scratch);
+}
+
+uint32_t RenderQueue::add_pipeline(const VkPipeline pipeline, const VkPipelineLayout layout)
+{
+    if (m_pipelines.size() >= max_pipelines)
+        throw std::length_error("Too many pipelines in RenderQueue!");
+    m_pipelines.push_back({pipeline, layout});
+    return static_cast<uint32_t>(m_pipelines.size() - 1);
+}
+
+uint32_t RenderQueue::add_material(const VkDescriptorSet descriptor_set, const uint32_t first_set)
+{
+    if (m_materials.size() >= max_materials)
+        throw std::length_error("Too many materials in RenderQueue!");
+    m_materials.push_back({descriptor_set, first_set});
+    return static_cast<uint32_t>(m_materials.size() - 1);
+}
+
+uint32_t RenderQueue::add_mesh(const std::vector<VkBuffer>& vertex_buffers,
+                               const VkBuffer index_buffer,
+                               const VkIndexType index_type,
+                               const std::vector<VkDeviceSize>& vertex_offsets,
+                               const VkDeviceSize index_offset)
+{
+    if (m_meshes.size() >= max_meshes)
+        throw std::length_error("Too many meshes in RenderQueue!");
+    if (vertex_buffers.empty())
+        throw std::invalid_argument("RenderQueue mesh needs a vertex buffer!");
+    if (!vertex_offsets.empty() && vertex_offsets.size() != vertex_buffers.size())
+        throw std::invalid_argument("RenderQueue mesh needs an offset for every vertex buffer!");
+
+    Mesh mesh{};
+    mesh.vertex_buffers = vertex_buffers;
+    mesh.vertex_offsets = vertex_offsets.empty()
+        ? std::vector<VkDeviceSize>(vertex_buffers.size(), 0)
+        : vertex_offsets;
+    mesh.index_buffer = index_buffer;
+    mesh.index_offset = index_offset;
+    mesh.index_type = index_type;
+    m_meshes.push_back(std::move(mesh));
+    return static_cast<uint32_t>(m_meshes.size() - 1);
+}
+
+void RenderQueue::set_material(const uint32_t material, const VkDescriptorSet descriptor_set)
+{
+    m_materials.at(material).descriptor_set = descriptor_set;
+}
+
+void RenderQueue::clear()
+{
+    m_draws.clear();
+    m_entries.clear();
+}
+
+uint64_t RenderQueue::make_key(const uint32_t layer,
+                               const RenderBlend blend,
+                               const uint32_t pipeline,
+                               const uint32_t material,
+                               const uint32_t mesh,
+                               const float depth)
+{
+    // The upper half of a non negative float orders like the float itself,
+    // with precision relative to the distance.
+    const uint64_t depth_bits = depth > 0.0f ? std::bit_cast<uint32_t>(depth) >> 16 : 0;
+    const uint64_t state = (uint64_t(pipeline) << 32) | (uint64_t(material) << 16) | mesh;
+    const uint64_t prefix = uint64_t(layer) << 60;
+    if (blend == RenderBlend::opaque)
+        return prefix | (state << 16) | depth_bits;
+    return prefix | (uint64_t(1) << 59) | ((0xffff - depth_bits) << 43) | state;
+}
+
+void RenderQueue::submit(const uint32_t layer,
+                         const RenderBlend blend,
+                         const uint32_t pipeline,
+                         const uint32_t material,
+                         const uint32_t mesh,
+                         const float depth,
+                         const VkDrawIndexedIndirectCommand& command)
+{
+    if (layer >= max_layers)
+        throw std::out_of_range("RenderQueue layer out of range!");
+    if (pipeline >= m_pipelines.size() || material >= m_materials.size() || mesh >= m_meshes.size())
+        throw std::out_of_range("RenderQueue draw uses unregistered state!");
+
+    m_entries.push_back({make_key(layer, blend, pipeline, material, mesh, depth),
+                         static_cast<uint32_t>(m_draws.size())});
+    m_draws.push_back({pipeline, material, mesh, command});
+}
+
+RenderQueueStats RenderQueue::record(VkCommandBuffer command_buffer)
+{
+    radix_sort(m_entries, m_scratch);
+
+    RenderQueueStats stats{};
+    constexpr uint32_t none = UINT32_MAX;
+    uint32_t bound_pipeline = none;
+    uint32_t bound_material = none;
+    uint32_t bound_mesh = none;
+    VkPipelineLayout bound_layout = VK_NULL_HANDLE;
+    VkBuffer bound_index_buffer = VK_NULL_HANDLE;
+    VkDeviceSize bound_index_offset = 0;
+    VkIndexType bound_index_type = VK_INDEX_TYPE_MAX_ENUM;
+
+    for (const auto& entry: m_entries) {
+        const auto& draw = m_draws[entry.index];
+
+        if (draw.pipeline != bound_pipeline) {
+            const auto& pipeline = m_pipelines[draw.pipeline];
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+            // Sets bound with another layout may be disturbed, so bind the material again.
+            if (pipeline.layout != bound_layout)
+                bound_material = none;
+            bound_pipeline = draw.pipeline;
+            bound_layout = pipeline.layout;
+            stats.pipeline_binds++;
+        }
+
+        if (draw.material != bound_material) {
+            const auto& material = m_materials[draw.material];
+            vkCmdBindDescriptorSets(command_buffer,
+                                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                    bound_layout,
+                                    material.first_set,
+                                    1,
+                                    &material.descriptor_set,
+                                    0,
+                                    nullptr);
+            bound_material = draw.material;
+            stats.material_binds++;
+        }
+
+        if (draw.mesh != bound_mesh) {
+            const auto& mesh = m_meshes[draw.mesh];
+            vkCmdBindVertexBuffers(command_buffer,
+                                   0,
+                                   static_cast<uint32_t>(mesh.vertex_buffers.size()),
+                                   mesh.vertex_buffers.data(),
+                                   mesh.vertex_offsets.data());
+            // Meshes often share one index buffer at different offsets.
+            if (mesh.index_buffer != bound_index_buffer
+                || mesh.index_offset != bound_index_offset
+                || mesh.index_type != bound_index_type) {
+                vkCmdBindIndexBuffer(command_buffer, mesh.index_buffer, mesh.index_offset, mesh.index_type);
+                bound_index_buffer = mesh.index_buffer;
+                bound_index_offset = mesh.index_offset;
+                bound_index_type = mesh.index_type;
+            }
+            bound_mesh = draw.mesh;
+            stats.mesh_binds++;
+        }
+
+        vkCmdDrawIndexed(command_buffer,
+                         draw.command.indexCount,
+                         draw.command.instanceCount,
+                         draw.command.firstIndex,
+                         draw.command.vertexOffset,
+                         draw.command.firstInstance);
+        stats.draws++;
+    }
+    return stats;
+}
+
+size_t RenderQueue::size() const
+{
+    return m_draws.size();
+}
+
+}
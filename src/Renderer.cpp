@@ -6,28 +6,6 @@
 
 namespace ArcGraphics {
     
-[[nodiscard]]
-std::optional<VkFormat> find_supported_texture_format(const VkPhysicalDevice& physical_device,
-                                                      const std::vector<VkFormat>& candidates,
-                                                      const VkImageTiling tiling,
-                                                      const VkFormatFeatureFlags features) 
-{
-    for (const VkFormat format : candidates) {
-        VkFormatProperties props;
-        vkGetPhysicalDeviceFormatProperties(physical_device, format, &props);
-
-        if (tiling == VK_IMAGE_TILING_LINEAR 
-        && (props.linearTilingFeatures & features) == features) {
-            return format;
-        }
-        else if (tiling == VK_IMAGE_TILING_OPTIMAL 
-            && (props.optimalTilingFeatures & features) == features) {
-            return format;
-        }
-    }
-    return std::nullopt;
-}
-    
 [[nodiscard]]
 std::optional<VkFormat> find_depthbuffer_format(const VkPhysicalDevice& physical_device) 
 {
@@ -62,7 +40,8 @@ Renderer::Renderer(Device* device,
                    const VkImage depthbuffer_image,
                    const VkDeviceMemory depthbuffer_memory,
                    const VkImageView depthbuffer_view,
-                   const VkFormat depthbuffer_format
+                   const VkFormat depthbuffer_format,
+                   const PhaseTimings startup_timings
                    )
     : m_device(device)
     , m_window(window)
@@ -79,6 +58,8 @@ Renderer::Renderer(Device* device,
     , m_depthbuffer_memory(depthbuffer_memory)
     , m_depthbuffer_view(depthbuffer_view)
     , m_depthbuffer_format(depthbuffer_format)
+
+    , m_startup_timings(startup_timings)
 {
     if (!m_device)
         throw std::runtime_error("Renderer() device was nullptr!");
@@ -153,6 +134,11 @@ VkExtent2D Renderer::window_size() const
     return size;
 }
     
+const PhaseTimings& Renderer::startup_timings() const
+{
+    return m_startup_timings;
+}
+    
 const VkSwapchainKHR& Renderer::swapchain() const
 {
     return m_swapchain;
@@ -198,24 +184,47 @@ Renderer Renderer::Builder::produce()
               << std::endl;
 
     const auto capabilities = m_device->capabilities();
+    PhaseTimings timings{};
+
+    /* ===========================================================================
+     * Reuse the window the device was selected for, or create a new one
+     */
+    auto window = m_device->window();
+    VkSurfaceKHR window_surface = m_device->window_surface();
+    uint32_t window_width = m_window_width;
+    uint32_t window_height = m_window_height;
 
-    auto window = SDL_CreateWindow(m_window_name.c_str(),
-                                   SDL_WINDOWPOS_UNDEFINED,
-                                   SDL_WINDOWPOS_UNDEFINED,
-                                   m_window_width,
-                                   m_window_height,
-                                   m_window_flags | SDL_WINDOW_VULKAN);
+    if (window) {
+        int width, height;
+        SDL_Vulkan_GetDrawableSize(window, &width, &height);
+        window_width = static_cast<uint32_t>(width);
+        window_height = static_cast<uint32_t>(height);
+    }
+    else {
+        window = time_phase(timings, "create_window", [&] {
+            return SDL_CreateWindow(m_window_name.c_str(),
+                                    SDL_WINDOWPOS_UNDEFINED,
+                                    SDL_WINDOWPOS_UNDEFINED,
+                                    window_width,
+                                    window_height,
+                                    m_window_flags | SDL_WINDOW_VULKAN);
+        });
+        if (!window)
+            throw std::runtime_error("Could not create window!");
    
-    VkSurfaceKHR window_surface;
-    SDL_Vulkan_CreateSurface(window,
-                             m_device->instance(), 
-                             &window_surface);
+        time_phase(timings, "create_surface", [&] {
+            if (!SDL_Vulkan_CreateSurface(window, m_device->instance(), &window_surface))
+                throw std::runtime_error("Could not create window surface!");
+        });
+    }
     
-    const auto swap_chain = create_swap_chain(m_device->physical_device(),
-                                              m_device->logical_device(),
-                                              window_surface,
-                                              m_window_width,
-                                              m_window_height);
+    const auto swap_chain = time_phase(timings, "create_swap_chain", [&] {
+        return create_swap_chain(m_device->physical_device(),
+                                 m_device->logical_device(),
+                                 window_surface,
+                                 window_width,
+                                 window_height);
+    });
     
     const auto queue_families = get_queue_families(m_device->physical_device());
     const auto indices = find_graphics_present_indices(queue_families,
@@ -238,29 +247,33 @@ Renderer Renderer::Builder::produce()
     VkImage depthbuffer_image{};
     VkDeviceMemory depthbuffer_memory{};
     
-    create_image(m_device->physical_device(),
-                 m_device->logical_device(),
-                 m_window_width,
-                 m_window_height,
-                 *depthbuffer_format,
-                 VK_IMAGE_TILING_OPTIMAL,
-                 VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                 depthbuffer_image,
-                 depthbuffer_memory);
+    const auto depthbuffer_view = time_phase(timings, "create_depth_buffer", [&] {
+        create_image(m_device->physical_device(),
+                     m_device->logical_device(),
+                     window_width,
+                     window_height,
+                     *depthbuffer_format,
+                     VK_IMAGE_TILING_OPTIMAL,
+                     VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                     depthbuffer_image,
+                     depthbuffer_memory);
     
-    auto depthbuffer_view = create_image_view(m_device->logical_device(),
-                                              depthbuffer_image,
-                                              *depthbuffer_format,
-                                              VK_IMAGE_ASPECT_DEPTH_BIT);
+        return create_image_view(m_device->logical_device(),
+                                 depthbuffer_image,
+                                 *depthbuffer_format,
+                                 VK_IMAGE_ASPECT_DEPTH_BIT);
+    });
     if (!depthbuffer_view)
         throw std::runtime_error("Could not create depth buffer view!");
 
+    std::cout << "Renderer startup timings:\n" << stringify(timings);
+
     return Renderer(m_device,
                     window,
                     window_surface,
-                    m_window_width,
-                    m_window_height,
+                    window_width,
+                    window_height,
                     swap_chain.swap_chain,
                     swap_chain.image_views,
                     swap_chain.surface_format,
@@ -270,7 +283,8 @@ Renderer Renderer::Builder::produce()
                     depthbuffer_image,
                     depthbuffer_memory,
                     *depthbuffer_view,
-                    *depthbuffer_format
+                    *depthbuffer_format,
+                    timings
                     );
 }
    
@@ -0,0 +1,84 @@
+#include "../arc/SamplerCache.hpp"
+#include "../arc/Algorithm.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace ArcGraphics {
+
+SamplerCache::SamplerCache(const VkPhysicalDevice physical_device, const VkDevice logical_device)
+    : m_logical_device(logical_device)
+    , m_max_anisotropy(get_physical_device_properties(physical_device).limits.maxSamplerAnisotropy)
+{
+}
+
+[[nodiscard]]
+static uint32_t float_bits(const float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+SamplerCache::Key SamplerCache::make_key(const VkSamplerCreateInfo& info)
+{
+    return {
+        static_cast<uint32_t>(info.flags),
+        static_cast<uint32_t>(info.magFilter),
+        static_cast<uint32_t>(info.minFilter),
+        static_cast<uint32_t>(info.mipmapMode),
+        static_cast<uint32_t>(info.addressModeU),
+        static_cast<uint32_t>(info.addressModeV),
+        static_cast<uint32_t>(info.addressModeW),
+        float_bits(info.mipLodBias),
+        static_cast<uint32_t>(info.anisotropyEnable),
+        float_bits(info.maxAnisotropy),
+        static_cast<uint32_t>(info.compareEnable),
+        static_cast<uint32_t>(info.compareOp),
+        float_bits(info.minLod),
+        float_bits(info.maxLod),
+        static_cast<uint32_t>(info.borderColor),
+        static_cast<uint32_t>(info.unnormalizedCoordinates),
+    };
+}
+
+VkSampler SamplerCache::get(const VkSamplerCreateInfo& info)
+{
+    if (info.pNext)
+        throw std::invalid_argument("Samplers with a pNext chain can not be cached!");
+
+    VkSamplerCreateInfo clamped = info;
+    clamped.maxAnisotropy = std::min(info.maxAnisotropy, m_max_anisotropy);
+    // Anisotropy is ignored when disabled, so it should not split the cache.
+    if (!clamped.anisotropyEnable)
+        clamped.maxAnisotropy = 1.0f;
+    const auto key = make_key(clamped);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_samplers.find(key);
+    if (it != m_samplers.end())
+        return it->second;
+
+    VkSampler sampler{};
+    if (vkCreateSampler(m_logical_device, &clamped, nullptr, &sampler) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create cached sampler!");
+    m_samplers.emplace(key, sampler);
+    return sampler;
+}
+
+size_t SamplerCache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_samplers.size();
+}
+
+void SamplerCache::destroy()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& [key, sampler]: m_samplers)
+        vkDestroySampler(m_logical_device, sampler, nullptr);
+    m_samplers.clear();
+}
+
+}
@@ -1,5 +1,11 @@
 #include "../arc/SimpleGeometry.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+
 namespace ArcGraphics {
     
 VkVertexInputBindingDescription Vertex_PosTex::get_binding_description() {
@@ -114,4 +120,329 @@ create_unit_cube()
 }
     
 
+static constexpr float pi = 3.14159265358979f;
+
+/**
+ * @brief Append two triangles per quad of a (columns + 1) x (rows + 1) grid of vertices.
+ * Columns run along the first surface parameter and rows along the second, so the
+ * triangles face along the cross product of the two.
+ */
+static void append_grid_indices(IndexBuffer::vector_type& indices,
+                                const uint32_t first_vertex,
+                                const uint32_t columns,
+                                const uint32_t rows)
+{
+    const uint32_t stride = columns + 1;
+    const size_t offset = indices.size();
+    indices.resize(offset + size_t(columns) * rows * 6);
+    uint32_t* out = indices.data() + offset;
+    for (uint32_t row = 0; row < rows; row++) {
+        const uint32_t row_start = first_vertex + row * stride;
+        for (uint32_t column = 0; column < columns; column++) {
+            const uint32_t a = row_start + column;
+            out[0] = a;
+            out[1] = a + 1;
+            out[2] = a + 1 + stride;
+            out[3] = a + 1 + stride;
+            out[4] = a + stride;
+            out[5] = a;
+            out += 6;
+        }
+    }
+}
+
+/**
+ * @brief Sample cos and sin at count + 1 evenly spaced angles over [0, range].
+ * The last sample repeats the first for full turns, so seams are exact.
+ */
+static void sample_circle(const uint32_t count,
+                          const float range,
+                          std::vector<float>& cosines,
+                          std::vector<float>& sines)
+{
+    cosines.resize(count + 1);
+    sines.resize(count + 1);
+    for (uint32_t i = 0; i <= count; i++) {
+        const float angle = range * float(i) / float(count);
+        cosines[i] = std::cos(angle);
+        sines[i] = std::sin(angle);
+    }
+}
+
+Geometry create_grid(const uint32_t columns, const uint32_t rows)
+{
+    if (columns == 0 || rows == 0)
+        throw std::invalid_argument("Grid needs at least one column and row!");
+
+    // Positions along a row only depend on the column, so rows are filled from a table.
+    const uint32_t stride = columns + 1;
+    std::vector<float> us(stride);
+    for (uint32_t column = 0; column <= columns; column++)
+        us[column] = float(column) / float(columns);
+
+    VertexBuffer_PosTex::vector_type vertices(size_t(stride) * (rows + 1));
+    for (uint32_t row = 0; row <= rows; row++) {
+        const float v = float(row) / float(rows);
+        Vertex_PosTex* out = vertices.data() + size_t(row) * stride;
+        for (uint32_t column = 0; column <= columns; column++)
+            out[column] = {{us[column] - 0.5f, v - 0.5f, 0.0f}, {us[column], v}};
+    }
+
+    IndexBuffer::vector_type indices{};
+    append_grid_indices(indices, 0, columns, rows);
+    return {std::move(vertices), std::move(indices)};
+}
+
+Geometry create_uv_sphere(const uint32_t segments, const uint32_t rings)
+{
+    if (segments < 3 || rings < 2)
+        throw std::invalid_argument("UV sphere needs at least 3 segments and 2 rings!");
+
+    // Trigonometry is evaluated once per segment and ring rather than per vertex.
+    std::vector<float> segment_cos, segment_sin, ring_cos, ring_sin;
+    sample_circle(segments, 2.0f * pi, segment_cos, segment_sin);
+    sample_circle(rings, pi, ring_cos, ring_sin);
+
+    const uint32_t stride = segments + 1;
+    VertexBuffer_PosTex::vector_type vertices(size_t(stride) * (rings + 1));
+    for (uint32_t ring = 0; ring <= rings; ring++) {
+        const float radius = 0.5f * ring_sin[ring];
+        const float y = -0.5f * ring_cos[ring];
+        const float v = float(ring) / float(rings);
+        Vertex_PosTex* out = vertices.data() + size_t(ring) * stride;
+        for (uint32_t segment = 0; segment <= segments; segment++)
+            out[segment] = {{radius * segment_cos[segment], y, -radius * segment_sin[segment]},
+                            {float(segment) / float(segments), v}};
+    }
+
+    IndexBuffer::vector_type indices{};
+    append_grid_indices(indices, 0, segments, rings);
+    return {std::move(vertices), std::move(indices)};
+}
+
+Geometry create_icosphere(const uint32_t subdivisions)
+{
+    // Subdivision n has 10 * 4^n + 2 vertices, so 32 bit indices would allow up to
+    // n = 14 (about 2.7e9 vertices). The cap is memory: each subdivision quadruples the
+    // mesh, and n = 10 already takes about 21M triangles and 500MB of vertices and indices.
+    if (subdivisions > 10)
+        throw std::invalid_argument("Icosphere can be subdivided at most 10 times!");
+
+    const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+    std::vector<glm::vec3> positions = {
+        {-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0},
+        {0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t},
+        {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1},
+    };
+    for (auto& position: positions)
+        position = glm::normalize(position);
+
+    std::vector<std::array<uint32_t, 3>> faces = {
+        {0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11},
+        {1, 5, 9}, {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+        {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9},
+        {4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1},
+    };
+
+    for (uint32_t level = 0; level < subdivisions; level++) {
+        std::map<std::pair<uint32_t, uint32_t>, uint32_t> midpoints{};
+        const auto midpoint = [&](const uint32_t a, const uint32_t b) {
+            const auto key = std::minmax(a, b);
+            const auto [it, inserted] = midpoints.try_emplace(key, uint32_t(positions.size()));
+            if (inserted)
+                positions.push_back(glm::normalize(positions[a] + positions[b]));
+            return it->second;
+        };
+        std::vector<std::array<uint32_t, 3>> split{};
+        split.reserve(faces.size() * 4);
+        for (const auto& [a, b, c]: faces) {
+            const uint32_t ab = midpoint(a, b);
+            const uint32_t bc = midpoint(b, c);
+            const uint32_t ca = midpoint(c, a);
+            split.push_back({a, ab, ca});
+            split.push_back({b, bc, ab});
+            split.push_back({c, ca, bc});
+            split.push_back({ab, bc, ca});
+        }
+        faces = std::move(split);
+    }
+
+    VertexBuffer_PosTex::vector_type vertices(positions.size());
+    for (size_t i = 0; i < positions.size(); i++) {
+        const auto& p = positions[i];
+        const float u = 0.5f + std::atan2(-p.z, p.x) / (2.0f * pi);
+        const float v = std::acos(std::clamp(-p.y, -1.0f, 1.0f)) / pi;
+        vertices[i] = {p * 0.5f, {u, v}};
+    }
+
+    // Triangles crossing the seam get copies of their low u vertices shifted by one
+    // turn, so the texture does not wrap backwards across them.
+    std::map<uint32_t, uint32_t> wrapped{};
+    IndexBuffer::vector_type indices{};
+    indices.reserve(faces.size() * 3);
+    for (auto face: faces) {
+        const float u0 = vertices[face[0]].uv.x;
+        const float u1 = vertices[face[1]].uv.x;
+        const float u2 = vertices[face[2]].uv.x;
+        if (std::max({u0, u1, u2}) - std::min({u0, u1, u2}) > 0.5f) {
+            for (auto& index: face) {
+                if (vertices[index].uv.x >= 0.5f)
+                    continue;
+                const auto [it, inserted] = wrapped.try_emplace(index, uint32_t(vertices.size()));
+                if (inserted) {
+                    auto copy = vertices[index];
+                    copy.uv.x += 1.0f;
+                    vertices.push_back(copy);
+                }
+                index = it->second;
+            }
+        }
+        indices.insert(indices.end(), face.begin(), face.end());
+    }
+    return {std::move(vertices), std::move(indices)};
+}
+
+Geometry create_cylinder(const uint32_t segments, const uint32_t height_segments)
+{
+    if (segments < 3 || height_segments == 0)
+        throw std::invalid_argument("Cylinder needs at least 3 segments and 1 height segment!");
+
+    std::vector<float> segment_cos, segment_sin;
+    sample_circle(segments, 2.0f * pi, segment_cos, segment_sin);
+
+    const uint32_t stride = segments + 1;
+    VertexBuffer_PosTex::vector_type vertices(size_t(stride) * (height_segments + 1));
+    for (uint32_t row = 0; row <= height_segments; row++) {
+        const float v = float(row) / float(height_segments);
+        Vertex_PosTex* out = vertices.data() + size_t(row) * stride;
+        for (uint32_t segment = 0; segment <= segments; segment++)
+            out[segment] = {{0.5f * segment_cos[segment], v - 0.5f, -0.5f * segment_sin[segment]},
+                            {float(segment) / float(segments), v}};
+    }
+    IndexBuffer::vector_type indices{};
+    append_grid_indices(indices, 0, segments, height_segments);
+
+    // Caps are fans around a center vertex, textured with a planar projection.
+    for (const float y: {-0.5f, 0.5f}) {
+        const auto center = static_cast<uint32_t>(vertices.size());
+        vertices.push_back({{0.0f, y, 0.0f}, {0.5f, 0.5f}});
+        for (uint32_t segment = 0; segment < segments; segment++) {
+            const float x = 0.5f * segment_cos[segment];
+            const float z = -0.5f * segment_sin[segment];
+            vertices.push_back({{x, y, z}, {0.5f + x, 0.5f + z}});
+        }
+        for (uint32_t segment = 0; segment < segments; segment++) {
+            const uint32_t current = center + 1 + segment;
+            const uint32_t next = center + 1 + (segment + 1) % segments;
+            if (y > 0.0f)
+                indices.insert(indices.end(), {center, current, next});
+            else
+                indices.insert(indices.end(), {center, next, current});
+        }
+    }
+    return {std::move(vertices), std::move(indices)};
+}
+
+Geometry create_torus(const uint32_t major_segments,
+                      const uint32_t minor_segments,
+                      const float major_radius,
+                      const float minor_radius)
+{
+    if (major_segments < 3 || minor_segments < 3)
+        throw std::invalid_argument("Torus needs at least 3 segments around both circles!");
+
+    std::vector<float> major_cos, major_sin, minor_cos, minor_sin;
+    sample_circle(major_segments, 2.0f * pi, major_cos, major_sin);
+    sample_circle(minor_segments, 2.0f * pi, minor_cos, minor_sin);
+
+    const uint32_t stride = major_segments + 1;
+    VertexBuffer_PosTex::vector_type vertices(size_t(stride) * (minor_segments + 1));
+    for (uint32_t ring = 0; ring <= minor_segments; ring++) {
+        const float radius = major_radius + minor_radius * minor_cos[ring];
+        const float y = minor_radius * minor_sin[ring];
+        const float v = float(ring) / float(minor_segments);
+        Vertex_PosTex* out = vertices.data() + size_t(ring) * stride;
+        for (uint32_t segment = 0; segment <= major_segments; segment++)
+            out[segment] = {{radius * major_cos[segment], y, -radius * major_sin[segment]},
+                            {float(segment) / float(major_segments), v}};
+    }
+
+    IndexBuffer::vector_type indices{};
+    append_grid_indices(indices, 0, major_segments, minor_segments);
+    return {std::move(vertices), std::move(indices)};
+}
+
+LodGeometry create_lod_chain(const uint32_t level_count,
+                             const std::function<Geometry(const uint32_t level)>& generate)
+{
+    LodGeometry chain{};
+    for (uint32_t level = 0; level < level_count; level++) {
+        const auto [vertices, indices] = generate(level);
+        const auto first_vertex = static_cast<uint32_t>(chain.vertices.size());
+        chain.levels.push_back({static_cast<uint32_t>(chain.indices.size()),
+                                static_cast<uint32_t>(indices.size())});
+        chain.vertices.insert(chain.vertices.end(), vertices.begin(), vertices.end());
+        for (const auto index: indices)
+            chain.indices.push_back(first_vertex + index);
+    }
+    return chain;
+}
+
+uint32_t lod_resolution(const uint32_t resolution, const uint32_t level, const uint32_t minimum)
+{
+    if (level >= 32)
+        return std::min(resolution, minimum);
+    return std::max(resolution >> level, std::min(resolution, minimum));
+}
+
+LodGeometry create_grid_lods(const uint32_t columns, const uint32_t rows, const uint32_t level_count)
+{
+    return create_lod_chain(level_count, [&](const uint32_t level) {
+        return create_grid(lod_resolution(columns, level, 1), lod_resolution(rows, level, 1));
+    });
+}
+
+LodGeometry create_uv_sphere_lods(const uint32_t segments, const uint32_t rings, const uint32_t level_count)
+{
+    return create_lod_chain(level_count, [&](const uint32_t level) {
+        return create_uv_sphere(lod_resolution(segments, level, 3), lod_resolution(rings, level, 2));
+    });
+}
+
+LodGeometry create_icosphere_lods(const uint32_t subdivisions, const uint32_t level_count)
+{
+    return create_lod_chain(level_count, [&](const uint32_t level) {
+        return create_icosphere(level < subdivisions ? subdivisions - level : 0);
+    });
+}
+
+LodGeometry create_cylinder_lods(const uint32_t segments, const uint32_t level_count)
+{
+    return create_lod_chain(level_count, [&](const uint32_t level) {
+        return create_cylinder(lod_resolution(segments, level, 3));
+    });
+}
+
+LodGeometry create_torus_lods(const uint32_t major_segments,
+                              const uint32_t minor_segments,
+                              const uint32_t level_count)
+{
+    return create_lod_chain(level_count, [&](const uint32_t level) {
+        return create_torus(lod_resolution(major_segments, level, 3),
+                            lod_resolution(minor_segments, level, 3));
+    });
+}
+
+uint32_t select_lod(const float distance,
+                    const float radius,
+                    const uint32_t level_count,
+                    const float detail_distance)
+{
+    const float threshold = detail_distance * radius;
+    if (level_count <= 1 || !(threshold > 0.0f) || distance <= threshold)
+        return 0;
+    const float level = std::floor(std::log2(distance / threshold)) + 1.0f;
+    return std::min(static_cast<uint32_t>(std::min(level, 32.0f)), level_count - 1);
+}
+
 }
@@ -0,0 +1,70 @@
+#include "../arc/StagingBuffer.hpp"
+#include "../arc/BasicBuffer.hpp"
+
+#include <stdexcept>
+
+namespace ArcGraphics {
+
+StagingBuffer::StagingBuffer(const VkPhysicalDevice& physical_device,
+                             const VkDevice& logical_device,
+                             const VkDeviceSize capacity)
+    : m_capacity(capacity)
+{
+    VkBufferCreateInfo buffer_info;
+    create_buffer(physical_device,
+                  logical_device,
+                  capacity,
+                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                  | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                  buffer_info,
+                  m_buffer,
+                  m_memory);
+
+    void* mapping = nullptr;
+    if (vkMapMemory(logical_device, m_memory, 0, capacity, 0, &mapping) != VK_SUCCESS) {
+        vkDestroyBuffer(logical_device, m_buffer, nullptr);
+        vkFreeMemory(logical_device, m_memory, nullptr);
+        throw std::runtime_error("Failed to map staging buffer!");
+    }
+    m_mapping = static_cast<unsigned char*>(mapping);
+}
+
+std::optional<StagingRegion> StagingBuffer::allocate(const VkDeviceSize size,
+                                                     const VkDeviceSize alignment)
+{
+    const VkDeviceSize offset = (m_head + alignment - 1) / alignment * alignment;
+    if (offset > m_capacity || size > m_capacity - offset)
+        return std::nullopt;
+    m_head = offset + size;
+    return StagingRegion{offset, size, m_mapping + offset};
+}
+
+void StagingBuffer::release(const StagingRegion& region)
+{
+    if (region.offset + region.size == m_head)
+        m_head = region.offset;
+}
+
+void StagingBuffer::reset()
+{
+    m_head = 0;
+}
+
+const VkBuffer& StagingBuffer::buffer() const { return m_buffer; }
+VkDeviceSize StagingBuffer::capacity() const { return m_capacity; }
+VkDeviceSize StagingBuffer::used() const { return m_head; }
+
+void StagingBuffer::destroy(const VkDevice logical_device)
+{
+    if (m_mapping)
+        vkUnmapMemory(logical_device, m_memory);
+    m_mapping = nullptr;
+    vkDestroyBuffer(logical_device, m_buffer, nullptr);
+    vkFreeMemory(logical_device, m_memory, nullptr);
+    m_buffer = VK_NULL_HANDLE;
+    m_memory = VK_NULL_HANDLE;
+    m_head = 0;
+}
+
+}
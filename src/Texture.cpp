@@ -1,10 +1,21 @@
 #include "../arc/Texture.hpp"
 #include "../arc/BasicBuffer.hpp"
 #include "../arc/Algorithm.hpp"
+#include "../arc/MappedFile.hpp"
 
 #include <stb/stb_image.h>
 
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <new>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace ArcGraphics {
     
@@ -27,16 +38,25 @@ Image::~Image()
     stbi_image_free(m_pixels);
 }
 
-std::unique_ptr<Image> Image::load_from_path(const std::string& path)
+std::unique_ptr<Image> Image::load_from_path(const std::string& path,
+                                             const int desired_channels)
 {
     int width;
     int height;
-    int channels;
+    int channels = desired_channels;
+    if (channels == 0) {
+        if (!stbi_info(path.c_str(), &width, &height, &channels))
+            return nullptr;
+        if (channels == STBI_rgb)
+            channels = STBI_rgb_alpha;
+    }
+
+    int source_channels;
     const auto pixels = stbi_load(path.c_str(),
                                   &width,
                                   &height,
-                                  &channels,
-                                  STBI_rgb_alpha);
+                                  &source_channels,
+                                  channels);
     if (!pixels)
         return nullptr;
     
@@ -46,8 +66,90 @@ std::unique_ptr<Image> Image::load_from_path(const std::string& path)
 
 VkDeviceSize Image::device_size() const
 {
-    const auto channels_size = 4; // TODO: this should be dynamic and based on the formatting of the image
-    return m_width * m_height * channels_size;
+    return VkDeviceSize(m_width) * m_height * m_channels;
+}
+
+std::unique_ptr<Image> expand_channels(const Image& image, const int channels)
+{
+    const int source_channels = image.channels();
+    if (channels < source_channels || channels > 4)
+        throw std::invalid_argument("Images can only be expanded to at most 4 channels!");
+
+    const size_t pixel_count = size_t(image.width()) * image.height();
+    // Allocated with malloc, since Image frees its pixels with stbi_image_free.
+    auto pixels = static_cast<unsigned char*>(malloc(pixel_count * channels));
+    if (!pixels)
+        throw std::bad_alloc();
+
+    const unsigned char* src = image.pixels();
+    for (size_t i = 0; i < pixel_count; i++) {
+        const unsigned char* in = src + i * source_channels;
+        unsigned char* out = pixels + i * channels;
+        unsigned char rgba[4] = {0, 0, 0, 255};
+        if (source_channels <= 2) {
+            // Gray and gray-alpha, gray is replicated to RGB.
+            rgba[0] = rgba[1] = rgba[2] = in[0];
+            if (source_channels == 2)
+                rgba[3] = in[1];
+            // Gray keeps its alpha in the second channel of two channel output.
+            if (channels == 2)
+                rgba[1] = rgba[3];
+        } else {
+            for (int c = 0; c < source_channels; c++)
+                rgba[c] = in[c];
+        }
+        memcpy(out, rgba, channels);
+    }
+    return std::make_unique<Image>(pixels, image.width(), image.height(), channels);
+}
+
+std::optional<ImageFormat> find_image_format(const VkPhysicalDevice& physical_device,
+                                             const int channels,
+                                             const bool srgb)
+{
+    const auto rgba = ImageFormat{srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM, 4};
+    std::vector<ImageFormat> candidates{};
+    switch (channels) {
+    case 1:
+        candidates = {{srgb ? VK_FORMAT_R8_SRGB : VK_FORMAT_R8_UNORM, 1}, rgba};
+        break;
+    case 2:
+        candidates = {{srgb ? VK_FORMAT_R8G8_SRGB : VK_FORMAT_R8G8_UNORM, 2}, rgba};
+        break;
+    case 3:
+    case 4:
+        candidates = {rgba};
+        break;
+    default:
+        return std::nullopt;
+    }
+
+    for (const auto& candidate: candidates) {
+        const auto supported = find_supported_texture_format(physical_device,
+                                                             {candidate.format},
+                                                             VK_IMAGE_TILING_OPTIMAL,
+                                                             VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+        if (supported)
+            return candidate;
+    }
+    return std::nullopt;
+}
+
+VkComponentMapping texture_swizzle(const VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_SRGB:
+        return {VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ONE};
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R8G8_SRGB:
+        return {VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G};
+    default:
+        return {VK_COMPONENT_SWIZZLE_IDENTITY,
+                VK_COMPONENT_SWIZZLE_IDENTITY,
+                VK_COMPONENT_SWIZZLE_IDENTITY,
+                VK_COMPONENT_SWIZZLE_IDENTITY};
+    }
 }
 
 int Image::width() const { return m_width; }
@@ -101,19 +203,26 @@ Texture::Texture(const VkImage image,
                  const VkDeviceMemory memory,
                  const VkFormat format,
                  const VkImageView view,
-                 const VkSampler sampler
+                 const VkSampler sampler,
+                 const uint32_t mip_levels,
+                 const uint32_t array_layers,
+                 const bool owns_sampler
                  )
     : m_image(image)
     , m_memory(memory)
     , m_format(format)
     , m_view(view)
     , m_sampler(sampler)
+    , m_mip_levels(mip_levels)
+    , m_array_layers(array_layers)
+    , m_owns_sampler(owns_sampler)
 {
 }
 
 void Texture::destroy(const VkDevice logical_device)
 {
-    vkDestroySampler(logical_device, m_sampler, nullptr);
+    if (m_owns_sampler)
+        vkDestroySampler(logical_device, m_sampler, nullptr);
     vkDestroyImageView(logical_device, m_view, nullptr);
     vkDestroyImage(logical_device, m_image, nullptr);
     vkFreeMemory(logical_device, m_memory, nullptr);
@@ -147,35 +256,594 @@ const VkSampler& Texture::sampler()
     return m_sampler;
 }
 
+uint32_t Texture::mip_levels()
+{
+    return m_mip_levels;
+}
+
+uint32_t Texture::array_layers()
+{
+    return m_array_layers;
+}
+
    
+VkSamplerCreateInfo texture_sampler_info(const VkPhysicalDevice& physical_device,
+                                         const float max_lod)
+{
+    VkSamplerCreateInfo sampler_info{};
+    sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    //TODO: Make it possible to change interpolation to bilinear as well as others..
+    sampler_info.magFilter = VK_FILTER_LINEAR;
+    sampler_info.minFilter = VK_FILTER_LINEAR;
+    //TODO: Make it possible to change address_modes..
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+
+    const auto device_properties = get_physical_device_properties(physical_device);
+    // TODO: It should be possible to make this an optional thing, if this change is made
+    // Remove the forced selection of physical devices in calculate_device_score()
+
+    sampler_info.anisotropyEnable = VK_TRUE;
+    sampler_info.maxAnisotropy = device_properties.limits.maxSamplerAnisotropy;
+    sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    sampler_info.unnormalizedCoordinates = VK_FALSE;
+    sampler_info.compareEnable = VK_FALSE;
+    sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
+    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    sampler_info.mipLodBias = 0.0f;
+    sampler_info.minLod = 0.0f;
+    sampler_info.maxLod = max_lod;
+    return sampler_info;
+}
+
+VkSampler create_texture_sampler(const VkPhysicalDevice& physical_device,
+                                 const VkDevice& logical_device,
+                                 const uint32_t mip_levels)
+{
+    const auto sampler_info = texture_sampler_info(physical_device,
+                                                   static_cast<float>(mip_levels));
+    VkSampler sampler{};
+    const auto status = vkCreateSampler(logical_device, &sampler_info, nullptr, &sampler);
+    if (status != VK_SUCCESS)
+        throw std::runtime_error("Failed to create texture sampler!");
+    return sampler;
+}
+
+VkSampler get_texture_sampler(const VkPhysicalDevice& physical_device,
+                              const VkDevice& logical_device,
+                              const uint32_t mip_levels,
+                              SamplerCache* samplers)
+{
+    if (!samplers)
+        return create_texture_sampler(physical_device, logical_device, mip_levels);
+    // The view already limits the levels, so one sampler serves every mip count.
+    return samplers->get(texture_sampler_info(physical_device));
+}
+
+uint32_t mip_level_count(const uint32_t width, const uint32_t height)
+{
+    uint32_t levels = 1;
+    for (auto size = std::max(width, height); size > 1; size /= 2)
+        levels++;
+    return levels;
+}
+
+bool supports_linear_blit(const VkPhysicalDevice& physical_device, const VkFormat format)
+{
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physical_device, format, &properties);
+    const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT
+                                        | VK_FORMAT_FEATURE_BLIT_DST_BIT
+                                        | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (properties.optimalTilingFeatures & required) == required;
+}
+
+void downsample_box(const unsigned char* src,
+                    const uint32_t width,
+                    const uint32_t height,
+                    const uint32_t bytes_per_pixel,
+                    unsigned char* dst)
+{
+    const uint32_t dst_width = std::max(width / 2, 1u);
+    const uint32_t dst_height = std::max(height / 2, 1u);
+    const size_t src_stride = size_t(width) * bytes_per_pixel;
+
+    // For odd sizes the last destination row and column also take in the last
+    // source row and column, which a plain 2x2 box would drop.
+    const bool odd_width = width > 1 && width % 2 == 1;
+    const bool odd_height = height > 1 && height % 2 == 1;
+    const uint32_t box_columns = odd_width ? dst_width - 1 : dst_width;
+
+    for (uint32_t y = 0; y < dst_height; y++) {
+        const uint32_t first_row = std::min(y * 2, height - 1);
+        const uint32_t last_row = (odd_height && y == dst_height - 1)
+            ? height - 1
+            : std::min(y * 2 + 1, height - 1);
+        unsigned char* out = dst + size_t(y) * dst_width * bytes_per_pixel;
+        uint32_t x = 0;
+
+#if defined(__SSE2__)
+        // Four source pixels of both rows become two destination pixels per iteration.
+        if (bytes_per_pixel == 4 && width >= 2 && last_row - first_row == 1) {
+            const unsigned char* row0 = src + first_row * src_stride;
+            const unsigned char* row1 = row0 + src_stride;
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i rounding = _mm_set1_epi16(2);
+            for (; x + 2 <= box_columns && (x * 2 + 4) <= width; x += 2) {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+                const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                                                 _mm_unpacklo_epi8(b, zero));
+                const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                                                 _mm_unpackhi_epi8(b, zero));
+                // Sum the horizontal neighbours, leaving one pixel in the low half of each.
+                const __m128i lo_sum = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+                const __m128i hi_sum = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+                const __m128i sum = _mm_unpacklo_epi64(lo_sum, hi_sum);
+                const __m128i average = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x * 4),
+                                 _mm_packus_epi16(average, zero));
+            }
+        }
+#endif
+
+        for (; x < dst_width; x++) {
+            const uint32_t first_column = std::min(x * 2, width - 1);
+            const uint32_t last_column = (odd_width && x == dst_width - 1)
+                ? width - 1
+                : std::min(x * 2 + 1, width - 1);
+            // Sizes of 1 repeat the single row or column, like clamped sampling.
+            const uint32_t rows = std::max(last_row - first_row + 1, 2u);
+            const uint32_t columns = std::max(last_column - first_column + 1, 2u);
+            const uint32_t count = rows * columns;
+            for (uint32_t c = 0; c < bytes_per_pixel; c++) {
+                uint32_t sum = 0;
+                for (uint32_t i = 0; i < rows; i++) {
+                    const unsigned char* row = src + std::min(first_row + i, height - 1) * src_stride;
+                    for (uint32_t j = 0; j < columns; j++)
+                        sum += row[size_t(std::min(first_column + j, width - 1)) * bytes_per_pixel + c];
+                }
+                out[x * bytes_per_pixel + c] = static_cast<unsigned char>((sum + count / 2) / count);
+            }
+        }
+    }
+}
+
+MipChain generate_mip_chain(const Image& image, const uint32_t mip_levels)
+{
+    MipChain chain{};
+    auto width = static_cast<uint32_t>(image.width());
+    auto height = static_cast<uint32_t>(image.height());
+    const auto bytes_per_pixel = static_cast<uint32_t>(image.device_size() / (VkDeviceSize(width) * height));
+
+    VkDeviceSize size = 0;
+    for (uint32_t level = 1, w = width, h = height; level < mip_levels; level++) {
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+        // Buffer to image copies need offsets that are a multiple of 4.
+        size = (size + 3) / 4 * 4;
+        chain.offsets.push_back(size);
+        size += VkDeviceSize(w) * h * bytes_per_pixel;
+    }
+    chain.pixels.resize(size);
+
+    const unsigned char* src = image.pixels();
+    for (uint32_t level = 1; level < mip_levels; level++) {
+        unsigned char* dst = chain.pixels.data() + chain.offsets[level - 1];
+        downsample_box(src, width, height, bytes_per_pixel, dst);
+        src = dst;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    return chain;
+}
+
+void record_texture_upload(VkCommandBuffer command_buffer,
+                           VkBuffer staging_buffer,
+                           const std::vector<VkDeviceSize>& level_offsets,
+                           VkImage image,
+                           const uint32_t width,
+                           const uint32_t height,
+                           const uint32_t mip_levels,
+                           const uint32_t layer_count)
+{
+    const auto staged_levels = static_cast<uint32_t>(level_offsets.size());
+
+    record_transition_image_layout(command_buffer,
+                                   image,
+                                   VK_IMAGE_LAYOUT_UNDEFINED,
+                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   0,
+                                   mip_levels,
+                                   layer_count);
+
+    const auto level_extent = [&](const uint32_t level) {
+        return std::pair<int32_t, int32_t>{std::max<int32_t>(width >> level, 1),
+                                           std::max<int32_t>(height >> level, 1)};
+    };
+
+    for (uint32_t level = 0; level < mip_levels; level++) {
+        const auto [level_width, level_height] = level_extent(level);
+        if (level < staged_levels) {
+            record_copy_buffer_to_image(command_buffer,
+                                        staging_buffer,
+                                        level_offsets[level],
+                                        image,
+                                        static_cast<uint32_t>(level_width),
+                                        static_cast<uint32_t>(level_height),
+                                        level,
+                                        layer_count);
+            continue;
+        }
+
+        // The level above is done being written, and is read by the blit.
+        record_transition_image_layout(command_buffer,
+                                       image,
+                                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                       VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                       level - 1,
+                                       1,
+                                       layer_count);
+
+        const auto [src_width, src_height] = level_extent(level - 1);
+        VkImageBlit blit{};
+        blit.srcOffsets[0] = {0, 0, 0};
+        blit.srcOffsets[1] = {src_width, src_height, 1};
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = level - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = layer_count;
+        blit.dstOffsets[0] = {0, 0, 0};
+        blit.dstOffsets[1] = {level_width, level_height, 1};
+        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel = level;
+        blit.dstSubresource.baseArrayLayer = 0;
+        blit.dstSubresource.layerCount = layer_count;
+        vkCmdBlitImage(command_buffer,
+                       image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       1, &blit,
+                       VK_FILTER_LINEAR);
+
+        record_transition_image_layout(command_buffer,
+                                       image,
+                                       VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                       level - 1,
+                                       1,
+                                       layer_count);
+    }
+
+    // Blitted levels above the last one were already transitioned as they were read.
+    const uint32_t first_remaining = staged_levels < mip_levels ? mip_levels - 1 : 0;
+    record_transition_image_layout(command_buffer,
+                                   image,
+                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                   first_remaining,
+                                   mip_levels - first_remaining,
+                                   layer_count);
+}
+
 std::unique_ptr<Texture> Texture::create_staging(const VkPhysicalDevice& physical_device,
                                                  const VkDevice& logical_device,
                                                  const VkCommandPool& command_pool,
                                                  const VkQueue& graphics_queue,
                                                  const VkFormat format,
-                                                 const Image* image)
+                                                 const Image* image,
+                                                 const bool generate_mipmaps,
+                                                 SamplerCache* samplers)
+{
+    if (!image) return nullptr;
+
+    const auto width = static_cast<uint32_t>(image->width());
+    const auto height = static_cast<uint32_t>(image->height());
+    const uint32_t mip_levels = generate_mipmaps ? mip_level_count(width, height) : 1;
+
+    // Without linear blits the levels are filtered on the CPU and staged with level 0.
+    MipChain cpu_levels{};
+    if (mip_levels > 1 && !supports_linear_blit(physical_device, format))
+        cpu_levels = generate_mip_chain(*image, mip_levels);
+
+    // Copy offsets must be a multiple of 4, which level 0 of R8 images may not end on.
+    const VkDeviceSize chain_offset = (image->device_size() + 3) / 4 * 4;
+    std::vector<VkDeviceSize> level_offsets{0};
+    for (const auto offset: cpu_levels.offsets)
+        level_offsets.push_back(chain_offset + offset);
+    const VkDeviceSize staging_size = chain_offset + cpu_levels.pixels.size();
+
+    VkBuffer staging_buffer;
+    VkBufferCreateInfo staging_buffer_info;
+    VkDeviceMemory staging_buffer_memory;
+    create_buffer(physical_device,
+                  logical_device,
+                  staging_size,
+                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT 
+                  | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                  staging_buffer_info,
+                  staging_buffer,
+                  staging_buffer_memory);
+
+    const auto fill_staging = [&](void* mapping) {
+        auto dst = static_cast<unsigned char*>(mapping);
+        memcpy(dst, image->pixels(), image->device_size());
+        if (!cpu_levels.pixels.empty())
+            memcpy(dst + chain_offset, cpu_levels.pixels.data(), cpu_levels.pixels.size());
+    };
+    with_memory_mapping(logical_device, staging_size, staging_buffer_memory, fill_staging);
+
+    VkImage texture{};
+    VkDeviceMemory texture_memory;
+    // The blit chain reads from the texture itself, so it must be a transfer source too.
+    try {
+        create_image(physical_device,
+                     logical_device,
+                     width,
+                     height,
+                     format,
+                     VK_IMAGE_TILING_OPTIMAL,
+                     VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+                     | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+                     | VK_IMAGE_USAGE_SAMPLED_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                     texture,
+                     texture_memory,
+                     mip_levels);
+    } catch (const OutOfDeviceMemory&) {
+        vkDestroyBuffer(logical_device, staging_buffer, nullptr);
+        vkFreeMemory(logical_device, staging_buffer_memory, nullptr);
+        throw;
+    }
+
+    // Every level is copied or blitted and transitioned in the same command buffer.
+    const auto record_upload = [&](VkCommandBuffer& command_buffer) {
+        record_texture_upload(command_buffer,
+                              staging_buffer,
+                              level_offsets,
+                              texture,
+                              width,
+                              height,
+                              mip_levels);
+    };
+    with_single_use_command_buffer(logical_device,
+                                   command_pool,
+                                   graphics_queue,
+                                   record_upload);
+    
+    vkDestroyBuffer(logical_device, staging_buffer, nullptr);
+    vkFreeMemory(logical_device, staging_buffer_memory, nullptr);
+    
+    const auto view = create_image_view(logical_device,
+                                        texture,
+                                        format,
+                                        VK_IMAGE_ASPECT_COLOR_BIT,
+                                        mip_levels,
+                                        1,
+                                        VK_IMAGE_VIEW_TYPE_2D,
+                                        texture_swizzle(format));
+    if (!view)
+        return nullptr;
+    
+    const auto sampler = get_texture_sampler(physical_device, logical_device, mip_levels, samplers);
+   
+    return std::make_unique<Texture>(texture,
+                                     texture_memory,
+                                     format,
+                                     *view,
+                                     sampler,
+                                     mip_levels,
+                                     1,
+                                     samplers == nullptr);
+}
+   
+std::unique_ptr<Texture> Texture::create_from_image(const VkPhysicalDevice& physical_device,
+                                                    const VkDevice& logical_device,
+                                                    const VkCommandPool& command_pool,
+                                                    const VkQueue& graphics_queue,
+                                                    const Image* image,
+                                                    const bool srgb,
+                                                    const bool generate_mipmaps,
+                                                    SamplerCache* samplers)
 {
     if (!image) return nullptr;
 
+    const auto format = find_image_format(physical_device, image->channels(), srgb);
+    if (!format)
+        return nullptr;
+
+    if (format->channels == image->channels())
+        return create_staging(physical_device,
+                              logical_device,
+                              command_pool,
+                              graphics_queue,
+                              format->format,
+                              image,
+                              generate_mipmaps,
+                              samplers);
+
+    const auto expanded = expand_channels(*image, format->channels);
+    return create_staging(physical_device,
+                          logical_device,
+                          command_pool,
+                          graphics_queue,
+                          format->format,
+                          expanded.get(),
+                          generate_mipmaps,
+                          samplers);
+}
+
+std::unique_ptr<Texture> Texture::create_array(const VkPhysicalDevice& physical_device,
+                                               const VkDevice& logical_device,
+                                               const VkCommandPool& command_pool,
+                                               const VkQueue& graphics_queue,
+                                               const VkFormat format,
+                                               const std::vector<const Image*>& layers,
+                                               const bool generate_mipmaps,
+                                               SamplerCache* samplers)
+{
+    if (layers.empty() || !layers[0]) return nullptr;
+
+    const auto width = static_cast<uint32_t>(layers[0]->width());
+    const auto height = static_cast<uint32_t>(layers[0]->height());
+    const auto channels = static_cast<uint32_t>(layers[0]->channels());
+    for (const auto layer: layers)
+        if (!layer || layer->width() != layers[0]->width()
+         || layer->height() != layers[0]->height()
+         || layer->channels() != layers[0]->channels())
+            throw std::invalid_argument("Array texture layers must have the same size and channels!");
+
+    const auto layer_count = static_cast<uint32_t>(layers.size());
+    const uint32_t mip_levels = generate_mipmaps ? mip_level_count(width, height) : 1;
+    const bool cpu_mipmaps = mip_levels > 1 && !supports_linear_blit(physical_device, format);
+
+    // Each staged level holds every layer after each other, as one copy region.
+    std::vector<MipChain> cpu_levels(cpu_mipmaps ? layer_count : 0);
+    for (uint32_t layer = 0; layer < cpu_levels.size(); layer++)
+        cpu_levels[layer] = generate_mip_chain(*layers[layer], mip_levels);
+
+    const uint32_t staged_levels = cpu_mipmaps ? mip_levels : 1;
+    std::vector<VkDeviceSize> level_offsets{};
+    std::vector<VkDeviceSize> level_sizes{};
+    VkDeviceSize staging_size = 0;
+    for (uint32_t level = 0; level < staged_levels; level++) {
+        const VkDeviceSize level_size = VkDeviceSize(std::max(width >> level, 1u))
+                                      * std::max(height >> level, 1u) * channels;
+        staging_size = (staging_size + 15) / 16 * 16;
+        level_offsets.push_back(staging_size);
+        level_sizes.push_back(level_size);
+        staging_size += level_size * layer_count;
+    }
+
     VkBuffer staging_buffer;
     VkBufferCreateInfo staging_buffer_info;
     VkDeviceMemory staging_buffer_memory;
+    create_buffer(physical_device,
+                  logical_device,
+                  staging_size,
+                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT 
+                  | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                  staging_buffer_info,
+                  staging_buffer,
+                  staging_buffer_memory);
+
+    const auto fill_staging = [&](void* mapping) {
+        auto dst = static_cast<unsigned char*>(mapping);
+        for (uint32_t level = 0; level < staged_levels; level++) {
+            for (uint32_t layer = 0; layer < layer_count; layer++) {
+                const unsigned char* src = level == 0
+                    ? layers[layer]->pixels()
+                    : cpu_levels[layer].pixels.data() + cpu_levels[layer].offsets[level - 1];
+                memcpy(dst + level_offsets[level] + layer * level_sizes[level],
+                       src,
+                       static_cast<size_t>(level_sizes[level]));
+            }
+        }
+    };
+    with_memory_mapping(logical_device, staging_size, staging_buffer_memory, fill_staging);
 
     VkImage texture{};
     VkDeviceMemory texture_memory;
+    try {
+        create_image(physical_device,
+                     logical_device,
+                     width,
+                     height,
+                     format,
+                     VK_IMAGE_TILING_OPTIMAL,
+                     VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+                     | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+                     | VK_IMAGE_USAGE_SAMPLED_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                     texture,
+                     texture_memory,
+                     mip_levels,
+                     layer_count);
+    } catch (const OutOfDeviceMemory&) {
+        vkDestroyBuffer(logical_device, staging_buffer, nullptr);
+        vkFreeMemory(logical_device, staging_buffer_memory, nullptr);
+        throw;
+    }
+
+    const auto record_upload = [&](VkCommandBuffer& command_buffer) {
+        record_texture_upload(command_buffer,
+                              staging_buffer,
+                              level_offsets,
+                              texture,
+                              width,
+                              height,
+                              mip_levels,
+                              layer_count);
+    };
+    with_single_use_command_buffer(logical_device,
+                                   command_pool,
+                                   graphics_queue,
+                                   record_upload);
+
+    vkDestroyBuffer(logical_device, staging_buffer, nullptr);
+    vkFreeMemory(logical_device, staging_buffer_memory, nullptr);
+
+    const auto view = create_image_view(logical_device,
+                                        texture,
+                                        format,
+                                        VK_IMAGE_ASPECT_COLOR_BIT,
+                                        mip_levels,
+                                        layer_count,
+                                        VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+                                        texture_swizzle(format));
+    if (!view)
+        return nullptr;
+
+    const auto sampler = get_texture_sampler(physical_device, logical_device, mip_levels, samplers);
+
+    return std::make_unique<Texture>(texture,
+                                     texture_memory,
+                                     format,
+                                     *view,
+                                     sampler,
+                                     mip_levels,
+                                     layer_count,
+                                     samplers == nullptr);
+}
+
+/**
+ * @brief Check that images of a block compressed format can be sampled.
+ */
+[[nodiscard]]
+static bool supports_sampling(const VkPhysicalDevice& physical_device, const VkFormat format)
+{
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physical_device, format, &properties);
+    if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)
+        return true;
+    std::cout << "Block compressed format " << format
+              << " is not supported by the device" << std::endl;
+    return false;
+}
+
+std::unique_ptr<Texture> Texture::create_compressed(const VkPhysicalDevice& physical_device,
+                                                    const VkDevice& logical_device,
+                                                    const VkCommandPool& command_pool,
+                                                    const VkQueue& graphics_queue,
+                                                    const CompressedImage* image,
+                                                    SamplerCache* samplers)
+{
+    if (!image) return nullptr;
+
+    const auto format = image->format();
+    if (!supports_sampling(physical_device, format))
+        return nullptr;
 
-    #if 0
-    create_image(physical_device,
-                 logical_device,
-                 static_cast<uint32_t>(image->width()),
-                 static_cast<uint32_t>(image->height()),
-                 format,
-                 VK_IMAGE_TILING_OPTIMAL,
-                 VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                 texture,
-                 staging_buffer_memory);
-    #else
+    const auto mip_levels = static_cast<uint32_t>(image->levels().size());
+    std::vector<VkDeviceSize> level_offsets{};
+    for (const auto& level: image->levels())
+        level_offsets.push_back(level.offset);
+
+    VkBuffer staging_buffer;
+    VkBufferCreateInfo staging_buffer_info;
+    VkDeviceMemory staging_buffer_memory;
     create_buffer(physical_device,
                   logical_device,
                   image->device_size(),
@@ -187,128 +855,249 @@ std::unique_ptr<Texture> Texture::create_staging(const VkPhysicalDevice& physica
                   staging_buffer_memory);
 
     memcopy_to_buffer(logical_device,
-                      image->pixels(),
+                      image->data(),
                       image->device_size(),
                       staging_buffer_memory);
 
-    VkImageCreateInfo image_info{};
-    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    image_info.imageType = VK_IMAGE_TYPE_2D;
-    image_info.extent.width = static_cast<uint32_t>(image->width());
-    image_info.extent.height = static_cast<uint32_t>(image->height());
-    image_info.extent.depth = 1;
-    image_info.mipLevels = 1;
-    image_info.arrayLayers = 1;
-    image_info.format = format;
-    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
-    //VK_IMAGE_TILING_LINEAR:
-    //  Texels are laid out in row-major order like our pixels array
-    //VK_IMAGE_TILING_OPTIMAL:
-    //  Texels are laid out in an implementation defined order for optimal access
-    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    image_info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
-
-    image_info.flags = 0; // Optional
-    
-    auto status = vkCreateImage(logical_device, &image_info, nullptr, &texture);
-    if (status != VK_SUCCESS)
-        throw std::runtime_error("failed to create image!");
-    
-    VkMemoryRequirements mem_requirements;
-    vkGetImageMemoryRequirements(logical_device, texture, &mem_requirements);
-
-    VkMemoryAllocateInfo alloc_info{};
-    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    alloc_info.allocationSize = mem_requirements.size;
-    
-    const auto memory_properties = get_physical_device_memory_properties(physical_device);
-    alloc_info.memoryTypeIndex = find_memory_type(memory_properties,
-                                                  mem_requirements.memoryTypeBits,
-                                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    VkImage texture{};
+    VkDeviceMemory texture_memory;
+    try {
+        create_image(physical_device,
+                     logical_device,
+                     image->width(),
+                     image->height(),
+                     format,
+                     VK_IMAGE_TILING_OPTIMAL,
+                     VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                     texture,
+                     texture_memory,
+                     mip_levels);
+    } catch (const OutOfDeviceMemory&) {
+        vkDestroyBuffer(logical_device, staging_buffer, nullptr);
+        vkFreeMemory(logical_device, staging_buffer_memory, nullptr);
+        throw;
+    }
 
-    status = vkAllocateMemory(logical_device, &alloc_info, nullptr, &texture_memory);
-    if (status != VK_SUCCESS)
-        throw std::runtime_error("failed to allocate image memory!");
+    // Every level is staged, so nothing is blitted.
+    const auto record_upload = [&](VkCommandBuffer& command_buffer) {
+        record_texture_upload(command_buffer,
+                              staging_buffer,
+                              level_offsets,
+                              texture,
+                              image->width(),
+                              image->height(),
+                              mip_levels);
+    };
+    with_single_use_command_buffer(logical_device,
+                                   command_pool,
+                                   graphics_queue,
+                                   record_upload);
 
-    vkBindImageMemory(logical_device, texture, texture_memory, 0);   
-    #endif
-    
-    // First we transition the image into a transfer destination layout.
-    //so we can copy the image buffer to the image 
-    transition_image_layout(logical_device,
-                            command_pool,
-                            graphics_queue,
-                            texture,
-                            format,
-                            VK_IMAGE_LAYOUT_UNDEFINED,
-                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    
-    copy_buffer_to_image(logical_device,
-                         command_pool,
-                         graphics_queue,
-                         staging_buffer,
-                         texture,
-                         image->width(),
-                         image->height()); 
- 
-    // Then we transition the image to shader memory
-    transition_image_layout(logical_device,
-                            command_pool,
-                            graphics_queue,
-                            texture,
-                            format,
-                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    
-    
     vkDestroyBuffer(logical_device, staging_buffer, nullptr);
     vkFreeMemory(logical_device, staging_buffer_memory, nullptr);
-    
+
     const auto view = create_image_view(logical_device,
                                         texture,
                                         format,
-                                        VK_IMAGE_ASPECT_COLOR_BIT);
+                                        VK_IMAGE_ASPECT_COLOR_BIT,
+                                        mip_levels);
     if (!view)
         return nullptr;
-    
-    VkSamplerCreateInfo sampler_info{};
-    sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    //TODO: Make it possible to change interpolation to bilinear as well as others..
-    sampler_info.magFilter = VK_FILTER_LINEAR;
-    sampler_info.minFilter = VK_FILTER_LINEAR;
-    //TODO: Make it possible to change address_modes..
-    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
 
-    const auto device_properties = get_physical_device_properties(physical_device);
-    // TODO: It should be possible to make this an optional thing, if this change is made
-    // Remove the forced selection of physical devices in calculate_device_score()
+    const auto sampler = get_texture_sampler(physical_device, logical_device, mip_levels, samplers);
 
-    sampler_info.anisotropyEnable = VK_TRUE;
-    sampler_info.maxAnisotropy = device_properties.limits.maxSamplerAnisotropy;
-    sampler_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-    sampler_info.unnormalizedCoordinates = VK_FALSE;
-    sampler_info.compareEnable = VK_FALSE;
-    sampler_info.compareOp = VK_COMPARE_OP_ALWAYS;
-    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-    sampler_info.mipLodBias = 0.0f;
-    sampler_info.minLod = 0.0f;
-    sampler_info.maxLod = 0.0f;
+    return std::make_unique<Texture>(texture,
+                                     texture_memory,
+                                     format,
+                                     *view,
+                                     sampler,
+                                     mip_levels,
+                                     1,
+                                     samplers == nullptr);
+}
+
+std::unique_ptr<Texture> Texture::create_from_file(const VkPhysicalDevice& physical_device,
+                                                   const VkDevice& logical_device,
+                                                   const VkCommandPool& command_pool,
+                                                   const VkQueue& graphics_queue,
+                                                   StagingBuffer& staging,
+                                                   const std::string& path,
+                                                   const bool srgb,
+                                                   const bool generate_mipmaps,
+                                                   SamplerCache* samplers)
+{
+    const auto file = MappedFile::open(path);
+    if (!file)
+        return nullptr;
+
+    // Files larger than the shared staging buffer get a buffer of their own.
+    std::optional<StagingBuffer> temporary{};
+    const auto stage = [&](const VkDeviceSize size) {
+        auto region = staging.allocate(size);
+        if (region)
+            return *region;
+        temporary.emplace(physical_device, logical_device, size);
+        return *temporary->allocate(size);
+    };
+    const auto release = [&](const StagingRegion& region) {
+        if (temporary)
+            temporary->destroy(logical_device);
+        else
+            staging.release(region);
+    };
+
+    VkFormat format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mip_levels;
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    std::vector<VkDeviceSize> level_offsets{};
+    StagingRegion region;
+
+    if (const auto layout = read_ktx2_layout(file->data(), file->size())) {
+        if (!supports_sampling(physical_device, layout->format))
+            return nullptr;
+        format = layout->format;
+        width = layout->width;
+        height = layout->height;
+        mip_levels = static_cast<uint32_t>(layout->levels.size());
+        region = stage(layout->data_size);
+        for (size_t level = 0; level < layout->levels.size(); level++) {
+            memcpy(region.data + layout->levels[level].offset,
+                   file->data() + layout->source_offsets[level],
+                   static_cast<size_t>(layout->levels[level].size));
+            level_offsets.push_back(region.offset + layout->levels[level].offset);
+        }
+    } else {
+        // stb takes the size of the encoded image as an int.
+        if (file->size() > static_cast<size_t>(INT_MAX)) {
+            std::cout << "Image file too large to decode: " << path << std::endl;
+            return nullptr;
+        }
+        const auto data = file->data();
+        const auto size = static_cast<int>(file->size());
+        int source_width;
+        int source_height;
+        int channels;
+        if (!stbi_info_from_memory(data, size, &source_width, &source_height, &channels)) {
+            std::cout << "Unsupported image file: " << path << std::endl;
+            return nullptr;
+        }
+        if (channels == STBI_rgb)
+            channels = STBI_rgb_alpha;
+        const auto image_format = find_image_format(physical_device, channels, srgb);
+        if (!image_format)
+            return nullptr;
+
+        // stb can only decode into memory of its own, which is freed as soon as it is staged.
+        int source_channels;
+        const auto pixels = stbi_load_from_memory(data,
+                                                  size,
+                                                  &source_width,
+                                                  &source_height,
+                                                  &source_channels,
+                                                  image_format->channels);
+        if (!pixels)
+            return nullptr;
+        const Image decoded(pixels, source_width, source_height, image_format->channels);
+
+        format = image_format->format;
+        width = static_cast<uint32_t>(source_width);
+        height = static_cast<uint32_t>(source_height);
+        mip_levels = generate_mipmaps ? mip_level_count(width, height) : 1;
+        MipChain cpu_levels{};
+        if (mip_levels > 1 && !supports_linear_blit(physical_device, format))
+            cpu_levels = generate_mip_chain(decoded, mip_levels);
+        if (mip_levels > 1)
+            usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+        // Copy offsets must be a multiple of 4, which level 0 of R8 images may not end on.
+        const VkDeviceSize chain_offset = (decoded.device_size() + 3) / 4 * 4;
+        region = stage(chain_offset + cpu_levels.pixels.size());
+        memcpy(region.data, decoded.pixels(), decoded.device_size());
+        level_offsets.push_back(region.offset);
+        if (!cpu_levels.pixels.empty())
+            memcpy(region.data + chain_offset, cpu_levels.pixels.data(), cpu_levels.pixels.size());
+        for (const auto offset: cpu_levels.offsets)
+            level_offsets.push_back(region.offset + chain_offset + offset);
+    }
+
+    VkImage texture{};
+    VkDeviceMemory texture_memory;
+    try {
+        create_image(physical_device,
+                     logical_device,
+                     width,
+                     height,
+                     format,
+                     VK_IMAGE_TILING_OPTIMAL,
+                     usage,
+                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                     texture,
+                     texture_memory,
+                     mip_levels);
+    } catch (const OutOfDeviceMemory&) {
+        release(region);
+        throw;
+    }
+
+    const VkBuffer staging_buffer = temporary ? temporary->buffer() : staging.buffer();
+    const auto record_upload = [&](VkCommandBuffer& command_buffer) {
+        record_texture_upload(command_buffer,
+                              staging_buffer,
+                              level_offsets,
+                              texture,
+                              width,
+                              height,
+                              mip_levels);
+    };
+    const auto destroy_texture = [&]() {
+        vkDestroyImage(logical_device, texture, nullptr);
+        vkFreeMemory(logical_device, texture_memory, nullptr);
+    };
+    try {
+        with_single_use_command_buffer(logical_device,
+                                       command_pool,
+                                       graphics_queue,
+                                       record_upload);
+    } catch (const std::exception&) {
+        release(region);
+        destroy_texture();
+        throw;
+    }
+    release(region);
+
+    const auto view = create_image_view(logical_device,
+                                        texture,
+                                        format,
+                                        VK_IMAGE_ASPECT_COLOR_BIT,
+                                        mip_levels,
+                                        1,
+                                        VK_IMAGE_VIEW_TYPE_2D,
+                                        texture_swizzle(format));
+    if (!view) {
+        destroy_texture();
+        return nullptr;
+    }
+
+    VkSampler sampler;
+    try {
+        sampler = get_texture_sampler(physical_device, logical_device, mip_levels, samplers);
+    } catch (const std::exception&) {
+        vkDestroyImageView(logical_device, *view, nullptr);
+        destroy_texture();
+        throw;
+    }
 
-    VkSampler sampler{};
-    status = vkCreateSampler(logical_device, &sampler_info, nullptr, &sampler);
-    if (status != VK_SUCCESS)
-        throw std::runtime_error("Failed to create texture sampler!");
-    
-   
     return std::make_unique<Texture>(texture,
                                      texture_memory,
                                      format,
                                      *view,
-                                     sampler);
+                                     sampler,
+                                     mip_levels,
+                                     1,
+                                     samplers == nullptr);
 }
-   
+
 }
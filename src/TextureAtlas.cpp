@@ -0,0 +1,306 @@
+#include "../arc/TextureAtlas.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <numeric>
+#include <stdexcept>
+
+namespace ArcGraphics {
+
+SkylinePacker::SkylinePacker(const uint32_t width, const uint32_t height)
+    : m_width(width)
+    , m_height(height)
+    , m_used_area(0)
+    , m_skyline{{0, 0, width}}
+{
+}
+
+std::optional<uint32_t> SkylinePacker::fit(const size_t index,
+                                           const uint32_t width,
+                                           const uint32_t height) const
+{
+    const uint32_t x = m_skyline[index].x;
+    if (x + width > m_width)
+        return std::nullopt;
+
+    // The rectangle rests on the highest segment below it.
+    uint32_t y = 0;
+    uint32_t remaining = width;
+    for (size_t i = index; remaining > 0; i++) {
+        y = std::max(y, m_skyline[i].y);
+        if (y + height > m_height)
+            return std::nullopt;
+        remaining -= std::min(remaining, m_skyline[i].width);
+    }
+    return y;
+}
+
+std::optional<AtlasPosition> SkylinePacker::insert(const uint32_t width, const uint32_t height)
+{
+    if (width == 0 || height == 0)
+        return AtlasPosition{0, 0};
+
+    size_t best_index = m_skyline.size();
+    uint32_t best_top = UINT32_MAX;
+    uint32_t best_y = 0;
+    for (size_t i = 0; i < m_skyline.size(); i++) {
+        const auto y = fit(i, width, height);
+        if (y && *y + height < best_top) {
+            best_index = i;
+            best_top = *y + height;
+            best_y = *y;
+        }
+    }
+    if (best_index == m_skyline.size())
+        return std::nullopt;
+
+    const AtlasPosition position{m_skyline[best_index].x, best_y};
+    m_skyline.insert(m_skyline.begin() + best_index, Segment{position.x, best_top, width});
+
+    // Cut away the parts of the following segments that are now covered.
+    for (size_t i = best_index + 1; i < m_skyline.size();) {
+        const auto& previous = m_skyline[i - 1];
+        const uint32_t previous_end = previous.x + previous.width;
+        auto& segment = m_skyline[i];
+        if (segment.x >= previous_end)
+            break;
+        const uint32_t covered = previous_end - segment.x;
+        if (segment.width <= covered) {
+            m_skyline.erase(m_skyline.begin() + i);
+            continue;
+        }
+        segment.x += covered;
+        segment.width -= covered;
+        break;
+    }
+
+    for (size_t i = 1; i < m_skyline.size();) {
+        if (m_skyline[i - 1].y == m_skyline[i].y) {
+            m_skyline[i - 1].width += m_skyline[i].width;
+            m_skyline.erase(m_skyline.begin() + i);
+        } else {
+            i++;
+        }
+    }
+
+    m_used_area += uint64_t(width) * height;
+    return position;
+}
+
+float SkylinePacker::occupancy() const
+{
+    return float(double(m_used_area) / (double(m_width) * m_height));
+}
+
+void TextureAtlas::destroy(const VkDevice logical_device)
+{
+    if (texture)
+        texture->destroy(logical_device);
+    texture.reset();
+    regions.clear();
+}
+
+/**
+ * @brief Get the largest channel count of images.
+ * @throw std::invalid_argument if any of the images is null.
+ */
+[[nodiscard]]
+static int max_channels(const std::vector<const Image*>& images)
+{
+    int channels = 1;
+    for (const auto image: images) {
+        if (!image)
+            throw std::invalid_argument("Can not pack a null image!");
+        channels = std::max(channels, image->channels());
+    }
+    return channels;
+}
+
+/**
+ * @brief Get images with exactly channels, expanding the ones with fewer.
+ * @param expanded owns the expanded copies.
+ */
+[[nodiscard]]
+static std::vector<const Image*> with_channels(const std::vector<const Image*>& images,
+                                               const int channels,
+                                               std::vector<std::unique_ptr<Image>>& expanded)
+{
+    std::vector<const Image*> result{};
+    result.reserve(images.size());
+    for (const auto image: images) {
+        if (image->channels() == channels) {
+            result.push_back(image);
+            continue;
+        }
+        expanded.push_back(expand_channels(*image, channels));
+        result.push_back(expanded.back().get());
+    }
+    return result;
+}
+
+/**
+ * @brief Copy image into layer at position, surrounded by padding copies of its edge texels.
+ */
+static void blit_padded(const Image& image,
+                        unsigned char* layer,
+                        const uint32_t layer_size,
+                        const AtlasPosition position,
+                        const uint32_t padding)
+{
+    const auto width = static_cast<uint32_t>(image.width());
+    const auto height = static_cast<uint32_t>(image.height());
+    const auto channels = static_cast<size_t>(image.channels());
+    const size_t row_size = size_t(width) * channels;
+
+    for (uint32_t row = 0; row < height + 2 * padding; row++) {
+        const uint32_t src_y = std::min(row > padding ? row - padding : 0, height - 1);
+        const unsigned char* src = image.pixels() + src_y * row_size;
+        unsigned char* dst = layer + (size_t(position.y + row) * layer_size + position.x) * channels;
+        for (uint32_t x = 0; x < padding; x++)
+            memcpy(dst + x * channels, src, channels);
+        memcpy(dst + padding * channels, src, row_size);
+        for (uint32_t x = 0; x < padding; x++)
+            memcpy(dst + (padding + width + x) * channels, src + row_size - channels, channels);
+    }
+}
+
+std::unique_ptr<TextureAtlas> pack_atlas(const VkPhysicalDevice& physical_device,
+                                         const VkDevice& logical_device,
+                                         const VkCommandPool& command_pool,
+                                         const VkQueue& graphics_queue,
+                                         const std::vector<const Image*>& images,
+                                         const uint32_t atlas_size,
+                                         const uint32_t padding,
+                                         const bool srgb,
+                                         const bool generate_mipmaps,
+                                         SamplerCache* samplers)
+{
+    if (images.empty())
+        return nullptr;
+
+    const auto format = find_image_format(physical_device, max_channels(images), srgb);
+    if (!format)
+        return nullptr;
+    std::vector<std::unique_ptr<Image>> expanded{};
+    const auto sources = with_channels(images, format->channels, expanded);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    const uint32_t layer_size = std::min(atlas_size, properties.limits.maxImageDimension2D);
+
+    // Tall images first, so each row of the skyline is filled with similar heights.
+    std::vector<size_t> order(sources.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [&](const size_t a, const size_t b) {
+        if (sources[a]->height() != sources[b]->height())
+            return sources[a]->height() > sources[b]->height();
+        return sources[a]->width() > sources[b]->width();
+    });
+
+    std::vector<SkylinePacker> packers{};
+    std::vector<std::pair<uint32_t, AtlasPosition>> placements(sources.size());
+    for (const auto index: order) {
+        const uint32_t width = static_cast<uint32_t>(sources[index]->width()) + 2 * padding;
+        const uint32_t height = static_cast<uint32_t>(sources[index]->height()) + 2 * padding;
+        if (width > layer_size || height > layer_size)
+            throw std::invalid_argument("Image is larger than the atlas layers!");
+
+        std::optional<AtlasPosition> position{};
+        uint32_t layer = 0;
+        for (; layer < packers.size() && !position; layer++)
+            position = packers[layer].insert(width, height);
+        if (!position) {
+            packers.emplace_back(layer_size, layer_size);
+            position = packers.back().insert(width, height);
+            layer = static_cast<uint32_t>(packers.size());
+        }
+        placements[index] = {layer - 1, *position};
+    }
+
+    if (packers.size() > properties.limits.maxImageArrayLayers)
+        throw std::invalid_argument("Atlas needs more layers than the device supports!");
+
+    // The layers are allocated with calloc, since Image frees its pixels with stbi_image_free.
+    const size_t layer_bytes = size_t(layer_size) * layer_size * format->channels;
+    std::vector<std::unique_ptr<Image>> layers{};
+    for (size_t layer = 0; layer < packers.size(); layer++) {
+        auto pixels = static_cast<unsigned char*>(calloc(layer_bytes, 1));
+        if (!pixels)
+            throw std::bad_alloc();
+        layers.push_back(std::make_unique<Image>(pixels,
+                                                 int(layer_size),
+                                                 int(layer_size),
+                                                 format->channels));
+    }
+
+    auto atlas = std::make_unique<TextureAtlas>();
+    atlas->regions.reserve(sources.size());
+    const float scale = 1.0f / float(layer_size);
+    for (size_t i = 0; i < sources.size(); i++) {
+        const auto [layer, position] = placements[i];
+        blit_padded(*sources[i], layers[layer]->pixels(), layer_size, position, padding);
+
+        const glm::vec2 min{float(position.x + padding), float(position.y + padding)};
+        const glm::vec2 size{float(sources[i]->width()), float(sources[i]->height())};
+        atlas->regions.push_back({min * scale, (min + size) * scale, layer});
+    }
+
+    std::vector<const Image*> layer_images{};
+    for (const auto& layer: layers)
+        layer_images.push_back(layer.get());
+    atlas->texture = Texture::create_array(physical_device,
+                                           logical_device,
+                                           command_pool,
+                                           graphics_queue,
+                                           format->format,
+                                           layer_images,
+                                           generate_mipmaps,
+                                           samplers);
+    if (!atlas->texture)
+        return nullptr;
+    return atlas;
+}
+
+std::unique_ptr<TextureAtlas> pack_texture_array(const VkPhysicalDevice& physical_device,
+                                                 const VkDevice& logical_device,
+                                                 const VkCommandPool& command_pool,
+                                                 const VkQueue& graphics_queue,
+                                                 const std::vector<const Image*>& images,
+                                                 const bool srgb,
+                                                 const bool generate_mipmaps,
+                                                 SamplerCache* samplers)
+{
+    if (images.empty())
+        return nullptr;
+
+    const auto format = find_image_format(physical_device, max_channels(images), srgb);
+    if (!format)
+        return nullptr;
+    std::vector<std::unique_ptr<Image>> expanded{};
+    const auto sources = with_channels(images, format->channels, expanded);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    if (sources.size() > properties.limits.maxImageArrayLayers)
+        throw std::invalid_argument("Texture array has more layers than the device supports!");
+
+    auto atlas = std::make_unique<TextureAtlas>();
+    atlas->texture = Texture::create_array(physical_device,
+                                           logical_device,
+                                           command_pool,
+                                           graphics_queue,
+                                           format->format,
+                                           sources,
+                                           generate_mipmaps,
+                                           samplers);
+    if (!atlas->texture)
+        return nullptr;
+
+    for (size_t layer = 0; layer < sources.size(); layer++)
+        atlas->regions.push_back({glm::vec2(0.0f), glm::vec2(1.0f), uint32_t(layer)});
+    return atlas;
+}
+
+}
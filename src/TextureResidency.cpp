@@ -0,0 +1,314 @@
+#include "../arc/TextureResidency.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+
+namespace ArcGraphics {
+
+TextureResidency::TextureResidency(const Device& device,
+                                   const VkCommandPool& command_pool,
+                                   const VkQueue& graphics_queue,
+                                   const uint32_t frames_in_flight,
+                                   const bool srgb,
+                                   const float budget_fraction,
+                                   const uint32_t min_dimension)
+    : m_device(device)
+    , m_command_pool(command_pool)
+    , m_graphics_queue(graphics_queue)
+    , m_frames_in_flight(frames_in_flight)
+    , m_srgb(srgb)
+    , m_budget_fraction(budget_fraction)
+    , m_min_dimension(std::max(min_dimension, 1u))
+{
+    // Image frees its pixels with stbi_image_free, which is free().
+    auto pixels = static_cast<unsigned char*>(malloc(4));
+    if (!pixels)
+        throw std::bad_alloc();
+    memset(pixels, 128, 4);
+    const Image placeholder_image(pixels, 1, 1, 4);
+    m_placeholder = Texture::create_from_image(device.physical_device(),
+                                               device.logical_device(),
+                                               command_pool,
+                                               graphics_queue,
+                                               &placeholder_image,
+                                               srgb,
+                                               false,
+                                               &device.sampler_cache());
+    if (!m_placeholder)
+        throw std::runtime_error("Failed to create placeholder texture!");
+}
+
+/**
+ * @brief Get the device memory bound to the image of texture.
+ */
+[[nodiscard]]
+static VkDeviceSize texture_bytes(const VkDevice logical_device, Texture& texture)
+{
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(logical_device, texture.image(), &requirements);
+    return requirements.size;
+}
+
+/**
+ * @brief Estimate the device memory of image starting at mip level, including the levels below.
+ */
+[[nodiscard]]
+static VkDeviceSize estimate_bytes(const Image& image, const uint32_t level)
+{
+    const VkDeviceSize width = std::max(static_cast<uint32_t>(image.width()) >> level, 1u);
+    const VkDeviceSize height = std::max(static_cast<uint32_t>(image.height()) >> level, 1u);
+    return width * height * image.channels() * 4 / 3;
+}
+
+TextureResidency::Budget TextureResidency::query_budget() const
+{
+    VkDeviceSize budget = 0;
+    VkDeviceSize usage = 0;
+    bool measured = false;
+    for (const auto& heap: m_device.memory_heap_budgets()) {
+        if (!heap.device_local)
+            continue;
+        budget += heap.budget;
+        usage += heap.usage;
+        measured = heap.measured;
+    }
+    // Without the extension only the memory of the managed textures is known.
+    if (!measured)
+        usage = m_resident_bytes;
+    return {usage, static_cast<VkDeviceSize>(double(budget) * m_budget_fraction)};
+}
+
+uint32_t TextureResidency::max_dropped_levels(const Entry& entry) const
+{
+    const auto size = static_cast<uint32_t>(std::max(entry.image->width(), entry.image->height()));
+    uint32_t levels = 0;
+    while ((size >> (levels + 1)) >= m_min_dimension)
+        levels++;
+    return levels;
+}
+
+std::unique_ptr<Texture> TextureResidency::create_level(const Entry& entry,
+                                                        const uint32_t level) const
+{
+    const auto create = [&](const Image* image) {
+        return Texture::create_from_image(m_device.physical_device(),
+                                          m_device.logical_device(),
+                                          m_command_pool,
+                                          m_graphics_queue,
+                                          image,
+                                          m_srgb,
+                                          true,
+                                          &m_device.sampler_cache());
+    };
+    if (level == 0)
+        return create(entry.image.get());
+
+    const auto chain = generate_mip_chain(*entry.image, level + 1);
+    const auto width = std::max(entry.image->width() >> level, 1);
+    const auto height = std::max(entry.image->height() >> level, 1);
+    const size_t size = size_t(width) * height * entry.image->channels();
+    auto pixels = static_cast<unsigned char*>(malloc(size));
+    if (!pixels)
+        throw std::bad_alloc();
+    memcpy(pixels, chain.pixels.data() + chain.offsets[level - 1], size);
+    const Image level_image(pixels, width, height, entry.image->channels());
+    return create(&level_image);
+}
+
+ResidencyHandle TextureResidency::add(std::unique_ptr<Image> image)
+{
+    if (!image)
+        throw std::invalid_argument("Can not manage the residency of a null image!");
+
+    const auto handle = static_cast<ResidencyHandle>(m_entries.size());
+    m_entries.push_back({std::move(image), nullptr, 0, 0, m_frame});
+    auto& entry = m_entries.back();
+
+    // Start at the largest level that fits, degrading older textures if allocation fails.
+    auto budget = query_budget();
+    const uint32_t max_level = max_dropped_levels(entry);
+    uint32_t level = 0;
+    while (level < max_level
+        && budget.usage + estimate_bytes(*entry.image, level) > budget.target)
+        level++;
+
+    for (;;) {
+        try {
+            auto texture = create_level(entry, level);
+            if (!texture)
+                throw std::runtime_error("Failed to create managed texture!");
+            replace(handle, std::move(texture), level, false);
+            break;
+        } catch (const OutOfDeviceMemory&) {
+            if (!degrade_least_recently_used(budget)) {
+                std::cout << "Out of device memory, texture " << handle
+                          << " stays evicted" << std::endl;
+                entry.dropped_levels = max_level + 1;
+                break;
+            }
+        }
+    }
+    return handle;
+}
+
+Texture& TextureResidency::use(const ResidencyHandle handle)
+{
+    auto& entry = m_entries.at(handle);
+    entry.last_used = m_frame;
+    return entry.texture ? *entry.texture : *m_placeholder;
+}
+
+void TextureResidency::set_changed_callback(ChangedCallback callback)
+{
+    m_changed_callback = std::move(callback);
+}
+
+void TextureResidency::replace(const ResidencyHandle handle,
+                               std::unique_ptr<Texture> texture,
+                               const uint32_t dropped_levels,
+                               const bool in_flight)
+{
+    auto& entry = m_entries[handle];
+    const auto logical_device = m_device.logical_device();
+    if (entry.texture) {
+        m_resident_bytes -= entry.bytes;
+        if (in_flight)
+            m_retired.push_back({std::move(entry.texture), m_frame});
+        else
+            entry.texture->destroy(logical_device);
+    }
+    entry.texture = std::move(texture);
+    entry.bytes = entry.texture ? texture_bytes(logical_device, *entry.texture) : 0;
+    entry.dropped_levels = dropped_levels;
+    m_resident_bytes += entry.bytes;
+
+    if (m_changed_callback)
+        m_changed_callback(handle, entry.texture ? *entry.texture : *m_placeholder);
+}
+
+bool TextureResidency::degrade_least_recently_used(Budget& budget)
+{
+    Entry* victim = nullptr;
+    for (auto& entry: m_entries) {
+        if (!entry.texture || entry.last_used + m_frames_in_flight > m_frame)
+            continue;
+        if (!victim || entry.last_used < victim->last_used)
+            victim = &entry;
+    }
+    if (!victim)
+        return false;
+
+    const auto handle = static_cast<ResidencyHandle>(victim - m_entries.data());
+    const auto freed = victim->bytes;
+    const uint32_t level = victim->dropped_levels + 1;
+
+    // The victim is not sampled by any frame in flight, so it is destroyed right away.
+    std::unique_ptr<Texture> smaller{};
+    if (level <= max_dropped_levels(*victim)) {
+        victim->texture->destroy(m_device.logical_device());
+        victim->texture.reset();
+        m_resident_bytes -= freed;
+        victim->bytes = 0;
+        try {
+            smaller = create_level(*victim, level);
+        } catch (const OutOfDeviceMemory&) {
+        }
+    }
+    replace(handle, std::move(smaller), level, false);
+
+    budget.usage -= std::min(budget.usage, freed);
+    budget.usage += victim->bytes;
+    return true;
+}
+
+void TextureResidency::restore_used(Budget& budget)
+{
+    std::vector<ResidencyHandle> used{};
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        const auto& entry = m_entries[i];
+        const bool degraded = !entry.texture || entry.dropped_levels > 0;
+        if (degraded && entry.last_used + 1 >= m_frame)
+            used.push_back(static_cast<ResidencyHandle>(i));
+    }
+    std::sort(used.begin(), used.end(), [&](const auto a, const auto b) {
+        return m_entries[a].last_used > m_entries[b].last_used;
+    });
+
+    for (const auto handle: used) {
+        auto& entry = m_entries[handle];
+        const uint32_t current = entry.texture ? entry.dropped_levels : max_dropped_levels(entry) + 1;
+        for (uint32_t level = 0; level < current; level++) {
+            const auto needed = estimate_bytes(*entry.image, level);
+            if (budget.usage + needed - std::min(needed, entry.bytes) > budget.target)
+                continue;
+            std::unique_ptr<Texture> texture{};
+            try {
+                texture = create_level(entry, level);
+            } catch (const OutOfDeviceMemory&) {
+                return;
+            }
+            if (!texture)
+                break;
+            const auto previous_bytes = entry.bytes;
+            // The previous texture was used last frame, which may still be in flight.
+            replace(handle, std::move(texture), level, true);
+            budget.usage += entry.bytes - std::min(entry.bytes, previous_bytes);
+            break;
+        }
+    }
+}
+
+void TextureResidency::begin_frame()
+{
+    m_frame++;
+
+    const auto logical_device = m_device.logical_device();
+    const auto done = std::remove_if(m_retired.begin(), m_retired.end(), [&](auto& retired) {
+        if (retired.frame + m_frames_in_flight > m_frame)
+            return false;
+        retired.texture->destroy(logical_device);
+        return true;
+    });
+    m_retired.erase(done, m_retired.end());
+
+    auto budget = query_budget();
+    while (budget.usage > budget.target && degrade_least_recently_used(budget)) {}
+    restore_used(budget);
+}
+
+uint32_t TextureResidency::dropped_levels(const ResidencyHandle handle) const
+{
+    return m_entries.at(handle).dropped_levels;
+}
+
+bool TextureResidency::is_evicted(const ResidencyHandle handle) const
+{
+    return !m_entries.at(handle).texture;
+}
+
+VkDeviceSize TextureResidency::resident_bytes() const
+{
+    return m_resident_bytes;
+}
+
+void TextureResidency::destroy()
+{
+    const auto logical_device = m_device.logical_device();
+    for (auto& retired: m_retired)
+        retired.texture->destroy(logical_device);
+    m_retired.clear();
+    for (auto& entry: m_entries)
+        if (entry.texture)
+            entry.texture->destroy(logical_device);
+    m_entries.clear();
+    m_resident_bytes = 0;
+    if (m_placeholder)
+        m_placeholder->destroy(logical_device);
+    m_placeholder.reset();
+}
+
+}
@@ -0,0 +1,413 @@
+#include "../arc/TextureStreamer.hpp"
+#include "../arc/BasicBuffer.hpp"
+#include "../arc/Algorithm.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace ArcGraphics {
+
+TextureStreamer::TextureStreamer(ThreadPool& pool,
+                                 const VkPhysicalDevice& physical_device,
+                                 const VkDevice& logical_device,
+                                 const VkCommandPool& command_pool,
+                                 const VkQueue& graphics_queue,
+                                 const bool srgb,
+                                 const VkDeviceSize frame_byte_budget,
+                                 SamplerCache* samplers,
+                                 GpuTimeline* timeline)
+    : m_pool(pool)
+    , m_physical_device(physical_device)
+    , m_logical_device(logical_device)
+    , m_command_pool(command_pool)
+    , m_graphics_queue(graphics_queue)
+    , m_frame_byte_budget(frame_byte_budget)
+    , m_samplers(samplers)
+    , m_timeline(timeline)
+    , m_queues(std::make_shared<Queues>())
+{
+    // The formats are resolved up front, so decode tasks never query the device.
+    for (int channels = 1; channels <= 4; channels++) {
+        const auto format = find_image_format(physical_device, channels, srgb);
+        if (format)
+            m_queues->formats[channels] = ChannelFormat{
+                *format, supports_linear_blit(physical_device, format->format)};
+    }
+    if (!m_queues->formats[4])
+        throw std::runtime_error("No supported texture format for streaming!");
+
+    // Image frees its pixels with stbi_image_free, which is free().
+    auto pixels = static_cast<unsigned char*>(malloc(4));
+    memset(pixels, 128, 4);
+    const Image placeholder_image(pixels, 1, 1, 4);
+    m_placeholder = Texture::create_staging(physical_device,
+                                            logical_device,
+                                            command_pool,
+                                            graphics_queue,
+                                            m_queues->formats[4]->format.format,
+                                            &placeholder_image,
+                                            false,
+                                            samplers);
+    if (!m_placeholder)
+        throw std::runtime_error("Failed to create placeholder texture!");
+}
+
+TextureHandle TextureStreamer::request(const std::string& path, const int priority)
+{
+    const auto handle = static_cast<TextureHandle>(m_entries.size());
+    m_entries.push_back({path, State::queued, nullptr});
+    {
+        std::lock_guard<std::mutex> lock(m_queues->mutex);
+        m_queues->requests.push_back({handle, priority, path});
+    }
+    // Every task decodes whichever request has the highest priority when it starts,
+    // not necessarily the one that queued it.
+    (void)m_pool.submit([queues = m_queues] { decode_next(queues); });
+    return handle;
+}
+
+void TextureStreamer::set_priority(const TextureHandle handle, const int priority)
+{
+    std::lock_guard<std::mutex> lock(m_queues->mutex);
+    for (auto& request: m_queues->requests)
+        if (request.handle == handle)
+            request.priority = priority;
+    for (auto& decoded: m_queues->decoded)
+        if (decoded.handle == handle)
+            decoded.priority = priority;
+}
+
+void TextureStreamer::set_resident_callback(ResidentCallback callback)
+{
+    m_resident_callback = std::move(callback);
+}
+
+void TextureStreamer::decode_next(const std::shared_ptr<Queues>& queues)
+{
+    DecodeRequest request;
+    {
+        std::lock_guard<std::mutex> lock(queues->mutex);
+        if (queues->requests.empty())
+            return;
+        const auto next = std::max_element(queues->requests.begin(),
+                                           queues->requests.end(),
+                                           [](const auto& a, const auto& b) {
+                                               return a.priority < b.priority;
+                                           });
+        request = std::move(*next);
+        queues->requests.erase(next);
+    }
+
+    // The formats are only written before any task is queued.
+    Decoded decoded{request.handle, request.priority, nullptr, VK_FORMAT_UNDEFINED, {}, 1};
+    // The future of the task is discarded, so a failure must still be handed back
+    // as a decoded entry without an image, which marks the texture failed.
+    try {
+        decoded.image = Image::load_from_path(request.path);
+        const auto& format = decoded.image
+            ? queues->formats[decoded.image->channels()]
+            : std::optional<ChannelFormat>{};
+        if (!format) {
+            decoded.image.reset();
+        } else {
+            if (format->format.channels != decoded.image->channels())
+                decoded.image = expand_channels(*decoded.image, format->format.channels);
+            decoded.format = format->format.format;
+            decoded.mip_levels = mip_level_count(static_cast<uint32_t>(decoded.image->width()),
+                                                 static_cast<uint32_t>(decoded.image->height()));
+            if (!format->blit_mipmaps)
+                decoded.cpu_levels = generate_mip_chain(*decoded.image, decoded.mip_levels);
+        }
+    } catch (const std::exception& error) {
+        std::cout << "Failed to decode texture " << request.path << ": " << error.what() << std::endl;
+        decoded.image.reset();
+        decoded.cpu_levels = {};
+    }
+
+    std::lock_guard<std::mutex> lock(queues->mutex);
+    queues->decoded.push_back(std::move(decoded));
+}
+
+void TextureStreamer::update()
+{
+    finish_uploads();
+    start_uploads();
+}
+
+void TextureStreamer::release_batch(UploadBatch& batch)
+{
+    vkDestroyFence(m_logical_device, batch.fence, nullptr);
+    vkFreeCommandBuffers(m_logical_device, m_command_pool, 1, &batch.command_buffer);
+    vkDestroyBuffer(m_logical_device, batch.staging_buffer, nullptr);
+    vkFreeMemory(m_logical_device, batch.staging_memory, nullptr);
+}
+
+void TextureStreamer::finish_uploads()
+{
+    for (auto batch = m_in_flight.begin(); batch != m_in_flight.end();) {
+        const bool done = m_timeline
+            ? m_timeline->is_complete(batch->timeline_point)
+            : vkGetFenceStatus(m_logical_device, batch->fence) == VK_SUCCESS;
+        if (!done) {
+            ++batch;
+            continue;
+        }
+        for (auto& [handle, texture]: batch->textures) {
+            auto& entry = m_entries[handle];
+            entry.texture = std::move(texture);
+            entry.state = State::resident;
+            if (m_resident_callback)
+                m_resident_callback(handle, *entry.texture);
+        }
+        release_batch(*batch);
+        batch = m_in_flight.erase(batch);
+    }
+}
+
+void TextureStreamer::start_uploads()
+{
+    // Take the highest priority decoded images that fit in the budget.
+    std::vector<Decoded> uploads{};
+    {
+        std::lock_guard<std::mutex> lock(m_queues->mutex);
+        auto& decoded = m_queues->decoded;
+        std::sort(decoded.begin(), decoded.end(), [](const auto& a, const auto& b) {
+            return a.priority > b.priority;
+        });
+        VkDeviceSize bytes = 0;
+        size_t count = 0;
+        for (; count < decoded.size(); count++) {
+            const auto& next = decoded[count];
+            const VkDeviceSize size = next.image
+                ? next.image->device_size() + next.cpu_levels.pixels.size()
+                : 0;
+            if (count > 0 && bytes + size > m_frame_byte_budget)
+                break;
+            bytes += size;
+        }
+        uploads.insert(uploads.end(),
+                       std::make_move_iterator(decoded.begin()),
+                       std::make_move_iterator(decoded.begin() + count));
+        decoded.erase(decoded.begin(), decoded.begin() + count);
+    }
+
+    // Buffer to image copies need offsets that are a multiple of the texel size.
+    constexpr VkDeviceSize staging_alignment = 16;
+    std::vector<std::vector<VkDeviceSize>> level_offsets(uploads.size());
+    VkDeviceSize staging_size = 0;
+    for (size_t i = 0; i < uploads.size(); i++) {
+        auto& upload = uploads[i];
+        if (!upload.image) {
+            std::cout << "Failed to stream texture " << m_entries[upload.handle].path << std::endl;
+            m_entries[upload.handle].state = State::failed;
+            continue;
+        }
+        level_offsets[i].push_back(staging_size);
+        staging_size += (upload.image->device_size() + staging_alignment - 1)
+                        / staging_alignment * staging_alignment;
+        for (const auto offset: upload.cpu_levels.offsets)
+            level_offsets[i].push_back(staging_size + offset);
+        staging_size += (upload.cpu_levels.pixels.size() + staging_alignment - 1)
+                        / staging_alignment * staging_alignment;
+    }
+    if (staging_size == 0)
+        return;
+
+    // A failure part way leaves nothing behind: the textures created so far and the
+    // batch are released, and every image of the batch is marked failed.
+    UploadBatch batch{};
+    try {
+        VkBufferCreateInfo staging_buffer_info;
+        create_buffer(m_physical_device,
+                      m_logical_device,
+                      staging_size,
+                      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                      | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                      staging_buffer_info,
+                      batch.staging_buffer,
+                      batch.staging_memory);
+
+        const auto fill_staging = [&](void* mapping) {
+            auto dst = static_cast<unsigned char*>(mapping);
+            for (size_t i = 0; i < uploads.size(); i++) {
+                const auto& upload = uploads[i];
+                if (!upload.image)
+                    continue;
+                memcpy(dst + level_offsets[i][0], upload.image->pixels(), upload.image->device_size());
+                if (!upload.cpu_levels.pixels.empty())
+                    memcpy(dst + level_offsets[i][1],
+                           upload.cpu_levels.pixels.data(),
+                           upload.cpu_levels.pixels.size());
+            }
+        };
+        with_memory_mapping(m_logical_device, staging_size, batch.staging_memory, fill_staging);
+
+        VkCommandBufferAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        alloc_info.commandPool = m_command_pool;
+        alloc_info.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(m_logical_device, &alloc_info, &batch.command_buffer) != VK_SUCCESS) {
+            batch.command_buffer = VK_NULL_HANDLE;
+            throw std::runtime_error("Failed to allocate texture streaming command buffer!");
+        }
+
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if (vkBeginCommandBuffer(batch.command_buffer, &begin_info) != VK_SUCCESS)
+            throw std::runtime_error("Failed to begin texture streaming command buffer!");
+
+        for (size_t i = 0; i < uploads.size(); i++) {
+            const auto& upload = uploads[i];
+            if (!upload.image)
+                continue;
+            const auto width = static_cast<uint32_t>(upload.image->width());
+            const auto height = static_cast<uint32_t>(upload.image->height());
+
+            VkImage image;
+            VkDeviceMemory memory;
+            create_image(m_physical_device,
+                         m_logical_device,
+                         width,
+                         height,
+                         upload.format,
+                         VK_IMAGE_TILING_OPTIMAL,
+                         VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+                         | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+                         | VK_IMAGE_USAGE_SAMPLED_BIT,
+                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                         image,
+                         memory,
+                         upload.mip_levels);
+            record_texture_upload(batch.command_buffer,
+                                  batch.staging_buffer,
+                                  level_offsets[i],
+                                  image,
+                                  width,
+                                  height,
+                                  upload.mip_levels);
+
+            const auto view = create_image_view(m_logical_device,
+                                                image,
+                                                upload.format,
+                                                VK_IMAGE_ASPECT_COLOR_BIT,
+                                                upload.mip_levels,
+                                                1,
+                                                VK_IMAGE_VIEW_TYPE_2D,
+                                                texture_swizzle(upload.format));
+            if (!view) {
+                vkDestroyImage(m_logical_device, image, nullptr);
+                vkFreeMemory(m_logical_device, memory, nullptr);
+                throw std::runtime_error("Failed to create image view for streamed texture!");
+            }
+            VkSampler sampler;
+            try {
+                sampler = get_texture_sampler(m_physical_device,
+                                              m_logical_device,
+                                              upload.mip_levels,
+                                              m_samplers);
+            } catch (const std::exception&) {
+                vkDestroyImageView(m_logical_device, *view, nullptr);
+                vkDestroyImage(m_logical_device, image, nullptr);
+                vkFreeMemory(m_logical_device, memory, nullptr);
+                throw;
+            }
+            batch.textures.emplace_back(upload.handle,
+                                        std::make_unique<Texture>(image,
+                                                                  memory,
+                                                                  upload.format,
+                                                                  *view,
+                                                                  sampler,
+                                                                  upload.mip_levels,
+                                                                  1,
+                                                                  m_samplers == nullptr));
+        }
+        if (vkEndCommandBuffer(batch.command_buffer) != VK_SUCCESS)
+            throw std::runtime_error("Failed to record texture streaming command buffer!");
+
+        // The fence or timeline point is polled by later updates instead of waiting here.
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &batch.command_buffer;
+        if (m_timeline) {
+            batch.timeline_point = m_timeline->submit(m_graphics_queue, submit_info);
+        } else {
+            VkFenceCreateInfo fence_info{};
+            fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            if (vkCreateFence(m_logical_device, &fence_info, nullptr, &batch.fence) != VK_SUCCESS) {
+                batch.fence = VK_NULL_HANDLE;
+                throw std::runtime_error("Failed to create texture streaming fence!");
+            }
+            if (vkQueueSubmit(m_graphics_queue, 1, &submit_info, batch.fence) != VK_SUCCESS)
+                throw std::runtime_error("Failed to submit texture streaming upload!");
+        }
+    } catch (const std::exception&) {
+        for (auto& [handle, texture]: batch.textures)
+            texture->destroy(m_logical_device);
+        release_batch(batch);
+        for (const auto& upload: uploads)
+            if (upload.image)
+                m_entries[upload.handle].state = State::failed;
+        throw;
+    }
+
+    for (const auto& [handle, texture]: batch.textures)
+        m_entries[handle].state = State::uploading;
+    m_in_flight.push_back(std::move(batch));
+}
+
+Texture& TextureStreamer::texture(const TextureHandle handle)
+{
+    const auto& entry = m_entries.at(handle);
+    return entry.state == State::resident ? *entry.texture : *m_placeholder;
+}
+
+bool TextureStreamer::is_resident(const TextureHandle handle) const
+{
+    return m_entries.at(handle).state == State::resident;
+}
+
+size_t TextureStreamer::pending_count() const
+{
+    return std::count_if(m_entries.begin(), m_entries.end(), [](const auto& entry) {
+        return entry.state == State::queued || entry.state == State::uploading;
+    });
+}
+
+void TextureStreamer::destroy(const VkDevice logical_device)
+{
+    {
+        // Decode tasks that have not started yet find nothing to do.
+        std::lock_guard<std::mutex> lock(m_queues->mutex);
+        m_queues->requests.clear();
+        m_queues->decoded.clear();
+    }
+
+    for (auto& batch: m_in_flight) {
+        if (m_timeline)
+            m_timeline->wait(batch.timeline_point);
+        else
+            vkWaitForFences(logical_device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+        for (auto& [handle, texture]: batch.textures)
+            texture->destroy(logical_device);
+        release_batch(batch);
+    }
+    m_in_flight.clear();
+
+    for (auto& entry: m_entries)
+        if (entry.texture)
+            entry.texture->destroy(logical_device);
+    m_entries.clear();
+
+    if (m_placeholder)
+        m_placeholder->destroy(logical_device);
+    m_placeholder.reset();
+}
+
+}
@@ -0,0 +1,123 @@
+#include "../arc/ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace ArcGraphics {
+
+ThreadPool::ThreadPool(const size_t thread_count)
+{
+    const auto count = std::max<size_t>(thread_count, 1);
+    m_threads.reserve(count);
+    for (size_t i = 0; i < count; i++)
+        m_threads.emplace_back([this] { work(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+    for (auto& thread: m_threads)
+        thread.join();
+}
+
+size_t ThreadPool::thread_count() const noexcept
+{
+    return m_threads.size();
+}
+
+void ThreadPool::enqueue(std::function<void()>&& task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+void ThreadPool::work()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+            if (m_tasks.empty())
+                return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallel_for(const size_t begin,
+                              const size_t end,
+                              const std::function<void(size_t, size_t)>& f,
+                              const size_t min_chunk_size)
+{
+    if (begin >= end)
+        return;
+
+    const size_t count = end - begin;
+    // A few chunks per thread evens out chunks that take longer than others.
+    const size_t wanted_chunks = (m_threads.size() + 1) * 4;
+    const size_t chunk_size = std::max(std::max<size_t>(min_chunk_size, 1),
+                                       (count + wanted_chunks - 1) / wanted_chunks);
+    const size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+
+    if (chunk_count == 1) {
+        f(begin, end);
+        return;
+    }
+
+    struct Shared {
+        std::atomic<size_t> next_chunk{0};
+        std::atomic<size_t> done_chunks{0};
+        std::mutex mutex{};
+        std::condition_variable done{};
+        std::exception_ptr error{};
+    };
+    auto shared = std::make_shared<Shared>();
+
+    // Helpers and the calling thread pull chunks until none are left, so a
+    // helper that starts late simply finds nothing to do.
+    const auto run_chunks = [shared, begin, end, chunk_size, chunk_count, &f] {
+        while (true) {
+            const size_t chunk = shared->next_chunk.fetch_add(1);
+            if (chunk >= chunk_count)
+                return;
+            const size_t chunk_begin = begin + chunk * chunk_size;
+            const size_t chunk_end = std::min(end, chunk_begin + chunk_size);
+            try {
+                f(chunk_begin, chunk_end);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                if (!shared->error)
+                    shared->error = std::current_exception();
+            }
+            if (shared->done_chunks.fetch_add(1) + 1 == chunk_count) {
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                shared->done.notify_all();
+            }
+        }
+    };
+
+    const size_t helpers = std::min(m_threads.size(), chunk_count - 1);
+    for (size_t i = 0; i < helpers; i++)
+        enqueue(run_chunks);
+
+    run_chunks();
+
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->done.wait(lock, [&] { return shared->done_chunks.load() == chunk_count; });
+    if (shared->error)
+        std::rethrow_exception(shared->error);
+}
+
+}
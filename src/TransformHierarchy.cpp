@@ -0,0 +1,278 @@
+#include "../arc/TransformHierarchy.hpp"
+#include "../arc/BasicBuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace ArcGraphics {
+
+void multiply_matrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+    // Column j of the product is the columns of a weighted by column j of b.
+    // a is loaded up front and b[j] is read before out[j] is written, so out may alias either.
+#if defined(__SSE2__)
+    const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+    const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+    const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+    const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+    for (int j = 0; j < 4; j++) {
+        const float* column = &b[j][0];
+        __m128 result = _mm_mul_ps(a0, _mm_set1_ps(column[0]));
+        result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(column[1])));
+        result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(column[2])));
+        result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(column[3])));
+        _mm_storeu_ps(&out[j][0], result);
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t a0 = vld1q_f32(&a[0][0]);
+    const float32x4_t a1 = vld1q_f32(&a[1][0]);
+    const float32x4_t a2 = vld1q_f32(&a[2][0]);
+    const float32x4_t a3 = vld1q_f32(&a[3][0]);
+    for (int j = 0; j < 4; j++) {
+        const float* column = &b[j][0];
+        float32x4_t result = vmulq_n_f32(a0, column[0]);
+        result = vmlaq_n_f32(result, a1, column[1]);
+        result = vmlaq_n_f32(result, a2, column[2]);
+        result = vmlaq_n_f32(result, a3, column[3]);
+        vst1q_f32(&out[j][0], result);
+    }
+#else
+    out = a * b;
+#endif
+}
+
+glm::mat4 compose_transform(const glm::vec3& position,
+                            const glm::quat& rotation,
+                            const glm::vec3& scale)
+{
+    const glm::mat3 basis = glm::mat3_cast(rotation);
+    glm::mat4 transform{};
+    transform[0] = glm::vec4(basis[0] * scale.x, 0.0f);
+    transform[1] = glm::vec4(basis[1] * scale.y, 0.0f);
+    transform[2] = glm::vec4(basis[2] * scale.z, 0.0f);
+    transform[3] = glm::vec4(position, 1.0f);
+    return transform;
+}
+
+/* ===================================================================
+ * TransformHierarchy
+ */
+
+TransformHierarchy::TransformHierarchy(const uint32_t frames_in_flight)
+    : m_frames_in_flight(frames_in_flight)
+    , m_all_frames_mask(static_cast<uint8_t>((1u << frames_in_flight) - 1))
+{
+    if (frames_in_flight == 0 || frames_in_flight > max_frames_in_flight)
+        throw std::invalid_argument("TransformHierarchy supports 1 to 8 frames in flight!");
+}
+
+uint32_t TransformHierarchy::create(const uint32_t parent, const glm::mat4& local)
+{
+    if (parent != no_parent && parent >= m_parents.size())
+        throw std::out_of_range("Parent transform does not exist!");
+    m_parents.push_back(parent);
+    m_locals.push_back(local);
+    m_worlds.push_back(local);
+    m_dirty.push_back(1);
+    m_unwritten.push_back(m_all_frames_mask);
+    m_any_dirty = true;
+    return static_cast<uint32_t>(m_parents.size() - 1);
+}
+
+void TransformHierarchy::set_local(const uint32_t node, const glm::mat4& local)
+{
+    m_locals.at(node) = local;
+    m_dirty[node] = 1;
+    m_any_dirty = true;
+}
+
+void TransformHierarchy::set_local(const uint32_t node,
+                                   const glm::vec3& position,
+                                   const glm::quat& rotation,
+                                   const glm::vec3& scale)
+{
+    set_local(node, compose_transform(position, rotation, scale));
+}
+
+size_t TransformHierarchy::update()
+{
+    if (!m_any_dirty)
+        return 0;
+
+    size_t updated = 0;
+    const size_t count = m_parents.size();
+    for (size_t node = 0; node < count; node++) {
+        const uint32_t parent = m_parents[node];
+        // The parent comes first, so its flag already says whether it was recomputed.
+        if (parent != no_parent)
+            m_dirty[node] |= m_dirty[parent];
+        if (!m_dirty[node])
+            continue;
+
+        if (parent == no_parent)
+            m_worlds[node] = m_locals[node];
+        else
+            multiply_matrices(m_worlds[parent], m_locals[node], m_worlds[node]);
+        m_unwritten[node] = m_all_frames_mask;
+        updated++;
+    }
+    std::fill(m_dirty.begin(), m_dirty.end(), uint8_t(0));
+    m_any_dirty = false;
+    return updated;
+}
+
+size_t TransformHierarchy::write_world_matrices(const uint32_t flight_frame, glm::mat4* destination)
+{
+    if (flight_frame >= m_frames_in_flight)
+        throw std::invalid_argument("Flight frame is beyond the frames of the TransformHierarchy!");
+
+    const uint8_t bit = static_cast<uint8_t>(1u << flight_frame);
+    const size_t count = m_unwritten.size();
+    size_t written = 0;
+    for (size_t node = 0; node < count; node++) {
+        if (!(m_unwritten[node] & bit))
+            continue;
+        // Copy runs of changed nodes at once, the usual case after a subtree moved.
+        size_t end = node + 1;
+        while (end < count && (m_unwritten[end] & bit))
+            end++;
+        memcpy(destination + node, m_worlds.data() + node, (end - node) * sizeof(glm::mat4));
+        for (size_t i = node; i < end; i++)
+            m_unwritten[i] &= static_cast<uint8_t>(~bit);
+        written += end - node;
+        node = end;
+    }
+    return written;
+}
+
+const glm::mat4& TransformHierarchy::local(const uint32_t node) const
+{
+    return m_locals.at(node);
+}
+
+const glm::mat4& TransformHierarchy::world(const uint32_t node) const
+{
+    return m_worlds.at(node);
+}
+
+uint32_t TransformHierarchy::parent(const uint32_t node) const
+{
+    return m_parents.at(node);
+}
+
+const std::vector<glm::mat4>& TransformHierarchy::world_matrices() const
+{
+    return m_worlds;
+}
+
+size_t TransformHierarchy::size() const
+{
+    return m_parents.size();
+}
+
+void TransformHierarchy::reserve(const size_t count)
+{
+    m_parents.reserve(count);
+    m_locals.reserve(count);
+    m_worlds.reserve(count);
+    m_dirty.reserve(count);
+    m_unwritten.reserve(count);
+}
+
+void TransformHierarchy::clear()
+{
+    m_parents.clear();
+    m_locals.clear();
+    m_worlds.clear();
+    m_dirty.clear();
+    m_unwritten.clear();
+    m_any_dirty = false;
+}
+
+/* ===================================================================
+ * TransformBuffer
+ */
+
+TransformBuffer::TransformBuffer(const VkPhysicalDevice& physical_device,
+                                 const VkDevice& logical_device,
+                                 const uint32_t capacity,
+                                 const uint32_t frames_in_flight)
+    : m_capacity(capacity)
+    , m_frames_in_flight(frames_in_flight)
+{
+    if (capacity == 0 || frames_in_flight == 0)
+        throw std::invalid_argument("Transform buffer can not be empty!");
+
+    // 256 is the largest minStorageBufferOffsetAlignment the spec allows.
+    constexpr VkDeviceSize region_alignment = 256;
+    m_region_size = VkDeviceSize(sizeof(glm::mat4)) * capacity;
+    m_region_size = (m_region_size + region_alignment - 1) / region_alignment * region_alignment;
+
+    const VkDeviceSize size = m_region_size * frames_in_flight;
+    VkBufferCreateInfo buffer_info;
+    create_buffer(physical_device,
+                  logical_device,
+                  size,
+                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                  | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                  buffer_info,
+                  m_buffer,
+                  m_memory);
+
+    void* mapping = nullptr;
+    if (vkMapMemory(logical_device, m_memory, 0, size, 0, &mapping) != VK_SUCCESS) {
+        vkDestroyBuffer(logical_device, m_buffer, nullptr);
+        vkFreeMemory(logical_device, m_memory, nullptr);
+        throw std::runtime_error("Failed to map transform buffer!");
+    }
+    m_mapping = static_cast<unsigned char*>(mapping);
+}
+
+size_t TransformBuffer::write(TransformHierarchy& hierarchy, const uint32_t flight_frame)
+{
+    if (flight_frame >= m_frames_in_flight)
+        throw std::invalid_argument("Flight frame is beyond the frames of the transform buffer!");
+    if (hierarchy.size() > m_capacity)
+        throw std::length_error("TransformHierarchy has more nodes than the transform buffer!");
+    auto* region = reinterpret_cast<glm::mat4*>(m_mapping + m_region_size * flight_frame);
+    return hierarchy.write_world_matrices(flight_frame, region);
+}
+
+VkDescriptorBufferInfo TransformBuffer::descriptor_buffer_info(const uint32_t flight_frame) const
+{
+    return {m_buffer, m_region_size * flight_frame, VkDeviceSize(sizeof(glm::mat4)) * m_capacity};
+}
+
+void TransformBuffer::bind(VkCommandBuffer command_buffer,
+                           const uint32_t binding,
+                           const uint32_t flight_frame) const
+{
+    const VkDeviceSize offset = m_region_size * flight_frame;
+    vkCmdBindVertexBuffers(command_buffer, binding, 1, &m_buffer, &offset);
+}
+
+uint32_t TransformBuffer::capacity() const
+{
+    return m_capacity;
+}
+
+void TransformBuffer::destroy(const VkDevice logical_device)
+{
+    if (m_mapping)
+        vkUnmapMemory(logical_device, m_memory);
+    m_mapping = nullptr;
+    vkDestroyBuffer(logical_device, m_buffer, nullptr);
+    vkFreeMemory(logical_device, m_memory, nullptr);
+    m_buffer = VK_NULL_HANDLE;
+    m_memory = VK_NULL_HANDLE;
+}
+
+}
@@ -0,0 +1,258 @@
+/** *******************************************************************
+ * @file main.cpp
+ * @brief Bake shaders, geometry and textures into a single asset archive.
+ *
+ *   arc-pack manifest.txt output.arcpack
+ *
+ * Each line of the manifest adds one asset, paths are relative to the manifest:
+ *
+ *   shader <name> <file.spv>
+ *   texture <name> <file.ktx2|image> [bc1|bc1a|bc3|bc5|raw] [srgb] [nomips]
+ *   geometry <name> plane|cube
+ *   blob <name> <file>
+ *
+ * Geometry is stored as <name>.vertices and <name>.indices. Textures are
+ * block compressed with bc1 unless raw is given, KTX2 files are stored as is.
+ * Empty lines and lines starting with # are ignored.
+ *
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include <arc/AssetArchive.hpp>
+#include <arc/BlockCompression.hpp>
+#include <arc/SimpleGeometry.hpp>
+#include <arc/ThreadPool.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+[[nodiscard]]
+std::optional<VkFormat> parse_format(const std::string& name, const bool srgb)
+{
+    if (name == "bc1")
+        return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    if (name == "bc1a")
+        return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    if (name == "bc3")
+        return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    if (name == "bc5" && !srgb)
+        return VK_FORMAT_BC5_UNORM_BLOCK;
+    return {};
+}
+
+[[nodiscard]]
+std::optional<std::vector<unsigned char>> read_file(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return {};
+    return std::vector<unsigned char>(std::istreambuf_iterator<char>(file),
+                                      std::istreambuf_iterator<char>());
+}
+
+/**
+ * @brief Store image uncompressed, with its mip levels generated on the CPU.
+ * Gray and gray alpha images stay R8 and R8G8 unless they are sRGB, which is only
+ * stored as R8G8B8A8 since the smaller sRGB formats are rarely sampleable.
+ */
+void add_raw_texture(ArcGraphics::ArchiveWriter& writer,
+                     const std::string& name,
+                     const ArcGraphics::Image& image,
+                     const bool srgb,
+                     const bool mipmaps)
+{
+    std::unique_ptr<ArcGraphics::Image> expanded{};
+    const ArcGraphics::Image* source = &image;
+    if ((srgb || image.channels() == 3) && image.channels() != 4) {
+        expanded = ArcGraphics::expand_channels(image, 4);
+        source = expanded.get();
+    }
+
+    VkFormat format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    if (source->channels() == 1)
+        format = VK_FORMAT_R8_UNORM;
+    else if (source->channels() == 2)
+        format = VK_FORMAT_R8G8_UNORM;
+
+    const auto width = static_cast<uint32_t>(source->width());
+    const auto height = static_cast<uint32_t>(source->height());
+    const uint32_t mip_levels = mipmaps ? ArcGraphics::mip_level_count(width, height) : 1;
+    const auto chain = ArcGraphics::generate_mip_chain(*source, mip_levels);
+
+    std::vector<unsigned char> data(source->pixels(), source->pixels() + source->device_size());
+    std::vector<ArcGraphics::CompressedLevel> levels{{0, source->device_size(), width, height}};
+    data.insert(data.end(), chain.pixels.begin(), chain.pixels.end());
+    for (uint32_t level = 1; level < mip_levels; level++) {
+        const uint32_t level_width = std::max(width >> level, 1u);
+        const uint32_t level_height = std::max(height >> level, 1u);
+        levels.push_back({source->device_size() + chain.offsets[level - 1],
+                          VkDeviceSize(level_width) * level_height * source->channels(),
+                          level_width,
+                          level_height});
+    }
+    writer.add_texture(name, format, width, height, levels, data.data());
+}
+
+[[nodiscard]]
+bool add_texture(ArcGraphics::ArchiveWriter& writer,
+                 ArcGraphics::ThreadPool& pool,
+                 const std::string& name,
+                 const std::filesystem::path& path,
+                 const std::vector<std::string>& options)
+{
+    std::string format_name = "bc1";
+    bool srgb = false;
+    bool mipmaps = true;
+    for (const auto& option: options) {
+        if (option == "srgb")
+            srgb = true;
+        else if (option == "nomips")
+            mipmaps = false;
+        else
+            format_name = option;
+    }
+
+    if (path.extension() == ".ktx2") {
+        const auto compressed = ArcGraphics::CompressedImage::load_from_path(path.string());
+        if (!compressed)
+            return false;
+        writer.add_texture(name,
+                           compressed->format(),
+                           compressed->width(),
+                           compressed->height(),
+                           compressed->levels(),
+                           compressed->data());
+        return true;
+    }
+
+    const auto image = ArcGraphics::Image::load_from_path(path.string());
+    if (!image)
+        return false;
+    if (format_name == "raw") {
+        add_raw_texture(writer, name, *image, srgb, mipmaps);
+        return true;
+    }
+
+    const auto format = parse_format(format_name, srgb);
+    if (!format) {
+        std::cout << "Unknown texture format " << format_name << "\n";
+        return false;
+    }
+    const auto compressed = ArcGraphics::compress_image(*image, *format, mipmaps, &pool);
+    writer.add_texture(name,
+                       compressed->format(),
+                       compressed->width(),
+                       compressed->height(),
+                       compressed->levels(),
+                       compressed->data());
+    return true;
+}
+
+[[nodiscard]]
+bool add_geometry(ArcGraphics::ArchiveWriter& writer,
+                  const std::string& name,
+                  const std::string& shape)
+{
+    std::pair<ArcGraphics::VertexBuffer_PosTex::vector_type,
+              ArcGraphics::IndexBuffer::vector_type> geometry{};
+    if (shape == "plane")
+        geometry = ArcGraphics::create_unit_plane();
+    else if (shape == "cube")
+        geometry = ArcGraphics::create_unit_cube();
+    else
+        return false;
+
+    const auto& [vertices, indices] = geometry;
+    writer.add_buffer(name + ".vertices",
+                      ArcGraphics::AssetType::vertices,
+                      vertices.data(),
+                      vertices.size() * sizeof(vertices[0]),
+                      sizeof(vertices[0]));
+    writer.add_buffer(name + ".indices",
+                      ArcGraphics::AssetType::indices,
+                      indices.data(),
+                      indices.size() * sizeof(indices[0]),
+                      sizeof(indices[0]));
+    return true;
+}
+
+void print_usage()
+{
+    std::cout << "usage: arc-pack manifest.txt output.arcpack\n";
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        print_usage();
+        return 1;
+    }
+
+    const std::filesystem::path manifest_path = argv[1];
+    std::ifstream manifest(manifest_path);
+    if (!manifest.is_open()) {
+        std::cout << "Failed to open " << manifest_path.string() << "\n";
+        return 1;
+    }
+    const auto root = manifest_path.parent_path();
+
+    ArcGraphics::ArchiveWriter writer{};
+    ArcGraphics::ThreadPool pool{};
+    std::string line;
+    for (size_t line_number = 1; std::getline(manifest, line); line_number++) {
+        std::istringstream words(line);
+        std::string kind;
+        std::string name;
+        std::string argument;
+        if (!(words >> kind) || kind[0] == '#')
+            continue;
+        words >> name >> argument;
+        std::vector<std::string> options{};
+        for (std::string option; words >> option;)
+            options.push_back(option);
+
+        bool added = false;
+        try {
+            if (name.empty() || argument.empty()) {
+                added = false;
+            } else if (kind == "shader") {
+                const auto bytecode = read_file(root / argument);
+                added = bytecode.has_value();
+                if (added)
+                    writer.add_shader(name, {bytecode->begin(), bytecode->end()});
+            } else if (kind == "texture") {
+                added = add_texture(writer, pool, name, root / argument, options);
+            } else if (kind == "geometry") {
+                added = add_geometry(writer, name, argument);
+            } else if (kind == "blob") {
+                const auto data = read_file(root / argument);
+                added = data.has_value();
+                if (added)
+                    writer.add_blob(name, data->data(), data->size());
+            }
+        } catch (const std::invalid_argument& error) {
+            std::cout << error.what() << "\n";
+            added = false;
+        }
+        if (!added) {
+            std::cout << manifest_path.string() << ":" << line_number
+                      << ": could not add \"" << line << "\"\n";
+            return 1;
+        }
+    }
+
+    if (!writer.write(argv[2])) {
+        std::cout << "Failed to write " << argv[2] << "\n";
+        return 1;
+    }
+    std::cout << argv[2] << ": " << std::filesystem::file_size(argv[2]) << " bytes\n";
+    return 0;
+}
@@ -0,0 +1,95 @@
+/** *******************************************************************
+ * @file main.cpp
+ * @brief Bake JPEG/PNG images into block compressed KTX2 textures.
+ *
+ *   ktx-bake [--format bc1|bc1a|bc3|bc5] [--srgb] [--no-mips] input output.ktx2
+ *
+ * Normal maps should use bc5, which keeps the red and green channels.
+ *
+ * @copyright
+ * Copyright 2024 Thomas Alexgaard Jensen
+ *********************************************************************/
+
+#include <arc/BlockCompression.hpp>
+#include <arc/Texture.hpp>
+#include <arc/ThreadPool.hpp>
+#include <arc/Timing.hpp>
+
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+[[nodiscard]]
+std::optional<VkFormat> parse_format(const std::string& name, const bool srgb)
+{
+    if (name == "bc1")
+        return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    if (name == "bc1a")
+        return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    if (name == "bc3")
+        return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    if (name == "bc5" && !srgb)
+        return VK_FORMAT_BC5_UNORM_BLOCK;
+    return {};
+}
+
+void print_usage()
+{
+    std::cout << "usage: ktx-bake [--format bc1|bc1a|bc3|bc5] [--srgb] [--no-mips]"
+              << " input output.ktx2\n";
+}
+
+int main(int argc, char** argv)
+{
+    std::string format_name = "bc1";
+    bool srgb = false;
+    bool mipmaps = true;
+    std::vector<std::string> paths{};
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc)
+            format_name = argv[++i];
+        else if (arg == "--srgb")
+            srgb = true;
+        else if (arg == "--no-mips")
+            mipmaps = false;
+        else
+            paths.push_back(arg);
+    }
+
+    const auto format = parse_format(format_name, srgb);
+    if (paths.size() != 2 || !format) {
+        print_usage();
+        return 1;
+    }
+
+    ArcGraphics::PhaseTimings timings{};
+    const auto image = ArcGraphics::time_phase(timings, "decode", [&] {
+        return ArcGraphics::Image::load_from_path(paths[0]);
+    });
+    if (!image) {
+        std::cout << "Failed to load " << paths[0] << "\n";
+        return 1;
+    }
+
+    ArcGraphics::ThreadPool pool{};
+    const auto compressed = ArcGraphics::time_phase(timings, "encode", [&] {
+        return ArcGraphics::compress_image(*image, *format, mipmaps, &pool);
+    });
+
+    const bool written = ArcGraphics::time_phase(timings, "write", [&] {
+        return compressed->write_ktx2(paths[1]);
+    });
+    if (!written) {
+        std::cout << "Failed to write " << paths[1] << "\n";
+        return 1;
+    }
+
+    std::cout << paths[1] << ": " << image->width() << "x" << image->height()
+              << ", " << compressed->levels().size() << " levels, "
+              << compressed->device_size() << " bytes (uncompressed "
+              << image->device_size() << " bytes)\n"
+              << ArcGraphics::stringify(timings);
+    return 0;
+}